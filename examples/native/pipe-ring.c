@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include <native/task.h>
+#include <native/pipe.h>
+
+#define RING_SIZE  (256 * 1024)
+#define PIPE_MINOR 0
+
+RT_TASK demo_task;
+
+RT_PIPE demo_pipe;
+
+static volatile int done;
+
+/* NOTE: error handling mostly omitted. */
+
+void demo(void *arg)
+{
+	unsigned long sample[16];
+	unsigned long seq = 0;
+	ssize_t ret;
+
+	rt_task_set_periodic(NULL, TM_NOW, 100000); /* 100 us */
+
+	while (!done) {
+		rt_task_wait_period(NULL);
+		sample[0] = seq++;
+		/* Goes straight to the shared ring. */
+		ret = rt_pipe_write(&demo_pipe, sample, sizeof(sample), P_NORMAL);
+		if (ret == -ENOMEM)
+			continue; /* Ring full, the reader is lagging. */
+	}
+}
+
+void catch_signal(int sig)
+{
+	done = 1;
+}
+
+int main(int argc, char* argv[])
+{
+	unsigned long tail, head, nrecs = 0;
+	struct xnpipe_ring *ring;
+	struct xnpipe_rec *rec;
+	struct pollfd pfd;
+	char *data;
+	int fd;
+
+	signal(SIGTERM, catch_signal);
+	signal(SIGINT, catch_signal);
+
+	mlockall(MCL_CURRENT|MCL_FUTURE);
+
+	rt_pipe_create(&demo_pipe, "ring-demo", PIPE_MINOR, 0);
+
+	fd = open("/dev/rtp0", O_RDWR);
+	if (fd < 0) {
+		perror("open");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Attach a shared ring to the pipe, then map it: the control
+	 * block comes first, followed by the data area.
+	 */
+	if (ioctl(fd, XNPIPEIOC_RING, RING_SIZE)) {
+		perror("ioctl");
+		exit(EXIT_FAILURE);
+	}
+
+	ring = mmap(NULL, getpagesize() + RING_SIZE, PROT_READ|PROT_WRITE,
+		    MAP_SHARED, fd, 0);
+	if (ring == MAP_FAILED) {
+		perror("mmap");
+		exit(EXIT_FAILURE);
+	}
+
+	data = (char *)ring + ring->offset;
+
+	/* Only wake up when a quarter of the ring is filled. */
+	ioctl(fd, XNPIPEIOC_SETWM, RING_SIZE / 4);
+
+	rt_task_create(&demo_task, "ring-writer", 0, 99, 0);
+	rt_task_start(&demo_task, &demo, NULL);
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	while (!done) {
+		if (poll(&pfd, 1, 1000) <= 0)
+			continue;
+
+		tail = ring->tail;
+		head = ring->head;
+		__sync_synchronize();
+
+		/* Consume all available records in place. */
+		while (tail != head) {
+			rec = (struct xnpipe_rec *)(data + (tail & (ring->size - 1)));
+			if ((rec->flags & XNPIPE_REC_PAD) == 0)
+				nrecs++;
+			tail += xnpipe_rec_len(rec->size);
+		}
+
+		__sync_synchronize();
+		ring->tail = tail;
+
+		printf("%lu records received\n", nrecs);
+	}
+
+	rt_task_delete(&demo_task);
+	munmap(ring, getpagesize() + RING_SIZE);
+	close(fd);
+	rt_pipe_delete(&demo_pipe);
+
+	return 0;
+}
@@ -0,0 +1,231 @@
+/*
+ * PSDP-based publish/subscribe demo, using the write(2)/recvfrom(2)
+ * system calls to broadcast a state vector to several readers.
+ *
+ * In this example, a publisher thread binds a socket to a labeled
+ * real-time port, which creates a topic. Several subscriber threads
+ * connect to this topic by label, then receive every state vector
+ * the publisher writes. The vector is copied once into a buffer
+ * shared by all subscribers, regardless of their number.
+ *
+ * The last subscriber is deliberately slow: since its input ring
+ * only holds a few messages, it misses some of them, which it
+ * detects by reading the PSDP_OVERRUNS counter.
+ *
+ * See Makefile in this directory for build directives.
+ */
+#include <sys/mman.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <rtdk.h>
+#include <rtdm/rtipc.h>
+
+#define NR_SUBSCRIBERS  4
+
+#define STATE_SIZE  4096
+
+#define PSDP_TOPIC_LABEL  "psdp-demo"
+
+pthread_t pubtid, subtid[NR_SUBSCRIBERS];
+
+static void fail(const char *reason)
+{
+	perror(reason);
+	exit(EXIT_FAILURE);
+}
+
+static void *publisher(void *arg)
+{
+	struct rtipc_port_label plabel;
+	struct sockaddr_ipc saddr;
+	static char state[STATE_SIZE];
+	unsigned long count = 0;
+	struct timespec ts;
+	size_t poolsz;
+	int ret, s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_PSDP);
+	if (s < 0)
+		fail("socket");
+
+	/*
+	 * Reserve a local pool large enough for every subscriber
+	 * ring to be full of distinct messages, plus some slack.
+	 */
+	poolsz = 64 * (STATE_SIZE + 64);
+	ret = setsockopt(s, SOL_PSDP, PSDP_POOLSZ, &poolsz, sizeof(poolsz));
+	if (ret)
+		fail("setsockopt");
+
+	strcpy(plabel.label, PSDP_TOPIC_LABEL);
+	ret = setsockopt(s, SOL_PSDP, PSDP_LABEL,
+			 &plabel, sizeof(plabel));
+	if (ret)
+		fail("setsockopt");
+
+	/*
+	 * Publish the topic. Labeled topics will appear in the
+	 * /proc/xenomai/registry/rtipc/psdp directory once the
+	 * socket is bound.
+	 */
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;	/* Pick next free */
+	ret = bind(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		fail("bind");
+
+	for (;;) {
+		memset(state, count & 0xff, sizeof(state));
+		memcpy(state, &count, sizeof(count));
+		/* One write, whatever the number of subscribers. */
+		ret = write(s, state, sizeof(state));
+		if (ret < 0) {
+			close(s);
+			fail("write");
+		}
+		count++;
+		/*
+		 * We run in full real-time mode (i.e. primary mode),
+		 * so we have to let the system breathe between two
+		 * iterations.
+		 */
+		ts.tv_sec = 0;
+		ts.tv_nsec = 100000000; /* 100 ms */
+		clock_nanosleep(CLOCK_REALTIME, 0, &ts, NULL);
+	}
+
+	return NULL;
+}
+
+static void *subscriber(void *arg)
+{
+	struct rtipc_port_label plabel;
+	struct sockaddr_ipc saddr;
+	static char states[NR_SUBSCRIBERS][STATE_SIZE];
+	long n = (long)arg;
+	char *state = states[n];
+	unsigned long seq, overruns;
+	int ret, s, depth, slow;
+	struct timespec ts;
+	socklen_t optlen;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_PSDP);
+	if (s < 0)
+		fail("socket");
+
+	/* The slow subscriber keeps a short ring. */
+	slow = n == NR_SUBSCRIBERS - 1;
+	depth = slow ? 2 : 16;
+	ret = setsockopt(s, SOL_PSDP, PSDP_DEPTH, &depth, sizeof(depth));
+	if (ret)
+		fail("setsockopt");
+
+	strcpy(plabel.label, PSDP_TOPIC_LABEL);
+	ret = setsockopt(s, SOL_PSDP, PSDP_LABEL,
+			 &plabel, sizeof(plabel));
+	if (ret)
+		fail("setsockopt");
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;	/* Tell PSDP to search by label. */
+	ret = connect(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		fail("connect");
+
+	for (;;) {
+		ret = read(s, state, STATE_SIZE);
+		if (ret < 0) {
+			close(s);
+			fail("read");
+		}
+		memcpy(&seq, state, sizeof(seq));
+		optlen = sizeof(overruns);
+		ret = getsockopt(s, SOL_PSDP, PSDP_OVERRUNS,
+				 &overruns, &optlen);
+		if (ret)
+			fail("getsockopt");
+		rt_printf("%s[%ld]: received state #%lu, %lu overrun(s)\n",
+			  __FUNCTION__, n, seq, overruns);
+		if (slow) {
+			ts.tv_sec = 0;
+			ts.tv_nsec = 350000000; /* 350 ms */
+			clock_nanosleep(CLOCK_REALTIME, 0, &ts, NULL);
+		}
+	}
+
+	return NULL;
+}
+
+static void cleanup_upon_sig(int sig)
+{
+	int n;
+
+	pthread_cancel(pubtid);
+	for (n = 0; n < NR_SUBSCRIBERS; n++)
+		pthread_cancel(subtid[n]);
+	signal(sig, SIG_DFL);
+	pthread_join(pubtid, NULL);
+	for (n = 0; n < NR_SUBSCRIBERS; n++)
+		pthread_join(subtid[n], NULL);
+}
+
+int main(int argc, char **argv)
+{
+	struct sched_param pubparam = {.sched_priority = 70 };
+	struct sched_param subparam = {.sched_priority = 71 };
+	pthread_attr_t pubattr, subattr;
+	sigset_t mask, oldmask;
+	long n;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGINT);
+	signal(SIGINT, cleanup_upon_sig);
+	sigaddset(&mask, SIGTERM);
+	signal(SIGTERM, cleanup_upon_sig);
+	sigaddset(&mask, SIGHUP);
+	signal(SIGHUP, cleanup_upon_sig);
+	pthread_sigmask(SIG_BLOCK, &mask, &oldmask);
+
+	/*
+	 * This is a real-time compatible printf() package from
+	 * Xenomai's RT Development Kit (RTDK), that does NOT cause
+	 * any transition to secondary mode.
+	 */
+	rt_print_auto_init(1);
+
+	pthread_attr_init(&subattr);
+	pthread_attr_setdetachstate(&subattr, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_setinheritsched(&subattr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&subattr, SCHED_FIFO);
+	pthread_attr_setschedparam(&subattr, &subparam);
+
+	/* Subscribers wait for the topic to be published. */
+	for (n = 0; n < NR_SUBSCRIBERS; n++) {
+		errno = pthread_create(&subtid[n], &subattr,
+				       &subscriber, (void *)n);
+		if (errno)
+			fail("pthread_create");
+	}
+
+	pthread_attr_init(&pubattr);
+	pthread_attr_setdetachstate(&pubattr, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_setinheritsched(&pubattr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&pubattr, SCHED_FIFO);
+	pthread_attr_setschedparam(&pubattr, &pubparam);
+
+	errno = pthread_create(&pubtid, &pubattr, &publisher, NULL);
+	if (errno)
+		fail("pthread_create");
+
+	sigsuspend(&oldmask);
+
+	return 0;
+}
@@ -130,6 +130,12 @@ int a4l_snd_insnlist(a4l_desc_t *dsc, a4l_insnlst_t *arg);
 
 int a4l_snd_insn(a4l_desc_t *dsc, a4l_insn_t *arg);
 
+int a4l_prep_insnlist(a4l_desc_t *dsc, a4l_insnprep_t *arg);
+
+int a4l_exec_insnlist(a4l_desc_t *dsc, a4l_insnprep_t *arg);
+
+int a4l_free_insnlist(a4l_desc_t *dsc, a4l_insnprep_t *arg);
+
 /* --- Level 2 API (supposed to be used) --- */
 
 int a4l_sync_write(a4l_desc_t *dsc,
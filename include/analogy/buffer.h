@@ -94,6 +94,16 @@ struct a4l_buffer {
 };
 typedef struct a4l_buffer a4l_buf_t;
 
+/* Contiguous windows of the buffer handed out by
+   a4l_buf_reserve_put() and a4l_buf_reserve_get(); the second window
+   is only used when the reserved area wraps around the end of the
+   buffer */
+struct a4l_buffer_span {
+	void *ptr[2];
+	unsigned long size[2];
+};
+typedef struct a4l_buffer_span a4l_buf_span_t;
+
 /* --- Static inline functions related with
    user<->kernel data transfers --- */
 
@@ -187,6 +197,26 @@ static inline void __munge(struct a4l_subdevice * subd,
 	}
 }
 
+/* The function __span is an inline function which splits the area
+   starting at the counter value start and spreading over count bytes
+   into at most two contiguous windows within the buffer */
+static inline void __span(a4l_buf_t * buf, unsigned long start,
+			  unsigned long count, a4l_buf_span_t * span)
+{
+	unsigned long start_ptr = (start % buf->size);
+
+	span->ptr[0] = buf->buf + start_ptr;
+	if (start_ptr + count > buf->size) {
+		span->size[0] = buf->size - start_ptr;
+		span->ptr[1] = buf->buf;
+		span->size[1] = count - span->size[0];
+	} else {
+		span->size[0] = count;
+		span->ptr[1] = NULL;
+		span->size[1] = 0;
+	}
+}
+
 /* The function __handle_event can only be called from process context
    (not interrupt service routine). It allows the client process to
    retrieve the buffer status which has been updated by the driver */
@@ -414,6 +444,9 @@ int a4l_buf_commit_put(struct a4l_subdevice *subd,
 int a4l_buf_put(struct a4l_subdevice *subd,
 		void *bufdata, unsigned long count);
 
+int a4l_buf_reserve_put(struct a4l_subdevice *subd,
+			unsigned long count, a4l_buf_span_t *span);
+
 int a4l_buf_prepare_absget(struct a4l_subdevice *subd,
 			   unsigned long count);
 
@@ -429,6 +462,9 @@ int a4l_buf_commit_get(struct a4l_subdevice *subd,
 int a4l_buf_get(struct a4l_subdevice *subd,
 		void *bufdata, unsigned long count);
 
+int a4l_buf_reserve_get(struct a4l_subdevice *subd,
+			unsigned long count, a4l_buf_span_t *span);
+
 int a4l_buf_evt(struct a4l_subdevice *subd, unsigned long evts);
 
 unsigned long a4l_buf_count(struct a4l_subdevice *subd);
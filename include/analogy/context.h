@@ -29,6 +29,10 @@
 
 struct a4l_device;
 struct a4l_buffer;
+struct a4l_kernel_prepared_list;
+
+/* Prepared instruction lists count per context */
+#define A4L_NB_PREPARED_LISTS 8
 
 struct a4l_device_context {
 
@@ -43,6 +47,9 @@ struct a4l_device_context {
 	   from asynchronous acquisition operations on a specific
 	   subdevice */
 	struct a4l_buffer *buffer;
+
+	/* Instruction lists prepared through this context */
+	struct a4l_kernel_prepared_list *preps[A4L_NB_PREPARED_LISTS];
 };
 typedef struct a4l_device_context a4l_cxt_t;
 
@@ -193,6 +193,31 @@ struct a4l_instruction_list {
 };
 typedef struct a4l_instruction_list a4l_insnlst_t;
 
+/**
+ * Largest data size of an instruction in a prepared list
+ */
+#define A4L_PREPARED_DATA_MAX (64 * 1024)
+
+/*!
+ * @brief Structure describing a prepared list of synchronous
+ * instructions
+ * @see a4l_prep_insnlist()
+ */
+
+struct a4l_prepared_instruction_list {
+	unsigned int count;
+			/**< Instructions count */
+	a4l_insn_t *insns;
+			  /**< Tab containing the instructions */
+	unsigned int id;
+		     /**< List identifier, set by the preparation */
+	void *data;
+		    /**< Mapped data area, set by the preparation */
+	unsigned long data_size;
+			     /**< Size of the mapped data area */
+};
+typedef struct a4l_prepared_instruction_list a4l_insnprep_t;
+
 	  /*! @} sync1_lib */
 
 #if defined(__KERNEL__) && !defined(DOXYGEN_CPP)
@@ -214,11 +239,40 @@ struct a4l_kernel_instruction_list {
 };
 typedef struct a4l_kernel_instruction_list a4l_kilst_t;
 
+/* Largest instructions count in a prepared list */
+#define A4L_PREPARED_INSNS_MAX 256
+
+struct a4l_kernel_prepared_instruction {
+	a4l_kinsn_t insn;
+	/* Resolved at preparation time, NULL for special instructions */
+	struct a4l_subdevice *subd;
+	int (*hdlr) (struct a4l_subdevice *, a4l_kinsn_t *);
+};
+typedef struct a4l_kernel_prepared_instruction a4l_kpinsn_t;
+
+struct a4l_kernel_prepared_list {
+	unsigned int count;
+	a4l_kpinsn_t *insns;
+	/* Data area shared with user space */
+	void *data;
+	unsigned long data_size;
+	/* Held by the context and by the user mapping */
+	atomic_t refs;
+	/* Set while the list is being executed */
+	int busy;
+};
+typedef struct a4l_kernel_prepared_list a4l_kplst_t;
+
 /* Instruction related functions */
 
+void a4l_release_insnpreps(a4l_cxt_t * cxt);
+
 /* Upper layer functions */
 int a4l_ioctl_insnlist(a4l_cxt_t * cxt, void *arg);
 int a4l_ioctl_insn(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_insnprep(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_insnexec(a4l_cxt_t * cxt, void *arg);
+int a4l_ioctl_insnrls(a4l_cxt_t * cxt, void *arg);
 
 #endif /* __KERNEL__ && !DOXYGEN_CPP */
 
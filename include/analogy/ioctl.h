@@ -29,7 +29,7 @@
 
 #include <rtdm/rtdm_driver.h>
 
-#define NB_IOCTL_FUNCTIONS 17
+#define NB_IOCTL_FUNCTIONS 20
 
 #endif /* __KERNEL__ */
 
@@ -57,6 +57,10 @@
 #define A4L_BUFCFG2 _IOR(CIO,15,a4l_bufcfg_t)
 #define A4L_BUFINFO2 _IOWR(CIO,16,a4l_bufcfg_t)
 
+#define A4L_INSNPREP _IOWR(CIO,17,a4l_insnprep_t)
+#define A4L_INSNEXEC _IOR(CIO,18,unsigned int)
+#define A4L_INSNRLS _IOR(CIO,19,unsigned int)
+
 #endif /* !DOXYGEN_CPP */
 
 #endif /* __ANALOGY_IOCTL__ */
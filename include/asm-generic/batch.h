@@ -0,0 +1,63 @@
+#ifndef _XENO_ASM_GENERIC_BATCH_H
+#define _XENO_ASM_GENERIC_BATCH_H
+
+#include <asm/xenomai/syscall.h>
+
+/*
+ * Per-thread batches of skin calls. Calls are queued by the
+ * XENOMAI_BATCH_SKINCALLn() macros, which take the same arguments as
+ * their XENOMAI_SKINCALLn() counterparts and return the address of
+ * the slot receiving the call status, or NULL if the batch is full
+ * (XNSYS_BATCH_MAX calls). xeno_batch_submit() then issues the whole
+ * batch in a single trip to primary mode, the nucleus rescheduling
+ * only once after the last call, and returns the number of calls
+ * processed, or a negative error code.
+ *
+ * Calls which did not run because a signal interrupted the batch get
+ * -EINTR. Calls following one which switched the caller to secondary
+ * mode do not run either, and get -EAGAIN; they may be queued again
+ * for another batch. This happens to non real-time threads after
+ * each call which leaves them holding no resource, as it would
+ * outside of a batch. Calls which must run from, or switch back
+ * from, secondary mode cannot be batched, and get -EPERM. Status
+ * slots are valid until the next call is queued.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+long *__xeno_batch_add(unsigned long muxcode,
+		       unsigned long a1, unsigned long a2, unsigned long a3,
+		       unsigned long a4, unsigned long a5);
+
+int xeno_batch_submit(void);
+
+void xeno_batch_discard(void);
+
+int xeno_batch_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#define __XENO_BATCH(id, op, a1, a2, a3, a4, a5)			\
+	__xeno_batch_add(__xn_mux_code(id, op),				\
+			 (unsigned long)(a1), (unsigned long)(a2),	\
+			 (unsigned long)(a3), (unsigned long)(a4),	\
+			 (unsigned long)(a5))
+
+#define XENOMAI_BATCH_SKINCALL0(id, op) \
+	__XENO_BATCH(id, op, 0, 0, 0, 0, 0)
+#define XENOMAI_BATCH_SKINCALL1(id, op, a1) \
+	__XENO_BATCH(id, op, a1, 0, 0, 0, 0)
+#define XENOMAI_BATCH_SKINCALL2(id, op, a1, a2) \
+	__XENO_BATCH(id, op, a1, a2, 0, 0, 0)
+#define XENOMAI_BATCH_SKINCALL3(id, op, a1, a2, a3) \
+	__XENO_BATCH(id, op, a1, a2, a3, 0, 0)
+#define XENOMAI_BATCH_SKINCALL4(id, op, a1, a2, a3, a4) \
+	__XENO_BATCH(id, op, a1, a2, a3, a4, 0)
+#define XENOMAI_BATCH_SKINCALL5(id, op, a1, a2, a3, a4, a5) \
+	__XENO_BATCH(id, op, a1, a2, a3, a4, a5)
+
+#endif /* _XENO_ASM_GENERIC_BATCH_H */
@@ -28,6 +28,11 @@ static inline unsigned long xeno_get_current_mode(void)
 	return xeno_current_mode ? *xeno_current_mode : XNRELAX;
 }
 
+static inline struct xnthread_user_window *xeno_get_current_window(void)
+{
+	return (struct xnthread_user_window *)xeno_current_mode;
+}
+
 #else /* ! HAVE___THREAD */
 extern pthread_key_t xeno_current_key;
 
@@ -59,6 +64,11 @@ static inline unsigned long xeno_get_current_mode(void)
 	return mode ? *mode : XNRELAX;
 }
 
+static inline struct xnthread_user_window *xeno_get_current_window(void)
+{
+	return pthread_getspecific(xeno_current_mode_key);
+}
+
 #endif /* ! HAVE___THREAD */
 
 void xeno_init_current_keys(void);
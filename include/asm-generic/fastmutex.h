@@ -0,0 +1,53 @@
+#ifndef _XENO_ASM_GENERIC_FASTMUTEX_H
+#define _XENO_ASM_GENERIC_FASTMUTEX_H
+
+#include <asm/xenomai/atomic.h>
+#include <nucleus/types.h>
+#include <nucleus/thread.h>
+#include <nucleus/synch.h>
+#include <asm-generic/current.h>
+#include <asm-generic/sem_heap.h>
+
+#ifdef CONFIG_XENO_FASTSYNCH
+
+/*
+ * Adaptive mutexes. The fast lock word of native and POSIX mutexes
+ * is the first member of a struct xnsynch_fastmutex, which also
+ * records the user window of the current owner. When the fast path
+ * fails, xeno_fastmutex_spin() polls the lock word for a while
+ * instead of entering the kernel, as long as the owner runs in
+ * primary mode on another CPU and nobody sleeps on the mutex
+ * already. Skins must call xeno_fastmutex_set_owner() once they got
+ * the mutex, by any means, and xeno_fastmutex_clear_owner() before
+ * releasing it.
+ */
+
+static inline void xeno_fastmutex_set_owner(struct xnsynch_fastmutex *fm)
+{
+	if (fm->adaptive)
+		xnarch_atomic_set(&fm->owner_window,
+				  (unsigned long)xeno_get_current_window()
+				  - xeno_sem_heap[0]);
+}
+
+static inline void xeno_fastmutex_clear_owner(struct xnsynch_fastmutex *fm)
+{
+	if (fm->adaptive)
+		xnarch_atomic_set(&fm->owner_window, XNSYNCH_NO_WINDOW);
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void xeno_fastmutex_count(xnarch_atomic_t *counter);
+
+int xeno_fastmutex_spin(struct xnsynch_fastmutex *fm, xnhandle_t cur);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+#endif /* _XENO_ASM_GENERIC_FASTMUTEX_H */
@@ -0,0 +1,67 @@
+#ifndef _XENO_ASM_GENERIC_POOL_H
+#define _XENO_ASM_GENERIC_POOL_H
+
+#include <asm/xenomai/atomic.h>
+#include <nucleus/types.h>
+
+/*
+ * Pools of pre-spawned shadow threads. Skins create the pool threads
+ * their own way, each of them running xeno_pool_worker() once
+ * mapped, which pre-faults its stack then parks it in the nucleus.
+ * xeno_pool_dispatch() then hands a routine over to an idle worker
+ * and moves it to the requested priority, all in a single call
+ * (__xn_sys_unpark), instead of paying for a Linux clone and a
+ * shadow mapping each time. Callers which need to attach their own
+ * data to the worker first may split this into xeno_pool_claim() and
+ * xeno_pool_activate().
+ *
+ * The worker goes back to the pool when the routine returns, keeping
+ * the priority of its last job until the next dispatch.
+ */
+
+#define XENO_POOL_STARTING	0
+#define XENO_POOL_IDLE		1
+#define XENO_POOL_BUSY		2
+#define XENO_POOL_EXIT		3
+
+struct xeno_pool_worker {
+	xnarch_atomic_t state;
+	xnhandle_t handle;
+	void (*entry)(void *cookie);
+	void *cookie;
+};
+
+struct xeno_pool {
+	unsigned nr;
+	unsigned long prefault;	/* Stack bytes to touch at startup. */
+	xnarch_atomic_t next;	/* Where to start looking for an idle worker. */
+	struct xeno_pool_worker *workers;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int xeno_pool_init(struct xeno_pool *pool, unsigned nr, unsigned stksize);
+
+void xeno_pool_worker(struct xeno_pool *pool, unsigned n);
+
+int xeno_pool_wait_ready(struct xeno_pool *pool);
+
+int xeno_pool_claim(struct xeno_pool *pool);
+
+int xeno_pool_activate(struct xeno_pool *pool, unsigned n, int prio,
+		       void (*entry)(void *cookie), void *cookie);
+
+int xeno_pool_dispatch(struct xeno_pool *pool, int prio,
+		       void (*entry)(void *cookie), void *cookie);
+
+void xeno_pool_shutdown(struct xeno_pool *pool);
+
+void xeno_pool_destroy(struct xeno_pool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _XENO_ASM_GENERIC_POOL_H */
@@ -36,6 +36,9 @@
 #define __xn_sys_current	8	/* threadh = xnthread_handle(cur) */
 #define __xn_sys_current_info	9	/* r = xnshadow_current_info(&info) */
 #define __xn_sys_mayday        10	/* request mayday fixup */
+#define __xn_sys_batch		11	/* n = xnshadow_sys_batch(&entries[], nr) */
+#define __xn_sys_park		12	/* r = xnshadow_sys_park() */
+#define __xn_sys_unpark		13	/* r = xnshadow_sys_unpark(threadh, prio) */
 
 #define XENOMAI_LINUX_DOMAIN  0
 #define XENOMAI_XENO_DOMAIN   1
@@ -46,6 +49,15 @@ typedef struct xnsysinfo {
 	unsigned long vdso;  		/* Offset of nkvdso in the sem heap */
 } xnsysinfo_t;
 
+/* Maximum number of calls in a single __xn_sys_batch request. */
+#define XNSYS_BATCH_MAX  32
+
+struct xnsys_batch_entry {
+	unsigned long muxcode;		/* __xn_mux_code(shifted_id, op) */
+	unsigned long args[5];
+	long result;			/* Return value of the call */
+};
+
 #define SIGSHADOW  SIGWINCH
 #define SIGSHADOW_ACTION_HARDEN   1
 #define SIGSHADOW_ACTION_RENICE   2
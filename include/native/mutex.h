@@ -41,6 +41,12 @@ typedef struct rt_mutex_info {
 	char owner[XNOBJECT_NAME_LEN]; /**< Symbolic name of the current owner,
 					    empty if unlocked. */
 
+	unsigned long contended; /**< Number of contended acquisitions. */
+
+	unsigned long spun;	/**< Contended acquisitions served by spinning. */
+
+	unsigned long slow;	/**< Contended acquisitions served by sleeping. */
+
 } RT_MUTEX_INFO;
 
 typedef struct rt_mutex_placeholder {
@@ -167,6 +173,9 @@ int rt_mutex_release(RT_MUTEX *mutex);
 int rt_mutex_inquire(RT_MUTEX *mutex,
 		     RT_MUTEX_INFO *info);
 
+int rt_mutex_set_adaptive(RT_MUTEX *mutex,
+			  int adaptive);
+
 #ifdef __cplusplus
 }
 #endif
@@ -128,6 +128,8 @@
 #define __native_buffer_inquire     102
 #define __native_queue_flush        103
 #define __native_cond_wait_epilogue 104
+#define __native_alarm_set_slack    105
+#define __native_task_reply_receive 106
 
 struct rt_arg_bulk {
 
@@ -139,6 +141,11 @@ struct rt_arg_bulk {
 	u_long a6;
 };
 
+#if !defined(__KERNEL__) && !defined(__XENO_SIM__)
+/* Shifted skin id, e.g. for XENOMAI_BATCH_SKINCALLn(). */
+extern int __native_muxid;
+#endif /* !__KERNEL__ && !__XENO_SIM__ */
+
 #if defined (__KERNEL__) || defined(__XENO_SIM__)
 
 #ifdef __cplusplus
@@ -97,6 +97,8 @@ typedef struct rt_task_info {
 
     int pagefaults; /**< Number of triggered page faults. */
 
+    struct xnthread_relstat relstat; /**< Release statistics of periodic tasks. @see rt_task_wait_period() */
+
 } RT_TASK_INFO;
 
 #define RT_MCB_FSTORE_LIMIT  64
@@ -237,6 +239,27 @@ static inline int rt_task_unbind (RT_TASK *task)
 
 int rt_task_join(RT_TASK *task);
 
+/** Pool of pre-spawned tasks.
+  @see rt_task_pool_create(), rt_task_spawn_from_pool()
+*/
+typedef struct rt_task_pool {
+    void *opaque;
+} RT_TASK_POOL;
+
+int rt_task_pool_create(RT_TASK_POOL *pool,
+			const char *name,
+			int nr,
+			int stksize,
+			int mode);
+
+int rt_task_spawn_from_pool(RT_TASK_POOL *pool,
+			    RT_TASK **taskp,
+			    int prio,
+			    void (*entry)(void *cookie),
+			    void *cookie);
+
+int rt_task_pool_delete(RT_TASK_POOL *pool);
+
 #ifdef __cplusplus
 }
 #endif
@@ -308,6 +331,11 @@ int rt_task_receive(RT_TASK_MCB *mcb_r,
 int rt_task_reply(int flowid,
 		  RT_TASK_MCB *mcb_s);
 
+int rt_task_reply_receive(int flowid,
+			  RT_TASK_MCB *mcb_s,
+			  RT_TASK_MCB *mcb_r,
+			  RTIME timeout);
+
 static inline int rt_task_spawn(RT_TASK *task,
 				const char *name,
 				int stksize,
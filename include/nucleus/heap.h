@@ -42,6 +42,10 @@
  * list. So we need a bucket for each power of two between
  * XNHEAP_MINLOG2 and XNHEAP_MAXLOG2 inclusive, plus one to honor
  * requests ranging from the maximum page size to twice this size.
+ *
+ * With CONFIG_XENO_OPT_HEAP_TLSF, the page map is replaced by a
+ * two-level segregated fit index (see below), and the constraints
+ * above regarding block sizes do not apply anymore.
  */
 
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
@@ -63,6 +67,52 @@
 
 #define XNHEAP_GFP_NONCACHED (1 << __GFP_BITS_SHIFT)
 
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+
+/*
+ * Two-level segregated fit (TLSF) layout. Each extent is carved into
+ * physically contiguous blocks, every block starting with a
+ * XNHEAP_TLSF_HDRSZ header. Free blocks are indexed by a first level
+ * (the power of two range their size falls in), then by a second
+ * level (one of the XNHEAP_TLSF_SLI linear subdivisions of that
+ * range), both levels being tracked by bitmaps. This gives constant
+ * time allocation and release, with a worst-case internal
+ * fragmentation of 1 / XNHEAP_TLSF_SLI. Blocks smaller than
+ * XNHEAP_TLSF_SMALLSZ are indexed by exact size in the first row.
+ *
+ * The index itself lives in the header of the initial extent, in
+ * place of the page map.
+ */
+#define XNHEAP_TLSF_SLLOG2	5
+#define XNHEAP_TLSF_SLI		(1 << XNHEAP_TLSF_SLLOG2)
+#define XNHEAP_TLSF_ALIGNLOG2	4 /* i.e. XNHEAP_MINALIGNSZ */
+#define XNHEAP_TLSF_FLSHIFT	(XNHEAP_TLSF_SLLOG2 + XNHEAP_TLSF_ALIGNLOG2)
+#define XNHEAP_TLSF_SMALLSZ	(1 << XNHEAP_TLSF_FLSHIFT)
+#define XNHEAP_TLSF_HDRSZ	(1 << XNHEAP_TLSF_ALIGNLOG2)
+#define XNHEAP_TLSF_MINBLKSZ	(2 * XNHEAP_TLSF_HDRSZ)
+#define XNHEAP_TLSF_FREE	0x1 /* In xntlsf_block::size */
+
+struct xntlsf_block {
+	struct xntlsf_block *prev_phys;
+	u_long size;		/* Including the header, plus flags. */
+	/* Free blocks only. */
+	struct xntlsf_block *next_free;
+	struct xntlsf_block *prev_free;
+};
+
+struct xntlsf_row {
+	u_long sl_bitmap;
+	struct xntlsf_block *free[XNHEAP_TLSF_SLI];
+};
+
+struct xntlsf {
+	u_long fl_bitmap;
+	int fl_count;
+	struct xntlsf_row rows[0];
+};
+
+#endif /* CONFIG_XENO_OPT_HEAP_TLSF */
+
 struct xnpagemap {
 	unsigned int type : 8;	  /* PFREE, PCONT, PLIST or log2 */
 	unsigned int bcount : 24; /* Number of active blocks. */
@@ -100,10 +150,14 @@ typedef struct xnheap {
 
 	DECLARE_XNLOCK(lock);
 
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+	struct xntlsf *tlsf;
+#else /* !CONFIG_XENO_OPT_HEAP_TLSF */
 	struct xnbucket {
 		caddr_t freelist;
 		int fcount;
 	} buckets[XNHEAP_NBUCKETS];
+#endif /* !CONFIG_XENO_OPT_HEAP_TLSF */
 
 	xnholder_t *idleq[XNARCH_NR_CPUS];
 
@@ -136,6 +190,60 @@ static inline size_t xnheap_align(size_t size, size_t al)
 	return ((size+al-1)&(~(al-1)));
 }
 
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+
+/* Size of the TLSF index for an extent of hsize bytes. */
+static inline size_t xnheap_tlsf_size(size_t hsize)
+{
+	int msb, rows = 1;
+
+	if (hsize >= XNHEAP_TLSF_SMALLSZ) {
+		for (msb = 0; hsize > 1; hsize >>= 1)
+			msb++;
+		rows = msb - XNHEAP_TLSF_FLSHIFT + 2;
+	}
+
+	return xnheap_align(sizeof(struct xntlsf)
+			    + rows * sizeof(struct xntlsf_row),
+			    XNHEAP_MINALIGNSZ);
+}
+
+/*
+ * The extent header holds the static part of the extent descriptor,
+ * the TLSF index and the header of the first block, so that the
+ * first block returned by an empty heap is page-aligned.
+ */
+static inline size_t xnheap_internal_overhead(size_t hsize, size_t psize)
+{
+	if (psize < XNHEAP_MINALIGNSZ)
+		psize = XNHEAP_MINALIGNSZ;
+
+	return xnheap_align(xnheap_align(sizeof(xnextent_t), XNHEAP_MINALIGNSZ)
+			    + xnheap_tlsf_size(hsize) + XNHEAP_TLSF_HDRSZ,
+			    psize);
+}
+
+static inline size_t xnheap_external_overhead(size_t hsize, size_t psize)
+{
+	size_t o, n;
+
+	/*
+	 * Account for the extent header and the trailing sentinel
+	 * block. The index grows with the extent size, so iterate
+	 * until the overhead covers the index of the final extent.
+	 */
+	n = xnheap_internal_overhead(hsize, psize) + XNHEAP_TLSF_HDRSZ;
+	do {
+		o = n;
+		n = xnheap_internal_overhead(hsize + o + psize, psize)
+			+ XNHEAP_TLSF_HDRSZ;
+	} while (n > o);
+
+	return o;
+}
+
+#else /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 static inline size_t xnheap_external_overhead(size_t hsize, size_t psize)
 {
 	size_t pages = (hsize + psize - 1) / psize;
@@ -155,6 +263,8 @@ static inline size_t xnheap_internal_overhead(size_t hsize, size_t psize)
 			    / (psize + sizeof(struct xnpagemap)), psize);
 }
 
+#endif /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 #define xnmalloc(size)     xnheap_alloc(&kheap,size)
 #define xnfree(ptr)        xnheap_free(&kheap,ptr)
 #define xnfreesync()       xnheap_finalize_free(&kheap)
@@ -37,23 +37,58 @@
 /* Operational flags. */
 #define XN_ISR_ATTACHED	 0x10000
 
+/*
+ * Per-IRQ histograms: bucket #0 counts delays below 128 ns, bucket
+ * #n those in [128 << (n - 1), 128 << n) ns, the last bucket also
+ * collects everything beyond.
+ */
+#define XNINTR_HIST_BUCKETS  16
+#define XNINTR_HIST_SHIFT    7
+
+/*
+ * Binary record read from /proc/xenomai/irqhist, one per interrupt
+ * object and online CPU. Delays are expressed in nanoseconds.
+ */
+struct xnintr_hist_rec {
+	unsigned int irq;
+	unsigned int cpu;
+	char name[32];
+	unsigned long long count;	/* Handled receipts */
+	unsigned long long lat_max;	/* Worst-case entry latency */
+	unsigned long long run_max;	/* Worst-case handler duration */
+	unsigned long long lat[XNINTR_HIST_BUCKETS];
+	unsigned long long run[XNINTR_HIST_BUCKETS];
+};
+
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 
 #include <nucleus/types.h>
 #include <nucleus/stat.h>
 
 struct xnsched;
+struct xnintr_thread;
+
+struct xnintr_hist {
+	unsigned long lat[XNINTR_HIST_BUCKETS]; /* !< Entry latency histogram. */
+	unsigned long run[XNINTR_HIST_BUCKETS]; /* !< Handler duration histogram. */
+	xnticks_t lat_max;	/* !< Worst-case entry latency (TSC). */
+	xnticks_t run_max;	/* !< Worst-case handler duration (TSC). */
+};
 
 typedef struct xnintr {
 
 #ifdef CONFIG_XENO_OPT_SHIRQ
     struct xnintr *next; /* !< Next object in the IRQ-sharing chain. */
+
+    unsigned score;	/* !< Recent hits, for ordering the chain. */
 #endif /* CONFIG_XENO_OPT_SHIRQ */
 
     unsigned unhandled;	/* !< Number of consequent unhandled interrupts */
 
     xnisr_t isr;	/* !< Interrupt service routine. */
 
+    xnisr_t probe;	/* !< Optional ownership probe, for shared IRQs. */
+
     void *cookie;	/* !< User-defined cookie value. */
 
     xnflags_t flags; 	/* !< Creation flags. */
@@ -64,6 +99,12 @@ typedef struct xnintr {
 
     const char *name;	/* !< Symbolic name. */
 
+    struct xnintr_thread *thread; /* !< Bottom half server, if threaded. */
+
+#ifdef CONFIG_XENO_OPT_STATS
+    struct xnintr_hist *hist; /* !< Per-CPU histograms, while attached. */
+#endif /* CONFIG_XENO_OPT_STATS */
+
     struct {
 	xnstat_counter_t hits;	  /* !< Number of handled receipts since attachment. */
 	xnstat_exectime_t account; /* !< Runtime accounting entity */
@@ -98,6 +139,8 @@ extern "C" {
 
 int xnintr_mount(void);
 
+void xnintr_umount(void);
+
 void xnintr_clock_handler(void);
 
 void xnintr_host_tick(struct xnsched *sched);
@@ -120,6 +163,10 @@ int xnintr_destroy(xnintr_t *intr);
 int xnintr_attach(xnintr_t *intr,
 		  void *cookie);
 
+int xnintr_attach_threaded(xnintr_t *intr,
+			   void *cookie,
+			   int prio);
+
 int xnintr_detach(xnintr_t *intr);
 
 int xnintr_enable(xnintr_t *intr);
@@ -129,6 +176,9 @@ int xnintr_disable(xnintr_t *intr);
 void xnintr_affinity(xnintr_t *intr,
 		     xnarch_cpumask_t cpumask);
 
+void xnintr_set_probe(xnintr_t *intr,
+		      xnisr_t probe);
+
 int xnintr_query_init(xnintr_iterator_t *iterator);
 
 int xnintr_query_next(int irq, xnintr_iterator_t *iterator,
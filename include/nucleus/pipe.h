@@ -29,6 +29,9 @@
 #define XNPIPEIOC_OFLUSH	_IO(XNPIPE_IOCTL_BASE,2)
 #define XNPIPEIOC_FLUSH		XNPIPEIOC_OFLUSH
 #define XNPIPEIOC_SETSIG	_IO(XNPIPE_IOCTL_BASE,3)
+#define XNPIPEIOC_RING		_IO(XNPIPE_IOCTL_BASE,4)
+#define XNPIPEIOC_BATCH		_IO(XNPIPE_IOCTL_BASE,5)
+#define XNPIPEIOC_SETWM		_IO(XNPIPE_IOCTL_BASE,6)
 
 #define XNPIPE_NORMAL  0x0
 #define XNPIPE_URGENT  0x1
@@ -38,6 +41,38 @@
 
 #define XNPIPE_MINOR_AUTO  -1
 
+/*
+ * Message record, as laid out in the shared ring, and in the buffer
+ * returned by read(2) in batch mode. Records are aligned on
+ * XNPIPE_REC_ALIGN bytes; a padding record carries no data, and
+ * should be skipped.
+ */
+struct xnpipe_rec {
+	unsigned int size;	/* Payload size, following the header */
+	unsigned int flags;
+};
+
+#define XNPIPE_REC_PAD    0x1
+
+#define XNPIPE_REC_ALIGN  8
+#define xnpipe_rec_len(size) \
+	(((size) + sizeof(struct xnpipe_rec) + XNPIPE_REC_ALIGN - 1) & \
+	 ~(XNPIPE_REC_ALIGN - 1))
+
+/*
+ * Control block heading the ring shared with the Linux side, mapped
+ * by mmap(2) on the pipe device after XNPIPEIOC_RING. The data area
+ * starts at the given offset from the control block. The indexes are
+ * free-running byte counts; the consumer reads records from
+ * (tail % size) up to (head % size), then updates the tail index.
+ */
+struct xnpipe_ring {
+	unsigned long head;	/* Producer index, updated by the nucleus */
+	unsigned long tail;	/* Consumer index, updated by the reader */
+	unsigned long size;	/* Size of the data area (power of two) */
+	unsigned long offset;	/* Offset of the data area */
+};
+
 #ifdef __KERNEL__
 
 #include <nucleus/queue.h>
@@ -54,6 +89,7 @@
 #define XNPIPE_USER_WREAD_READY  0x20
 #define XNPIPE_USER_WSYNC        0x40
 #define XNPIPE_USER_WSYNC_READY  0x80
+#define XNPIPE_USER_BATCH        0x100
 
 #define XNPIPE_USER_ALL_WAIT \
 (XNPIPE_USER_WREAD|XNPIPE_USER_WSYNC)
@@ -76,6 +112,17 @@ static inline xnpipe_mh_t *link2mh(struct xnholder *ln)
 
 struct xnpipe_state;
 
+struct xnpipe_ringbuf {
+	struct xnpipe_ring *ctl;	/* Shared control block */
+	char *data;			/* Data area */
+	size_t size;			/* Size of data area */
+	size_t memsize;			/* Size of the mapping */
+	unsigned long resv;		/* Next reserved index */
+	int nwriters;			/* Pending reservations */
+	int closing;
+	atomic_t refcnt;		/* State + user mappings */
+};
+
 struct xnpipe_operations {
 	void (*output)(struct xnpipe_mh *mh, void *xstate);
 	int (*input)(struct xnpipe_mh *mh, int retval, void *xstate);
@@ -93,6 +140,7 @@ struct xnpipe_state {
 
 	struct xnqueue inq;		/* From user-space to kernel */
 	struct xnqueue outq;		/* From kernel to user-space */
+	struct xnqueue freeq;		/* Sent through the ring, to be freed */
 	struct xnsynch synchbase;
 	struct xnpipe_operations ops;
 	void *xstate;		/* Extra state managed by caller */
@@ -104,6 +152,9 @@ struct xnpipe_state {
 	wait_queue_head_t syncq;	/* sync waiters */
 	int wcount;			/* number of waiters on this minor */
 	size_t ionrd;
+	size_t wmark;			/* reader wakeup threshold (bytes) */
+	struct xnpipe_ringbuf *ring;	/* shared ring, if any */
+	struct xnpipe_ringbuf *orphan;	/* detached ring, pending commits */
 
 };
 
@@ -136,6 +187,10 @@ ssize_t xnpipe_recv(int minor,
 
 int xnpipe_flush(int minor, int mode);
 
+ssize_t xnpipe_ring_reserve(int minor, size_t size, void **datap);
+
+void xnpipe_ring_commit(int minor, void *data, int cancel);
+
 #ifdef __cplusplus
 }
 #endif /* __cplusplus */
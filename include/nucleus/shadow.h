@@ -107,6 +107,21 @@ static inline void xnshadow_call_mayday(struct xnthread *thread)
 }
 #endif
 
+/* Tell the mode switch profiler what the next switch is caused by. */
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+#define xnshadow_mswprof_trigger(thread, class, n)			\
+	do {								\
+		(thread)->mswprof.trigger = xnmswprof_trigger(class, n); \
+	} while (0)
+#define xnshadow_mswprof_clear(thread)					\
+	do {								\
+		(thread)->mswprof.trigger = XNMSWPROF_TRIG_NONE;	\
+	} while (0)
+#else
+#define xnshadow_mswprof_trigger(thread, class, n)	do { } while (0)
+#define xnshadow_mswprof_clear(thread)			do { } while (0)
+#endif /* !CONFIG_XENO_OPT_STATS_MSWPROF */
+
 #ifdef __cplusplus
 }
 #endif
@@ -22,6 +22,9 @@
 #define _XENO_NUCLEUS_STAT_H
 
 #include <nucleus/types.h>  /* This pulls in linux/config.h with legacy kernels. */
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+#include <nucleus/seqlock.h>
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
 
 #ifdef CONFIG_XENO_OPT_STATS
 
@@ -146,4 +149,50 @@ typedef struct xnstat_counter {
 	xnstat_exectime_set_current(sched, new_account); \
 })
 
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+
+#define XNMSWPROF_SITES		16	/* Call sites per thread */
+#define XNMSWPROF_DEPTH		8	/* User frames hashed per site */
+
+/* Site events: SIGDEBUG_* relax reasons, or... */
+#define XNMSWPROF_HARDEN	0xff	/* ...switch back to primary mode. */
+
+/* Trigger classes, in the upper bits of the trigger code. */
+#define XNMSWPROF_TRIG_NONE	0
+#define XNMSWPROF_TRIG_XENO	1	/* Xenomai call: muxid << 8 | muxop */
+#define XNMSWPROF_TRIG_LINUX	2	/* Regular Linux syscall number */
+#define XNMSWPROF_TRIG_TRAP	3	/* Fault trap number */
+
+#define XNMSWPROF_TRIG_SHIFT	28
+#define xnmswprof_trigger(class, n) \
+	(((class) << XNMSWPROF_TRIG_SHIFT) | \
+	 ((n) & ((1 << XNMSWPROF_TRIG_SHIFT) - 1)))
+#define xnmswprof_trigger_class(t)	((t) >> XNMSWPROF_TRIG_SHIFT)
+#define xnmswprof_trigger_code(t)	((t) & ((1 << XNMSWPROF_TRIG_SHIFT) - 1))
+
+struct xnmswprof_site {
+	unsigned hash;		/* User call chain hash */
+	unsigned trigger;	/* Triggering event (XNMSWPROF_TRIG_*) */
+	int event;		/* Relax reason, or XNMSWPROF_HARDEN */
+	unsigned long count;	/* Number of hits */
+	xnticks_t total;	/* Time spent in secondary mode (relax only) */
+	xnticks_t max;		/* Longest stay in secondary mode */
+};
+
+/*
+ * Only the owner thread updates its profile, readers retry on
+ * sequence changes.
+ */
+struct xnmswprof {
+	xnseqcount_t seq;
+	unsigned gen;		/* Reset generation this data belongs to */
+	unsigned trigger;	/* Pending trigger */
+	int cursite;		/* Site of the last relax, -1 if none */
+	xnticks_t relaxed_at;	/* Date of the last relax */
+	unsigned long lost;	/* Hits dropped on table overflow */
+	struct xnmswprof_site sites[XNMSWPROF_SITES];
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
+
 #endif /* !_XENO_NUCLEUS_STAT_H */
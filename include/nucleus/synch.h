@@ -38,6 +38,27 @@
 
 #ifdef CONFIG_XENO_FASTSYNCH
 
+#define XNSYNCH_FLCLAIM XN_HANDLE_SPARE3 /* Corresponding bit in fast lock */
+
+#define XNSYNCH_NO_WINDOW ((unsigned long)-1)
+
+/*
+ * Shared block backing the fast lock word of mutexes (native and
+ * POSIX), allocated from a semaphore heap. The lock word must come
+ * first, since the nucleus only knows about it.
+ */
+struct xnsynch_fastmutex {
+	xnarch_atomic_t lock;	/* Fast lock word */
+	xnarch_atomic_t owner_window; /* Heap offset of the owner's user window */
+	unsigned long spinmax;	/* Spin budget (in CPU ticks), 0 if none */
+	int adaptive;		/* Spin before sleeping upon contention */
+	struct xnsynch_fastmutex_stats {
+		xnarch_atomic_t contended; /* Fast path failures */
+		xnarch_atomic_t spun;	/* Lock grabbed while spinning */
+		xnarch_atomic_t slow;	/* Lock grabbed through the nucleus */
+	} stats;
+};
+
 /* Fast lock API */
 static inline int xnsynch_fast_owner_check(xnarch_atomic_t *fastlock,
 					   xnhandle_t ownerh)
@@ -88,8 +109,6 @@ static inline int xnsynch_fast_release(xnarch_atomic_t *fastlock,
 
 #define XNSYNCH_CLAIMED 0x10	/* Claimed by other thread(s) w/ PIP */
 
-#define XNSYNCH_FLCLAIM XN_HANDLE_SPARE3 /* Corresponding bit in fast lock */
-
 /* Spare flags usable by upper interfaces */
 #define XNSYNCH_SPARE0  0x01000000
 #define XNSYNCH_SPARE1  0x02000000
@@ -157,6 +176,35 @@ typedef struct xnsynch {
 	(((fastlock) & ~XNSYNCH_FLCLAIM) | ((enable) ? XNSYNCH_FLCLAIM : 0))
 #define xnsynch_fast_mask_claimed(fastlock) ((fastlock) & ~XNSYNCH_FLCLAIM)
 
+#ifdef CONFIG_XENO_FASTSYNCH
+
+#ifndef CONFIG_XENO_OPT_SYNCH_SPIN
+#define CONFIG_XENO_OPT_SYNCH_SPIN 0
+#endif /* CONFIG_XENO_OPT_SYNCH_SPIN */
+
+/*
+ * Spinning only makes sense for process-private mutexes, since the
+ * owner's user window is looked up in the private semaphore heap of
+ * the contender, and on SMP, since the owner cannot run while a
+ * contender spins on the same CPU.
+ */
+static inline void xnsynch_init_fastmutex(struct xnsynch_fastmutex *fm,
+					  int adaptive, int private)
+{
+	xnarch_atomic_set(&fm->owner_window, XNSYNCH_NO_WINDOW);
+#ifdef CONFIG_SMP
+	fm->spinmax = private ? xnarch_ns_to_tsc(CONFIG_XENO_OPT_SYNCH_SPIN) : 0;
+#else /* !CONFIG_SMP */
+	fm->spinmax = 0;
+#endif /* !CONFIG_SMP */
+	fm->adaptive = adaptive;
+	xnarch_atomic_set(&fm->stats.contended, 0);
+	xnarch_atomic_set(&fm->stats.spun, 0);
+	xnarch_atomic_set(&fm->stats.slow, 0);
+}
+
+#endif /* CONFIG_XENO_FASTSYNCH */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
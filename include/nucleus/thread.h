@@ -23,6 +23,7 @@
 #define _XENO_NUCLEUS_THREAD_H
 
 #include <nucleus/types.h>
+#include <nucleus/seqlock.h>
 
 /*! @ingroup nucleus
   @defgroup nucleus_state_flags Thread state flags.
@@ -153,6 +154,39 @@ typedef struct xnthread_info {
 
 } xnthread_info_t;
 
+#define XNTHREAD_RELSTAT_BUCKETS  16
+
+/*!
+  @brief Release statistics of a periodic thread.
+
+  The release latency is the delay between a periodic release point
+  and the actual wakeup of the thread. Bucket #0 of the histogram
+  counts latencies below 1 us, bucket #n latencies in the [2^(n-1),
+  2^n) us range; the last bucket also counts all longer latencies.
+*/
+struct xnthread_relstat {
+	unsigned long releases; /**< Release points reached. */
+	unsigned long overruns; /**< Release points missed. */
+	unsigned long maxburst; /**< Longest run of missed release points. */
+	unsigned long long latmax; /**< Worst release latency in nanoseconds. */
+	unsigned long long latsum; /**< Sum of release latencies in nanoseconds. */
+	unsigned long hist[XNTHREAD_RELSTAT_BUCKETS]; /**< Release latency histogram. */
+};
+
+/*
+ * Per-thread data shared with userland, allocated from the private
+ * semaphore heap of the owning process when the thread is mapped.
+ * The state word must come first, since older libraries only know
+ * about it (u_mode).
+ */
+struct xnthread_user_window {
+	unsigned long state; /**< Thread state, mirrors xnthread->state. */
+	xnseqcount_t seqcount; /**< Protects the accounting data below. */
+	unsigned long long exectime; /**< Primary mode exectime (in CPU ticks) until lastswitch. */
+	unsigned long long lastswitch; /**< Date of the last switch in (in CPU ticks). */
+	unsigned long oncpu; /**< Non-zero while running in primary mode. */
+};
+
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 
 #include <nucleus/stat.h>
@@ -285,6 +319,10 @@ typedef struct xnthread {
 	/* Active wait context - Obsoletes wait_u. */
 	struct xnthread_wait_context *wcontext;
 
+	int parkstate;			/* Park/unpark state (shadow only) */
+
+	struct xnsynch parksynch;	/* Where parked shadows sleep */
+
 	struct {
 		xnstat_counter_t ssw;	/* Primary -> secondary mode switch count */
 		xnstat_counter_t csw;	/* Context switches (includes secondary -> primary switches) */
@@ -293,6 +331,14 @@ typedef struct xnthread {
 		xnstat_exectime_t lastperiod; /* Interval marker for execution time reports */
 	} stat;
 
+#ifdef CONFIG_XENO_OPT_STATS
+	struct xnthread_relstat relstat; /* Periodic release statistics */
+#endif /* CONFIG_XENO_OPT_STATS */
+
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+	struct xnmswprof mswprof;	/* Mode switch profile (shadow only) */
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
+
 #ifdef CONFIG_XENO_OPT_SELECT
 	struct xnselector *selector;    /* For select. */
 #endif /* CONFIG_XENO_OPT_SELECT */
@@ -330,6 +376,7 @@ typedef struct xnthread {
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 	unsigned long *u_mode;	/* Thread mode variable shared with userland. */
+	struct xnthread_user_window *u_window; /* Shared data area, u_mode lives there. */
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 
     XNARCH_DECL_DISPLAY_CONTEXT();
@@ -389,6 +436,13 @@ typedef struct xnhook {
 #define xnthread_affine_p(thread, cpu)     xnarch_cpu_isset(cpu, (thread)->affinity)
 #define xnthread_get_exectime(thread)      xnstat_exectime_get_total(&(thread)->stat.account)
 #define xnthread_get_lastswitch(thread)    xnstat_exectime_get_last_switch((thread)->sched)
+#ifdef CONFIG_XENO_OPT_STATS
+#define xnthread_get_relstat(thread, rs)   (*(rs) = (thread)->relstat)
+#define xnthread_reset_relstat(thread)     memset(&(thread)->relstat, 0, sizeof((thread)->relstat))
+#else /* !CONFIG_XENO_OPT_STATS */
+#define xnthread_get_relstat(thread, rs)   memset(rs, 0, sizeof(*(rs)))
+#define xnthread_reset_relstat(thread)     do { } while (0)
+#endif /* CONFIG_XENO_OPT_STATS */
 #ifdef CONFIG_XENO_OPT_PERVASIVE
 #define xnthread_inc_rescnt(thread)        ({ (thread)->hrescnt++; })
 #define xnthread_dec_rescnt(thread)        ({ --(thread)->hrescnt; })
@@ -72,6 +72,12 @@ typedef struct xntbase {
 
 	const char *name;	/* !< Name of time base. */
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+	xnticks_t tickdate;	/* !< Master date of tick #jiffies (ns). */
+
+	int tsliced;		/* !< Number of threads using the slicer. */
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
 	xnholder_t link;
 
 #define link2tbase(ln)		container_of(ln, xntbase_t, link)
@@ -108,10 +114,12 @@ static inline xnticks_t xntbase_get_wallclock_offset(xntbase_t *base)
 	return base->wallclock_offset;
 }
 
+#ifndef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
 static inline void xntbase_set_hook(xntbase_t *base, void (*hook)(void))
 {
 	base->hook = hook;
 }
+#endif /* !CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 
 static inline int xntbase_timeset_p(xntbase_t *base)
 {
@@ -156,14 +164,61 @@ static inline int xntbase_periodic_p(xntbase_t *base)
 	return !xntbase_master_p(base);
 }
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+
+/*
+ * Tickless periodic time bases only account for elapsed ticks when
+ * some timer is due, the current tick count is derived from the
+ * master clock. Ticks announced by a hook are counted as they come.
+ */
+static inline xnticks_t xntbase_get_slave_jiffies(xntbase_t *base)
+{
+	xnsticks_t elapsed;
+
+	if (!xntbase_enabled_p(base) || base->hook)
+		return base->jiffies;
+
+	elapsed = xnarch_get_cpu_time() - base->tickdate;
+	if (elapsed < (xnsticks_t)base->tickvalue)
+		return base->jiffies;
+
+	return base->jiffies + xnarch_ulldiv(elapsed, base->tickvalue, NULL);
+}
+
+/* Fold the elapsed ticks into the tick count, nklock held. */
+static inline void xntbase_sync_jiffies(xntbase_t *base)
+{
+	xnticks_t jiffies = xntbase_get_slave_jiffies(base);
+
+	base->tickdate += (jiffies - base->jiffies) * base->tickvalue;
+	base->jiffies = jiffies;
+}
+
+void xntbase_set_hook(xntbase_t *base, void (*hook)(void));
+
+#else /* !CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
+static inline xnticks_t xntbase_get_slave_jiffies(xntbase_t *base)
+{
+	return base->jiffies;
+}
+
+static inline void xntbase_sync_jiffies(xntbase_t *base)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
 static inline xnticks_t xntbase_get_jiffies(xntbase_t *base)
 {
-	return xntbase_periodic_p(base) ? base->jiffies : xnarch_get_cpu_time();
+	return xntbase_periodic_p(base) ?
+		xntbase_get_slave_jiffies(base) : xnarch_get_cpu_time();
 }
 
 static inline xnticks_t xntbase_get_rawclock(xntbase_t *base)
 {
-	return xntbase_periodic_p(base) ? base->jiffies : xnarch_get_cpu_tsc();
+	return xntbase_periodic_p(base) ?
+		xntbase_get_slave_jiffies(base) : xnarch_get_cpu_tsc();
 }
 
 int xntbase_alloc(const char *name,
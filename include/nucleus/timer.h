@@ -294,6 +294,10 @@ typedef struct xntimer {
 
 	xnticks_t pexpect;	/* !< Date of next periodic release point (raw ticks). */
 
+	xnticks_t slack;	/* !< Tolerated expiry delay (raw ticks, aperiodic only). */
+
+	xnticks_t slackgrid;	/* !< Coalescing granularity (raw ticks). */
+
 	struct xnsched *sched;	/* !< Sched structure to which the timer is
 				   attached. */
 
@@ -324,6 +328,11 @@ typedef struct xntimed_slave {
 	struct percpu_cascade {
 		xntimer_t timer; /* !< Cascading timer in master time base. */
 		xnqueue_t wheel[XNTIMER_WHEELSIZE]; /*!< BSDish timer wheel. */
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+		xnticks_t lastjiffy; /* !< Last tick processed. */
+		xnticks_t nextjiffy; /* !< Tick the cascading timer is set for. */
+		int armed;	/* !< Cascading timer is set. */
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 	} cascade[XNARCH_NR_CPUS];
 
 #define timer2slave(t) \
@@ -655,6 +664,10 @@ void xntslave_stop(xntslave_t *slave);
 
 void xntslave_adjust(xntslave_t *slave, xnsticks_t delta);
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+void xntslave_rearm(xntslave_t *slave);
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
 #else /* !CONFIG_XENO_OPT_TIMING_PERIODIC */
 
 int xntimer_start_aperiodic(xntimer_t *timer,
@@ -726,6 +739,8 @@ void xntimer_cleanup_proc(void);
 
 unsigned long xntimer_get_overruns(xntimer_t *timer, xnticks_t now);
 
+void xntimer_set_slack(xntimer_t *timer, xnticks_t slack);
+
 void xntimer_freeze(void);
 
 void xntimer_tick_aperiodic(void);
@@ -26,6 +26,15 @@
 #include <nucleus/types.h>
 #include <nucleus/hostrt.h>
 
+/*
+ * Offset of the nucleus wallclock (CLOCK_REALTIME) from the
+ * monotonic CPU time, in nanoseconds.
+ */
+struct xnvdso_wallclock_data {
+	xnseqcount_t seqcount;
+	long long offset;
+};
+
 /*
  * Data shared between Xenomai kernel/userland and the Linux kernel/userland
  * on the global semaphore heap. The features element indicates which data are
@@ -35,6 +44,8 @@ struct xnvdso {
 	unsigned long long features;
 
 	struct xnvdso_hostrt_data hostrt_data;
+
+	struct xnvdso_wallclock_data wallclock_data;
 	/*
 	 * Embed further domain specific structures that
 	 * describe the shared data here
@@ -52,11 +63,21 @@ struct xnvdso {
 #define XNVDSO_FEATURES	(XNVDSO_FEAT_A | XNVDSO_FEAT_B | XVDSO_FEAT_C)
 */
 #define XNVDSO_FEAT_HOST_REALTIME	0x0000000000000001ULL
+#define XNVDSO_FEAT_WALLCLOCK		0x0000000000000002ULL
+#define XNVDSO_FEAT_THREAD_EXECTIME	0x0000000000000004ULL
 #ifdef CONFIG_XENO_OPT_HOSTRT
-#define XNVDSO_FEATURES XNVDSO_FEAT_HOST_REALTIME
+#define XNVDSO_FEAT_HOSTRT_ENABLED XNVDSO_FEAT_HOST_REALTIME
 #else
-#define XNVDSO_FEATURES 0
+#define XNVDSO_FEAT_HOSTRT_ENABLED 0
 #endif /* CONFIG_XENO_OPT_HOSTRT */
+#ifdef CONFIG_XENO_OPT_STATS
+#define XNVDSO_FEAT_EXECTIME_ENABLED XNVDSO_FEAT_THREAD_EXECTIME
+#else
+#define XNVDSO_FEAT_EXECTIME_ENABLED 0
+#endif /* CONFIG_XENO_OPT_STATS */
+#define XNVDSO_FEATURES (XNVDSO_FEAT_HOSTRT_ENABLED | \
+			 XNVDSO_FEAT_WALLCLOCK | \
+			 XNVDSO_FEAT_EXECTIME_ENABLED)
 
 extern struct xnvdso *nkvdso;
 
@@ -70,5 +91,17 @@ static inline int xnvdso_test_feature(unsigned long long feature)
 	return testbits(nkvdso->features, feature);
 }
 
+#ifdef __KERNEL__
+/* Must be called nklock locked, interrupts off. */
+static inline void xnvdso_update_wallclock(long long offset)
+{
+	struct xnvdso_wallclock_data *wallclock_data = &nkvdso->wallclock_data;
+
+	xnwrite_seqcount_begin(&wallclock_data->seqcount);
+	wallclock_data->offset = offset;
+	xnwrite_seqcount_end(&wallclock_data->seqcount);
+}
+#endif /* __KERNEL__ */
+
 extern void xnheap_init_vdso(void);
 #endif /* _XENO_NUCLEUS_VDSO_H */
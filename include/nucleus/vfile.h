@@ -32,11 +32,13 @@
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
 #include <nucleus/types.h>
+#include <nucleus/queue.h>
 
 struct xnvfile_directory;
 struct xnvfile_regular_iterator;
 struct xnvfile_snapshot_iterator;
 struct xnvfile_lock_ops;
+struct xnvfile_cursor;
 
 struct xnvfile {
 	struct proc_dir_entry *pde;
@@ -401,7 +403,11 @@ struct xnvfile_snapshot_ops {
 	 * to the @ref snapshot_show "show() handler()" during the
 	 * formatting and output phase. Otherwise:
 	 *
-	 * - A negative error code. This will abort the data
+	 * - -EAGAIN, which restarts the data collection from
+	 * scratch. This is how incremental scans may give up when
+	 * some data not covered by the cursor changed concurrently.
+	 *
+	 * - Any other negative error code. This will abort the data
 	 * collection, and return this status to the reader.
 	 *
 	 * - VFILE_SEQ_SKIP, a special value indicating that the
@@ -417,6 +423,12 @@ struct xnvfile_snapshot_ops {
 	 * fetched via the @ref snapshot_next "next() handler", while
 	 * the revision tag remains unchanged, which indicates that a
 	 * consistent snapshot of the object state was taken.
+	 *
+	 * Vfiles scanning a queue by mean of a @ref snapshot_cursor
+	 * "snapshot cursor" are collected incrementally instead: the
+	 * scan goes on from the cursor position regardless of
+	 * revision changes, and the snapshot buffer grows as
+	 * needed.
 	 */
 	int (*next)(struct xnvfile_snapshot_iterator *it, void *data);
 	/**
@@ -490,6 +502,35 @@ struct xnvfile_snapshot_ops {
 struct xnvfile_rev_tag {
 	/** Current revision number. */
 	int rev;
+	/** Cursors of incremental readers. */
+	struct xnvfile_cursor *cursors;
+};
+
+/**
+ * @brief Snapshot cursor
+ * @anchor snapshot_cursor
+ *
+ * A cursor remembers the next element to collect from a queue of
+ * objects while the vfile lock is dropped between records. Cursors
+ * are registered with the revision tag of the queue, so that
+ * removing an element via xnvfile_touch_remove() moves any cursor
+ * referring to it past it. This allows the vfile core to collect
+ * very large object populations incrementally, without ever
+ * restarting the scan, nor holding the lock for more than one
+ * record. Elements added while scanning are collected if they are
+ * queued after the cursor; elements removed are output if they
+ * were already collected.
+ *
+ * Cursors must be handled with nklock held, and so do the
+ * updates to the tracked queue.
+ */
+struct xnvfile_cursor {
+	/** Next registered cursor. */
+	struct xnvfile_cursor *next;
+	/** Queue being scanned. */
+	struct xnqueue *q;
+	/** Next element to collect. */
+	struct xnholder *curr;
 };
 
 struct xnvfile_snapshot_template {
@@ -536,6 +577,8 @@ struct xnvfile_snapshot_iterator {
 	struct xnvfile_snapshot *vfile;
 	/** Buffer release handler. */
 	void (*endfn)(struct xnvfile_snapshot_iterator *it, void *buf);
+	/** Queue cursor, for incremental collection. */
+	struct xnvfile_cursor cursor;
 	/**
 	 * Start of private area. Use xnvfile_iterator_priv() to
 	 * address it.
@@ -573,6 +616,34 @@ static inline void xnvfile_touch(struct xnvfile_snapshot *vfile)
 	xnvfile_touch_tag(vfile->tag);
 }
 
+/*
+ * Called with nklock held, before @holder is unlinked from the queue
+ * tracked by @tag.
+ */
+static inline void xnvfile_touch_remove(struct xnvfile_rev_tag *tag,
+					struct xnholder *holder)
+{
+	struct xnvfile_cursor *c;
+
+	for (c = tag->cursors; c; c = c->next)
+		if (c->curr == holder)
+			c->curr = nextq(c->q, holder);
+
+	xnvfile_touch_tag(tag);
+}
+
+static inline struct xnholder *
+xnvfile_cursor_next(struct xnvfile_snapshot_iterator *it)
+{
+	struct xnvfile_cursor *c = &it->cursor;
+	struct xnholder *holder = c->curr;
+
+	if (holder)
+		c->curr = nextq(c->q, holder);
+
+	return holder;
+}
+
 #define xnvfile_noentry			\
 	{				\
 		.pde = NULL,		\
@@ -629,6 +700,9 @@ ssize_t xnvfile_get_string(struct xnvfile_input *input,
 
 ssize_t xnvfile_get_integer(struct xnvfile_input *input, long *valp);
 
+void xnvfile_cursor_rewind(struct xnvfile_snapshot_iterator *it,
+			   struct xnqueue *q);
+
 int __vfile_hostlock_get(struct xnvfile *vfile);
 
 void __vfile_hostlock_put(struct xnvfile *vfile);
@@ -676,6 +750,8 @@ void xnvfile_destroy_link(struct xnvfile_link *vlink)
 
 #define xnvfile_touch(vfile)	do { } while (0)
 
+#define xnvfile_touch_remove(tag, holder)	do { } while (0)
+
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
 /*@}*/
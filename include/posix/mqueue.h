@@ -159,4 +159,94 @@ int __real_mq_notify(mqd_t mqdes, const struct sigevent *notification);
 
 #endif /* !(__KERNEL__ || __XENO_SIM__ || !CONFIG_XENO_HAVE_MQUEUE_H) */
 
+/*
+ * Xenomai extension: mq_open() flag creating (or opening) a zero-copy
+ * message queue, whose message slots and indices live in a heap
+ * mapped into every participant.
+ */
+#define MQ_ZEROCOPY  0x40000000
+
+#ifndef __KERNEL__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int mq_reserve_np(mqd_t q,
+		  void **bufp,
+		  size_t len,
+		  const struct timespec *abs_timeout);
+
+int mq_commit_np(mqd_t q,
+		 void *buf,
+		 size_t len);
+
+ssize_t mq_fetch_np(mqd_t q,
+		    void **bufp,
+		    const struct timespec *abs_timeout);
+
+int mq_release_np(mqd_t q,
+		  void *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !__KERNEL__ */
+
+#if defined(__KERNEL__) || defined(__XENO_SIM__) || defined(__IN_XENO__)
+
+#include <nucleus/heap.h>
+#include <asm/xenomai/atomic.h>
+
+/*
+ * Layout of a zero-copy queue in its mapped heap. Slots form a
+ * bounded multi-producer/multi-consumer ring: each slot carries a
+ * sequence number telling whether it is free for the producer
+ * reserving position "seq", or holds a message for the consumer
+ * fetching position "seq - 1". The waiter counts are only updated by
+ * the kernel under nklock, user-space merely reads them to figure
+ * out whether a peer needs to be woken up.
+ */
+struct pse51_mq_zcring {
+	xnarch_atomic_t head;		/* Next position to reserve. */
+	xnarch_atomic_t tail;		/* Next position to fetch. */
+	xnarch_atomic_t rwaiters;	/* Receivers blocked in kernel. */
+	xnarch_atomic_t swaiters;	/* Senders blocked in kernel. */
+	unsigned long nslots;		/* Power of two. */
+	unsigned long slotsize;
+	unsigned long msgsize;
+	unsigned long slots;		/* Offset of slot array from ring. */
+};
+
+struct pse51_mq_zcslot {
+	xnarch_atomic_t seq;
+	unsigned long len;
+	char data[0];
+};
+
+/*
+ * nslots is a power of two, so that the slot index remains
+ * consistent when positions wrap around.
+ */
+#define pse51_mq_zcslot(ring, pos)					\
+	((struct pse51_mq_zcslot *)((char *)(ring) + (ring)->slots +	\
+				    ((pos) & ((ring)->nslots - 1)) *	\
+				    (ring)->slotsize))
+
+#define pse51_mq_zcdata2slot(p) \
+	((struct pse51_mq_zcslot *)((char *)(p) - offsetof(struct pse51_mq_zcslot, data)))
+
+/* Mapping information returned by the __pse51_mq_zcinfo syscall. */
+struct pse51_mq_zcinfo {
+	struct xnheap_desc hdesc;
+	unsigned long ringoff;
+};
+
+/* Arguments to the __pse51_mq_zcwait/__pse51_mq_zcwake syscalls. */
+#define PSE51_MQ_ZCSEND  0
+#define PSE51_MQ_ZCRECV  1
+
+#endif /* __KERNEL__ || __XENO_SIM__ || __IN_XENO__ */
+
 #endif /* _XENO_POSIX_MQUEUE_H */
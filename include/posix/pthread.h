@@ -168,6 +168,7 @@ struct pse51_mutexattr {
 	unsigned type: 2;
 	unsigned protocol: 2;
 	unsigned pshared: 1;
+	unsigned adaptive: 1;
 };
 
 struct pse51_condattr {
@@ -190,6 +191,9 @@ struct pse51_interrupt;
 
 typedef struct pse51_interrupt *pthread_intr_t;
 
+/* Release statistics of a periodic thread, see pthread_getrelstat_np(). */
+typedef struct xnthread_relstat pthread_relstat_np_t;
+
 #if defined(__KERNEL__) || defined(__XENO_SIM__)
 typedef struct pse51_mutexattr pthread_mutexattr_t;
 
@@ -322,6 +326,11 @@ int pthread_mutexattr_getpshared(const pthread_mutexattr_t *attr, int *pshared);
 
 int pthread_mutexattr_setpshared(pthread_mutexattr_t *attr, int pshared);
 
+int pthread_mutexattr_getadaptive_np(const pthread_mutexattr_t *attr,
+				     int *adaptive);
+
+int pthread_mutexattr_setadaptive_np(pthread_mutexattr_t *attr, int adaptive);
+
 int pthread_mutex_init(pthread_mutex_t *mutex,
 		       const pthread_mutexattr_t *attr);
 
@@ -400,6 +409,9 @@ int pthread_make_periodic_np(pthread_t thread,
 
 int pthread_wait_np(unsigned long *overruns_r);
 
+int pthread_getrelstat_np(pthread_t thread,
+			  pthread_relstat_np_t *stat);
+
 int pthread_set_mode_np(int clrmask,
 			int setmask);
 
@@ -424,6 +436,16 @@ int pthread_intr_control_np(pthread_intr_t intr,
 
 struct sched_param_ex;
 
+typedef struct pthread_pool_np {
+	void *opaque;
+} pthread_pool_np_t;
+
+struct pthread_mutex_stats_np {
+	unsigned long contended; /* Fast path failures */
+	unsigned long spun;	/* Lock grabbed while spinning */
+	unsigned long slow;	/* Lock grabbed by sleeping in the kernel */
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -450,6 +472,9 @@ int pthread_make_periodic_np(pthread_t thread,
 
 int pthread_wait_np(unsigned long *overruns_r);
 
+int pthread_getrelstat_np(pthread_t thread,
+			  pthread_relstat_np_t *stat);
+
 int pthread_set_mode_np(int clrmask,
 			int setmask);
 
@@ -468,6 +493,26 @@ int pthread_intr_wait_np(pthread_intr_t intr,
 int pthread_intr_control_np(pthread_intr_t intr,
 			    int cmd);
 
+int pthread_pool_create_np(pthread_pool_np_t *pool,
+			   unsigned nr,
+			   const pthread_attr_t *attr);
+
+int pthread_spawn_from_pool_np(pthread_pool_np_t *pool,
+			       pthread_t *tid,
+			       int prio,
+			       void *(*start)(void *),
+			       void *arg);
+
+int pthread_pool_destroy_np(pthread_pool_np_t *pool);
+
+int pthread_mutexattr_getadaptive_np(const pthread_mutexattr_t *attr,
+				     int *adaptive);
+
+int pthread_mutexattr_setadaptive_np(pthread_mutexattr_t *attr, int adaptive);
+
+int pthread_mutex_getstats_np(pthread_mutex_t *mutex,
+			      struct pthread_mutex_stats_np *stats);
+
 int pthread_getschedparam_ex(pthread_t tid,
 			     int *pol,
 			     struct sched_param_ex *par);
@@ -105,6 +105,13 @@
 #define __pse51_thread_setschedparam_ex	78
 #define __pse51_thread_getschedparam_ex	79
 #define __pse51_sched_setconfig_np	80
+#define __pse51_mq_zcinfo		81
+#define __pse51_mq_zcwait		82
+#define __pse51_mq_zcwake		83
+#define __pse51_timer_setslack_np	84
+#define __pse51_mutexattr_getadaptive_np 85
+#define __pse51_mutexattr_setadaptive_np 86
+#define __pse51_thread_getrelstat_np	87
 
 #ifdef __KERNEL__
 
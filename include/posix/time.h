@@ -150,4 +150,14 @@ int __real_timer_getoverrun(timer_t timerid);
 
 #endif /* !(__KERNEL__ || __XENO_SIM__) */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int timer_setslack_np(timer_t timerid, const struct timespec *slack);
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* _XENO_POSIX_TIME_H */
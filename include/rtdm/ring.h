@@ -0,0 +1,201 @@
+/**
+ * @file
+ * Asynchronous submission/completion rings for RTDM devices
+ */
+
+#ifndef _RTDM_RING_H
+#define _RTDM_RING_H
+
+#include <rtdm/rtdm.h>
+
+/*!
+ * @ingroup userapi
+ * @defgroup ring Submission/Completion Rings
+ *
+ * A ring lets a single thread keep many I/O requests in flight on
+ * RTDM file descriptors. The application queues requests into the
+ * submission queue (SQ) of a ring shared with the kernel, and collects
+ * their outcome from the completion queue (CQ). Requests are carried
+ * out by a pool of kernel RTDM tasks attached to the ring, so a
+ * blocking driver operation only stalls one worker, not the
+ * submitter.
+ *
+ * Data is exchanged through a registered buffer area, which is part of
+ * the shared mapping: requests refer to a buffer by index and offset,
+ * never by pointer.
+ *
+ * @{
+ */
+
+/*!
+ * @anchor RTDM_RING_OP_xxx @name Ring Operations
+ * Operation codes of submission queue entries
+ * @{
+ */
+#define RTDM_RING_OP_NOP		0
+#define RTDM_RING_OP_READ		1
+#define RTDM_RING_OP_WRITE		2
+#define RTDM_RING_OP_RECVMSG		3
+#define RTDM_RING_OP_SENDMSG		4
+/** @} */
+
+/*!
+ * @anchor RTDM_RING_MAX_xxx @name Ring Limits
+ * @{
+ */
+/** Number of rings a process may own at the same time */
+#define RTDM_RING_MAX			8
+/** Maximum number of submission queue entries */
+#define RTDM_RING_MAX_ENTRIES		4096
+/** Maximum number of kernel workers serving a ring */
+#define RTDM_RING_MAX_WORKERS		32
+/** Maximum size of a single registered buffer */
+#define RTDM_RING_MAX_BUFSZ		65536
+/** @} */
+
+/** Submission queue entry */
+struct rtdm_ring_sqe {
+	/** Operation, see @ref RTDM_RING_OP_xxx */
+	unsigned int opcode;
+	/** Target file descriptor */
+	int fd;
+	/** Index of the registered buffer holding the data */
+	unsigned int buf;
+	/** Offset of the data within the buffer */
+	unsigned int off;
+	/** Length of the data */
+	unsigned int len;
+	/** Flags passed to recvmsg/sendmsg */
+	int msg_flags;
+	/** Offset of the socket address within the buffer (msg ops) */
+	unsigned int addr_off;
+	/** Length of the socket address, 0 if none (msg ops) */
+	unsigned int addr_len;
+	/** Opaque value copied to the completion entry */
+	unsigned long long user_data;
+};
+
+/** Completion queue entry */
+struct rtdm_ring_cqe {
+	/** Value of the originating submission entry */
+	unsigned long long user_data;
+	/** Return value of the operation, negative error code on failure */
+	long long res;
+	/** Length of the returned socket address (recvmsg), 0 otherwise */
+	unsigned int addr_len;
+	unsigned int __pad;
+};
+
+/**
+ * Shared ring header, at the start of the mapping. The application
+ * owns sq_tail and cq_head, the kernel owns sq_head and cq_tail; each
+ * side only reads the indexes owned by its peer. Indexes are free
+ * running, entries are addressed modulo the queue size.
+ */
+struct rtdm_ring_shared {
+	unsigned int sq_head;	/* Next SQE to be consumed by a worker. */
+	unsigned int sq_tail;	/* Next SQE to be filled by the application. */
+	unsigned int cq_head;	/* Next CQE to be consumed by the application. */
+	unsigned int cq_tail;	/* Next CQE to be posted by a worker. */
+	unsigned int sq_entries;
+	unsigned int cq_entries;
+	unsigned int nr_bufs;
+	unsigned int buf_size;
+	unsigned long sqes;	/* Offset of the SQE array. */
+	unsigned long cqes;	/* Offset of the CQE array. */
+	unsigned long bufs;	/* Offset of the registered buffers. */
+};
+
+/** Ring creation parameters */
+struct rtdm_ring_params {
+	/** Number of SQEs, a power of two. The CQ is twice as large. */
+	unsigned int sq_entries;
+	/** Number of registered buffers */
+	unsigned int nr_bufs;
+	/** Size of each registered buffer */
+	unsigned int buf_size;
+	/** Number of kernel workers, i.e. of concurrently executing requests */
+	unsigned int nr_workers;
+	/** Priority of the kernel workers */
+	int priority;
+};
+
+/** @} */
+
+#if defined(__KERNEL__) || defined(__XENO_SIM__) || defined(__IN_XENO__)
+
+#include <nucleus/heap.h>
+
+/* Mapping information returned by the __rtdm_ring_setup syscall. */
+struct rtdm_ring_info {
+	int ring;
+	struct xnheap_desc hdesc;
+	unsigned long offset;
+};
+
+#endif /* __KERNEL__ || __XENO_SIM__ || __IN_XENO__ */
+
+#ifndef __KERNEL__
+
+/**
+ * @ingroup ring
+ * Application side of a ring.
+ */
+typedef struct rt_dev_ring {
+	int id;
+	struct rtdm_ring_shared *shared;
+	struct rtdm_ring_sqe *sqes;
+	struct rtdm_ring_cqe *cqes;
+	char *bufs;
+	unsigned int sq_mask;
+	unsigned int cq_mask;
+	unsigned int sq_tail;		/* Local tail, published on submit. */
+	unsigned int sq_submitted;	/* Entries accepted by the kernel. */
+	void *mapbase;
+	unsigned long mapsize;
+} rt_dev_ring_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int rt_dev_ring_setup(rt_dev_ring_t *ring,
+		      const struct rtdm_ring_params *params);
+int rt_dev_ring_destroy(rt_dev_ring_t *ring);
+struct rtdm_ring_sqe *rt_dev_ring_get_sqe(rt_dev_ring_t *ring);
+int rt_dev_ring_submit(rt_dev_ring_t *ring, unsigned int min_complete,
+		       nanosecs_rel_t timeout);
+struct rtdm_ring_cqe *rt_dev_ring_peek_cqe(rt_dev_ring_t *ring);
+int rt_dev_ring_wait_cqe(rt_dev_ring_t *ring, struct rtdm_ring_cqe **cqep,
+			 nanosecs_rel_t timeout);
+void rt_dev_ring_cqe_seen(rt_dev_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline void *rt_dev_ring_buffer(rt_dev_ring_t *ring, unsigned int buf)
+{
+	return ring->bufs + (unsigned long)buf * ring->shared->buf_size;
+}
+
+static inline void rt_dev_ring_prep_rw(struct rtdm_ring_sqe *sqe,
+				       unsigned int opcode, int fd,
+				       unsigned int buf, unsigned int off,
+				       unsigned int len,
+				       unsigned long long user_data)
+{
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->buf = buf;
+	sqe->off = off;
+	sqe->len = len;
+	sqe->msg_flags = 0;
+	sqe->addr_off = 0;
+	sqe->addr_len = 0;
+	sqe->user_data = user_data;
+}
+
+#endif /* !__KERNEL__ */
+
+#endif /* _RTDM_RING_H */
@@ -910,6 +910,10 @@ int rtdm_irq_request(rtdm_irq_t *irq_handle, unsigned int irq_no,
 		     rtdm_irq_handler_t handler, unsigned long flags,
 		     const char *device_name, void *arg);
 
+int rtdm_irq_request_threaded(rtdm_irq_t *irq_handle, unsigned int irq_no,
+			      rtdm_irq_handler_t handler, unsigned long flags,
+			      const char *device_name, void *arg, int prio);
+
 #ifndef DOXYGEN_CPP /* Avoid static inline tags for RTDM in doxygen */
 static inline int rtdm_irq_free(rtdm_irq_t *irq_handle)
 {
@@ -926,6 +930,12 @@ static inline int rtdm_irq_disable(rtdm_irq_t *irq_handle)
 {
 	return xnintr_disable(irq_handle);
 }
+
+static inline void rtdm_irq_set_probe(rtdm_irq_t *irq_handle,
+				      rtdm_irq_handler_t probe)
+{
+	xnintr_set_probe(irq_handle, probe);
+}
 #endif /* !DOXYGEN_CPP */
 
 /* --- non-real-time signalling services --- */
@@ -1254,6 +1264,136 @@ static inline void rtdm_mutex_destroy(rtdm_mutex_t *mutex)
 }
 #endif /* !DOXYGEN_CPP */
 
+/* --- packet buffer services --- */
+
+/*!
+ * @addtogroup rtdmpbuf
+ * @{
+ */
+
+struct rtdm_pbuf_pool;
+
+/**
+ * Packet buffer descriptor
+ *
+ * Descriptors live apart from the payload area of their pool, so that
+ * the latter can be mapped to user-space without exposing them.
+ */
+struct rtdm_pbuf {
+	/** Next segment of a scatter chain, NULL on the last one */
+	struct rtdm_pbuf *next;
+	/** Queueing hook, free for use by the current owner */
+	struct list_head link;
+	/** Start of the payload */
+	unsigned char *data;
+	/** Payload length in this segment */
+	size_t len;
+	/** Scratch area, free for use by the current owner */
+	unsigned long cb[4];
+
+	/* Internal use only */
+	struct rtdm_pbuf_pool *pool;
+	unsigned char *head;
+	atomic_t refs;
+	struct rtdm_pbuf *nextfree;
+};
+
+struct rtdm_pbuf_cpu;
+
+/**
+ * Packet buffer pool
+ */
+struct rtdm_pbuf_pool {
+	/* Internal use only */
+	unsigned char *area;
+	size_t area_size;
+	size_t buf_size;
+	unsigned int nr_bufs;
+	atomic_t avail;
+	struct rtdm_pbuf *descs;
+	struct rtdm_pbuf_cpu *cpus;
+};
+/** @} rtdmpbuf */
+
+int rtdm_pbuf_pool_init(struct rtdm_pbuf_pool *pool,
+			unsigned int nr_bufs, size_t buf_size);
+void rtdm_pbuf_pool_destroy(struct rtdm_pbuf_pool *pool);
+struct rtdm_pbuf *rtdm_pbuf_alloc(struct rtdm_pbuf_pool *pool,
+				  size_t headroom);
+int rtdm_pbuf_alloc_chain(struct rtdm_pbuf_pool *pool, size_t len,
+			  size_t headroom, struct rtdm_pbuf **ppbuf);
+void rtdm_pbuf_free(struct rtdm_pbuf *pbuf);
+ssize_t rtdm_pbuf_copy_from_iov(rtdm_user_info_t *user_info,
+				struct rtdm_pbuf *pbuf,
+				struct iovec *iov, int iovlen, size_t len);
+ssize_t rtdm_pbuf_copy_to_iov(rtdm_user_info_t *user_info,
+			      struct rtdm_pbuf *pbuf, size_t offset,
+			      struct iovec *iov, int iovlen, size_t len);
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+int rtdm_pbuf_pool_mmap(struct rtdm_pbuf_pool *pool,
+			rtdm_user_info_t *user_info, int prot, void **pptr);
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+#ifndef DOXYGEN_CPP /* Avoid static inline tags for RTDM in doxygen */
+static inline void rtdm_pbuf_get(struct rtdm_pbuf *pbuf)
+{
+	atomic_inc(&pbuf->refs);
+}
+
+static inline size_t rtdm_pbuf_headroom(struct rtdm_pbuf *pbuf)
+{
+	return pbuf->data - pbuf->head;
+}
+
+static inline size_t rtdm_pbuf_tailroom(struct rtdm_pbuf *pbuf)
+{
+	return pbuf->pool->buf_size - rtdm_pbuf_headroom(pbuf) - pbuf->len;
+}
+
+static inline unsigned char *rtdm_pbuf_append(struct rtdm_pbuf *pbuf,
+					      size_t len)
+{
+	unsigned char *tail = pbuf->data + pbuf->len;
+
+	pbuf->len += len;
+
+	return tail;
+}
+
+static inline unsigned char *rtdm_pbuf_push(struct rtdm_pbuf *pbuf,
+					    size_t len)
+{
+	pbuf->data -= len;
+	pbuf->len += len;
+
+	return pbuf->data;
+}
+
+static inline unsigned char *rtdm_pbuf_pull(struct rtdm_pbuf *pbuf,
+					    size_t len)
+{
+	pbuf->data += len;
+	pbuf->len -= len;
+
+	return pbuf->data;
+}
+
+static inline size_t rtdm_pbuf_chain_len(struct rtdm_pbuf *pbuf)
+{
+	size_t len = 0;
+
+	for (; pbuf; pbuf = pbuf->next)
+		len += pbuf->len;
+
+	return len;
+}
+
+static inline unsigned long rtdm_pbuf_offset(struct rtdm_pbuf *pbuf)
+{
+	return pbuf->data - pbuf->pool->area;
+}
+#endif /* !DOXYGEN_CPP */
+
 /* --- utility functions --- */
 
 #define rtdm_printk(format, ...)	printk(format, ##__VA_ARGS__)
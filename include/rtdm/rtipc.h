@@ -49,7 +49,7 @@
  * Create an endpoint for communication in the AF_RTIPC domain.
  *
  * @param [in] protocol Any of @ref IPCPROTO_XDDP, @ref IPCPROTO_IDDP,
- * or @ref IPCPROTO_BUFP. @ref IPCPROTO_IPC is also valid, and refers
+ * @ref IPCPROTO_BUFP or @ref IPCPROTO_PSDP. @ref IPCPROTO_IPC is also valid, and refers
  * to the default RTIPC protocol, namely @ref IPCPROTO_IDDP.
  *
  * @return In addition to the standard error codes for @c socket(2),
@@ -157,6 +157,27 @@ int close__AF_RTIPC(int sockfd);
  *   the label string passed to setsockopt() for the @a BUFP_LABEL
  *   option.
  *
+ * - IPCPROTO_PSDP
+ *
+ *   This action publishes a topic within the Xenomai domain, the
+ *   bound socket being its sole publisher.
+ *
+ *   @em sipc_family must be AF_RTIPC, @em sipc_port is either -1,
+ *   or a valid free port number between 0 and
+ *   CONFIG_XENO_OPT_PSDP_NRPORT-1.
+ *
+ *   If @em sipc_port is -1, an available port will be assigned
+ *   automatically. Subscribers shall connect to the same port for
+ *   receiving the messages published on the topic.
+ *
+ * @anchor psdp_label_binding
+ *   If a label was assigned (see @ref PSDP_LABEL) prior to binding
+ *   the socket to a port, a registry link referring to the assigned
+ *   port number will be automatically set up as @c
+ *   /proc/xenomai/registry/rtipc/psdp/@em label, where @em label is
+ *   the label string passed to setsockopt() for the @ref PSDP_LABEL
+ *   option.
+ *
  * @return In addition to the standard error codes for @c
  * bind(2), the following specific error code may be returned:
  *   - -EFAULT (Invalid data address given)
@@ -194,6 +215,12 @@ int bind__AF_RTIPC(int sockfd, const struct sockaddr_ipc *addr,
  * write to the socket will return -EDESTADDRREQ, until a valid
  * destination address is set via @c connect(2) or @c bind(2).
  *
+ * @ref IPCPROTO_PSDP sockets subscribe to a topic when connecting,
+ * which must be published at the time of the call unless a label is
+ * used; -ECONNREFUSED is returned otherwise. Connecting again leaves
+ * the previous topic first. Connecting a PSDP socket is a non-RT
+ * operation.
+ *
  * @return In addition to the standard error codes for @c connect(2),
  * the following specific error code may be returned:
  * none.
@@ -216,6 +243,7 @@ int connect__AF_RTIPC(int sockfd, const struct sockaddr_ipc *addr,
  * - Level @ref sockopts_xddp "SOL_XDDP"
  * - Level @ref sockopts_iddp "SOL_IDDP"
  * - Level @ref sockopts_bufp "SOL_BUFP"
+ * - Level @ref sockopts_psdp "SOL_PSDP"
  * .
  *
  * @return In addition to the standard error codes for @c
@@ -240,6 +268,7 @@ int setsockopt__AF_RTIPC(int sockfd, int level, int optname,
  * - Level @ref sockopts_xddp "SOL_XDDP"
  * - Level @ref sockopts_iddp "SOL_IDDP"
  * - Level @ref sockopts_bufp "SOL_BUFP"
+ * - Level @ref sockopts_psdp "SOL_PSDP"
  * .
  *
  * @return In addition to the standard error codes for @c
@@ -283,6 +312,10 @@ int getsockopt__AF_RTIPC(int sockfd, int level, int optname,
  * @note No RTIPC protocol allows for short writes, and only complete
  * messages are sent to the peer.
  *
+ * @note @ref IPCPROTO_PSDP sockets may only send to the topic they
+ * are bound to, which is copied once and shared by all current
+ * subscribers. Passing a destination address yields -EISCONN.
+ *
  * @return In addition to the standard error codes for @c sendmsg(2),
  * the following specific error code may be returned:
  * none.
@@ -313,6 +346,10 @@ ssize_t sendmsg__AF_RTIPC(int sockfd, const struct msghdr *msg, int flags);
  * BUFP_BUFSZ. In that case, a short read is allowed to prevent a
  * deadlock.
  *
+ * @note @ref IPCPROTO_PSDP messages are shared between subscribers,
+ * so a short read discards the excess data, and MSG_TRUNC is set
+ * in @a msg->msg_flags.
+ *
  * @return In addition to the standard error codes for @c recvmsg(2),
  * the following specific error code may be returned:
  * none.
@@ -437,6 +474,21 @@ enum {
  * writers waiting for each other indefinitely).
  */
 	IPCPROTO_BUFP = 3,
+/**
+ * Publish/subscribe datagram protocol (RT -> RT, one-to-many).
+ *
+ * The RTDM-based PSDP protocol broadcasts datagrams from a publisher
+ * socket to any number of subscriber sockets, within the Xenomai
+ * domain. Each message is copied once into a shared buffer, which
+ * all subscribers reference until they read it.
+ *
+ * Every subscriber owns a bounded input ring (see @ref
+ * PSDP_DEPTH). When a subscriber lags behind, its oldest pending
+ * message is overwritten and an overrun is accounted (see @ref
+ * PSDP_OVERRUNS), so that slow readers never hold back the
+ * publisher nor other subscribers.
+ */
+	IPCPROTO_PSDP = 4,
 	IPCPROTO_MAX
 };
 /** @} */
@@ -650,7 +702,9 @@ struct sockaddr_ipc {
  *
  * XDDP_EVTOUT is sent when the non real-time endpoint successfully
  * reads a complete message (i.e. via /dev/rtp@em N). The argument is
- * the size of the outgoing message.
+ * the size of the outgoing message. When the non real-time endpoint
+ * consumes messages from a shared ring (XNPIPEIOC_RING), the event is
+ * sent as soon as a message is copied to the ring instead.
  */
 #define XDDP_EVTOUT		2
 /**
@@ -715,11 +769,13 @@ struct sockaddr_ipc {
  * IDDP local pool size configuration
  *
  * By default, the memory needed to convey the data is pulled from
- * Xenomai's system pool. Setting a local pool size overrides this
- * default for the socket.
+ * the IDDP system pool, which CONFIG_XENO_OPT_IDDP_POOLSZ sizes.
+ * Setting a local pool size overrides this default for the socket.
  *
  * If a non-zero size was configured, a local pool is allocated at
  * binding time. This pool will provide storage for pending datagrams.
+ * Sending a datagram larger than the pool of the receiving socket
+ * fails with -ENOBUFS.
  *
  * It is not allowed to configure a local pool size after the socket
  * was bound. However, multiple configuration calls are allowed prior
@@ -816,6 +872,131 @@ struct sockaddr_ipc {
 #define BUFP_BUFSZ		2
 /** @} */
 
+#define SOL_PSDP		314
+/**
+ * @anchor sockopts_psdp @name PSDP socket options
+ * Setting and getting PSDP socket options.
+ * @{ */
+/**
+ * PSDP label assignment
+ *
+ * ASCII label strings can be attached to PSDP topics, in order to
+ * subscribe to them in a more descriptive way than using plain
+ * numeric port values.
+ *
+ * When available, this label will be registered when binding, in
+ * addition to the port number (see @ref psdp_label_binding
+ * "PSDP port binding"). A subscriber connecting to port -1 waits
+ * for a topic to be published under the label it was given.
+ *
+ * It is not allowed to assign a label after the socket was
+ * bound. However, multiple assignment calls are allowed prior to the
+ * binding; the last label set will be used.
+ *
+ * @param [in] level @ref sockopts_psdp "SOL_PSDP"
+ * @param [in] optname @b PSDP_LABEL
+ * @param [in] optval Pointer to struct rtipc_port_label
+ * @param [in] optlen sizeof(struct rtipc_port_label)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define PSDP_LABEL		1
+/**
+ * PSDP local pool size configuration
+ *
+ * By default, the memory needed to convey the published messages is
+ * pulled from Xenomai's system pool. Setting a local pool size
+ * overrides this default for the topic.
+ *
+ * If a non-zero size was configured, a local pool is allocated at
+ * binding time. This pool will provide storage for the messages not
+ * yet read by all subscribers, and should be sized accordingly.
+ *
+ * It is not allowed to configure a local pool size after the socket
+ * was bound. However, multiple configuration calls are allowed prior
+ * to the binding; the last value set will be used.
+ *
+ * @note: the pool memory is obtained from the host allocator by the
+ * @ref bind__AF_RTIPC "bind call".
+ *
+ * @param [in] level @ref sockopts_psdp "SOL_PSDP"
+ * @param [in] optname @b PSDP_POOLSZ
+ * @param [in] optval Pointer to a variable of type size_t, containing
+ * the required size of the local pool to reserve at binding time
+ * @param [in] optlen sizeof(size_t)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid or *@a optval is zero)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define PSDP_POOLSZ		2
+/**
+ * PSDP subscriber ring depth
+ *
+ * Defines how many published messages a subscriber may leave unread
+ * before the oldest one is overwritten. The default depth is 16
+ * messages.
+ *
+ * It is not allowed to change the depth while the socket is
+ * subscribed to a topic; the value set applies to the next
+ * connection.
+ *
+ * @param [in] level @ref sockopts_psdp "SOL_PSDP"
+ * @param [in] optname @b PSDP_DEPTH
+ * @param [in] optval Pointer to a variable of type int, containing
+ * the ring depth
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already connected)
+ * - -EINVAL (@a optlen is invalid or *@a optval is not in the
+ *   [1..4096] range)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define PSDP_DEPTH		3
+/**
+ * PSDP subscriber overrun count
+ *
+ * Returns the number of messages this subscriber lost since it
+ * connected to its topic, because its input ring was full when they
+ * were published. This option can only be read.
+ *
+ * @param [in] level @ref sockopts_psdp "SOL_PSDP"
+ * @param [in] optname @b PSDP_OVERRUNS
+ * @param [out] optval Pointer to a variable of type unsigned long
+ * @param [in] optlen sizeof(unsigned long)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define PSDP_OVERRUNS		4
+/** @} */
+
 /**
  * @anchor sockopts_socket @name Socket level options
  * Setting and getting supported standard socket level options.
@@ -851,6 +1032,7 @@ struct sockaddr_ipc {
 /** @example bufp-label.c */
 /** @example iddp-label.c */
 /** @example iddp-sendrecv.c */
+/** @example psdp-fanout.c */
 /** @example xddp-echo.c */
 /** @example xddp-label.c */
 /** @example xddp-stream.c */
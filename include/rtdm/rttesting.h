@@ -99,6 +99,58 @@ typedef struct rttst_tmbench_config {
 	int freeze_max;
 } rttst_tmbench_config_t;
 
+/*
+ * Log-linear histogram layout, selected by passing a zero
+ * histogram_bucketsize to RTTST_RTIOC_TMBENCH_START. Latencies are
+ * recorded in nanoseconds; values below RTTST_HDR_SUB_COUNT get one
+ * cell each, every further power of two is split into
+ * RTTST_HDR_SUB_COUNT / 2 linear cells. This bounds the relative
+ * error of any cell to 1/64, from a few hundred nanoseconds up to
+ * 2^RTTST_HDR_MAX_BITS ns (~16.7 ms) excluded. One more cell, the
+ * last one, collects everything from 2^RTTST_HDR_MAX_BITS ns
+ * upwards. Histograms must have RTTST_HDR_CELLS cells.
+ */
+#define RTTST_HDR_SUB_BITS		7
+#define RTTST_HDR_SUB_COUNT		(1 << RTTST_HDR_SUB_BITS)
+#define RTTST_HDR_MAX_BITS		24
+#define RTTST_HDR_CELLS \
+	((RTTST_HDR_MAX_BITS - RTTST_HDR_SUB_BITS + 2) * \
+	 (RTTST_HDR_SUB_COUNT / 2) + 1)
+
+static inline int rttst_hdr_index(unsigned long ns)
+{
+	int shift;
+
+	if (ns < RTTST_HDR_SUB_COUNT)
+		return ns;
+
+	if (ns >= 1UL << RTTST_HDR_MAX_BITS)
+		return RTTST_HDR_CELLS - 1;
+
+	shift = sizeof(ns) * 8 - __builtin_clzl(ns) - RTTST_HDR_SUB_BITS;
+
+	return shift * (RTTST_HDR_SUB_COUNT / 2) + (ns >> shift);
+}
+
+/* Lowest value recorded by a cell. */
+static inline unsigned long rttst_hdr_lowest(int index)
+{
+	int shift;
+
+	if (index < RTTST_HDR_SUB_COUNT)
+		return index;
+
+	shift = index / (RTTST_HDR_SUB_COUNT / 2) - 1;
+
+	return (unsigned long)(index - shift * (RTTST_HDR_SUB_COUNT / 2)) << shift;
+}
+
+/* Highest value recorded by a cell (the last cell is open-ended). */
+static inline unsigned long rttst_hdr_highest(int index)
+{
+	return rttst_hdr_lowest(index + 1) - 1;
+}
+
 #define RTTST_IRQBENCH_USER_TASK	0
 #define RTTST_IRQBENCH_KERNEL_TASK	1
 #define RTTST_IRQBENCH_HANDLER		2
@@ -141,10 +193,64 @@ struct rttst_swtest_error {
 	unsigned fp_val;
 };
 
+/*
+ * Switch leg kinds, for RTTST_RTIOC_SWTEST_GET_LEG_STATS. A leg spans
+ * from the moment a task hands over to another one, until the latter
+ * resumes.
+ */
+#define RTTST_SWTEST_LEG_KK		0 /* kernel -> kernel */
+#define RTTST_SWTEST_LEG_KU		1 /* kernel -> user primary */
+#define RTTST_SWTEST_LEG_UK		2 /* user primary -> kernel */
+#define RTTST_SWTEST_LEG_UU		3 /* user primary -> user primary */
+#define RTTST_SWTEST_LEG_NRT		4 /* from or to secondary mode */
+#define RTTST_SWTEST_LEG_IPI		5 /* cross-CPU wakeup */
+#define RTTST_SWTEST_LEG_KINDS		6
+
+/* FPU handling of the resumed task, combined with the leg kind. */
+#define RTTST_SWTEST_LEG_NOFPU		0 /* no FPU context */
+#define RTTST_SWTEST_LEG_FPU_LAZY	1 /* FPU still owned, only enabled */
+#define RTTST_SWTEST_LEG_FPU_SWITCH	2 /* FPU context saved/restored */
+#define RTTST_SWTEST_LEG_FPU_MODES	3
+
+#define RTTST_SWTEST_LEG_TYPE(kind, fpu) \
+	((kind) * RTTST_SWTEST_LEG_FPU_MODES + (fpu))
+#define RTTST_SWTEST_LEG_TYPES \
+	(RTTST_SWTEST_LEG_KINDS * RTTST_SWTEST_LEG_FPU_MODES)
+
+struct rttst_swtest_leg_stats {
+	unsigned type;		/* in: leg type, see RTTST_SWTEST_LEG_TYPE */
+	unsigned __reserved;
+	unsigned long long count;
+	unsigned long long sum;	/* ns */
+	long min;		/* ns */
+	long max;		/* ns */
+	long *histogram;	/* RTTST_HDR_CELLS cells, may be NULL */
+	void *__padding;	/* align to dwords on 32-bit archs */
+};
+
 #define RTTST_RTDM_NORMAL_CLOSE		0
 #define RTTST_RTDM_DEFER_CLOSE_HANDLER	1
 #define RTTST_RTDM_DEFER_CLOSE_CONTEXT	2
 
+/*
+ * Interrupt checks, run over a virtual IRQ the driver raises itself,
+ * waiting for each IRQ to be served before raising the next one.
+ *
+ * The shared IRQ check chains three handlers in this order: the first
+ * one's probe always rejects the IRQ, the second one claims it, and
+ * the third one never does.
+ */
+#define RTTST_RTDM_IRQ_HANDLERS		3
+
+struct rttst_rtdm_irq_res {
+	unsigned long triggers;	/* in: number of IRQs to raise */
+	unsigned irq;		/* virtual IRQ used */
+	unsigned __reserved;
+	unsigned long hits[RTTST_RTDM_IRQ_HANDLERS]; /* ISR invocations */
+	unsigned long threaded;	/* ... from a handler thread */
+	unsigned long probes;	/* probe invocations */
+};
+
 #define RTIOC_TYPE_TESTING		RTDM_CLASS_TESTING
 
 /*!
@@ -215,8 +321,20 @@ struct rttst_swtest_error {
 #define RTTST_RTIOC_SWTEST_SET_PAUSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x38, unsigned long)
 
+#define RTTST_RTIOC_SWTEST_SET_LEG_STATS \
+	_IOW(RTIOC_TYPE_TESTING, 0x39, unsigned long)
+
+#define RTTST_RTIOC_SWTEST_GET_LEG_STATS \
+	_IOWR(RTIOC_TYPE_TESTING, 0x3a, struct rttst_swtest_leg_stats)
+
 #define RTTST_RTIOC_RTDM_DEFER_CLOSE \
 	_IOW(RTIOC_TYPE_TESTING, 0x40, unsigned long)
+
+#define RTTST_RTIOC_RTDM_IRQ_THREADED \
+	_IOWR(RTIOC_TYPE_TESTING, 0x41, struct rttst_rtdm_irq_res)
+
+#define RTTST_RTIOC_RTDM_IRQ_SHARED \
+	_IOWR(RTIOC_TYPE_TESTING, 0x42, struct rttst_rtdm_irq_res)
 /** @} */
 
 /** @} */
@@ -35,6 +35,9 @@
 #define __rtdm_write		6
 #define __rtdm_recvmsg		7
 #define __rtdm_sendmsg		8
+#define __rtdm_ring_setup	9
+#define __rtdm_ring_enter	10
+#define __rtdm_ring_destroy	11
 
 #ifdef __KERNEL__
 
@@ -57,6 +60,11 @@ static inline void rtdm_syscall_cleanup(void)
 }
 #endif
 
-#endif /* __KERNEL__ */
+#else /* !__KERNEL__ */
+
+/* Shifted skin id, e.g. for XENOMAI_BATCH_SKINCALLn(). */
+extern int __rtdm_muxid;
+
+#endif /* !__KERNEL__ */
 
 #endif /* _RTDM_SYSCALL_H */
@@ -332,6 +332,25 @@ int a4l_buf_put(a4l_subd_t *subd, void *bufdata, unsigned long count)
 	return err;
 }
 
+int a4l_buf_reserve_put(a4l_subd_t *subd,
+			unsigned long count, a4l_buf_span_t *span)
+{
+	a4l_buf_t *buf = subd->buf;
+
+	if (!buf || !test_bit(A4L_SUBD_BUSY_NR, &subd->status))
+		return -ENOENT;
+
+	if (!a4l_subd_is_input(subd))
+		return -EINVAL;
+
+	if (__count_to_put(buf) < count)
+		return -EAGAIN;
+
+	__span(buf, buf->prd_count, count, span);
+
+	return 0;
+}
+
 int a4l_buf_prepare_absget(a4l_subd_t *subd, unsigned long count)
 {
 	a4l_buf_t *buf = subd->buf;
@@ -413,6 +432,27 @@ int a4l_buf_get(a4l_subd_t *subd, void *bufdata, unsigned long count)
 	return err;
 }
 
+int a4l_buf_reserve_get(a4l_subd_t *subd,
+			unsigned long count, a4l_buf_span_t *span)
+{
+	a4l_buf_t *buf = subd->buf;
+
+	/* Basic checkings */
+
+	if (!buf || !test_bit(A4L_SUBD_BUSY_NR, &subd->status))
+		return -ENOENT;
+
+	if (!a4l_subd_is_output(subd))
+		return -EINVAL;
+
+	if (__count_to_get(buf) < count)
+		return -EAGAIN;
+
+	__span(buf, buf->cns_count, count, span);
+
+	return 0;
+}
+
 int a4l_buf_evt(a4l_subd_t *subd, unsigned long evts)
 {
 	a4l_buf_t *buf = subd->buf;
@@ -229,6 +229,7 @@ EXPORT_SYMBOL_GPL(a4l_get_subd);
  * - a4l_buf_prepare_(abs)get() and a4l_buf_commit_(abs)get()
  * - a4l_buf_put()
  * - a4l_buf_get()
+ * - a4l_buf_reserve_put() and a4l_buf_reserve_get()
  * - a4l_buf_evt().
  *
  * The functions count might seem high; however, the developer needs a
@@ -247,6 +248,12 @@ EXPORT_SYMBOL_GPL(a4l_get_subd);
  *   copy between the hardware component and the asynchronous
  *   buffer. In such cases, the functions a4l_buf_get() and
  *   a4l_buf_put() are useful.
+ * - If the driver can produce / consume data in place (a whole scan,
+ *   a FIFO burst, a bounce buffer), the functions
+ *   a4l_buf_reserve_put() and a4l_buf_reserve_get() hand out the
+ *   buffer area as at most two contiguous windows, then the transfer
+ *   is completed with a single call to a4l_buf_commit_put() or
+ *   a4l_buf_commit_get() and a single a4l_buf_evt().
  *
  * @{
  */
@@ -362,6 +369,35 @@ EXPORT_SYMBOL_GPL(a4l_buf_commit_put);
 int a4l_buf_put(a4l_subd_t *subd, void *bufdata, unsigned long count);
 EXPORT_SYMBOL_GPL(a4l_buf_put);
 
+/**
+ * @brief Reserve some room in the buffer for the device driver to
+ * write into
+ *
+ * The function a4l_buf_reserve_put() looks for count bytes of free
+ * room in the Analogy buffer, starting at the current production
+ * point, and describes it by the way of at most two contiguous
+ * windows: the second window is only used when the area wraps around
+ * the end of the ring-buffer. The driver may then fill the windows
+ * directly, without any intermediate copy, and publish the whole
+ * area with a4l_buf_commit_put().
+ *
+ * Nothing is updated by this function; calling it twice without
+ * committing in between returns the same area.
+ *
+ * @param[in] subd Subdevice descriptor structure
+ * @param[in] count The amount of data to reserve
+ * @param[out] span The windows descriptor to fill: span->ptr[i]
+ * and span->size[i] are the address and the size of the i-th window,
+ * span->size[1] is 0 if the area does not wrap
+ *
+ * @return 0 on success, -EAGAIN if less than count bytes are free,
+ * otherwise negative error code.
+ *
+ */
+int a4l_buf_reserve_put(a4l_subd_t *subd,
+			unsigned long count, a4l_buf_span_t *span);
+EXPORT_SYMBOL_GPL(a4l_buf_reserve_put);
+
 /**
  * @brief Update the absolute count of data sent from the buffer to
  * the device since the start of the acquisition and after the next
@@ -475,6 +511,35 @@ EXPORT_SYMBOL_GPL(a4l_buf_commit_get);
 int a4l_buf_get(a4l_subd_t *subd, void *bufdata, unsigned long count);
 EXPORT_SYMBOL_GPL(a4l_buf_get);
 
+/**
+ * @brief Reserve some data in the buffer for the device driver to
+ * read from
+ *
+ * The function a4l_buf_reserve_get() looks for count bytes of data
+ * available in the Analogy buffer, starting at the current
+ * consumption point, and describes them by the way of at most two
+ * contiguous windows: the second window is only used when the area
+ * wraps around the end of the ring-buffer. The driver may then send
+ * the data to the device directly from the windows and release the
+ * whole area with a4l_buf_commit_get().
+ *
+ * Nothing is updated by this function; calling it twice without
+ * committing in between returns the same area.
+ *
+ * @param[in] subd Subdevice descriptor structure
+ * @param[in] count The amount of data to reserve
+ * @param[out] span The windows descriptor to fill: span->ptr[i]
+ * and span->size[i] are the address and the size of the i-th window,
+ * span->size[1] is 0 if the area does not wrap
+ *
+ * @return 0 on success, -EAGAIN if less than count bytes are
+ * available, otherwise negative error code.
+ *
+ */
+int a4l_buf_reserve_get(a4l_subd_t *subd,
+			unsigned long count, a4l_buf_span_t *span);
+EXPORT_SYMBOL_GPL(a4l_buf_reserve_get);
+
 /**
  * @brief Signal some event(s) to a user-space program involved in
  * some read / write operation
@@ -26,6 +26,7 @@
 #include <linux/version.h>
 #include <linux/ioport.h>
 #include <linux/mman.h>
+#include <linux/vmalloc.h>
 #include <asm/div64.h>
 #include <asm/io.h>
 #include <asm/errno.h>
@@ -207,7 +208,11 @@ int a4l_do_special_insn(a4l_cxt_t * cxt, a4l_kinsn_t * dsc)
 	return ret;
 }
 
-int a4l_do_insn(a4l_cxt_t * cxt, a4l_kinsn_t * dsc)
+/* Checks an instruction and looks for the subdevice handler in charge
+   of it */
+static int a4l_check_insn(a4l_cxt_t * cxt, a4l_kinsn_t * dsc,
+			  a4l_subd_t ** subdp,
+			  int (**hdlrp) (a4l_subd_t *, a4l_kinsn_t *))
 {
 	int ret;
 	a4l_subd_t *subd;
@@ -264,12 +269,22 @@ int a4l_do_insn(a4l_cxt_t * cxt, a4l_kinsn_t * dsc)
 	if (hdlr == NULL)
 		return -ENOSYS;
 
+	*subdp = subd;
+	*hdlrp = hdlr;
+
+	return 0;
+}
+
+static int a4l_run_insn(a4l_subd_t * subd,
+			int (*hdlr) (a4l_subd_t *, a4l_kinsn_t *),
+			a4l_kinsn_t * dsc)
+{
+	int ret;
+
 	/* Prevents the subdevice from being used during
 	   the following operations */
-	if (test_and_set_bit(A4L_SUBD_BUSY_NR, &subd->status)) {
-		ret = -EBUSY;
-		goto out_do_insn;
-	}
+	if (test_and_set_bit(A4L_SUBD_BUSY_NR, &subd->status))
+		return -EBUSY;
 
 	/* Let's the driver-specific code perform the instruction */
 	ret = hdlr(subd, dsc);
@@ -279,14 +294,25 @@ int a4l_do_insn(a4l_cxt_t * cxt, a4l_kinsn_t * dsc)
 			  "execution of the instruction failed (err=%d)\n",
 			  ret);
 
-out_do_insn:
-
 	/* Releases the subdevice from its reserved state */
 	clear_bit(A4L_SUBD_BUSY_NR, &subd->status);
 
 	return ret;
 }
 
+int a4l_do_insn(a4l_cxt_t * cxt, a4l_kinsn_t * dsc)
+{
+	int ret;
+	a4l_subd_t *subd;
+	int (*hdlr) (a4l_subd_t *, a4l_kinsn_t *);
+
+	ret = a4l_check_insn(cxt, dsc, &subd, &hdlr);
+	if (ret < 0)
+		return ret;
+
+	return a4l_run_insn(subd, hdlr, dsc);
+}
+
 int a4l_ioctl_insn(a4l_cxt_t * cxt, void *arg)
 {
 	int ret = 0;
@@ -425,4 +451,339 @@ err_ioctl_ilst:
 	return ret;
 }
 
+/* --- Prepared instruction lists --- */
+
+/* A prepared list is checked, allocated and mapped once by
+   a4l_ioctl_insnprep(), then run as many times as needed by
+   a4l_ioctl_insnexec(): the instructions data live in an area shared
+   with the user process, so neither allocation nor copy is needed
+   when the list is executed */
+
+static void a4l_put_insnprep(a4l_kplst_t * prep)
+{
+	if (!atomic_dec_and_test(&prep->refs))
+		return;
+
+	if (prep->data != NULL)
+		vfree(prep->data);
+
+	rtdm_free(prep->insns);
+	rtdm_free(prep);
+}
+
+static void a4l_insnprep_map(struct vm_area_struct *area)
+{
+	a4l_kplst_t *prep = (a4l_kplst_t *)area->vm_private_data;
+	atomic_inc(&prep->refs);
+}
+
+static void a4l_insnprep_unmap(struct vm_area_struct *area)
+{
+	a4l_kplst_t *prep = (a4l_kplst_t *)area->vm_private_data;
+	a4l_put_insnprep(prep);
+}
+
+static struct vm_operations_struct a4l_insnprep_vm_ops = {
+	.open = a4l_insnprep_map,
+	.close = a4l_insnprep_unmap,
+};
+
+int a4l_ioctl_insnprep(a4l_cxt_t * cxt, void *arg)
+{
+	a4l_dev_t *dev = a4l_get_dev(cxt);
+	a4l_insn_t *uinsns = NULL;
+	unsigned long offset;
+	a4l_insnprep_t dsc;
+	a4l_kplst_t *prep;
+	void *uptr = NULL;
+	int i, id = -1, ret;
+
+	/* The allocation and the mapping of the data area cannot be
+	   performed in a real-time context */
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+
+	/* Basic checking */
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_insnprep: unattached device\n");
+		return -EINVAL;
+	}
+
+	ret = rtdm_safe_copy_from_user(cxt->user_info,
+				       &dsc, arg, sizeof(a4l_insnprep_t));
+	if (ret != 0)
+		return ret;
+
+	if (dsc.count == 0 || dsc.count > A4L_PREPARED_INSNS_MAX) {
+		__a4l_err("a4l_ioctl_insnprep: "
+			  "wrong instructions count (%u)\n", dsc.count);
+		return -EINVAL;
+	}
+
+	prep = rtdm_malloc(sizeof(a4l_kplst_t));
+	if (prep == NULL)
+		return -ENOMEM;
+
+	memset(prep, 0, sizeof(a4l_kplst_t));
+	atomic_set(&prep->refs, 1);
+	prep->count = dsc.count;
+	/* Keeps the list from being run or released until it is ready */
+	prep->busy = 1;
+
+	prep->insns = rtdm_malloc(dsc.count * sizeof(a4l_kpinsn_t));
+	uinsns = rtdm_malloc(dsc.count * sizeof(a4l_insn_t));
+	if (prep->insns == NULL || uinsns == NULL) {
+		ret = -ENOMEM;
+		goto err_insnprep;
+	}
+
+	memset(prep->insns, 0, dsc.count * sizeof(a4l_kpinsn_t));
+
+	ret = rtdm_safe_copy_from_user(cxt->user_info, uinsns, dsc.insns,
+				       dsc.count * sizeof(a4l_insn_t));
+	if (ret != 0)
+		goto err_insnprep;
+
+	/* Checks the instructions once for all and computes the
+	   layout of the data area */
+	for (i = 0, offset = 0; i < dsc.count; i++) {
+		a4l_kpinsn_t *pinsn = &prep->insns[i];
+
+		pinsn->insn.type = uinsns[i].type;
+		pinsn->insn.idx_subd = uinsns[i].idx_subd;
+		pinsn->insn.chan_desc = uinsns[i].chan_desc;
+		pinsn->insn.data_size = uinsns[i].data_size;
+
+		if (uinsns[i].data_size != 0 && uinsns[i].data == NULL) {
+			__a4l_err("a4l_ioctl_insnprep: "
+				  "no data pointer specified\n");
+			ret = -EINVAL;
+			goto err_insnprep;
+		}
+
+		if (uinsns[i].data_size > A4L_PREPARED_DATA_MAX) {
+			__a4l_err("a4l_ioctl_insnprep: "
+				  "data size too large (%u)\n",
+				  uinsns[i].data_size);
+			ret = -EINVAL;
+			goto err_insnprep;
+		}
+
+		if ((pinsn->insn.type & A4L_INSN_MASK_SPECIAL) == 0) {
+			ret = a4l_check_insn(cxt, &pinsn->insn,
+					     &pinsn->subd, &pinsn->hdlr);
+			if (ret < 0)
+				goto err_insnprep;
+		}
+
+		pinsn->insn.__udata = (void *)offset;
+		if (offset + ALIGN(pinsn->insn.data_size, sizeof(long long))
+		    < offset) {
+			ret = -EINVAL;
+			goto err_insnprep;
+		}
+		offset += ALIGN(pinsn->insn.data_size, sizeof(long long));
+	}
+
+	if (offset != 0) {
+		prep->data_size = PAGE_ALIGN(offset);
+		prep->data = vmalloc(prep->data_size);
+		if (prep->data == NULL) {
+			ret = -ENOMEM;
+			goto err_insnprep;
+		}
+		memset(prep->data, 0, prep->data_size);
+	}
+
+	/* Sets the data pointers and recovers the values to write */
+	for (i = 0; i < dsc.count; i++) {
+		a4l_kpinsn_t *pinsn = &prep->insns[i];
+
+		offset = (unsigned long)pinsn->insn.__udata;
+		pinsn->insn.data = prep->data + offset;
+
+		if (pinsn->insn.data_size != 0 &&
+		    (pinsn->insn.type & A4L_INSN_MASK_WRITE) != 0) {
+			ret = rtdm_safe_copy_from_user(cxt->user_info,
+						       pinsn->insn.data,
+						       uinsns[i].data,
+						       pinsn->insn.data_size);
+			if (ret != 0)
+				goto err_insnprep;
+		}
+	}
+
+	/* Reserves a slot in the context before mapping the area */
+	RTDM_EXECUTE_ATOMICALLY(
+		for (id = 0; id < A4L_NB_PREPARED_LISTS; id++)
+			if (cxt->preps[id] == NULL) {
+				cxt->preps[id] = prep;
+				break;
+			}
+	);
+
+	if (id == A4L_NB_PREPARED_LISTS) {
+		__a4l_err("a4l_ioctl_insnprep: "
+			  "too many prepared lists on this context\n");
+		id = -1;
+		ret = -EAGAIN;
+		goto err_insnprep;
+	}
+
+	if (prep->data != NULL) {
+		ret = rtdm_mmap_to_user(cxt->user_info,
+					prep->data, prep->data_size,
+					PROT_READ | PROT_WRITE,
+					&uptr, &a4l_insnprep_vm_ops, prep);
+		if (ret < 0) {
+			__a4l_err("a4l_ioctl_insnprep: internal error, "
+				  "rtdm_mmap_to_user failed (err=%d)\n", ret);
+			goto err_insnprep;
+		}
+		/* The mapping holds its own reference */
+		atomic_inc(&prep->refs);
+	}
+
+	/* Lets the user process know where the data of each
+	   instruction are located within the mapped area */
+	for (i = 0; i < dsc.count; i++) {
+		offset = (unsigned long)prep->insns[i].insn.__udata;
+		uinsns[i].data = uptr ? uptr + offset : NULL;
+		prep->insns[i].insn.__udata = uinsns[i].data;
+	}
+
+	ret = rtdm_safe_copy_to_user(cxt->user_info, dsc.insns, uinsns,
+				     dsc.count * sizeof(a4l_insn_t));
+	if (ret != 0)
+		goto err_insnprep;
+
+	dsc.id = id;
+	dsc.data = uptr;
+	dsc.data_size = prep->data_size;
+
+	ret = rtdm_safe_copy_to_user(cxt->user_info,
+				     arg, &dsc, sizeof(a4l_insnprep_t));
+	if (ret != 0)
+		goto err_insnprep;
+
+	rtdm_free(uinsns);
+
+	/* Eventually, the list may be run */
+	RTDM_EXECUTE_ATOMICALLY(prep->busy = 0);
+
+	return 0;
+
+err_insnprep:
+	if (uinsns != NULL)
+		rtdm_free(uinsns);
+
+	/* The caller does not know about the area, so it cannot unmap
+	   it; the unmapping drops the reference of the mapping */
+	if (uptr != NULL)
+		rtdm_munmap(cxt->user_info, uptr, prep->data_size);
+
+	if (id >= 0)
+		RTDM_EXECUTE_ATOMICALLY(cxt->preps[id] = NULL);
+
+	a4l_put_insnprep(prep);
+
+	return ret;
+}
+
+int a4l_ioctl_insnexec(a4l_cxt_t * cxt, void *arg)
+{
+	unsigned int id = (unsigned long)arg;
+	a4l_dev_t *dev = a4l_get_dev(cxt);
+	a4l_kplst_t *prep;
+	int i, ret = 0;
+
+	if (!rtdm_in_rt_context() && rtdm_rt_capable(cxt->user_info))
+		return -ENOSYS;
+
+	/* Basic checking */
+	if (!test_bit(A4L_DEV_ATTACHED_NR, &dev->flags)) {
+		__a4l_err("a4l_ioctl_insnexec: unattached device\n");
+		return -EINVAL;
+	}
+
+	if (id >= A4L_NB_PREPARED_LISTS)
+		return -EINVAL;
+
+	/* Prevents the list from being released while it runs */
+	RTDM_EXECUTE_ATOMICALLY(
+		prep = cxt->preps[id];
+		if (prep == NULL)
+			ret = -EINVAL;
+		else if (prep->busy)
+			ret = -EBUSY;
+		else
+			prep->busy = 1;
+	);
+
+	if (ret < 0)
+		return ret;
+
+	/* Performs the instructions */
+	for (i = 0; i < prep->count && ret == 0; i++) {
+		a4l_kpinsn_t *pinsn = &prep->insns[i];
+		unsigned int idx_subd = pinsn->insn.idx_subd;
+
+		if (pinsn->subd == NULL)
+			ret = a4l_do_special_insn(cxt, &pinsn->insn);
+		else if (idx_subd >= dev->transfer.nb_subd ||
+			 dev->transfer.subds[idx_subd] != pinsn->subd)
+			/* The device was configured again */
+			ret = -EINVAL;
+		else
+			ret = a4l_run_insn(pinsn->subd,
+					   pinsn->hdlr, &pinsn->insn);
+	}
+
+	RTDM_EXECUTE_ATOMICALLY(prep->busy = 0);
+
+	return ret;
+}
+
+int a4l_ioctl_insnrls(a4l_cxt_t * cxt, void *arg)
+{
+	unsigned int id = (unsigned long)arg;
+	a4l_kplst_t *prep;
+	int ret = 0;
+
+	/* Freeing the area cannot be done in a real-time context */
+	if (rtdm_in_rt_context())
+		return -ENOSYS;
+
+	if (id >= A4L_NB_PREPARED_LISTS)
+		return -EINVAL;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		prep = cxt->preps[id];
+		if (prep == NULL)
+			ret = -EINVAL;
+		else if (prep->busy)
+			ret = -EBUSY;
+		else
+			cxt->preps[id] = NULL;
+	);
+
+	if (ret < 0)
+		return ret;
+
+	a4l_put_insnprep(prep);
+
+	return 0;
+}
+
+void a4l_release_insnpreps(a4l_cxt_t * cxt)
+{
+	int id;
+
+	for (id = 0; id < A4L_NB_PREPARED_LISTS; id++)
+		if (cxt->preps[id] != NULL) {
+			a4l_put_insnprep(cxt->preps[id]);
+			cxt->preps[id] = NULL;
+		}
+}
+
 #endif /* !DOXYGEN_CPP */
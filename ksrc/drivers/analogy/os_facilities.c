@@ -51,6 +51,11 @@ nanosecs_abs_t a4l_get_time(void)
 
 /* --- IRQ section --- */
 
+static int irq_prio;
+module_param(irq_prio, int, 0400);
+MODULE_PARM_DESC(irq_prio, "Priority of the IRQ handler tasks "
+		 "(0 runs the handlers from the interrupt context)");
+
 static int a4l_handle_irq(rtdm_irq_t *irq_handle)
 {
 	a4l_irq_desc_t *dsc =
@@ -72,6 +77,16 @@ int __a4l_request_irq(a4l_irq_desc_t *dsc,
 	dsc->cookie = cookie;
 	dsc->irq = irq;
 
+	/* Shared lines cannot be masked on behalf of a single
+	   device, so their handlers always run from the interrupt
+	   context */
+	if (irq_prio > 0 && !(flags & RTDM_IRQTYPE_SHARED))
+		return rtdm_irq_request_threaded(&dsc->rtdm_desc,
+						 (int)irq,
+						 a4l_handle_irq, flags,
+						 "Analogy device", dsc,
+						 irq_prio);
+
 	/* Registers the RT IRQ handler */
 	return rtdm_irq_request(&dsc->rtdm_desc,
 				(int)irq,
@@ -52,7 +52,10 @@ int (*a4l_ioctl_functions[NB_IOCTL_FUNCTIONS]) (a4l_cxt_t *, void *) = {
 	a4l_ioctl_nbchaninfo, 
 	a4l_ioctl_nbrnginfo,
 	a4l_ioctl_bufcfg2,
-	a4l_ioctl_bufinfo2
+	a4l_ioctl_bufinfo2,
+	a4l_ioctl_insnprep,
+	a4l_ioctl_insnexec,
+	a4l_ioctl_insnrls
 };
 
 #ifdef CONFIG_PROC_FS
@@ -148,6 +151,9 @@ int a4l_open(struct rtdm_dev_context *context,
 	   (thanks to minor index) */
 	a4l_set_dev(cxt);
 
+	/* No instruction list was prepared yet */
+	memset(cxt->preps, 0, sizeof(cxt->preps));
+
 	/* Initialize the buffer structure */
 	cxt->buffer = rtdm_malloc(sizeof(a4l_buf_t));
 	a4l_init_buffer(cxt->buffer);
@@ -174,6 +180,9 @@ int a4l_close(struct rtdm_dev_context *context, rtdm_user_info_t * user_info)
 		return err;
 	}
 
+	/* Release the prepared instruction lists */
+	a4l_release_insnpreps(cxt);
+
 	/* Free the buffer which was linked with this context and... */
 	a4l_free_buffer(cxt->buffer);
 
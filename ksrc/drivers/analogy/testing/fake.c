@@ -1,7 +1,16 @@
 #include <linux/module.h>
+#include <asm/div64.h>
 #include <analogy/analogy_driver.h>
 
-#define TASK_PERIOD 1000000
+/* Scan periods down to 100ns are accepted, which means 80MS/s with
+   the 8 channels of the AI subdevice; for such rates, the task period
+   and the buffer size should be tuned so that one task cycle fits in
+   the asynchronous buffer */
+#define AI_MIN_SCAN_PERIOD 100
+
+static unsigned long task_period = 1000000;
+module_param(task_period, ulong, 0444);
+MODULE_PARM_DESC(task_period, "Period of the acquisition task (ns)");
 
 #define AI_SUBD 0
 #define DIO_SUBD 1
@@ -109,23 +118,21 @@ static a4l_cmd_t ao_cmd_mask = {
 
 /* --- Values generation for 1st AI --- */
 
+static uint16_t output_tab[8] = {
+	0x0001, 0x2000, 0x4000, 0x6000,
+	0x8000, 0xa000, 0xc000, 0xffff
+};
+static unsigned int output_idx;
+static a4l_lock_t output_lock = A4L_LOCK_UNLOCKED;
+
 static inline uint16_t ai_value_output(struct ai_priv *priv)
 {
-	static uint16_t output_tab[8] = {
-		0x0001, 0x2000, 0x4000, 0x6000,
-		0x8000, 0xa000, 0xc000, 0xffff
-	};
-	static unsigned int output_idx;
-	static a4l_lock_t output_lock = A4L_LOCK_UNLOCKED;
-
 	unsigned long flags;
 	unsigned int idx;
 
 	a4l_lock_irqsave(&output_lock, flags);
 
-	output_idx += priv->quanta_cnt;
-	if(output_idx == 8)
-		output_idx = 0;
+	output_idx = (output_idx + priv->quanta_cnt) % 8;
 	idx = output_idx;
 
 	a4l_unlock_irqrestore(&output_lock, flags);
@@ -133,38 +140,68 @@ static inline uint16_t ai_value_output(struct ai_priv *priv)
 	return output_tab[idx] / priv->amplitude_div;
 }
 
+/* Fill a contiguous window with the next values of the sequence; the
+   generator lock is only taken once for the whole window */
+static void ai_fill_values(struct ai_priv *priv,
+			   uint16_t *data, unsigned long nbr)
+{
+	unsigned long flags, i;
+	unsigned int idx;
+
+	a4l_lock_irqsave(&output_lock, flags);
+	idx = output_idx;
+	output_idx = (idx + nbr * priv->quanta_cnt) % 8;
+	a4l_unlock_irqrestore(&output_lock, flags);
+
+	for (i = 0; i < nbr; i++) {
+		idx = (idx + priv->quanta_cnt) % 8;
+		data[i] = output_tab[idx] / priv->amplitude_div;
+	}
+}
+
 int ai_push_values(a4l_subd_t *subd)
 {
 	struct ai_priv *priv = (struct ai_priv *)subd->priv;
 	a4l_cmd_t *cmd = a4l_get_cmd(subd);
-	uint64_t now_ns, elapsed_ns = 0;
-	int i = 0;
+	uint64_t now_ns, elapsed_ns;
+	unsigned long scans, count, room;
+	a4l_buf_span_t span;
 
 	if (!cmd)
 		return -EPIPE;
-	
+
 	now_ns = a4l_get_time();
-	elapsed_ns += now_ns - priv->last_ns + priv->reminder_ns;
+	elapsed_ns = now_ns - priv->last_ns + priv->reminder_ns;
 	priv->last_ns = now_ns;
 
-	while(elapsed_ns >= priv->scan_period_ns) {
-		int j;
-				
-		for(j = 0; j < cmd->nb_chan; j++) {
-			uint16_t value = ai_value_output(priv);
-			a4l_buf_put(subd, &value, sizeof(uint16_t));
-		}
-				
-		elapsed_ns -= priv->scan_period_ns;
-		i++;
-	}		       
-
-	priv->current_ns += i * priv->scan_period_ns;
-	priv->reminder_ns = elapsed_ns;
-
-	if (i != 0)
-		a4l_buf_evt(subd, 0);
-	
+	priv->reminder_ns = do_div(elapsed_ns, priv->scan_period_ns);
+	scans = (unsigned long)elapsed_ns;
+	if (scans == 0)
+		return 0;
+
+	priv->current_ns += scans * priv->scan_period_ns;
+
+	/* Whatever does not fit in the asynchronous buffer is
+	   dropped; it is just a test driver */
+	count = scans * cmd->nb_chan * sizeof(uint16_t);
+	room = a4l_buf_count(subd) & ~(sizeof(uint16_t) - 1);
+	if (count > room)
+		count = room;
+
+	/* Generate the values in place, then publish all the scans at
+	   once; a failure means that the acquisition is being
+	   cancelled */
+	if (count == 0 || a4l_buf_reserve_put(subd, count, &span) < 0)
+		return 0;
+
+	ai_fill_values(priv, span.ptr[0], span.size[0] / sizeof(uint16_t));
+	if (span.size[1] != 0)
+		ai_fill_values(priv,
+			       span.ptr[1], span.size[1] / sizeof(uint16_t));
+
+	a4l_buf_commit_put(subd, count);
+	a4l_buf_evt(subd, 0);
+
 	return 0;
 }
 
@@ -253,7 +290,7 @@ static void task_proc(void *arg)
 		if (running && ai2_push_values(ai2_subd) < 0)
 			break;
 
-		a4l_task_sleep(TASK_PERIOD);
+		a4l_task_sleep(task_period);
 	}
 }
 
@@ -287,7 +324,7 @@ static int ai_cmdtest(a4l_subd_t *subd, a4l_cmd_t *cmd)
 {
 	if(cmd->scan_begin_src == TRIG_TIMER)
 	{
-		if (cmd->scan_begin_arg < 1000)
+		if (cmd->scan_begin_arg < AI_MIN_SCAN_PERIOD)
 			return -EINVAL;
 
 		if (cmd->convert_src == TRIG_TIMER &&
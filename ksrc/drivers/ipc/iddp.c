@@ -22,8 +22,6 @@
 #include <linux/list.h>
 #include <linux/kernel.h>
 #include <linux/vmalloc.h>
-#include <nucleus/heap.h>
-#include <nucleus/bufd.h>
 #include <nucleus/map.h>
 #include <rtdm/rtipc.h>
 #include "internal.h"
@@ -32,21 +30,24 @@
 
 #define IDDP_SOCKET_MAGIC 0xa37a37a8
 
-struct iddp_message {
-	struct list_head next;
-	int from;
-	size_t rdoff;
-	size_t len;
-	char data[];
-};
+/*
+ * Datagrams are carried by chains of packet buffers, queued by their
+ * heading buffer. The latter keeps the datagram state in its
+ * scratch area.
+ */
+#define IDDP_SEGSZ  512
+
+#define iddp_mbuf_from(mbuf)   ((mbuf)->cb[0])
+#define iddp_mbuf_rdoff(mbuf)  ((mbuf)->cb[1])
+#define iddp_mbuf_len(mbuf)    ((mbuf)->cb[2])
 
 struct iddp_socket {
 	int magic;
 	struct sockaddr_ipc name;
 	struct sockaddr_ipc peer;
 
-	struct xnheap *bufpool;
-	struct xnheap privpool;
+	struct rtdm_pbuf_pool *bufpool;
+	struct rtdm_pbuf_pool privpool;
 	rtdm_event_t *poolevt;
 	rtdm_event_t privevt;
 	int *poolwait;
@@ -72,6 +73,8 @@ static struct sockaddr_ipc nullsa = {
 
 static struct xnmap *portmap;
 
+static struct rtdm_pbuf_pool syspool;
+
 static rtdm_event_t poolevt;
 
 static int poolwait;
@@ -117,33 +120,30 @@ static struct xnpnode_link __iddp_pnode = {
 
 #endif /* !CONFIG_XENO_OPT_VFILE */
 
-static inline void __iddp_init_mbuf(struct iddp_message *mbuf, size_t len)
-{
-	mbuf->rdoff = 0;
-	mbuf->len = len;
-	INIT_LIST_HEAD(&mbuf->next);
-}
-
-static struct iddp_message *
+static struct rtdm_pbuf *
 __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 		  nanosecs_rel_t timeout, int flags, int *pret)
 {
-	struct iddp_message *mbuf = NULL;
+	struct rtdm_pbuf *mbuf = NULL;
 	rtdm_toseq_t timeout_seq;
 	int ret = 0;
 
 	rtdm_toseq_init(&timeout_seq, timeout);
 
 	for (;;) {
-		mbuf = xnheap_alloc(sk->bufpool, len + sizeof(*mbuf));
-		if (mbuf) {
-			__iddp_init_mbuf(mbuf, len);
+		ret = rtdm_pbuf_alloc_chain(sk->bufpool, len, 0, &mbuf);
+		if (ret == 0) {
+			iddp_mbuf_rdoff(mbuf) = 0;
+			iddp_mbuf_len(mbuf) = len;
 			break;
 		}
-		if (flags & MSG_DONTWAIT) {
-			ret = -EAGAIN;
+		if (ret != -EAGAIN) {
+			/* The pool could never hold this datagram. */
+			ret = -ENOBUFS;
 			break;
 		}
+		if (flags & MSG_DONTWAIT)
+			break;
 		/*
 		 * No luck, no buffer free. Wait for a buffer to be
 		 * released and retry. Admittedly, we might create a
@@ -175,9 +175,9 @@ __iddp_alloc_mbuf(struct iddp_socket *sk, size_t len,
 }
 
 static void __iddp_free_mbuf(struct iddp_socket *sk,
-			     struct iddp_message *mbuf)
+			     struct rtdm_pbuf *mbuf)
 {
-	xnheap_free(sk->bufpool, mbuf);
+	rtdm_pbuf_free(mbuf);
 	RTDM_EXECUTE_ATOMICALLY(
 		/* Wake up sleepers if any. */
 		if (*sk->poolwait > 0)
@@ -185,12 +185,6 @@ static void __iddp_free_mbuf(struct iddp_socket *sk,
 	);
 }
 
-static void __iddp_flush_pool(struct xnheap *heap,
-			      void *poolmem, u_long poolsz, void *cookie)
-{
-	xnarch_free_host_mem(poolmem, poolsz);
-}
-
 static int iddp_socket(struct rtipc_private *priv,
 		       rtdm_user_info_t *user_info)
 {
@@ -199,7 +193,7 @@ static int iddp_socket(struct rtipc_private *priv,
 	sk->magic = IDDP_SOCKET_MAGIC;
 	sk->name = nullsa;	/* Unbound */
 	sk->peer = nullsa;
-	sk->bufpool = &kheap;
+	sk->bufpool = &syspool;
 	sk->poolevt = &poolevt;
 	sk->poolwait = &poolwait;
 	sk->poolsz = 0;
@@ -221,7 +215,7 @@ static int iddp_close(struct rtipc_private *priv,
 		      rtdm_user_info_t *user_info)
 {
 	struct iddp_socket *sk = priv->state;
-	struct iddp_message *mbuf;
+	struct rtdm_pbuf *mbuf;
 
 	if (sk->name.sipc_port > -1)
 		xnmap_remove(portmap, sk->name.sipc_port);
@@ -232,16 +226,16 @@ static int iddp_close(struct rtipc_private *priv,
 	if (sk->handle)
 		xnregistry_remove(sk->handle);
 
-	if (sk->bufpool != &kheap) {
-		xnheap_destroy(&sk->privpool, __iddp_flush_pool, NULL);
+	if (sk->bufpool != &syspool) {
+		rtdm_pbuf_pool_destroy(&sk->privpool);
 		return 0;
 	}
 
-	/* Send unread datagrams back to the system heap. */
+	/* Send unread datagrams back to the system pool. */
 	while (!list_empty(&sk->inq)) {
-		mbuf = list_entry(sk->inq.next, struct iddp_message, next);
-		list_del(&mbuf->next);
-		xnheap_free(&kheap, mbuf);
+		mbuf = list_entry(sk->inq.next, struct rtdm_pbuf, link);
+		list_del(&mbuf->link);
+		rtdm_pbuf_free(mbuf);
 	}
 
 	kfree(sk);
@@ -255,11 +249,11 @@ static ssize_t __iddp_recvmsg(struct rtipc_private *priv,
 			      struct sockaddr_ipc *saddr)
 {
 	struct iddp_socket *sk = priv->state;
-	ssize_t maxlen, len, wrlen, vlen;
-	int nvec, rdoff, ret, dofree;
-	struct iddp_message *mbuf;
+	ssize_t maxlen, len, ret;
+	struct rtdm_pbuf *mbuf;
 	nanosecs_rel_t timeout;
-	struct xnbufd bufd;
+	size_t rdoff;
+	int dofree;
 
 	if (!test_bit(_IDDP_BOUND, &sk->status))
 		return -EAGAIN;
@@ -279,54 +273,32 @@ static ssize_t __iddp_recvmsg(struct rtipc_private *priv,
 
 	RTDM_EXECUTE_ATOMICALLY(
 		/* Pull heading message from input queue. */
-		mbuf = list_entry(sk->inq.next, struct iddp_message, next);
-		rdoff = mbuf->rdoff;
-		len = mbuf->len - rdoff;
+		mbuf = list_entry(sk->inq.next, struct rtdm_pbuf, link);
+		rdoff = iddp_mbuf_rdoff(mbuf);
+		len = iddp_mbuf_len(mbuf) - rdoff;
 		if (saddr) {
 			saddr->sipc_family = AF_RTIPC;
-			saddr->sipc_port = mbuf->from;
+			saddr->sipc_port = iddp_mbuf_from(mbuf);
 		}
 		if (maxlen >= len) {
-			list_del(&mbuf->next);
+			list_del(&mbuf->link);
 			dofree = 1;
 		} else {
 			/* Buffer is only partially read: repost. */
-			mbuf->rdoff += maxlen;
+			iddp_mbuf_rdoff(mbuf) += maxlen;
 			len = maxlen;
 			dofree = 0;
 			rtdm_sem_up(&sk->insem);
 		}
 	);
 
-	/* Now, write "len" bytes from mbuf->data to the vector cells */
-	for (nvec = 0, wrlen = len; nvec < iovlen && wrlen > 0; nvec++) {
-		if (iov[nvec].iov_len == 0)
-			continue;
-		vlen = wrlen >= iov[nvec].iov_len ? iov[nvec].iov_len : wrlen;
-#ifdef CONFIG_XENO_OPT_PERVASIVE
-		if (user_info) {
-			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
-			xnbufd_unmap_uread(&bufd);
-		} else
-#endif
-		{
-			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
-			xnbufd_unmap_kread(&bufd);
-		}
-		if (ret < 0)
-			break;
-		iov[nvec].iov_base += vlen;
-		iov[nvec].iov_len -= vlen;
-		wrlen -= vlen;
-		rdoff += vlen;
-	}
+	/* Now, write "len" bytes from the chain to the vector cells */
+	ret = rtdm_pbuf_copy_to_iov(user_info, mbuf, rdoff, iov, iovlen, len);
 
 	if (dofree)
 		__iddp_free_mbuf(sk, mbuf);
 
-	return ret ?: len;
+	return ret < 0 ? ret : len;
 }
 
 static ssize_t iddp_recvmsg(struct rtipc_private *priv,
@@ -390,11 +362,10 @@ static ssize_t __iddp_sendmsg(struct rtipc_private *priv,
 {
 	struct iddp_socket *sk = priv->state, *rsk;
 	struct rtdm_dev_context *rcontext;
-	struct iddp_message *mbuf;
-	ssize_t len, rdlen, vlen;
-	int nvec, wroff, ret;
-	struct xnbufd bufd;
+	struct rtdm_pbuf *mbuf;
+	ssize_t len;
 	void *p;
+	int ret;
 
 	len = rtipc_get_iov_flatlen(iov, iovlen);
 	if (len == 0)
@@ -420,38 +391,17 @@ static ssize_t __iddp_sendmsg(struct rtipc_private *priv,
 		return ret;
 	}
 
-	/* Now, move "len" bytes to mbuf->data from the vector cells */
-	for (nvec = 0, rdlen = len, wroff = 0;
-	     nvec < iovlen && rdlen > 0; nvec++) {
-		if (iov[nvec].iov_len == 0)
-			continue;
-		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
-#ifdef CONFIG_XENO_OPT_PERVASIVE
-		if (user_info) {
-			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
-			xnbufd_unmap_uread(&bufd);
-		} else
-#endif
-		{
-			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
-			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
-			xnbufd_unmap_kread(&bufd);
-		}
-		if (ret < 0)
-			goto fail;
-		iov[nvec].iov_base += vlen;
-		iov[nvec].iov_len -= vlen;
-		rdlen -= vlen;
-		wroff += vlen;
-	}
+	/* Now, move "len" bytes to the chain from the vector cells */
+	ret = rtdm_pbuf_copy_from_iov(user_info, mbuf, iov, iovlen, len);
+	if (ret < 0)
+		goto fail;
 
 	RTDM_EXECUTE_ATOMICALLY(
-		mbuf->from = sk->name.sipc_port;
+		iddp_mbuf_from(mbuf) = sk->name.sipc_port;
 		if (flags & MSG_OOB)
-			list_add(&mbuf->next, &rsk->inq);
+			list_add(&mbuf->link, &rsk->inq);
 		else
-			list_add_tail(&mbuf->next, &rsk->inq);
+			list_add_tail(&mbuf->link, &rsk->inq);
 		rtdm_sem_up(&rsk->insem);
 	);
 
@@ -538,7 +488,6 @@ static int __iddp_bind_socket(struct rtipc_private *priv,
 {
 	struct iddp_socket *sk = priv->state;
 	int ret = 0, port, fd;
-	void *poolmem;
 	size_t poolsz;
 
 	if (sa->sipc_family != AF_RTIPC)
@@ -571,20 +520,11 @@ static int __iddp_bind_socket(struct rtipc_private *priv,
 	 */
 	poolsz = sk->poolsz;
 	if (poolsz > 0) {
-		poolsz = xnheap_rounded_size(poolsz, XNHEAP_PAGE_SIZE);
-		poolmem = xnarch_alloc_host_mem(poolsz);
-		if (poolmem == NULL) {
-			ret = -ENOMEM;
-			goto fail;
-		}
-
-		ret = xnheap_init(&sk->privpool,
-				  poolmem, poolsz, XNHEAP_PAGE_SIZE);
-		if (ret) {
-			xnarch_free_host_mem(poolmem, poolsz);
+		ret = rtdm_pbuf_pool_init(&sk->privpool,
+					  (poolsz + IDDP_SEGSZ - 1) / IDDP_SEGSZ,
+					  IDDP_SEGSZ);
+		if (ret)
 			goto fail;
-		}
-		xnheap_set_label(&sk->privpool, "ippd: %d", port);
 
 		sk->poolevt = &sk->privevt;
 		sk->poolwait = &sk->privwait;
@@ -601,8 +541,7 @@ static int __iddp_bind_socket(struct rtipc_private *priv,
 				       &sk->handle, &__iddp_pnode.node);
 		if (ret) {
 			if (poolsz > 0)
-				xnheap_destroy(&sk->privpool,
-					       __iddp_flush_pool, NULL);
+				rtdm_pbuf_pool_destroy(&sk->privpool);
 			goto fail;
 		}
 	}
@@ -916,10 +855,20 @@ static int iddp_ioctl(struct rtipc_private *priv,
 
 static int iddp_init(void)
 {
+	int ret;
+
 	portmap = xnmap_create(CONFIG_XENO_OPT_IDDP_NRPORT, 0, 0);
 	if (portmap == NULL)
 		return -ENOMEM;
 
+	ret = rtdm_pbuf_pool_init(&syspool,
+				  CONFIG_XENO_OPT_IDDP_POOLSZ * 1024 / IDDP_SEGSZ,
+				  IDDP_SEGSZ);
+	if (ret) {
+		xnmap_delete(portmap);
+		return ret;
+	}
+
 	rtdm_event_init(&poolevt, 0);
 
 	return 0;
@@ -928,6 +877,7 @@ static int iddp_init(void)
 static void iddp_exit(void)
 {
 	rtdm_event_destroy(&poolevt);
+	rtdm_pbuf_pool_destroy(&syspool);
 	xnmap_delete(portmap);
 }
 
@@ -116,6 +116,8 @@ extern struct rtipc_protocol iddp_proto_driver;
 
 extern struct rtipc_protocol bufp_proto_driver;
 
+extern struct rtipc_protocol psdp_proto_driver;
+
 extern struct xnptree rtipc_ptree;
 
 #define rtipc_wait_context		xnthread_wait_context
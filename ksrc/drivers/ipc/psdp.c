@@ -0,0 +1,1146 @@
+/**
+ * This file is part of the Xenomai project.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <linux/module.h>
+#include <linux/list.h>
+#include <linux/kernel.h>
+#include <linux/vmalloc.h>
+#include <nucleus/heap.h>
+#include <nucleus/bufd.h>
+#include <nucleus/map.h>
+#include <rtdm/rtipc.h>
+#include "internal.h"
+
+#define PSDP_SOCKET_MAGIC 0xa37a37b9
+#define PSDP_TOPIC_MAGIC  0xa37a37ba
+
+#define PSDP_DEFAULT_DEPTH  16
+#define PSDP_MAX_DEPTH      4096
+
+/*
+ * A message is written once by the publisher, then referenced from
+ * the input ring of every subscriber. The last subscriber dropping
+ * its reference sends the buffer back to the topic pool.
+ */
+struct psdp_message {
+	struct psdp_message *nextfree;
+	int refs;
+	size_t len;
+	char data[];
+};
+
+struct psdp_topic {
+	int magic;
+	int refs;		/* Publisher + subscribers. */
+	int closed;
+	rtipc_port_t port;
+	xnhandle_t handle;
+
+	struct xnheap *bufpool;
+	struct xnheap privpool;
+	rtdm_event_t *poolevt;
+	rtdm_event_t privevt;
+	int *poolwait;
+	int privwait;
+
+	struct list_head subscribers;
+	int nrsubs;
+};
+
+struct psdp_socket {
+	int magic;
+	struct sockaddr_ipc name;
+	struct sockaddr_ipc peer;
+
+	struct psdp_topic *topic;
+	struct list_head next;	/* Link in topic->subscribers. */
+	struct psdp_message **ring;
+	int depth;
+	int rdidx;
+	int count;
+	unsigned long overruns;	/* Messages lost to a full ring. */
+	rtdm_sem_t insem;
+
+	size_t poolsz;
+	u_long status;
+	char label[XNOBJECT_NAME_LEN];
+
+	nanosecs_rel_t rx_timeout;
+	nanosecs_rel_t tx_timeout;
+	unsigned long stalls;	/* Buffer stall counter. */
+
+	struct rtipc_private *priv;
+};
+
+static struct sockaddr_ipc nullsa = {
+	.sipc_family = AF_RTIPC,
+	.sipc_port = -1
+};
+
+static struct xnmap *portmap;
+
+static rtdm_event_t poolevt;
+
+static int poolwait;
+
+#define _PSDP_BINDING    0
+#define _PSDP_BOUND      1
+#define _PSDP_CONNECTED  2
+
+#ifdef CONFIG_XENO_OPT_VFILE
+
+static char *__psdp_link_target(void *obj)
+{
+	struct psdp_topic *topic = obj;
+	char *buf;
+
+	/* XXX: older kernels don't have kasprintf(). */
+	buf = kmalloc(32, GFP_KERNEL);
+	if (buf == NULL)
+		return buf;
+
+	snprintf(buf, 32, "%d", topic->port);
+
+	return buf;
+}
+
+extern struct xnptree rtipc_ptree;
+
+static struct xnpnode_link __psdp_pnode = {
+	.node = {
+		.dirname = "psdp",
+		.root = &rtipc_ptree,
+		.ops = &xnregistry_vlink_ops,
+	},
+	.target = __psdp_link_target,
+};
+
+#else /* !CONFIG_XENO_OPT_VFILE */
+
+static struct xnpnode_link __psdp_pnode = {
+	.node = {
+		.dirname = "psdp",
+	},
+};
+
+#endif /* !CONFIG_XENO_OPT_VFILE */
+
+static struct psdp_message *
+__psdp_alloc_mbuf(struct psdp_socket *sk, struct psdp_topic *topic,
+		  size_t len, nanosecs_rel_t timeout, int flags, int *pret)
+{
+	struct psdp_message *mbuf = NULL;
+	rtdm_toseq_t timeout_seq;
+	int ret = 0;
+
+	rtdm_toseq_init(&timeout_seq, timeout);
+
+	for (;;) {
+		mbuf = xnheap_alloc(topic->bufpool, len + sizeof(*mbuf));
+		if (mbuf) {
+			mbuf->nextfree = NULL;
+			mbuf->refs = 1;
+			mbuf->len = len;
+			break;
+		}
+		if (flags & MSG_DONTWAIT) {
+			ret = -EAGAIN;
+			break;
+		}
+		/*
+		 * Slow subscribers pin buffers until they read them
+		 * or their ring overruns, so the pool may drain
+		 * temporarily. Wait for a buffer to be released and
+		 * retry.
+		 */
+		RTDM_EXECUTE_ATOMICALLY(
+			++sk->stalls;
+			(*topic->poolwait)++;
+			ret = rtdm_event_timedwait(topic->poolevt,
+						   timeout,
+						   &timeout_seq);
+			(*topic->poolwait)--;
+			if (unlikely(ret == -EIDRM))
+				ret = -ECONNRESET;
+		);
+		if (ret)
+			break;
+	}
+
+	*pret = ret;
+
+	return mbuf;
+}
+
+/* Must be called with nklock held. */
+static inline void __psdp_drop_mbuf(struct psdp_message *mbuf,
+				    struct psdp_message **freelist)
+{
+	if (--mbuf->refs == 0) {
+		mbuf->nextfree = *freelist;
+		*freelist = mbuf;
+	}
+}
+
+static void __psdp_free_mbufs(struct psdp_topic *topic,
+			      struct psdp_message *freelist)
+{
+	struct psdp_message *mbuf;
+
+	if (freelist == NULL)
+		return;
+
+	while (freelist) {
+		mbuf = freelist;
+		freelist = mbuf->nextfree;
+		xnheap_free(topic->bufpool, mbuf);
+	}
+
+	RTDM_EXECUTE_ATOMICALLY(
+		/* Wake up sleepers if any. */
+		if (*topic->poolwait > 0)
+			rtdm_event_pulse(topic->poolevt);
+	);
+}
+
+static void __psdp_flush_pool(struct xnheap *heap,
+			      void *poolmem, u_long poolsz, void *cookie)
+{
+	xnarch_free_host_mem(poolmem, poolsz);
+}
+
+static void __psdp_put_topic(struct psdp_topic *topic)
+{
+	int refs;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		refs = --topic->refs;
+	);
+	if (refs > 0)
+		return;
+
+	if (topic->bufpool != &kheap)
+		xnheap_destroy(&topic->privpool, __psdp_flush_pool, NULL);
+
+	rtdm_event_destroy(&topic->privevt);
+	kfree(topic);
+}
+
+static int psdp_socket(struct rtipc_private *priv,
+		       rtdm_user_info_t *user_info)
+{
+	struct psdp_socket *sk = priv->state;
+
+	sk->magic = PSDP_SOCKET_MAGIC;
+	sk->name = nullsa;	/* Unbound */
+	sk->peer = nullsa;
+	sk->topic = NULL;
+	sk->ring = NULL;
+	sk->depth = PSDP_DEFAULT_DEPTH;
+	sk->rdidx = 0;
+	sk->count = 0;
+	sk->overruns = 0;
+	sk->poolsz = 0;
+	sk->status = 0;
+	sk->rx_timeout = RTDM_TIMEOUT_INFINITE;
+	sk->tx_timeout = RTDM_TIMEOUT_INFINITE;
+	sk->stalls = 0;
+	*sk->label = 0;
+	INIT_LIST_HEAD(&sk->next);
+	rtdm_sem_init(&sk->insem, 0);
+	sk->priv = priv;
+
+	return 0;
+}
+
+/*
+ * Detach a subscriber from its topic, dropping the references it
+ * still holds on unread messages.
+ */
+static void __psdp_unsubscribe(struct psdp_socket *sk)
+{
+	struct psdp_message *freelist = NULL, **ring;
+	struct psdp_topic *topic;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		topic = sk->topic;
+		list_del(&sk->next);
+		topic->nrsubs--;
+		while (sk->count > 0) {
+			__psdp_drop_mbuf(sk->ring[sk->rdidx], &freelist);
+			sk->rdidx = (sk->rdidx + 1) % sk->depth;
+			sk->count--;
+		}
+		ring = sk->ring;
+		sk->ring = NULL;
+		sk->topic = NULL;
+		sk->peer = nullsa;
+		__clear_bit(_PSDP_CONNECTED, &sk->status);
+	);
+
+	__psdp_free_mbufs(topic, freelist);
+	kfree(ring);
+	__psdp_put_topic(topic);
+}
+
+/*
+ * Withdraw a topic, unblocking all subscribers which are notified
+ * with -ECONNRESET. The topic memory lingers until the last
+ * subscriber goes away; each subscriber keeps its input semaphore,
+ * which it destroys when closed.
+ */
+static void __psdp_unpublish(struct psdp_socket *sk)
+{
+	struct psdp_topic *topic = sk->topic;
+	struct psdp_socket *ssk;
+
+	xnmap_remove(portmap, topic->port);
+
+	if (topic->handle)
+		xnregistry_remove(topic->handle);
+
+	RTDM_EXECUTE_ATOMICALLY(
+		topic->closed = 1;
+		list_for_each_entry(ssk, &topic->subscribers, next)
+			__rtdm_synch_flush(&ssk->insem.synch_base, XNBREAK);
+		sk->topic = NULL;
+	);
+
+	__psdp_put_topic(topic);
+}
+
+static int psdp_close(struct rtipc_private *priv,
+		      rtdm_user_info_t *user_info)
+{
+	struct psdp_socket *sk = priv->state;
+
+	if (test_bit(_PSDP_BOUND, &sk->status))
+		__psdp_unpublish(sk);
+	else if (test_bit(_PSDP_CONNECTED, &sk->status))
+		__psdp_unsubscribe(sk);
+
+	rtdm_sem_destroy(&sk->insem);
+	kfree(sk);
+
+	return 0;
+}
+
+static ssize_t __psdp_recvmsg(struct rtipc_private *priv,
+			      rtdm_user_info_t *user_info,
+			      struct iovec *iov, int iovlen, int flags,
+			      struct sockaddr_ipc *saddr, int *truncp)
+{
+	struct psdp_socket *sk = priv->state;
+	struct psdp_message *mbuf = NULL, *freelist = NULL;
+	ssize_t maxlen, len, wrlen, vlen;
+	struct psdp_topic *topic;
+	nanosecs_rel_t timeout;
+	struct xnbufd bufd;
+	int nvec, rdoff, ret;
+
+	if (!test_bit(_PSDP_CONNECTED, &sk->status))
+		return -ENOTCONN;
+
+	maxlen = rtipc_get_iov_flatlen(iov, iovlen);
+	if (maxlen == 0)
+		return 0;
+
+	/*
+	 * We want to pick one reference from the ring. Check for a
+	 * withdrawn topic and go waiting atomically, so that we
+	 * cannot miss the wakeup from __psdp_unpublish().
+	 */
+	timeout = (flags & MSG_DONTWAIT) ? RTDM_TIMEOUT_NONE : sk->rx_timeout;
+	RTDM_EXECUTE_ATOMICALLY(
+		topic = sk->topic;
+		if (topic == NULL || topic->closed)
+			ret = -ECONNRESET;
+		else {
+			ret = rtdm_sem_timeddown(&sk->insem, timeout, NULL);
+			if (ret == -EIDRM ||
+			    (ret == -EINTR && topic->closed))
+				ret = -ECONNRESET;
+		}
+	);
+	if (unlikely(ret))
+		return ret;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		topic = sk->topic;
+		if (unlikely(sk->count == 0))
+			/* Raced with a disconnection. */
+			ret = -ECONNRESET;
+		else {
+			/* The ring reference is now ours. */
+			mbuf = sk->ring[sk->rdidx];
+			sk->rdidx = (sk->rdidx + 1) % sk->depth;
+			sk->count--;
+			if (saddr) {
+				saddr->sipc_family = AF_RTIPC;
+				saddr->sipc_port = topic->port;
+			}
+		}
+	);
+	if (ret)
+		return ret;
+
+	/*
+	 * The message is shared with other subscribers, so we may
+	 * not repost a partially read one: the excess data is lost,
+	 * as with regular truncated datagrams.
+	 */
+	len = mbuf->len;
+	if (len > maxlen) {
+		len = maxlen;
+		if (truncp)
+			*truncp = 1;
+	}
+
+	/* Now, write "len" bytes from mbuf->data to the vector cells */
+	for (nvec = 0, wrlen = len, rdoff = 0;
+	     nvec < iovlen && wrlen > 0; nvec++) {
+		if (iov[nvec].iov_len == 0)
+			continue;
+		vlen = wrlen >= iov[nvec].iov_len ? iov[nvec].iov_len : wrlen;
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+		if (user_info) {
+			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
+			xnbufd_unmap_uread(&bufd);
+		} else
+#endif
+		{
+			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, mbuf->data + rdoff, vlen);
+			xnbufd_unmap_kread(&bufd);
+		}
+		if (ret < 0)
+			break;
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		wrlen -= vlen;
+		rdoff += vlen;
+	}
+
+	RTDM_EXECUTE_ATOMICALLY(
+		__psdp_drop_mbuf(mbuf, &freelist);
+	);
+
+	__psdp_free_mbufs(topic, freelist);
+
+	return ret < 0 ? ret : len;
+}
+
+static ssize_t psdp_recvmsg(struct rtipc_private *priv,
+			    rtdm_user_info_t *user_info,
+			    struct msghdr *msg, int flags)
+{
+	struct iovec iov[RTIPC_IOV_MAX];
+	struct sockaddr_ipc saddr;
+	int trunc = 0;
+	ssize_t ret;
+
+	if (flags & ~MSG_DONTWAIT)
+		return -EINVAL;
+
+	if (msg->msg_name) {
+		if (msg->msg_namelen < sizeof(struct sockaddr_ipc))
+			return -EINVAL;
+	} else if (msg->msg_namelen != 0)
+		return -EINVAL;
+
+	if (msg->msg_iovlen >= RTIPC_IOV_MAX)
+		return -EINVAL;
+
+	/* Copy I/O vector in */
+	if (rtipc_get_arg(user_info, iov, msg->msg_iov,
+			  sizeof(iov[0]) * msg->msg_iovlen))
+		return -EFAULT;
+
+	ret = __psdp_recvmsg(priv, user_info,
+			     iov, msg->msg_iovlen, flags, &saddr, &trunc);
+	if (ret <= 0)
+		return ret;
+
+	/* Copy the updated I/O vector back */
+	if (rtipc_put_arg(user_info, msg->msg_iov, iov,
+			  sizeof(iov[0]) * msg->msg_iovlen))
+		return -EFAULT;
+
+	/* Copy the source address if required. */
+	if (msg->msg_name) {
+		if (rtipc_put_arg(user_info, msg->msg_name,
+				  &saddr, sizeof(saddr)))
+			return -EFAULT;
+		msg->msg_namelen = sizeof(struct sockaddr_ipc);
+	}
+
+	msg->msg_flags = trunc ? MSG_TRUNC : 0;
+
+	return ret;
+}
+
+static ssize_t psdp_read(struct rtipc_private *priv,
+			 rtdm_user_info_t *user_info,
+			 void *buf, size_t len)
+{
+	struct iovec iov = { .iov_base = buf, .iov_len = len };
+	return __psdp_recvmsg(priv, user_info, &iov, 1, 0, NULL, NULL);
+}
+
+static ssize_t __psdp_sendmsg(struct rtipc_private *priv,
+			      rtdm_user_info_t *user_info,
+			      struct iovec *iov, int iovlen, int flags)
+{
+	struct psdp_socket *sk = priv->state, *ssk;
+	struct psdp_message *mbuf, *freelist = NULL;
+	struct psdp_topic *topic = sk->topic;
+	ssize_t len, rdlen, vlen;
+	int nvec, wroff, ret;
+	struct xnbufd bufd;
+
+	len = rtipc_get_iov_flatlen(iov, iovlen);
+	if (len == 0)
+		return 0;
+
+	/*
+	 * Nobody listening: the message is dropped on the floor,
+	 * which is not an error for a publisher.
+	 */
+	if (topic->nrsubs == 0)
+		return len;
+
+	mbuf = __psdp_alloc_mbuf(sk, topic, len, sk->tx_timeout, flags, &ret);
+	if (unlikely(ret))
+		return ret;
+
+	/* Move "len" bytes to mbuf->data, once for all subscribers. */
+	for (nvec = 0, rdlen = len, wroff = 0;
+	     nvec < iovlen && rdlen > 0; nvec++) {
+		if (iov[nvec].iov_len == 0)
+			continue;
+		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+		if (user_info) {
+			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
+			xnbufd_unmap_uread(&bufd);
+		} else
+#endif
+		{
+			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(mbuf->data + wroff, &bufd, vlen);
+			xnbufd_unmap_kread(&bufd);
+		}
+		if (ret < 0) {
+			__psdp_free_mbufs(topic, mbuf);
+			return ret;
+		}
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		rdlen -= vlen;
+		wroff += vlen;
+	}
+
+	/*
+	 * Hand out one reference per subscriber. When a ring is
+	 * full, the oldest message is overwritten and accounted as
+	 * an overrun for that subscriber, so that a slow reader
+	 * never stalls the publisher nor its faster peers. The
+	 * semaphore count must track the ring occupancy, so it is
+	 * only raised when the ring actually grows.
+	 */
+	RTDM_EXECUTE_ATOMICALLY(
+		list_for_each_entry(ssk, &topic->subscribers, next) {
+			if (ssk->count == ssk->depth) {
+				__psdp_drop_mbuf(ssk->ring[ssk->rdidx],
+						 &freelist);
+				ssk->rdidx = (ssk->rdidx + 1) % ssk->depth;
+				ssk->count--;
+				ssk->overruns++;
+			} else
+				rtdm_sem_up(&ssk->insem);
+			ssk->ring[(ssk->rdidx + ssk->count) % ssk->depth] = mbuf;
+			ssk->count++;
+			mbuf->refs++;
+		}
+		/* Drop our own reference. */
+		__psdp_drop_mbuf(mbuf, &freelist);
+	);
+
+	__psdp_free_mbufs(topic, freelist);
+
+	return len;
+}
+
+static ssize_t psdp_sendmsg(struct rtipc_private *priv,
+			    rtdm_user_info_t *user_info,
+			    const struct msghdr *msg, int flags)
+{
+	struct psdp_socket *sk = priv->state;
+	struct iovec iov[RTIPC_IOV_MAX];
+	ssize_t ret;
+
+	if (flags & ~MSG_DONTWAIT)
+		return -EINVAL;
+
+	/* Publishers may only send to the topic they are bound to. */
+	if (msg->msg_name || msg->msg_namelen != 0)
+		return -EISCONN;
+
+	if (!test_bit(_PSDP_BOUND, &sk->status))
+		return -EDESTADDRREQ;
+
+	if (msg->msg_iovlen >= RTIPC_IOV_MAX)
+		return -EINVAL;
+
+	/* Copy I/O vector in */
+	if (rtipc_get_arg(user_info, iov, msg->msg_iov,
+			  sizeof(iov[0]) * msg->msg_iovlen))
+		return -EFAULT;
+
+	ret = __psdp_sendmsg(priv, user_info, iov, msg->msg_iovlen, flags);
+	if (ret <= 0)
+		return ret;
+
+	/* Copy updated I/O vector back */
+	if (rtipc_put_arg(user_info, msg->msg_iov, iov,
+			  sizeof(iov[0]) * msg->msg_iovlen))
+		return -EFAULT;
+
+	return ret;
+}
+
+static ssize_t psdp_write(struct rtipc_private *priv,
+			  rtdm_user_info_t *user_info,
+			  const void *buf, size_t len)
+{
+	struct iovec iov = { .iov_base = (void *)buf, .iov_len = len };
+	struct psdp_socket *sk = priv->state;
+
+	if (!test_bit(_PSDP_BOUND, &sk->status))
+		return -EDESTADDRREQ;
+
+	return __psdp_sendmsg(priv, user_info, &iov, 1, 0);
+}
+
+static int __psdp_bind_socket(struct rtipc_private *priv,
+			      struct sockaddr_ipc *sa)
+{
+	struct psdp_socket *sk = priv->state;
+	struct psdp_topic *topic;
+	int ret = 0, port;
+	void *poolmem;
+	size_t poolsz;
+
+	if (sa->sipc_family != AF_RTIPC)
+		return -EINVAL;
+
+	if (sa->sipc_port < -1 ||
+	    sa->sipc_port >= CONFIG_XENO_OPT_PSDP_NRPORT)
+		return -EINVAL;
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (test_bit(_PSDP_CONNECTED, &sk->status))
+			ret = -EISCONN;
+		else if (test_bit(_PSDP_BOUND, &sk->status) ||
+			 __test_and_set_bit(_PSDP_BINDING, &sk->status))
+			ret = -EADDRINUSE;
+	);
+	if (ret)
+		return ret;
+
+	topic = kmalloc(sizeof(*topic), GFP_KERNEL);
+	if (topic == NULL) {
+		ret = -ENOMEM;
+		goto fail_alloc;
+	}
+
+	topic->magic = PSDP_TOPIC_MAGIC;
+	topic->refs = 1;
+	topic->closed = 0;
+	topic->handle = 0;
+	topic->bufpool = &kheap;
+	topic->poolevt = &poolevt;
+	topic->poolwait = &poolwait;
+	topic->privwait = 0;
+	topic->nrsubs = 0;
+	INIT_LIST_HEAD(&topic->subscribers);
+	rtdm_event_init(&topic->privevt, 0);
+
+	/* Will auto-select a free port number if unspec (-1). */
+	port = xnmap_enter(portmap, sa->sipc_port, topic);
+	if (port < 0) {
+		ret = port == -EEXIST ? -EADDRINUSE : -ENOMEM;
+		goto fail_map;
+	}
+
+	sa->sipc_port = port;
+	topic->port = port;
+
+	/*
+	 * Allocate a local buffer pool if we were told to do so via
+	 * setsockopt() before we got there.
+	 */
+	poolsz = sk->poolsz;
+	if (poolsz > 0) {
+		poolsz = xnheap_rounded_size(poolsz, XNHEAP_PAGE_SIZE);
+		poolmem = xnarch_alloc_host_mem(poolsz);
+		if (poolmem == NULL) {
+			ret = -ENOMEM;
+			goto fail_pool;
+		}
+
+		ret = xnheap_init(&topic->privpool,
+				  poolmem, poolsz, XNHEAP_PAGE_SIZE);
+		if (ret) {
+			xnarch_free_host_mem(poolmem, poolsz);
+			goto fail_pool;
+		}
+		xnheap_set_label(&topic->privpool, "psdp: %d", port);
+
+		topic->poolevt = &topic->privevt;
+		topic->poolwait = &topic->privwait;
+		topic->bufpool = &topic->privpool;
+	}
+
+	if (*sk->label) {
+		ret = xnregistry_enter(sk->label, topic,
+				       &topic->handle, &__psdp_pnode.node);
+		if (ret) {
+			if (poolsz > 0)
+				xnheap_destroy(&topic->privpool,
+					       __psdp_flush_pool, NULL);
+			goto fail_pool;
+		}
+	}
+
+	RTDM_EXECUTE_ATOMICALLY(
+		sk->topic = topic;
+		sk->name = *sa;
+		__clear_bit(_PSDP_BINDING, &sk->status);
+		__set_bit(_PSDP_BOUND, &sk->status);
+	);
+
+	return 0;
+
+fail_pool:
+	xnmap_remove(portmap, port);
+fail_map:
+	rtdm_event_destroy(&topic->privevt);
+	kfree(topic);
+fail_alloc:
+	clear_bit(_PSDP_BINDING, &sk->status);
+
+	return ret;
+}
+
+static int __psdp_connect_socket(struct psdp_socket *sk,
+				 struct sockaddr_ipc *sa)
+{
+	struct psdp_message **ring;
+	struct psdp_topic *topic;
+	xnhandle_t h = 0;
+	int ret = 0, depth;
+
+	if (test_bit(_PSDP_BOUND, &sk->status) ||
+	    test_bit(_PSDP_BINDING, &sk->status))
+		return -EISCONN;
+
+	if (sa && sa->sipc_family != AF_RTIPC)
+		return -EINVAL;
+
+	if (sa && (sa->sipc_port < -1 ||
+		   sa->sipc_port >= CONFIG_XENO_OPT_PSDP_NRPORT))
+		return -EINVAL;
+
+	/* Subscribing again implies leaving the current topic. */
+	if (test_bit(_PSDP_CONNECTED, &sk->status))
+		__psdp_unsubscribe(sk);
+	/*
+	 * - If a valid sipc_port is passed in the [0..NRPORT-1] range,
+	 * the socket subscribes to the topic published on that port,
+	 * which must exist at the time of the call.
+	 *
+	 * - If sipc_port is -1 and a label was set via PSDP_LABEL,
+	 * connect() blocks for the requested amount of time (see
+	 * SO_RCVTIMEO) until a topic is published under the same
+	 * label.
+	 *
+	 * - If no address is given, or sipc_port is -1 and no label
+	 * was set, the socket is merely unsubscribed.
+	 */
+	if (sa == NULL || (sa->sipc_port < 0 && *sk->label == 0))
+		return 0;
+
+	if (sa->sipc_port < 0) {
+		ret = xnregistry_bind(sk->label,
+				      sk->rx_timeout, XN_RELATIVE, &h);
+		if (ret)
+			return ret;
+	}
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (sa->sipc_port < 0)
+			topic = xnregistry_fetch(h);
+		else
+			topic = xnmap_fetch_nocheck(portmap, sa->sipc_port);
+		if (topic == NULL || topic->magic != PSDP_TOPIC_MAGIC ||
+		    topic->closed)
+			ret = -ECONNREFUSED;
+		else {
+			topic->refs++;
+			/* Fetch topic port number. */
+			sa->sipc_port = topic->port;
+		}
+	);
+	if (ret)
+		return ret;
+
+	depth = sk->depth;
+	ring = kmalloc(depth * sizeof(*ring), GFP_KERNEL);
+	if (ring == NULL) {
+		__psdp_put_topic(topic);
+		return -ENOMEM;
+	}
+
+	/* Re-arm the input semaphore, which may still count messages
+	   from a former topic. */
+	rtdm_sem_destroy(&sk->insem);
+	rtdm_sem_init(&sk->insem, 0);
+
+	RTDM_EXECUTE_ATOMICALLY(
+		if (topic->closed)
+			ret = -ECONNREFUSED;
+		else {
+			sk->ring = ring;
+			sk->depth = depth;
+			sk->rdidx = 0;
+			sk->count = 0;
+			sk->overruns = 0;
+			sk->topic = topic;
+			sk->peer = *sa;
+			list_add_tail(&sk->next, &topic->subscribers);
+			topic->nrsubs++;
+			__set_bit(_PSDP_CONNECTED, &sk->status);
+		}
+	);
+	if (ret) {
+		kfree(ring);
+		__psdp_put_topic(topic);
+	}
+
+	return ret;
+}
+
+static int __psdp_setsockopt(struct psdp_socket *sk,
+			     rtdm_user_info_t *user_info,
+			     void *arg)
+{
+	struct _rtdm_setsockopt_args sopt;
+	struct rtipc_port_label plabel;
+	struct timeval tv;
+	int ret = 0, depth;
+	size_t len;
+
+	if (rtipc_get_arg(user_info, &sopt, arg, sizeof(sopt)))
+		return -EFAULT;
+
+	if (sopt.level == SOL_SOCKET) {
+		switch (sopt.optname) {
+
+		case SO_RCVTIMEO:
+			if (sopt.optlen != sizeof(tv))
+				return -EINVAL;
+			if (rtipc_get_arg(user_info, &tv,
+					  sopt.optval, sizeof(tv)))
+				return -EFAULT;
+			sk->rx_timeout = rtipc_timeval_to_ns(&tv);
+			break;
+
+		case SO_SNDTIMEO:
+			if (sopt.optlen != sizeof(tv))
+				return -EINVAL;
+			if (rtipc_get_arg(user_info, &tv,
+					  sopt.optval, sizeof(tv)))
+				return -EFAULT;
+			sk->tx_timeout = rtipc_timeval_to_ns(&tv);
+			break;
+
+		default:
+			ret = -EINVAL;
+		}
+
+		return ret;
+	}
+
+	if (sopt.level != SOL_PSDP)
+		return -ENOPROTOOPT;
+
+	switch (sopt.optname) {
+
+	case PSDP_POOLSZ:
+		if (sopt.optlen != sizeof(len))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &len,
+				  sopt.optval, sizeof(len)))
+			return -EFAULT;
+		if (len == 0)
+			return -EINVAL;
+		RTDM_EXECUTE_ATOMICALLY(
+			/*
+			 * We may not do this more than once, and we
+			 * have to do this before the topic is
+			 * published.
+			 */
+			if (test_bit(_PSDP_BOUND, &sk->status) ||
+			    test_bit(_PSDP_BINDING, &sk->status))
+				ret = -EALREADY;
+			else
+				sk->poolsz = len;
+		);
+		break;
+
+	case PSDP_DEPTH:
+		if (sopt.optlen != sizeof(depth))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &depth,
+				  sopt.optval, sizeof(depth)))
+			return -EFAULT;
+		if (depth <= 0 || depth > PSDP_MAX_DEPTH)
+			return -EINVAL;
+		RTDM_EXECUTE_ATOMICALLY(
+			/* Applies to the next subscription. */
+			if (test_bit(_PSDP_CONNECTED, &sk->status))
+				ret = -EALREADY;
+			else
+				sk->depth = depth;
+		);
+		break;
+
+	case PSDP_LABEL:
+		if (sopt.optlen < sizeof(plabel))
+			return -EINVAL;
+		if (rtipc_get_arg(user_info, &plabel,
+				  sopt.optval, sizeof(plabel)))
+			return -EFAULT;
+		RTDM_EXECUTE_ATOMICALLY(
+			if (test_bit(_PSDP_BINDING, &sk->status) ||
+			    test_bit(_PSDP_BOUND, &sk->status))
+				ret = -EALREADY;
+			else {
+				strcpy(sk->label, plabel.label);
+				sk->label[XNOBJECT_NAME_LEN-1] = 0;
+			}
+		);
+		break;
+
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static int __psdp_getsockopt(struct psdp_socket *sk,
+			     rtdm_user_info_t *user_info,
+			     void *arg)
+{
+	struct _rtdm_getsockopt_args sopt;
+	struct rtipc_port_label plabel;
+	unsigned long overruns;
+	struct timeval tv;
+	socklen_t len;
+	int ret = 0;
+
+	if (rtipc_get_arg(user_info, &sopt, arg, sizeof(sopt)))
+		return -EFAULT;
+
+	if (rtipc_get_arg(user_info, &len, sopt.optlen, sizeof(len)))
+		return -EFAULT;
+
+	if (sopt.level == SOL_SOCKET) {
+		switch (sopt.optname) {
+
+		case SO_RCVTIMEO:
+			if (len != sizeof(tv))
+				return -EINVAL;
+			rtipc_ns_to_timeval(&tv, sk->rx_timeout);
+			if (rtipc_put_arg(user_info, sopt.optval,
+					  &tv, sizeof(tv)))
+				return -EFAULT;
+			break;
+
+		case SO_SNDTIMEO:
+			if (len != sizeof(tv))
+				return -EINVAL;
+			rtipc_ns_to_timeval(&tv, sk->tx_timeout);
+			if (rtipc_put_arg(user_info, sopt.optval,
+					  &tv, sizeof(tv)))
+				return -EFAULT;
+			break;
+
+		default:
+			ret = -EINVAL;
+		}
+
+		return ret;
+	}
+
+	if (sopt.level != SOL_PSDP)
+		return -ENOPROTOOPT;
+
+	switch (sopt.optname) {
+
+	case PSDP_LABEL:
+		if (len < sizeof(plabel))
+			return -EINVAL;
+		RTDM_EXECUTE_ATOMICALLY(
+			strcpy(plabel.label, sk->label);
+		);
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &plabel, sizeof(plabel)))
+			return -EFAULT;
+		break;
+
+	case PSDP_DEPTH:
+		if (len != sizeof(sk->depth))
+			return -EINVAL;
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &sk->depth, sizeof(sk->depth)))
+			return -EFAULT;
+		break;
+
+	case PSDP_OVERRUNS:
+		if (len != sizeof(overruns))
+			return -EINVAL;
+		overruns = sk->overruns;
+		if (rtipc_put_arg(user_info, sopt.optval,
+				  &overruns, sizeof(overruns)))
+			return -EFAULT;
+		break;
+
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static int __psdp_ioctl(struct rtipc_private *priv,
+			rtdm_user_info_t *user_info,
+			unsigned int request, void *arg)
+{
+	struct sockaddr_ipc saddr, *saddrp = &saddr;
+	struct psdp_socket *sk = priv->state;
+	int ret = 0;
+
+	switch (request) {
+
+	case _RTIOC_CONNECT:
+		ret = rtipc_get_sockaddr(user_info, arg, &saddrp);
+		if (ret)
+		  return ret;
+		ret = __psdp_connect_socket(sk, saddrp);
+		break;
+
+	case _RTIOC_BIND:
+		ret = rtipc_get_sockaddr(user_info, arg, &saddrp);
+		if (ret)
+			return ret;
+		if (saddrp == NULL)
+			return -EFAULT;
+		ret = __psdp_bind_socket(priv, saddrp);
+		break;
+
+	case _RTIOC_GETSOCKNAME:
+		ret = rtipc_put_sockaddr(user_info, arg, &sk->name);
+		break;
+
+	case _RTIOC_GETPEERNAME:
+		ret = rtipc_put_sockaddr(user_info, arg, &sk->peer);
+		break;
+
+	case _RTIOC_SETSOCKOPT:
+		ret = __psdp_setsockopt(sk, user_info, arg);
+		break;
+
+	case _RTIOC_GETSOCKOPT:
+		ret = __psdp_getsockopt(sk, user_info, arg);
+		break;
+
+	case _RTIOC_LISTEN:
+	case _RTIOC_ACCEPT:
+		ret = -EOPNOTSUPP;
+		break;
+
+	case _RTIOC_SHUTDOWN:
+		ret = -ENOTCONN;
+		break;
+
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static int psdp_ioctl(struct rtipc_private *priv,
+		      rtdm_user_info_t *user_info,
+		      unsigned int request, void *arg)
+{
+	/* Both allocate and release topic memory. */
+	if (rtdm_in_rt_context() &&
+	    (request == _RTIOC_BIND || request == _RTIOC_CONNECT))
+		return -ENOSYS;	/* Try downgrading to NRT */
+
+	return __psdp_ioctl(priv, user_info, request, arg);
+}
+
+static int psdp_init(void)
+{
+	portmap = xnmap_create(CONFIG_XENO_OPT_PSDP_NRPORT, 0, 0);
+	if (portmap == NULL)
+		return -ENOMEM;
+
+	rtdm_event_init(&poolevt, 0);
+
+	return 0;
+}
+
+static void psdp_exit(void)
+{
+	rtdm_event_destroy(&poolevt);
+	xnmap_delete(portmap);
+}
+
+struct rtipc_protocol psdp_proto_driver = {
+	.proto_name = "psdp",
+	.proto_statesz = sizeof(struct psdp_socket),
+	.proto_init = psdp_init,
+	.proto_exit = psdp_exit,
+	.proto_ops = {
+		.socket = psdp_socket,
+		.close = psdp_close,
+		.recvmsg = psdp_recvmsg,
+		.sendmsg = psdp_sendmsg,
+		.read = psdp_read,
+		.write = psdp_write,
+		.ioctl = psdp_ioctl,
+	}
+};
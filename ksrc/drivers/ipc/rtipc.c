@@ -33,6 +33,9 @@ static struct rtipc_protocol *protocols[IPCPROTO_MAX] = {
 #ifdef CONFIG_XENO_DRIVERS_RTIPC_BUFP
 	[IPCPROTO_BUFP - 1] = &bufp_proto_driver,
 #endif
+#ifdef CONFIG_XENO_DRIVERS_RTIPC_PSDP
+	[IPCPROTO_PSDP - 1] = &psdp_proto_driver,
+#endif
 };
 
 DEFINE_XNPTREE(rtipc_ptree, "rtipc");
@@ -17,6 +17,7 @@
  */
 
 #include <linux/module.h>
+#include <linux/delay.h>
 
 #include <rtdm/rtdm_driver.h>
 #include <rtdm/rttesting.h>
@@ -29,10 +30,18 @@ MODULE_PARM_DESC(start_index, "First device instance number to be used");
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("jan.kiszka@web.de");
 
+struct rtdm_test_irq {
+	rtdm_irq_t irq_handle;
+	unsigned long hits;
+	unsigned long threaded;
+	unsigned long probes;
+};
+
 struct rtdm_test_context {
 	rtdm_timer_t close_timer;
 	unsigned long close_counter;
 	unsigned long close_deferral;
+	struct rtdm_test_irq irq[RTTST_RTDM_IRQ_HANDLERS];
 };
 
 static void close_timer_proc(rtdm_timer_t *timer)
@@ -105,12 +114,201 @@ static int rtdm_test_close(struct rtdm_dev_context *context,
 	return 0;
 }
 
+static int rtdm_test_irq_handler(rtdm_irq_t *irq_handle)
+{
+	struct rtdm_test_irq *ti =
+		rtdm_irq_get_arg(irq_handle, struct rtdm_test_irq);
+
+	ti->hits++;
+	if (!xnpod_interrupt_p() && !xnpod_root_p())
+		ti->threaded++;
+
+	/* There is no PIC to unmask for virtual IRQs. */
+	return XN_ISR_HANDLED | XN_ISR_NOENABLE;
+}
+
+static int rtdm_test_irq_decline(rtdm_irq_t *irq_handle)
+{
+	struct rtdm_test_irq *ti =
+		rtdm_irq_get_arg(irq_handle, struct rtdm_test_irq);
+
+	ti->hits++;
+
+	return XN_ISR_NONE;
+}
+
+static int rtdm_test_irq_reject(rtdm_irq_t *irq_handle)
+{
+	struct rtdm_test_irq *ti =
+		rtdm_irq_get_arg(irq_handle, struct rtdm_test_irq);
+
+	ti->probes++;
+
+	return 0;
+}
+
+static void rtdm_test_irq_reset(struct rtdm_test_context *ctx)
+{
+	int n;
+
+	for (n = 0; n < RTTST_RTDM_IRQ_HANDLERS; n++) {
+		ctx->irq[n].hits = 0;
+		ctx->irq[n].threaded = 0;
+		ctx->irq[n].probes = 0;
+	}
+}
+
+static void rtdm_test_irq_report(struct rtdm_test_context *ctx,
+				 struct rttst_rtdm_irq_res *res)
+{
+	int n;
+
+	res->threaded = 0;
+	res->probes = 0;
+	for (n = 0; n < RTTST_RTDM_IRQ_HANDLERS; n++) {
+		res->hits[n] = ctx->irq[n].hits;
+		res->threaded += ctx->irq[n].threaded;
+		res->probes += ctx->irq[n].probes;
+	}
+}
+
+static int rtdm_test_irq_wait(struct rtdm_test_irq *ti, unsigned long hits)
+{
+	int n;
+
+	for (n = 0; ti->hits < hits; n++) {
+		if (n >= 100)
+			return -ETIMEDOUT;
+		msleep(1);
+	}
+
+	return 0;
+}
+
+/*
+ * Virtual IRQs cannot be enabled at PIC level, so the nucleus
+ * services are called directly instead of rtdm_irq_request*().
+ */
+static int rtdm_test_irq_threaded(struct rtdm_test_context *ctx,
+				  struct rttst_rtdm_irq_res *res)
+{
+	struct rtdm_test_irq *ti = &ctx->irq[0];
+	unsigned long n;
+	unsigned irq;
+	int err;
+
+	if (res->triggers == 0)
+		return -EINVAL;
+
+	irq = rthal_alloc_virq();
+	if (irq == 0)
+		return -EBUSY;
+
+	rtdm_test_irq_reset(ctx);
+
+	err = xnintr_init(&ti->irq_handle, "rtdmtest", irq,
+			  rtdm_test_irq_handler, NULL, 0);
+	if (err)
+		goto free_virq;
+
+	err = xnintr_attach_threaded(&ti->irq_handle, ti,
+				     RTDM_TASK_LOWEST_PRIORITY + 1);
+	if (err)
+		goto free_virq;
+
+	for (n = 0; n < res->triggers; n++) {
+		rthal_trigger_irq(irq);
+		err = rtdm_test_irq_wait(ti, n + 1);
+		if (err)
+			break;
+	}
+
+	/* Returns only once the handler thread is gone. */
+	xnintr_detach(&ti->irq_handle);
+
+	res->irq = irq;
+	rtdm_test_irq_report(ctx, res);
+
+free_virq:
+	rthal_free_virq(irq);
+
+	return err;
+}
+
+#ifdef CONFIG_XENO_OPT_SHIRQ
+/*
+ * The second handler claims every IRQ, so the walk should stop there
+ * and the chain be reordered for it to come first.
+ */
+static int rtdm_test_irq_shared(struct rtdm_test_context *ctx,
+				struct rttst_rtdm_irq_res *res)
+{
+	static const xnisr_t isrs[RTTST_RTDM_IRQ_HANDLERS] = {
+		rtdm_test_irq_handler,
+		rtdm_test_irq_handler,
+		rtdm_test_irq_decline,
+	};
+	struct rtdm_test_irq *ti;
+	unsigned long n;
+	unsigned irq;
+	int i, err;
+
+	if (res->triggers == 0)
+		return -EINVAL;
+
+	irq = rthal_alloc_virq();
+	if (irq == 0)
+		return -EBUSY;
+
+	rtdm_test_irq_reset(ctx);
+
+	for (i = 0; i < RTTST_RTDM_IRQ_HANDLERS; i++) {
+		ti = &ctx->irq[i];
+		err = xnintr_init(&ti->irq_handle, "rtdmtest", irq,
+				  isrs[i], NULL, XN_ISR_SHARED);
+		if (err)
+			goto detach;
+		if (i == 0)
+			xnintr_set_probe(&ti->irq_handle,
+					 rtdm_test_irq_reject);
+		err = xnintr_attach(&ti->irq_handle, ti);
+		if (err)
+			goto detach;
+	}
+
+	for (n = 0; n < res->triggers; n++) {
+		rthal_trigger_irq(irq);
+		err = rtdm_test_irq_wait(&ctx->irq[1], n + 1);
+		if (err)
+			break;
+	}
+
+	res->irq = irq;
+	rtdm_test_irq_report(ctx, res);
+
+detach:
+	while (i > 0)
+		xnintr_detach(&ctx->irq[--i].irq_handle);
+
+	rthal_free_virq(irq);
+
+	return err;
+}
+#else /* !CONFIG_XENO_OPT_SHIRQ */
+static int rtdm_test_irq_shared(struct rtdm_test_context *ctx,
+				struct rttst_rtdm_irq_res *res)
+{
+	return -EOPNOTSUPP;
+}
+#endif /* !CONFIG_XENO_OPT_SHIRQ */
+
 static int rtdm_test_ioctl(struct rtdm_dev_context *context,
 			   rtdm_user_info_t *user_info,
 			   unsigned int request, void __user *arg)
 {
 	struct rtdm_test_context *ctx =
 		(struct rtdm_test_context *)context->dev_private;
+	struct rttst_rtdm_irq_res res;
 	int err = 0;
 
 	switch (request) {
@@ -118,6 +316,40 @@ static int rtdm_test_ioctl(struct rtdm_dev_context *context,
 		ctx->close_deferral = (unsigned long)arg;
 		break;
 
+	case RTTST_RTIOC_RTDM_IRQ_THREADED:
+		if (rtdm_in_rt_context())
+			return -ENOSYS;
+
+		err = rtdm_safe_copy_from_user(user_info, &res,
+					       arg, sizeof(res));
+		if (err)
+			break;
+
+		err = rtdm_test_irq_threaded(ctx, &res);
+		if (err)
+			break;
+
+		err = rtdm_safe_copy_to_user(user_info, arg,
+					     &res, sizeof(res));
+		break;
+
+	case RTTST_RTIOC_RTDM_IRQ_SHARED:
+		if (rtdm_in_rt_context())
+			return -ENOSYS;
+
+		err = rtdm_safe_copy_from_user(user_info, &res,
+					       arg, sizeof(res));
+		if (err)
+			break;
+
+		err = rtdm_test_irq_shared(ctx, &res);
+		if (err)
+			break;
+
+		err = rtdm_safe_copy_to_user(user_info, arg,
+					     &res, sizeof(res));
+		break;
+
 	default:
 		err = -ENOTTY;
 	}
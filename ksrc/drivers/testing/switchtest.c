@@ -9,14 +9,36 @@
 #define RTSWITCH_NRT     0
 #define RTSWITCH_KERNEL  0x8
 
+/* Task kinds, as seen by the switch legs accounting. */
+#define RTSWITCH_LEG_K   0
+#define RTSWITCH_LEG_U   1
+#define RTSWITCH_LEG_N   2
+
 typedef struct {
 	struct rttst_swtest_task base;
 	rtdm_event_t rt_synch;
 	struct semaphore nrt_synch;
 	xnthread_t ktask;          /* For kernel-space real-time tasks. */
+	xnthread_t *thread;        /* Once seen in primary mode. */
 	unsigned last_switch;
 } rtswitch_task_t;
 
+struct rtswitch_leg_stats {
+	unsigned long long count;
+	unsigned long long sum;
+	long min;
+	long max;
+	long histogram[RTTST_HDR_CELLS];
+};
+
+struct rtswitch_leg {
+	xnticks_t stamp;	/* TSC at hand over, 0 if unused. */
+	unsigned to;
+	unsigned from_kind;
+	unsigned fpu;
+	int cpu;
+};
+
 typedef struct rtswitch_context {
 	rtswitch_task_t *tasks;
 	unsigned tasks_count;
@@ -34,6 +56,10 @@ typedef struct rtswitch_context {
 
 	rtswitch_task_t *utask;
 	rtdm_nrtsig_t wake_utask;
+
+	struct rtswitch_leg_stats *legs;
+	int legs_on;
+	struct rtswitch_leg leg;
 } rtswitch_context_t;
 
 static unsigned int start_index;
@@ -44,6 +70,155 @@ MODULE_PARM_DESC(start_index, "First device instance number to be used");
 MODULE_LICENSE("GPL");
 MODULE_AUTHOR("Gilles.Chanteperdrix@laposte.net");
 
+static inline unsigned rtswitch_leg_fpu(rtswitch_task_t *to)
+{
+#ifdef CONFIG_XENO_HW_FPU
+	xnthread_t *thread = to->thread;
+
+	if (thread == NULL || !xnthread_test_state(thread, XNFPU))
+		return RTTST_SWTEST_LEG_NOFPU;
+
+	/* Mirrors the decision made by __xnpod_switch_fpu(). */
+	if (thread->sched->fpuholder == thread)
+		return RTTST_SWTEST_LEG_FPU_LAZY;
+
+	return RTTST_SWTEST_LEG_FPU_SWITCH;
+#else /* !CONFIG_XENO_HW_FPU */
+	return RTTST_SWTEST_LEG_NOFPU;
+#endif /* !CONFIG_XENO_HW_FPU */
+}
+
+/* Called by the current task right before handing over to "to". */
+static void rtswitch_leg_start(rtswitch_context_t *ctx,
+			       rtswitch_task_t *from,
+			       rtswitch_task_t *to,
+			       unsigned from_kind)
+{
+	struct rtswitch_leg *leg = &ctx->leg;
+
+	if (!ctx->legs_on)
+		return;
+
+	if (from->base.flags & RTSWITCH_KERNEL)
+		from_kind = RTSWITCH_LEG_K;
+
+	leg->to = to->base.index;
+	leg->from_kind = from_kind;
+	leg->fpu = rtswitch_leg_fpu(to);
+	leg->cpu = xnsched_cpu(xnpod_current_sched());
+	barrier();
+	leg->stamp = xnarch_get_cpu_tsc();
+}
+
+/* Called by a task when it resumes. */
+static void rtswitch_leg_end(rtswitch_context_t *ctx,
+			     rtswitch_task_t *task,
+			     unsigned kind)
+{
+	struct rtswitch_leg *leg = &ctx->leg;
+	struct rtswitch_leg_stats *stats;
+	xnticks_t now = xnarch_get_cpu_tsc();
+	unsigned fpu, type;
+	long delta;
+
+	if (leg->stamp == 0 || leg->to != task->base.index)
+		return;
+
+	/* TSCs of different CPUs may be slightly off. */
+	delta = now > leg->stamp ? (long)xnarch_tsc_to_ns(now - leg->stamp) : 0;
+	leg->stamp = 0;
+
+	if (task->base.flags & RTSWITCH_KERNEL)
+		kind = RTSWITCH_LEG_K;
+
+	fpu = kind == RTSWITCH_LEG_N ? RTTST_SWTEST_LEG_NOFPU : leg->fpu;
+
+	if (xnsched_cpu(xnpod_current_sched()) != leg->cpu)
+		type = RTTST_SWTEST_LEG_IPI;
+	else if (kind == RTSWITCH_LEG_N || leg->from_kind == RTSWITCH_LEG_N)
+		type = RTTST_SWTEST_LEG_NRT;
+	else if (leg->from_kind == RTSWITCH_LEG_K)
+		type = kind == RTSWITCH_LEG_K ?
+			RTTST_SWTEST_LEG_KK : RTTST_SWTEST_LEG_KU;
+	else
+		type = kind == RTSWITCH_LEG_K ?
+			RTTST_SWTEST_LEG_UK : RTTST_SWTEST_LEG_UU;
+
+	stats = &ctx->legs[RTTST_SWTEST_LEG_TYPE(type, fpu)];
+	if (stats->count == 0 || delta < stats->min)
+		stats->min = delta;
+	if (delta > stats->max)
+		stats->max = delta;
+	stats->sum += delta;
+	stats->count++;
+	stats->histogram[rttst_hdr_index(delta)]++;
+}
+
+static int rtswitch_set_leg_stats(rtswitch_context_t *ctx, unsigned long on)
+{
+	struct rtswitch_leg_stats *legs;
+
+	if (!on) {
+		/* Stats are released on close, tasks may still be running. */
+		ctx->legs_on = 0;
+		ctx->leg.stamp = 0;
+		return 0;
+	}
+
+	legs = ctx->legs;
+	if (legs == NULL) {
+		legs = vmalloc(RTTST_SWTEST_LEG_TYPES * sizeof(*legs));
+		if (legs == NULL)
+			return -ENOMEM;
+	}
+
+	memset(legs, 0, RTTST_SWTEST_LEG_TYPES * sizeof(*legs));
+
+	ctx->leg.stamp = 0;
+	ctx->legs = legs;
+	barrier();
+	ctx->legs_on = 1;
+
+	return 0;
+}
+
+static int rtswitch_get_leg_stats(rtswitch_context_t *ctx,
+				  rtdm_user_info_t *user_info,
+				  void *arg)
+{
+	struct rttst_swtest_leg_stats res;
+	struct rtswitch_leg_stats *stats;
+
+	if (!rtdm_rw_user_ok(user_info, arg, sizeof(res)))
+		return -EFAULT;
+
+	rtdm_copy_from_user(user_info, &res, arg, sizeof(res));
+
+	if (res.type >= RTTST_SWTEST_LEG_TYPES)
+		return -EINVAL;
+
+	if (ctx->legs == NULL)
+		return -ENODATA;
+
+	stats = &ctx->legs[res.type];
+	res.count = stats->count;
+	res.sum = stats->sum;
+	res.min = stats->min;
+	res.max = stats->max;
+
+	if (res.histogram) {
+		if (!rtdm_rw_user_ok(user_info, res.histogram,
+				     sizeof(stats->histogram)))
+			return -EFAULT;
+		rtdm_copy_to_user(user_info, res.histogram,
+				  stats->histogram, sizeof(stats->histogram));
+	}
+
+	rtdm_copy_to_user(user_info, arg, &res, sizeof(res));
+
+	return 0;
+}
+
 static void handle_ktask_error(rtswitch_context_t *ctx, unsigned fp_val)
 {
 	rtswitch_task_t *cur = &ctx->tasks[ctx->error.last_switch.to];
@@ -87,11 +262,14 @@ static int rtswitch_pend_rt(rtswitch_context_t *ctx,
 
 	task = &ctx->tasks[idx];
 	task->base.flags |= RTSWITCH_RT;
+	task->thread = xnpod_current_thread();
 
 	rc = rtdm_event_wait(&task->rt_synch);
 	if (rc < 0)
 		return rc;
 
+	rtswitch_leg_end(ctx, task, RTSWITCH_LEG_U);
+
 	if (ctx->failed)
 		return 1;
 
@@ -136,6 +314,7 @@ static int rtswitch_to_rt(rtswitch_context_t *ctx,
 	to = &ctx->tasks[to_idx];
 
 	from->base.flags |= RTSWITCH_RT;
+	from->thread = xnpod_current_thread();
 	from->last_switch = ++ctx->switches_count;
 	ctx->error.last_switch.from = from_idx;
 	ctx->error.last_switch.to = to_idx;
@@ -153,12 +332,14 @@ static int rtswitch_to_rt(rtswitch_context_t *ctx,
 		case RTSWITCH_NRT:
 			ctx->utask = to;
 			barrier();
+			rtswitch_leg_start(ctx, from, to, RTSWITCH_LEG_U);
 			rtdm_nrtsig_pend(&ctx->wake_utask);
 			xnpod_lock_sched();
 			break;
 
 		case RTSWITCH_RT:
 			xnpod_lock_sched();
+			rtswitch_leg_start(ctx, from, to, RTSWITCH_LEG_U);
 			rtdm_event_signal(&to->rt_synch);
 			break;
 
@@ -172,6 +353,8 @@ static int rtswitch_to_rt(rtswitch_context_t *ctx,
 	if (rc < 0)
 		return rc;
 
+	rtswitch_leg_end(ctx, from, RTSWITCH_LEG_U);
+
 	if (ctx->failed)
 		return 1;
 
@@ -193,6 +376,8 @@ static int rtswitch_pend_nrt(rtswitch_context_t *ctx,
 	if (down_interruptible(&task->nrt_synch))
 		return -EINTR;
 
+	rtswitch_leg_end(ctx, task, RTSWITCH_LEG_N);
+
 	if (ctx->failed)
 		return 1;
 
@@ -238,6 +423,7 @@ static int rtswitch_to_nrt(rtswitch_context_t *ctx,
 		switch (to->base.flags & RTSWITCH_RT) {
 		case RTSWITCH_NRT:
 		switch_to_nrt:
+			rtswitch_leg_start(ctx, from, to, RTSWITCH_LEG_N);
 			up(&to->nrt_synch);
 			break;
 
@@ -252,12 +438,14 @@ static int rtswitch_to_nrt(rtswitch_context_t *ctx,
 				(ctx->switches_count % 4000000) * 1000;
 
 			fp_regs_set(expected);
+			rtswitch_leg_start(ctx, from, to, RTSWITCH_LEG_N);
 			rtdm_event_signal(&to->rt_synch);
 			fp_val = fp_regs_check(expected);
 			fp_linux_end();
 
 			if(down_interruptible(&from->nrt_synch))
 				return -EINTR;
+			rtswitch_leg_end(ctx, from, RTSWITCH_LEG_N);
 			if (ctx->failed)
 				return 1;
 			if (fp_val != expected) {
@@ -277,12 +465,14 @@ static int rtswitch_to_nrt(rtswitch_context_t *ctx,
 
 			fp_linux_begin();
 			fp_regs_set(expected);
+			rtswitch_leg_start(ctx, from, to, RTSWITCH_LEG_N);
 			rtdm_event_signal(&to->rt_synch);
 			fp_val = fp_regs_check(expected);
 			fp_linux_end();
 
 			if (down_interruptible(&from->nrt_synch))
 				return -EINTR;
+			rtswitch_leg_end(ctx, from, RTSWITCH_LEG_N);
 			if (ctx->failed)
 				return 1;
 			if (fp_val != expected) {
@@ -299,6 +489,7 @@ static int rtswitch_to_nrt(rtswitch_context_t *ctx,
 				goto switch_to_nrt;
 
 		signal_nofp:
+			rtswitch_leg_start(ctx, from, to, RTSWITCH_LEG_N);
 			rtdm_event_signal(&to->rt_synch);
 			break;
 
@@ -309,6 +500,8 @@ static int rtswitch_to_nrt(rtswitch_context_t *ctx,
 	if (down_interruptible(&from->nrt_synch))
 		return -EINTR;
 
+	rtswitch_leg_end(ctx, from, RTSWITCH_LEG_N);
+
 	if (ctx->failed)
 		return 1;
 
@@ -357,6 +550,7 @@ static int rtswitch_register_task(rtswitch_context_t *ctx,
 	t = &ctx->tasks[arg->index];
 	ctx->next_index++;
 	t->base = *arg;
+	t->thread = NULL;
 	t->last_switch = 0;
 	sema_init(&t->nrt_synch, 0);
 	rtdm_event_init(&t->rt_synch, 0);
@@ -477,6 +671,7 @@ static int rtswitch_create_ktask(rtswitch_context_t *ctx,
 	err = xnpod_init_thread(&task->ktask,
 				&iattr, &xnsched_class_rt, &param);
 	if (!err) {
+		task->thread = &task->ktask;
 		sattr.mode = 0;
 		sattr.imask = 0;
 		sattr.affinity = xnarch_cpumask_of_cpu(ctx->cpu);
@@ -517,6 +712,9 @@ static int rtswitch_open(struct rtdm_dev_context *context,
 	ctx->failed = 0;
 	ctx->error.last_switch.from = ctx->error.last_switch.to = -1;
 	ctx->pause_us = 0;
+	ctx->legs = NULL;
+	ctx->legs_on = 0;
+	ctx->leg.stamp = 0;
 
 	err = rtdm_nrtsig_init(&ctx->wake_utask, rtswitch_utask_waker, ctx);
 	if (err)
@@ -548,6 +746,9 @@ static int rtswitch_close(struct rtdm_dev_context *context,
 	rtdm_timer_destroy(&ctx->wake_up_delay);
 	rtdm_nrtsig_destroy(&ctx->wake_utask);
 
+	if (ctx->legs)
+		vfree(ctx->legs);
+
 	return 0;
 }
 
@@ -578,6 +779,12 @@ static int rtswitch_ioctl_nrt(struct rtdm_dev_context *context,
 		ctx->pause_us = (unsigned long) arg;
 		return 0;
 
+	case RTTST_RTIOC_SWTEST_SET_LEG_STATS:
+		return rtswitch_set_leg_stats(ctx, (unsigned long) arg);
+
+	case RTTST_RTIOC_SWTEST_GET_LEG_STATS:
+		return rtswitch_get_leg_stats(ctx, user_info, arg);
+
 	case RTTST_RTIOC_SWTEST_REGISTER_UTASK:
 		if (!rtdm_rw_user_ok(user_info, arg, sizeof(task)))
 			return -EFAULT;
@@ -668,6 +875,8 @@ static int rtswitch_ioctl_rt(struct rtdm_dev_context *context,
 	case RTTST_RTIOC_SWTEST_REGISTER_UTASK:
 	case RTTST_RTIOC_SWTEST_CREATE_KTASK:
 	case RTTST_RTIOC_SWTEST_GET_SWITCHES_COUNT:
+	case RTTST_RTIOC_SWTEST_SET_LEG_STATS:
+	case RTTST_RTIOC_SWTEST_GET_LEG_STATS:
 		return -ENOSYS;
 
 	case RTTST_RTIOC_SWTEST_PEND:
@@ -739,7 +948,7 @@ static struct rtdm_device device = {
 	device_sub_class: RTDM_SUBCLASS_SWITCHTEST,
 	profile_version: RTTST_PROFILE_VER,
 	driver_name: "xeno_switchtest",
-	driver_version: RTDM_DRIVER_VER(0, 1, 1),
+	driver_version: RTDM_DRIVER_VER(0, 1, 2),
 	peripheral_name: "Context Switch Test",
 	provider_name: "Gilles Chanteperdrix",
 	proc_name: device.device_name,
@@ -61,8 +61,16 @@ MODULE_AUTHOR("jan.kiszka@web.de");
 static inline void add_histogram(struct rt_tmbench_context *ctx,
 				 long *histogram, long addval)
 {
-	/* bucketsize steps */
-	long inabs = (addval >= 0 ? addval : -addval) / ctx->bucketsize;
+	unsigned long absval = addval >= 0 ? addval : -addval;
+	long inabs;
+
+	if (ctx->bucketsize)
+		/* bucketsize steps */
+		inabs = absval / ctx->bucketsize;
+	else
+		/* log-linear steps */
+		inabs = rttst_hdr_index(absval);
+
 	histogram[inabs < ctx->histogram_size ?
 		  inabs : ctx->histogram_size - 1]++;
 }
@@ -497,7 +505,7 @@ static struct rtdm_device device = {
 	.device_sub_class	= RTDM_SUBCLASS_TIMERBENCH,
 	.profile_version	= RTTST_PROFILE_VER,
 	.driver_name		= "xeno_timerbench",
-	.driver_version		= RTDM_DRIVER_VER(0, 2, 1),
+	.driver_version		= RTDM_DRIVER_VER(0, 2, 2),
 	.peripheral_name	= "Timer Latency Benchmark",
 	.provider_name		= "Jan Kiszka",
 	.proc_name		= device.device_name,
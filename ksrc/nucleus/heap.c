@@ -59,6 +59,35 @@ HEAP {
 			     page_map[npages]
 			     page_array[npages][pagesize]
 		      }
+@endverbatim </tt>
+ *
+ * When CONFIG_XENO_OPT_HEAP_TLSF is enabled, the bucket and page map
+ * management is replaced by a Two-Level Segregated Fit allocator, as
+ * described by M. Masmano, I. Ripoll, A. Crespo and J. Real in "TLSF:
+ * a New Dynamic Memory Allocator for Real-Time Systems" (ECRTS
+ * 2004). Each extent is then carved into variable-sized blocks which
+ * are split upon allocation and coalesced with their free neighbours
+ * upon release, and free blocks are indexed by size class through a
+ * pair of bitmaps, so that both operations run in constant time
+ * regardless of the heap state. This trades a few bytes of header per
+ * block for much lower internal fragmentation with odd-sized
+ * requests:
+ *
+ * <tt> @verbatim
+HEAP {
+     tlsf_index -----------------+
+     extent_queue -------+       |
+}                        |       |
+			 V       V
+		      EXTENT #1 {
+			     {static header}
+			     tlsf_index {fl_bitmap, sl_bitmap[], free[][]}
+			     block[] {prev_phys, size, payload}
+			     sentinel
+		      } -+
+			 |
+			 V
+		      EXTENT #n { ... }
 @endverbatim </tt>
  *
  *@{*/
@@ -168,6 +197,182 @@ void xnheap_cleanup_proc(void)
 
 #endif /* CONFIG_XENO_OPT_VFILE */
 
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+
+#define tlsf_blksize(b)		((b)->size & ~(u_long)XNHEAP_TLSF_FREE)
+#define tlsf_blkfree(b)		((b)->size & XNHEAP_TLSF_FREE)
+#define tlsf_next_phys(b)	\
+	((struct xntlsf_block *)((caddr_t)(b) + tlsf_blksize(b)))
+#define tlsf_payload(b)		((caddr_t)(b) + XNHEAP_TLSF_HDRSZ)
+#define tlsf_header(p)		\
+	((struct xntlsf_block *)((caddr_t)(p) - XNHEAP_TLSF_HDRSZ))
+
+/*
+ * Map a block size to its size class. Sizes below SMALLSZ are
+ * indexed linearly by the first row, larger sizes by their most
+ * significant bit first, then by the XNHEAP_TLSF_SLLOG2 bits which
+ * follow it.
+ */
+static inline void tlsf_mapping(u_long size, int *fl, int *sl)
+{
+	int msb;
+
+	if (size < XNHEAP_TLSF_SMALLSZ) {
+		*fl = 0;
+		*sl = size >> XNHEAP_TLSF_ALIGNLOG2;
+	} else {
+		msb = fls(size) - 1;
+		*sl = (size >> (msb - XNHEAP_TLSF_SLLOG2)) - XNHEAP_TLSF_SLI;
+		*fl = msb - XNHEAP_TLSF_FLSHIFT + 1;
+	}
+}
+
+static void tlsf_insert(struct xntlsf *tlsf, struct xntlsf_block *b)
+{
+	struct xntlsf_block *head;
+	int fl, sl;
+
+	tlsf_mapping(tlsf_blksize(b), &fl, &sl);
+	head = tlsf->rows[fl].free[sl];
+	b->next_free = head;
+	b->prev_free = NULL;
+	if (head)
+		head->prev_free = b;
+	tlsf->rows[fl].free[sl] = b;
+	tlsf->rows[fl].sl_bitmap |= (1UL << sl);
+	tlsf->fl_bitmap |= (1UL << fl);
+}
+
+static void tlsf_remove(struct xntlsf *tlsf, struct xntlsf_block *b)
+{
+	int fl, sl;
+
+	tlsf_mapping(tlsf_blksize(b), &fl, &sl);
+
+	if (b->next_free)
+		b->next_free->prev_free = b->prev_free;
+
+	if (b->prev_free) {
+		b->prev_free->next_free = b->next_free;
+		return;
+	}
+
+	tlsf->rows[fl].free[sl] = b->next_free;
+	if (b->next_free == NULL) {
+		tlsf->rows[fl].sl_bitmap &= ~(1UL << sl);
+		if (tlsf->rows[fl].sl_bitmap == 0)
+			tlsf->fl_bitmap &= ~(1UL << fl);
+	}
+}
+
+/*
+ * Find a free block of at least bsize bytes. The request is rounded
+ * up to the next size class, so that any block from the first
+ * non-empty list at or above that class fits without searching
+ * it. When this fails, the head of the exact class list is given a
+ * chance, which notably allows the largest block of an empty extent
+ * to be obtained.
+ */
+static struct xntlsf_block *tlsf_find(struct xntlsf *tlsf, u_long bsize)
+{
+	struct xntlsf_block *b;
+	u_long map, rsize;
+	int fl, sl;
+
+	rsize = bsize;
+	if (rsize >= XNHEAP_TLSF_SMALLSZ)
+		rsize += (1UL << (fls(rsize) - 1 - XNHEAP_TLSF_SLLOG2)) - 1;
+
+	tlsf_mapping(rsize, &fl, &sl);
+
+	if (fl < tlsf->fl_count) {
+		map = tlsf->rows[fl].sl_bitmap & (~0UL << sl);
+		if (map == 0) {
+			map = tlsf->fl_bitmap & (~0UL << (fl + 1));
+			if (map == 0)
+				goto exact_class;
+			fl = ffnz(map);
+			map = tlsf->rows[fl].sl_bitmap;
+		}
+		return tlsf->rows[fl].free[ffnz(map)];
+	}
+
+exact_class:
+	tlsf_mapping(bsize, &fl, &sl);
+	if (fl >= tlsf->fl_count)
+		return NULL;
+
+	b = tlsf->rows[fl].free[sl];
+	if (b && tlsf_blksize(b) >= bsize)
+		return b;
+
+	return NULL;
+}
+
+/*
+ * Each extent is initially made of a single free block, followed by
+ * a busy sentinel of null size which stops coalescing at the end of
+ * the extent. The caller must have acquired the heap lock.
+ */
+static void init_extent(xnheap_t *heap, xnextent_t *extent)
+{
+	struct xntlsf_block *b, *sentinel;
+
+	inith(&extent->link);
+
+	extent->membase = (caddr_t) extent + heap->hdrsize;
+	extent->memlim = (caddr_t) extent + heap->extentsize;
+	extent->freelist = NULL;
+
+	b = tlsf_header(extent->membase);
+	sentinel = tlsf_header(extent->memlim);
+	b->prev_phys = NULL;
+	b->size = ((caddr_t)sentinel - (caddr_t)b) | XNHEAP_TLSF_FREE;
+	sentinel->prev_phys = b;
+	sentinel->size = 0;
+
+	tlsf_insert(heap->tlsf, b);
+}
+
+/*
+ * Find the extent a block belongs to, and make sure it is a busy
+ * block properly linked into the physical chain. The caller must
+ * have acquired the heap lock.
+ */
+static int tlsf_validate(xnheap_t *heap, void *block)
+{
+	struct xntlsf_block *b, *next;
+	xnextent_t *extent = NULL;
+	xnholder_t *holder;
+
+	for (holder = getheadq(&heap->extents);
+	     holder != NULL; holder = nextq(&heap->extents, holder)) {
+		extent = link2extent(holder);
+		if ((caddr_t) block >= extent->membase &&
+		    (caddr_t) block < extent->memlim)
+			break;
+	}
+
+	if (!holder)
+		return -EFAULT;
+
+	if (((u_long)block & (XNHEAP_MINALIGNSZ - 1)) != 0)
+		return -EINVAL;
+
+	b = tlsf_header(block);
+	if (tlsf_blkfree(b) || tlsf_blksize(b) < XNHEAP_TLSF_MINBLKSZ ||
+	    tlsf_blksize(b) > extent->memlim - (caddr_t)block)
+		return -EINVAL;
+
+	next = tlsf_next_phys(b);
+	if (next->prev_phys != b)
+		return -EINVAL;
+
+	return 0;
+}
+
+#else /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 static void init_extent(xnheap_t *heap, xnextent_t *extent)
 {
 	caddr_t freepage;
@@ -196,6 +401,8 @@ static void init_extent(xnheap_t *heap, xnextent_t *extent)
 	extent->freelist = extent->membase;
 }
 
+#endif /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 /*
  */
 
@@ -227,7 +434,10 @@ static void init_extent(xnheap_t *heap, xnextent_t *extent)
  *
  * This value is then aligned on the next 16-byte boundary. The
  * routine xnheap_overhead() computes the corrected heap size
- * according to the previous formula.
+ * according to the previous formula. With CONFIG_XENO_OPT_HEAP_TLSF,
+ * the header contains the allocator index instead of the page map,
+ * which only grows with log2(heapsize), and @a heapsize must also be
+ * a multiple of 16.
  *
  * @param pagesize The size in bytes of the fundamental memory page
  * which will be used to subdivide the heap internally. Choosing the
@@ -280,6 +490,11 @@ int xnheap_init(xnheap_t *heap,
 	    heapsize > XNHEAP_MAXEXTSZ || (heapsize & (pagesize - 1)) != 0)
 		return -EINVAL;
 
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+	if ((heapsize & (XNHEAP_MINALIGNSZ - 1)) != 0)
+		return -EINVAL;
+#endif
+
 	/*
 	 * Determine the page map overhead inside the given extent
 	 * size. We need to reserve 4 bytes in a page map for each
@@ -312,7 +527,12 @@ int xnheap_init(xnheap_t *heap,
 		return -EINVAL;
 
 	heap->ubytes = 0;
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+	/* Payload of the single free block of an empty extent. */
+	heap->maxcont = heapsize - hdrsize - XNHEAP_TLSF_HDRSZ;
+#else
 	heap->maxcont = heap->npages * pagesize;
+#endif
 	for (cpu = 0; cpu < nr_cpus; cpu++)
 		heap->idleq[cpu] = NULL;
 	inith(&heap->link);
@@ -320,8 +540,22 @@ int xnheap_init(xnheap_t *heap,
 	initq(&heap->extents);
 	xnlock_init(&heap->lock);
 	xnarch_init_heapcb(&heap->archdep);
-	memset(heap->buckets, 0, sizeof(heap->buckets));
 	extent = (xnextent_t *)heapaddr;
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+	/*
+	 * The allocator index lives in the header of the initial
+	 * extent, right after its static part.
+	 */
+	heap->tlsf = (struct xntlsf *)
+		((caddr_t)extent + xnheap_align(sizeof(xnextent_t),
+						XNHEAP_MINALIGNSZ));
+	memset(heap->tlsf, 0, xnheap_tlsf_size(heapsize));
+	heap->tlsf->fl_count =
+		(xnheap_tlsf_size(heapsize) - sizeof(struct xntlsf))
+		/ sizeof(struct xntlsf_row);
+#else
+	memset(heap->buckets, 0, sizeof(heap->buckets));
+#endif
 	init_extent(heap, extent);
 
 	appendq(&heap->extents, &extent->link);
@@ -432,6 +666,103 @@ void xnheap_destroy(xnheap_t *heap,
 }
 EXPORT_SYMBOL_GPL(xnheap_destroy);
 
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+
+/*
+ * TLSF flavour of xnheap_alloc(): requests are rounded to the
+ * minimum alignment size, plus the block header.
+ */
+void *xnheap_alloc(xnheap_t *heap, u_long size)
+{
+	struct xntlsf_block *b, *rest;
+	u_long bsize;
+	spl_t s;
+
+	if (size == 0 || size > heap->maxcont)
+		return NULL;
+
+	bsize = xnheap_align(size + XNHEAP_TLSF_HDRSZ, XNHEAP_MINALIGNSZ);
+	if (bsize < XNHEAP_TLSF_MINBLKSZ)
+		bsize = XNHEAP_TLSF_MINBLKSZ;
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	b = tlsf_find(heap->tlsf, bsize);
+	if (b == NULL) {
+		xnlock_put_irqrestore(&heap->lock, s);
+		return NULL;
+	}
+
+	tlsf_remove(heap->tlsf, b);
+
+	/* Give the trailing space back if it can hold a block. */
+	if (tlsf_blksize(b) - bsize >= XNHEAP_TLSF_MINBLKSZ) {
+		rest = (struct xntlsf_block *)((caddr_t)b + bsize);
+		rest->size = (tlsf_blksize(b) - bsize) | XNHEAP_TLSF_FREE;
+		rest->prev_phys = b;
+		tlsf_next_phys(rest)->prev_phys = rest;
+		tlsf_insert(heap->tlsf, rest);
+		b->size = bsize;
+	} else
+		b->size = tlsf_blksize(b);
+
+	heap->ubytes += tlsf_blksize(b) - XNHEAP_TLSF_HDRSZ;
+
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return tlsf_payload(b);
+}
+EXPORT_SYMBOL_GPL(xnheap_alloc);
+
+/*
+ * TLSF flavour of xnheap_test_and_free(): the released block is
+ * merged with its free physical neighbours before being indexed.
+ */
+int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
+{
+	struct xntlsf_block *b, *next, *prev;
+	int err;
+	spl_t s;
+
+	xnlock_get_irqsave(&heap->lock, s);
+
+	err = tlsf_validate(heap, block);
+	if (err)
+		goto unlock_and_exit;
+
+	if (ckfn && (err = ckfn(block)) != 0)
+		goto unlock_and_exit;
+
+	b = tlsf_header(block);
+	heap->ubytes -= tlsf_blksize(b) - XNHEAP_TLSF_HDRSZ;
+
+	next = tlsf_next_phys(b);
+	if (tlsf_blkfree(next)) {
+		tlsf_remove(heap->tlsf, next);
+		b->size += tlsf_blksize(next);
+	}
+
+	prev = b->prev_phys;
+	if (prev && tlsf_blkfree(prev)) {
+		tlsf_remove(heap->tlsf, prev);
+		prev->size += b->size;
+		b = prev;
+	}
+
+	b->size |= XNHEAP_TLSF_FREE;
+	tlsf_next_phys(b)->prev_phys = b;
+	tlsf_insert(heap->tlsf, b);
+
+unlock_and_exit:
+
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(xnheap_test_and_free);
+
+#else /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 /*
  * get_free_range() -- Obtain a range of contiguous free pages to
  * fulfill an allocation of 2 ** log2size.  The caller must have
@@ -895,6 +1226,8 @@ int xnheap_test_and_free(xnheap_t *heap, void *block, int (*ckfn) (void *block))
 }
 EXPORT_SYMBOL_GPL(xnheap_test_and_free);
 
+#endif /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 /*!
  * \fn int xnheap_free(xnheap_t *heap, void *block)
  * \brief Release a memory block to a memory heap.
@@ -971,8 +1304,8 @@ int xnheap_extend(xnheap_t *heap, void *extaddr, u_long extsize)
 	if (extsize != heap->extentsize)
 		return -EINVAL;
 
-	init_extent(heap, extent);
 	xnlock_get_irqsave(&heap->lock, s);
+	init_extent(heap, extent);
 	appendq(&heap->extents, &extent->link);
 	xnlock_put_irqrestore(&heap->lock, s);
 
@@ -1042,6 +1375,22 @@ void xnheap_finalize_free_inner(xnheap_t *heap, int cpu)
 }
 EXPORT_SYMBOL_GPL(xnheap_finalize_free_inner);
 
+#ifdef CONFIG_XENO_OPT_HEAP_TLSF
+
+int xnheap_check_block(xnheap_t *heap, void *block)
+{
+	int err;
+	spl_t s;
+
+	xnlock_get_irqsave(&heap->lock, s);
+	err = tlsf_validate(heap, block) ? -EINVAL : 0;
+	xnlock_put_irqrestore(&heap->lock, s);
+
+	return err;
+}
+
+#else /* !CONFIG_XENO_OPT_HEAP_TLSF */
+
 int xnheap_check_block(xnheap_t *heap, void *block)
 {
 	xnextent_t *extent = NULL;
@@ -1079,6 +1428,8 @@ int xnheap_check_block(xnheap_t *heap, void *block)
 
 	return err;
 }
+
+#endif /* !CONFIG_XENO_OPT_HEAP_TLSF */
 EXPORT_SYMBOL_GPL(xnheap_check_block);
 
 #ifdef CONFIG_XENO_OPT_PERVASIVE
@@ -32,6 +32,7 @@
  *
  *@{*/
 
+#include <linux/wait.h>
 #include <nucleus/pod.h>
 #include <nucleus/intr.h>
 #include <nucleus/stat.h>
@@ -43,6 +44,7 @@ DEFINE_PRIVATE_XNLOCK(intrlock);
 
 #ifdef CONFIG_XENO_OPT_STATS
 xnintr_t nkclock;	     /* Only for statistics */
+static struct xnintr_hist nkclock_hist[XNARCH_NR_CPUS];
 static int xnintr_count = 1; /* Number of attached xnintr objects + nkclock */
 static int xnintr_list_rev;  /* Modification counter of xnintr list */
 
@@ -75,14 +77,91 @@ static inline void xnintr_sync_stat_references(xnintr_t *intr)
 			cpu_relax();
 	}
 }
+
+static inline int xnintr_hist_bucket(xnticks_t delay)
+{
+	unsigned long long ns = xnarch_tsc_to_ns(delay) >> XNINTR_HIST_SHIFT;
+
+	if (ns >= 1ULL << (XNINTR_HIST_BUCKETS - 1))
+		return XNINTR_HIST_BUCKETS - 1;
+
+	return fls((unsigned long)ns);
+}
+
+/*
+ * Account for a handler run, from the IRQ entry date to the start
+ * of the ISR, then to its completion. Only the local CPU writes to
+ * its own slot, with interrupts off, so no locking is required.
+ */
+static inline void xnintr_hist_update(xnintr_t *intr, int cpu,
+				      xnticks_t entry, xnticks_t start,
+				      xnticks_t end)
+{
+	struct xnintr_hist *hist = &intr->hist[cpu];
+	xnsticks_t lat = (xnsticks_t)(start - entry);
+	xnticks_t run = end - start;
+
+	/* The entry date may have been taken on another CPU. */
+	if (lat < 0)
+		lat = 0;
+
+	hist->lat[xnintr_hist_bucket(lat)]++;
+	hist->run[xnintr_hist_bucket(run)]++;
+
+	if (lat > hist->lat_max)
+		hist->lat_max = lat;
+	if (run > hist->run_max)
+		hist->run_max = run;
+}
+
+/*
+ * Histograms are only needed while the object is attached, and only
+ * for online CPUs, so we don't embed them into each descriptor.
+ */
+static inline int xnintr_hist_alloc(xnintr_t *intr)
+{
+	size_t size = xnarch_num_online_cpus() * sizeof(*intr->hist);
+
+	if (intr->hist)
+		return 0;	/* Attached already. */
+
+	intr->hist = xnmalloc(size);
+	if (intr->hist == NULL)
+		return -ENOMEM;
+
+	memset(intr->hist, 0, size);
+
+	return 0;
+}
+
+static inline void xnintr_hist_free(xnintr_t *intr)
+{
+	struct xnintr_hist *hist;
+	spl_t s;
+
+	/* Readers of /proc/xenomai/irqhist hold intrlock. */
+	xnlock_get_irqsave(&intrlock, s);
+	hist = intr->hist;
+	intr->hist = NULL;
+	xnlock_put_irqrestore(&intrlock, s);
+
+	if (hist)
+		xnfree(hist);
+}
 #else
 static inline void xnintr_stat_counter_inc(void) {}
 static inline void xnintr_stat_counter_dec(void) {}
 static inline void xnintr_sync_stat_references(xnintr_t *intr) {}
+static inline int xnintr_hist_alloc(xnintr_t *intr) { return 0; }
+static inline void xnintr_hist_free(xnintr_t *intr) {}
+#define xnintr_hist_update(intr, cpu, entry, start, end)	\
+	do { (void)(entry); (void)(start); (void)(end); } while (0)
 #endif /* CONFIG_XENO_OPT_STATS */
 
 static void xnintr_irq_handler(unsigned irq, void *cookie);
 
+static int xnintr_thread_kick(struct xnintr *intr);
+
 void xnintr_host_tick(struct xnsched *sched) /* Interrupts off. */
 {
 	__clrbits(sched->lflags, XNHTICK);
@@ -95,6 +174,7 @@ void xnintr_clock_handler(void)
 {
 	struct xnsched *sched = xnpod_current_sched();
 	unsigned int cpu = xnsched_cpu(sched);
+	xnticks_t entry = xnstat_exectime_now(), start;
 	xnstat_exectime_t *prev;
 
 	if (!cpu_isset(cpu, xnarch_supported_cpus)) {
@@ -112,7 +192,9 @@ void xnintr_clock_handler(void)
 	__setbits(sched->lflags, XNINIRQ);
 
 	xnlock_get(&nklock);
+	start = xnstat_exectime_now();
 	xntimer_tick_aperiodic();
+	xnintr_hist_update(&nkclock, cpu, entry, start, xnstat_exectime_now());
 	xnlock_put(&nklock);
 
 	xnstat_exectime_switch(sched, prev);
@@ -146,11 +228,24 @@ typedef struct xnintr_irq {
 
 	xnintr_t *handlers;
 	int unhandled;
+	int period;		/* Dispatches until the next reordering. */
+
+	/* Chain walk statistics, updated under the lock. */
+	unsigned long walks;	/* Dispatches. */
+	unsigned long visits;	/* Handlers visited. */
+	unsigned long skips;	/* Handlers ruled out by their probe. */
+	int maxwalk;		/* Longest walk. */
 
 } ____cacheline_aligned_in_smp xnintr_irq_t;
 
 static xnintr_irq_t xnirqs[XNARCH_NR_IRQS];
 
+/*
+ * Number of dispatches between two reorderings of a shared IRQ
+ * chain by decreasing count of recent hits.
+ */
+#define XNINTR_SHIRQ_PERIOD	256
+
 static inline xnintr_t *xnintr_shirq_first(unsigned irq)
 {
 	return xnirqs[irq].handlers;
@@ -161,6 +256,50 @@ static inline xnintr_t *xnintr_shirq_next(xnintr_t *prev)
 	return prev->next;
 }
 
+/*
+ * Move the handlers which served the most IRQs recently to the
+ * front of the chain, then age their scores. Called with the
+ * per-IRQ lock held.
+ */
+static void xnintr_shirq_reorder(xnintr_irq_t *shirq)
+{
+	xnintr_t **p, *intr, *next;
+	int swapped;
+
+	do {
+		swapped = 0;
+		for (p = &shirq->handlers;
+		     (intr = *p) != NULL && (next = intr->next) != NULL;
+		     p = &intr->next) {
+			if (next->score <= intr->score)
+				continue;
+			intr->next = next->next;
+			next->next = intr;
+			*p = next;
+			intr = next;
+			swapped = 1;
+		}
+	} while (swapped);
+
+	for (intr = shirq->handlers; intr; intr = intr->next)
+		intr->score >>= 1;
+}
+
+/* Called with the per-IRQ lock held. */
+static inline void xnintr_shirq_account(xnintr_irq_t *shirq, int walk)
+{
+	shirq->walks++;
+	shirq->visits += walk;
+	if (walk > shirq->maxwalk)
+		shirq->maxwalk = walk;
+
+	if (--shirq->period <= 0) {
+		shirq->period = XNINTR_SHIRQ_PERIOD;
+		if (shirq->handlers && shirq->handlers->next)
+			xnintr_shirq_reorder(shirq);
+	}
+}
+
 /*
  * Low-level interrupt handler dispatching the user-defined ISRs for
  * shared interrupts -- Called with interrupts off.
@@ -169,13 +308,14 @@ static void xnintr_shirq_handler(unsigned irq, void *cookie)
 {
 	struct xnsched *sched = xnpod_current_sched();
 	xnintr_irq_t *shirq = &xnirqs[irq];
+	xnticks_t start, entry, isr_start;
 	xnstat_exectime_t *prev;
-	xnticks_t start;
+	int s = 0, ret, walk = 0;
 	xnintr_t *intr;
-	int s = 0, ret;
 
 	prev  = xnstat_exectime_get_current(sched);
 	start = xnstat_exectime_now();
+	entry = start;
 	trace_mark(xn_nucleus, irq_enter, "irq %u", irq);
 
 	++sched->inesting;
@@ -185,10 +325,18 @@ static void xnintr_shirq_handler(unsigned irq, void *cookie)
 	intr = shirq->handlers;
 
 	while (intr) {
+		walk++;
+
+		if (intr->probe && !intr->probe(intr)) {
+			shirq->skips++;
+			intr = intr->next;
+			continue;
+		}
 		/*
 		 * NOTE: We assume that no CPU migration will occur
 		 * while running the interrupt service routine.
 		 */
+		isr_start = xnstat_exectime_now();
 		ret = intr->isr(intr);
 		s |= ret;
 
@@ -199,11 +347,22 @@ static void xnintr_shirq_handler(unsigned irq, void *cookie)
 				&intr->stat[xnsched_cpu(sched)].account,
 				start);
 			start = xnstat_exectime_now();
+			xnintr_hist_update(intr, xnsched_cpu(sched),
+					   entry, isr_start, start);
+			intr->score++;
+			/*
+			 * The line is level-triggered, so it will be
+			 * raised again if another device still
+			 * asserts it: we may stop at the first taker.
+			 */
+			break;
 		}
 
 		intr = intr->next;
 	}
 
+	xnintr_shirq_account(shirq, walk);
+
 	xnlock_put(&shirq->lock);
 
 	if (unlikely(s == XN_ISR_NONE)) {
@@ -241,11 +400,12 @@ static void xnintr_edge_shirq_handler(unsigned irq, void *cookie)
 	xnintr_irq_t *shirq = &xnirqs[irq];
 	int s = 0, counter = 0, ret, code;
 	struct xnintr *intr, *end = NULL;
+	xnticks_t start, entry, isr_start;
 	xnstat_exectime_t *prev;
-	xnticks_t start;
 
 	prev  = xnstat_exectime_get_current(sched);
 	start = xnstat_exectime_now();
+	entry = start;
 	trace_mark(xn_nucleus, irq_enter, "irq %u", irq);
 
 	++sched->inesting;
@@ -255,12 +415,20 @@ static void xnintr_edge_shirq_handler(unsigned irq, void *cookie)
 	intr = shirq->handlers;
 
 	while (intr != end) {
+		if (intr->probe && !intr->probe(intr)) {
+			shirq->skips++;
+			if (end == NULL)
+				end = intr;
+			goto next;
+		}
+
 		xnstat_exectime_switch(sched,
 			&intr->stat[xnsched_cpu(sched)].account);
 		/*
 		 * NOTE: We assume that no CPU migration will occur
 		 * while running the interrupt service routine.
 		 */
+		isr_start = xnstat_exectime_now();
 		ret = intr->isr(intr);
 		code = ret & ~XN_ISR_BITMASK;
 		s |= ret;
@@ -273,9 +441,13 @@ static void xnintr_edge_shirq_handler(unsigned irq, void *cookie)
 				&intr->stat[xnsched_cpu(sched)].account,
 				start);
 			start = xnstat_exectime_now();
+			xnintr_hist_update(intr, xnsched_cpu(sched),
+					   entry, isr_start, start);
+			intr->score++;
 		} else if (end == NULL)
 			end = intr;
 
+	next:
 		if (counter++ > MAX_EDGEIRQ_COUNTER)
 			break;
 
@@ -283,6 +455,9 @@ static void xnintr_edge_shirq_handler(unsigned irq, void *cookie)
 			intr = shirq->handlers;
 	}
 
+	/* All handlers have been polled at least once. */
+	xnintr_shirq_account(shirq, counter);
+
 	xnlock_put(&shirq->lock);
 
 	if (counter > MAX_EDGEIRQ_COUNTER)
@@ -327,12 +502,6 @@ static inline int xnintr_irq_attach(xnintr_t *intr)
 		    || ((prev->flags & XN_ISR_EDGE) !=
 			(intr->flags & XN_ISR_EDGE)))
 			return -EBUSY;
-
-		/* Get a position at the end of the list to insert the new element. */
-		while (prev) {
-			p = &prev->next;
-			prev = *p;
-		}
 	} else {
 		/* Initialize the corresponding interrupt channel */
 		void (*handler) (unsigned, void *) = &xnintr_irq_handler;
@@ -345,6 +514,11 @@ static inline int xnintr_irq_attach(xnintr_t *intr)
 
 		}
 		shirq->unhandled = 0;
+		shirq->period = XNINTR_SHIRQ_PERIOD;
+		shirq->walks = 0;
+		shirq->visits = 0;
+		shirq->skips = 0;
+		shirq->maxwalk = 0;
 
 		err = xnarch_hook_irq(intr->irq, handler,
 				      (rthal_irq_ackfn_t)intr->iack, intr);
@@ -353,11 +527,22 @@ static inline int xnintr_irq_attach(xnintr_t *intr)
 	}
 
 	intr->next = NULL;
+	intr->score = 0;
+
+	/*
+	 * Add the given interrupt object at the end of the chain. The
+	 * IRQ handler may reorder the latter, so we need to
+	 * synchronise with it.
+	 */
+	xnlock_get(&shirq->lock);
+
+	while ((prev = *p) != NULL)
+		p = &prev->next;
 
-	/* Add the given interrupt object. No need to synchronise with the IRQ
-	   handler, we are only extending the chain. */
 	*p = intr;
 
+	xnlock_put(&shirq->lock);
+
 	return 0;
 }
 
@@ -367,10 +552,12 @@ static inline int xnintr_irq_detach(xnintr_t *intr)
 	xnintr_t *e, **p = &shirq->handlers;
 	int err = 0;
 
+	/* The IRQ handler may reorder the chain concurrently. */
+	xnlock_get(&shirq->lock);
+
 	while ((e = *p) != NULL) {
 		if (e == intr) {
 			/* Remove the given interrupt object from the list. */
-			xnlock_get(&shirq->lock);
 			*p = e->next;
 			xnlock_put(&shirq->lock);
 
@@ -385,6 +572,8 @@ static inline int xnintr_irq_detach(xnintr_t *intr)
 		p = &e->next;
 	}
 
+	xnlock_put(&shirq->lock);
+
 	xnlogerr("attempted to detach a non previously attached interrupt "
 		 "object.\n");
 	return err;
@@ -440,9 +629,9 @@ static inline int xnintr_irq_detach(xnintr_t *intr)
 static void xnintr_irq_handler(unsigned irq, void *cookie)
 {
 	struct xnsched *sched = xnpod_current_sched();
+	xnticks_t start, isr_start;
 	xnstat_exectime_t *prev;
 	struct xnintr *intr;
-	xnticks_t start;
 	int s;
 
 	prev  = xnstat_exectime_get_current(sched);
@@ -471,7 +660,12 @@ static void xnintr_irq_handler(unsigned irq, void *cookie)
 	/* cookie always valid, attach/detach happens with IRQs disabled */
 	intr = cookie;
 #endif
-	s = intr->isr(intr);
+	/* Threaded handlers are accounted for by their server. */
+	isr_start = xnstat_exectime_now();
+	if (intr->thread)
+		s = xnintr_thread_kick(intr);
+	else
+		s = intr->isr(intr);
 	if (unlikely(s == XN_ISR_NONE)) {
 		if (++intr->unhandled == XNINTR_MAX_UNHANDLED) {
 			xnlogerr("%s: IRQ%d not handled. Disabling IRQ "
@@ -480,6 +674,9 @@ static void xnintr_irq_handler(unsigned irq, void *cookie)
 		}
 	} else {
 		xnstat_counter_inc(&intr->stat[xnsched_cpu(sched)].hits);
+		if (intr->thread == NULL)
+			xnintr_hist_update(intr, xnsched_cpu(sched), start,
+					   isr_start, xnstat_exectime_now());
 		xnstat_exectime_lazy_switch(sched,
 			&intr->stat[xnsched_cpu(sched)].account,
 			start);
@@ -506,14 +703,245 @@ static void xnintr_irq_handler(unsigned irq, void *cookie)
 	trace_mark(xn_nucleus, irq_exit, "irq %u", irq);
 }
 
+/*
+ * Threaded interrupts: the top half masks the line and wakes up a
+ * per-IRQ server thread, which runs the ISR at its own priority then
+ * unmasks the line. Interference from slow handlers on higher
+ * priority threads is therefore bounded by the top half.
+ */
+struct xnintr_thread {
+	struct xnthread thread;
+	int pending;		/* !< An IRQ awaits processing. */
+	int stopped;		/* !< The server has to exit. */
+	xnticks_t raised;	/* !< TSC date of the pending IRQ. */
+	unsigned long runs;	/* !< Number of ISR invocations. */
+	xnticks_t lat_sum;	/* !< Cumulated wakeup latency (TSC). */
+	xnticks_t lat_max;	/* !< Worst-case wakeup latency (TSC). */
+	xnticks_t run_sum;	/* !< Cumulated ISR duration (TSC). */
+	xnticks_t run_max;	/* !< Worst-case ISR duration (TSC). */
+};
+
+/*
+ * Servers exiting post an APC, which runs once Linux resumes on
+ * their CPU, i.e. after they have switched out for good.
+ */
+static DECLARE_WAIT_QUEUE_HEAD(xnintr_thread_wq);
+static int xnintr_thread_apc;
+
+static void xnintr_thread_reap(void *cookie)
+{
+	wake_up_all(&xnintr_thread_wq);
+}
+
+static int xnintr_thread_exited(struct xnintr_thread *it)
+{
+	int ret;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	ret = xnthread_test_state(&it->thread, XNZOMBIE) != 0;
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+/* Top half -- called with interrupts off, under the per-IRQ lock. */
+static int xnintr_thread_kick(struct xnintr *intr)
+{
+	struct xnintr_thread *it = intr->thread;
+
+	xnlock_get(&nklock);
+
+	if (!it->pending) {
+		it->pending = 1;
+		it->raised = xnarch_get_cpu_tsc();
+		if (xnthread_test_state(&it->thread, XNSUSP))
+			xnpod_resume_thread(&it->thread, XNSUSP);
+	}
+
+	xnlock_put(&nklock);
+
+	/* The line remains masked until the bottom half is done. */
+	return XN_ISR_HANDLED | XN_ISR_NOENABLE;
+}
+
+static void xnintr_thread_body(void *cookie)
+{
+	struct xnintr *intr = cookie;
+	struct xnintr_thread *it = intr->thread;
+	xnticks_t raised, start, end;
+	xnsticks_t lat;
+	spl_t s;
+	int ret;
+
+	for (;;) {
+		xnlock_get_irqsave(&nklock, s);
+
+		while (!it->pending && !it->stopped)
+			xnpod_suspend_thread(&it->thread, XNSUSP,
+					     XN_INFINITE, XN_RELATIVE, NULL);
+
+		if (it->stopped) {
+			__rthal_apc_schedule(xnintr_thread_apc);
+			xnlock_put_irqrestore(&nklock, s);
+			return;
+		}
+
+		it->pending = 0;
+		raised = it->raised;
+
+		xnlock_put_irqrestore(&nklock, s);
+
+		start = xnarch_get_cpu_tsc();
+		ret = intr->isr(intr);
+		end = xnarch_get_cpu_tsc();
+
+		/* The top half may have run on another CPU. */
+		lat = (xnsticks_t)(start - raised);
+		if (lat < 0)
+			lat = 0;
+
+		xnlock_get_irqsave(&nklock, s);
+		xnintr_hist_update(intr, xnsched_cpu(xnpod_current_sched()),
+				   raised, start, end);
+		it->runs++;
+		it->lat_sum += lat;
+		if (lat > it->lat_max)
+			it->lat_max = lat;
+		it->run_sum += end - start;
+		if (end - start > it->run_max)
+			it->run_max = end - start;
+		xnlock_put_irqrestore(&nklock, s);
+
+		if (unlikely(ret == XN_ISR_NONE)) {
+			if (++intr->unhandled == XNINTR_MAX_UNHANDLED) {
+				xnlogerr("%s: IRQ%d not handled. Disabling IRQ "
+					 "line.\n", __FUNCTION__, intr->irq);
+				ret |= XN_ISR_NOENABLE;
+			}
+		} else
+			intr->unhandled = 0;
+
+		if (!(ret & XN_ISR_NOENABLE)) {
+			splhigh(s);
+			xnarch_end_irq(intr->irq);
+			splexit(s);
+		}
+	}
+}
+
+static int xnintr_thread_init(struct xnintr *intr, int prio)
+{
+	union xnsched_policy_param param;
+	struct xnthread_init_attr iattr;
+	struct xnintr_thread *it;
+	char name[XNOBJECT_NAME_LEN];
+	int ret;
+
+	it = xnmalloc(sizeof(*it));
+	if (it == NULL)
+		return -ENOMEM;
+
+	memset(it, 0, sizeof(*it));
+	snprintf(name, sizeof(name), "irq%u", intr->irq);
+
+	iattr.tbase = &nktbase;
+	iattr.name = name;
+	iattr.flags = 0;
+	iattr.ops = NULL;
+	iattr.stacksize = 0;
+	param.rt.prio = prio;
+
+	ret = xnpod_init_thread(&it->thread, &iattr, &xnsched_class_rt, &param);
+	if (ret)
+		goto fail_free;
+
+	/* Obtain a handle for fast mutex locking from the ISR. */
+	ret = xnthread_register(&it->thread, "");
+	if (ret)
+		goto fail_delete;
+
+	intr->thread = it;
+
+	return 0;
+
+fail_delete:
+	xnpod_delete_thread(&it->thread);
+fail_free:
+	xnfree(it);
+
+	return ret;
+}
+
+static int xnintr_thread_start(struct xnintr *intr)
+{
+	struct xnthread_start_attr sattr;
+
+	sattr.mode = 0;
+	sattr.imask = 0;
+	sattr.affinity = XNPOD_ALL_CPUS;
+	sattr.entry = xnintr_thread_body;
+	sattr.cookie = intr;
+
+	return xnpod_start_thread(&intr->thread->thread, &sattr);
+}
+
+/*
+ * Must be called once the IRQ is detached. Unless the server was
+ * never started, this may only happen from the root domain.
+ */
+static void xnintr_thread_stop(struct xnintr *intr)
+{
+	struct xnintr_thread *it = intr->thread;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (xnthread_test_state(&it->thread, XNDORMANT)) {
+		xnlock_put_irqrestore(&nklock, s);
+		xnpod_delete_thread(&it->thread);
+		xnlock_get_irqsave(&nklock, s);
+		goto out;
+	}
+
+	it->stopped = 1;
+	if (xnthread_test_state(&it->thread, XNSUSP))
+		xnpod_resume_thread(&it->thread, XNSUSP);
+	xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	/* Let the ISR complete if it was running. */
+	wait_event(xnintr_thread_wq, xnintr_thread_exited(it));
+
+	xnlock_get_irqsave(&nklock, s);
+out:
+	intr->thread = NULL;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	xnfree(it);
+}
+
 int __init xnintr_mount(void)
 {
 	int i;
 	for (i = 0; i < XNARCH_NR_IRQS; ++i)
 		xnlock_init(&xnirqs[i].lock);
+
+	xnintr_thread_apc = rthal_apc_alloc("intr_thread_exit",
+					    xnintr_thread_reap, NULL);
+	if (xnintr_thread_apc < 0)
+		return xnintr_thread_apc;
+
 	return 0;
 }
 
+void xnintr_umount(void)
+{
+	rthal_apc_free(xnintr_thread_apc);
+}
+
 /*!
  * \fn int xnintr_init (xnintr_t *intr,const char *name,unsigned irq,xnisr_t isr,xniack_t iack,xnflags_t flags)
  * \brief Initialize an interrupt object.
@@ -568,6 +996,10 @@ int __init xnintr_mount(void)
  * attached. Since this count could wrap around, it should be used as
  * an indication of interrupt activity only.
  *
+ * When statistics are enabled, the delay between the IRQ entry and
+ * the start of the ISR, and the duration of the latter, are also
+ * recorded in per-CPU histograms, readable from /proc/xenomai/irqhist.
+ *
  * @param intr The address of a interrupt object descriptor the
  * nucleus will use to store the object-specific data.  This
  * descriptor must always be valid while the object is active
@@ -631,10 +1063,24 @@ int xnintr_init(xnintr_t *intr,
 	intr->name = name ? : "<unknown>";
 	intr->flags = flags;
 	intr->unhandled = 0;
+	intr->thread = NULL;
+	intr->probe = NULL;
 	memset(&intr->stat, 0, sizeof(intr->stat));
 #ifdef CONFIG_XENO_OPT_SHIRQ
 	intr->next = NULL;
+	intr->score = 0;
 #endif
+#ifdef CONFIG_XENO_OPT_STATS
+	/*
+	 * Regular objects get their histograms when attached. The
+	 * clock object is never attached, it has its own.
+	 */
+	if (intr == &nkclock) {
+		memset(nkclock_hist, 0, sizeof(nkclock_hist));
+		intr->hist = nkclock_hist;
+	} else
+		intr->hist = NULL;
+#endif /* CONFIG_XENO_OPT_STATS */
 
 	return 0;
 }
@@ -695,6 +1141,9 @@ EXPORT_SYMBOL_GPL(xnintr_destroy);
  *
  * - -EBUSY is returned if the interrupt object was already attached.
  *
+ * - -ENOMEM is returned if the statistics histograms could not be
+ * allocated.
+ *
  * @note The caller <b>must not</b> hold nklock when invoking this service,
  * this would cause deadlocks.
  *
@@ -719,6 +1168,10 @@ int xnintr_attach(xnintr_t *intr, void *cookie)
 	trace_mark(xn_nucleus, irq_attach, "irq %u name %s",
 		   intr->irq, intr->name);
 
+	ret = xnintr_hist_alloc(intr);
+	if (ret)
+		return ret;
+
 	intr->cookie = cookie;
 	memset(&intr->stat, 0, sizeof(intr->stat));
 
@@ -734,8 +1187,11 @@ int xnintr_attach(xnintr_t *intr, void *cookie)
 	}
 
 	ret = xnintr_irq_attach(intr);
-	if (ret)
-		goto out;
+	if (ret) {
+		xnlock_put_irqrestore(&intrlock, s);
+		xnintr_hist_free(intr);
+		return ret;
+	}
 
 	__setbits(intr->flags, XN_ISR_ATTACHED);
 	xnintr_stat_counter_inc();
@@ -746,6 +1202,93 @@ out:
 }
 EXPORT_SYMBOL_GPL(xnintr_attach);
 
+/*!
+ * \fn int xnintr_attach_threaded (xnintr_t *intr, void *cookie, int prio);
+ * \brief Attach an interrupt object in threaded mode.
+ *
+ * This service works like xnintr_attach(), except that the ISR of the
+ * interrupt object does not run from the interrupt context. Instead,
+ * a dedicated kernel thread named "irq<n>" is created at priority @a
+ * prio in the real-time class, and the interrupt context only masks
+ * the IRQ line and wakes up this thread. The thread then invokes the
+ * ISR, and re-enables the line unless XN_ISR_NOENABLE was returned.
+ *
+ * This way, a slow ISR only delays threads which run at a lower
+ * priority than its server. The wakeup latency and the ISR duration
+ * are tracked for each threaded interrupt object, and reported by
+ * /proc/xenomai/irq.
+ *
+ * @param intr The descriptor address of the interrupt object to
+ * attach.
+ *
+ * @param cookie A user-defined opaque value which is stored into the
+ * interrupt object descriptor for further retrieval by the ISR.
+ *
+ * @param prio The priority of the server thread, in the
+ * [XNSCHED_LOW_PRIO..XNSCHED_HIGH_PRIO] range.
+ *
+ * @return 0 is returned on success. Otherwise:
+ *
+ * - -EINVAL is returned if @a prio is out of range, or if the
+ * interrupt object was initialized with XN_ISR_SHARED, since a shared
+ * line may not be masked on behalf of a single handler.
+ *
+ * - -ENOMEM is returned if the server thread could not be created.
+ *
+ * - Any error returned by xnintr_attach().
+ *
+ * @note The ISR runs over a thread context with interrupts enabled,
+ * so locks it shares with other interrupt handlers must be grabbed
+ * with interrupts off. XN_ISR_PROPAGATE is not supported.
+ *
+ * @note A threaded interrupt object may only be detached from the
+ * root domain, since xnintr_detach() then waits for the server thread
+ * to exit.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ *
+ * Rescheduling: never.
+ */
+
+int xnintr_attach_threaded(xnintr_t *intr, void *cookie, int prio)
+{
+	int ret;
+
+	if (intr->flags & XN_ISR_SHARED)
+		return -EINVAL;
+
+	if (prio < XNSCHED_LOW_PRIO || prio > XNSCHED_HIGH_PRIO)
+		return -EINVAL;
+
+	if (__testbits(intr->flags, XN_ISR_ATTACHED))
+		return -EBUSY;
+
+	ret = xnintr_thread_init(intr, prio);
+	if (ret)
+		return ret;
+
+	/*
+	 * IRQs received before the server starts remain pending,
+	 * and a dormant server can be dropped from any context.
+	 */
+	ret = xnintr_attach(intr, cookie);
+	if (ret) {
+		xnintr_thread_stop(intr);
+		return ret;
+	}
+
+	ret = xnintr_thread_start(intr);
+	if (ret)
+		xnintr_detach(intr);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnintr_attach_threaded);
+
 /*!
  * \fn int xnintr_detach (xnintr_t *intr)
  * \brief Detach an interrupt object.
@@ -768,6 +1311,10 @@ EXPORT_SYMBOL_GPL(xnintr_attach);
  * @note The caller <b>must not</b> hold nklock when invoking this service,
  * this would cause deadlocks.
  *
+ * @note Detaching a threaded interrupt object waits for its server
+ * thread to exit, which may only be done from the root domain (see
+ * xnintr_attach_threaded()).
+ *
  * Environments:
  *
  * This service can be called from:
@@ -801,6 +1348,12 @@ int xnintr_detach(xnintr_t *intr)
  out:
 	xnlock_put_irqrestore(&intrlock, s);
 
+	if (ret == 0) {
+		if (intr->thread)
+			xnintr_thread_stop(intr);
+		xnintr_hist_free(intr);
+	}
+
 	return ret;
 }
 EXPORT_SYMBOL_GPL(xnintr_detach);
@@ -898,6 +1451,48 @@ void xnintr_affinity(xnintr_t *intr, xnarch_cpumask_t cpumask)
 }
 EXPORT_SYMBOL_GPL(xnintr_affinity);
 
+/*!
+ * \fn void xnintr_set_probe (xnintr_t *intr, xnisr_t probe)
+ * \brief Set the ownership probe of a shared interrupt object.
+ *
+ * When an IRQ is received on a shared line, the nucleus walks the
+ * chain of interrupt objects attached to it, calling their ISR in
+ * turn. If a probe routine is set for an object, it is called first,
+ * and the ISR is skipped if the probe returns zero. This allows a
+ * driver to rule out its device cheaply, e.g. by reading a single
+ * status register, before the full handler runs.
+ *
+ * The chain of a level-triggered line is walked until the first ISR
+ * reports XN_ISR_HANDLED; the objects are periodically reordered by
+ * decreasing count of recent hits, so that the busiest devices are
+ * served first. Edge-triggered lines are still polled until a full
+ * pass over the chain reports nothing.
+ *
+ * @param intr The descriptor address of the interrupt object.
+ *
+ * @param probe The address of the probe routine, which receives the
+ * interrupt object descriptor, and should return a non-zero value if
+ * the associated device may have raised the IRQ. NULL removes the
+ * probe.
+ *
+ * @note The probe is ignored for non-shared interrupt objects.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ *
+ * Rescheduling: never.
+ */
+
+void xnintr_set_probe(xnintr_t *intr, xnisr_t probe)
+{
+	intr->probe = probe;
+}
+EXPORT_SYMBOL_GPL(xnintr_set_probe);
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 #include <nucleus/vfile.h>
@@ -1042,6 +1637,104 @@ static inline int format_irq_proc(unsigned int irq,
 	return 0;
 }
 
+static inline xnticks_t irq_thread_avg(xnticks_t sum, unsigned long runs)
+{
+	return runs ? xnarch_tsc_to_ns(xnarch_ulldiv(sum, runs, NULL)) : 0;
+}
+
+static void format_irq_threads(struct xnvfile_regular_iterator *it)
+{
+	xnticks_t lat_sum, lat_max, run_sum, run_max;
+	struct xnintr_thread *t;
+	int irq, prio, header = 0;
+	struct xnintr *intr;
+	unsigned long runs;
+	spl_t s;
+
+	for (irq = 0; irq < XNARCH_NR_IRQS; irq++) {
+		xnlock_get_irqsave(&intrlock, s);
+
+		intr = xnintr_shirq_first(irq);
+		if (intr == NULL || intr->thread == NULL) {
+			xnlock_put_irqrestore(&intrlock, s);
+			continue;
+		}
+
+		t = intr->thread;
+		xnlock_get(&nklock);
+		prio = xnthread_base_priority(&t->thread);
+		runs = t->runs;
+		lat_sum = t->lat_sum;
+		lat_max = t->lat_max;
+		run_sum = t->run_sum;
+		run_max = t->run_max;
+		xnlock_put(&nklock);
+
+		xnlock_put_irqrestore(&intrlock, s);
+
+		if (!header) {
+			xnvfile_puts(it, "\nIRQ  PRI        RUNS   AVGLAT(ns)"
+				     "   MAXLAT(ns)   AVGRUN(ns)   MAXRUN(ns)\n");
+			header = 1;
+		}
+
+		xnvfile_printf(it, "%3d: %3d %11lu %12Lu %12Lu %12Lu %12Lu\n",
+			       irq, prio, runs,
+			       irq_thread_avg(lat_sum, runs),
+			       xnarch_tsc_to_ns(lat_max),
+			       irq_thread_avg(run_sum, runs),
+			       xnarch_tsc_to_ns(run_max));
+	}
+}
+
+#ifdef CONFIG_XENO_OPT_SHIRQ
+
+static void format_irq_walks(struct xnvfile_regular_iterator *it)
+{
+	unsigned long walks, visits, skips, avg;
+	int irq, maxwalk, header = 0;
+	xnintr_irq_t *shirq;
+	spl_t s;
+
+	for (irq = 0; irq < XNARCH_NR_IRQS; irq++) {
+		shirq = &xnirqs[irq];
+
+		xnlock_get_irqsave(&shirq->lock, s);
+
+		if (shirq->handlers == NULL || shirq->handlers->next == NULL) {
+			xnlock_put_irqrestore(&shirq->lock, s);
+			continue;
+		}
+
+		walks = shirq->walks;
+		visits = shirq->visits;
+		skips = shirq->skips;
+		maxwalk = shirq->maxwalk;
+
+		xnlock_put_irqrestore(&shirq->lock, s);
+
+		if (!header) {
+			xnvfile_puts(it, "\nIRQ        WALKS  AVGWALK  MAXWALK"
+				     "      SKIPPED\n");
+			header = 1;
+		}
+
+		/* Average walk length, in hundredths. */
+		avg = walks ? xnarch_ulldiv((unsigned long long)visits * 100,
+					    walks, NULL) : 0;
+
+		xnvfile_printf(it, "%3d: %12lu %5lu.%02lu %8d %12lu\n",
+			       irq, walks, avg / 100, avg % 100,
+			       maxwalk, skips);
+	}
+}
+
+#else /* !CONFIG_XENO_OPT_SHIRQ */
+
+static inline void format_irq_walks(struct xnvfile_regular_iterator *it) { }
+
+#endif /* !CONFIG_XENO_OPT_SHIRQ */
+
 static int irq_vfile_show(struct xnvfile_regular_iterator *it,
 			  void *data)
 {
@@ -1071,6 +1764,10 @@ static int irq_vfile_show(struct xnvfile_regular_iterator *it,
 
 	xnvfile_putc(it, '\n');
 
+	format_irq_threads(it);
+
+	format_irq_walks(it);
+
 	return 0;
 }
 
@@ -1132,16 +1829,139 @@ static struct xnvfile_regular affinity_vfile = {
 
 #endif /* CONFIG_SMP */
 
+#ifdef CONFIG_XENO_OPT_STATS
+
+/*
+ * Binary export of the interrupt histograms: one record per
+ * interrupt object and online CPU, the timer first for its IRQ
+ * line, then the shared IRQ chains in order.
+ */
+static void *irqhist_vfile_fetch(struct xnvfile_regular_iterator *it)
+{
+	struct xnintr_hist_rec *rec = xnvfile_iterator_priv(it);
+	int irq, cpu, nrcpus = xnarch_num_online_cpus(), n;
+	loff_t pos = it->pos;
+	struct xnintr_hist *hist;
+	xnintr_t *intr = NULL;
+	spl_t s;
+
+	xnlock_get_irqsave(&intrlock, s);
+
+	for (irq = 0; irq < XNARCH_NR_IRQS; irq++) {
+		if (xnintr_is_timer_irq(irq))
+			intr = &nkclock;
+		else
+			intr = xnintr_shirq_first(irq);
+
+		while (intr && pos >= nrcpus) {
+			pos -= nrcpus;
+			intr = xnintr_shirq_next(intr);
+		}
+
+		if (intr)
+			break;
+	}
+
+	if (intr == NULL) {
+		xnlock_put_irqrestore(&intrlock, s);
+		return NULL;
+	}
+
+	cpu = (int)pos;
+	hist = &intr->hist[cpu];
+
+	memset(rec, 0, sizeof(*rec));
+	rec->irq = irq;
+	rec->cpu = cpu;
+	strncpy(rec->name, intr->name, sizeof(rec->name) - 1);
+	rec->count = xnstat_counter_get(&intr->stat[cpu].hits);
+	rec->lat_max = xnarch_tsc_to_ns(hist->lat_max);
+	rec->run_max = xnarch_tsc_to_ns(hist->run_max);
+	for (n = 0; n < XNINTR_HIST_BUCKETS; n++) {
+		rec->lat[n] = hist->lat[n];
+		rec->run[n] = hist->run[n];
+	}
+
+	xnlock_put_irqrestore(&intrlock, s);
+
+	return rec;
+}
+
+static int irqhist_vfile_show(struct xnvfile_regular_iterator *it,
+			      void *data)
+{
+	xnvfile_write(it, data, sizeof(struct xnintr_hist_rec));
+
+	return 0;
+}
+
+static ssize_t irqhist_vfile_store(struct xnvfile_input *input)
+{
+	xnintr_t *intr;
+	ssize_t ret;
+	long val;
+	int irq;
+	spl_t s;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val != 0)
+		return -EINVAL;
+
+	/*
+	 * Updates are lock-free, so a few counts may survive a reset
+	 * racing with an IRQ.
+	 */
+	for (irq = 0; irq < XNARCH_NR_IRQS; irq++) {
+		xnlock_get_irqsave(&intrlock, s);
+
+		if (xnintr_is_timer_irq(irq))
+			intr = &nkclock;
+		else
+			intr = xnintr_shirq_first(irq);
+
+		for (; intr; intr = xnintr_shirq_next(intr))
+			memset(intr->hist, 0, xnarch_num_online_cpus() *
+			       sizeof(*intr->hist));
+
+		xnlock_put_irqrestore(&intrlock, s);
+	}
+
+	return ret;
+}
+
+static struct xnvfile_regular_ops irqhist_vfile_ops = {
+	.begin = irqhist_vfile_fetch,
+	.next = irqhist_vfile_fetch,
+	.show = irqhist_vfile_show,
+	.store = irqhist_vfile_store,
+};
+
+static struct xnvfile_regular irqhist_vfile = {
+	.privsz = sizeof(struct xnintr_hist_rec),
+	.ops = &irqhist_vfile_ops,
+};
+
+#endif /* CONFIG_XENO_OPT_STATS */
+
 void xnintr_init_proc(void)
 {
 	xnvfile_init_regular("irq", &irq_vfile, &nkvfroot);
 #ifdef CONFIG_SMP
 	xnvfile_init_regular("affinity", &affinity_vfile, &nkvfroot);
 #endif /* CONFIG_SMP */
+#ifdef CONFIG_XENO_OPT_STATS
+	xnvfile_init_regular("irqhist", &irqhist_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_STATS */
 }
 
 void xnintr_cleanup_proc(void)
 {
+#ifdef CONFIG_XENO_OPT_STATS
+	xnvfile_destroy_regular(&irqhist_vfile);
+#endif /* CONFIG_XENO_OPT_STATS */
 #ifdef CONFIG_SMP
 	xnvfile_destroy_regular(&affinity_vfile);
 #endif /* CONFIG_SMP */
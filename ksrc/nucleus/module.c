@@ -178,12 +178,14 @@ int __init __xeno_sys_init(void)
 
 #ifdef __KERNEL__
 	xnpod_mount();
-	xnintr_mount();
+	ret = xnintr_mount();
+	if (ret)
+		goto cleanup_pod;
 
 #ifdef CONFIG_XENO_OPT_PIPE
 	ret = xnpipe_mount();
 	if (ret)
-		goto cleanup_proc;
+		goto cleanup_intr;
 #endif /* CONFIG_XENO_OPT_PIPE */
 
 #ifdef CONFIG_XENO_OPT_SELECT
@@ -240,10 +242,14 @@ int __init __xeno_sys_init(void)
 #ifdef CONFIG_XENO_OPT_PIPE
 	xnpipe_umount();
 
-      cleanup_proc:
+      cleanup_intr:
 
 #endif /* CONFIG_XENO_OPT_PIPE */
 
+	xnintr_umount();
+
+      cleanup_pod:
+
 	xnpod_umount();
 
 	cleanup_hostrt();
@@ -283,6 +289,7 @@ void __exit __xeno_sys_exit(void)
 #ifdef CONFIG_XENO_OPT_PIPE
 	xnpipe_umount();
 #endif /* CONFIG_XENO_OPT_PIPE */
+	xnintr_umount();
 #endif /* __KERNEL__ */
 
 #ifndef __XENO_SIM__
@@ -27,6 +27,9 @@
 #include <linux/termios.h>
 #include <linux/spinlock.h>
 #include <linux/device.h>
+#include <linux/vmalloc.h>
+#include <linux/delay.h>
+#include <linux/mm.h>
 #include <asm/io.h>
 #include <asm/uaccess.h>
 #include <nucleus/pod.h>
@@ -44,6 +47,11 @@ struct xnqueue xnpipe_sleepq, xnpipe_asyncq;
 
 int xnpipe_wakeup_apc;
 
+static int xnpipe_ring_gc;
+
+/* Milliseconds to wait for pending ring reservations upon close. */
+#define XNPIPE_RING_DRAIN  100
+
 static DECLARE_DEVCLASS(xnpipe_class);
 
 /* Allocation of minor values */
@@ -137,8 +145,48 @@ static inline void xnpipe_dequeue_all(struct xnpipe_state *state, int mask)
 	__sigpending;							\
 })
 
+static inline ssize_t xnpipe_flush_bufq(void (*fn)(void *buf, void *xstate),
+					struct xnqueue *q,
+					void *xstate)
+{
+	struct xnpipe_mh *mh;
+	struct xnholder *h;
+	ssize_t n = 0;
+
+	/* Queue is private, no locking is required. */
+	while ((h = getq(q)) != NULL) {
+		mh = link2mh(h);
+		n += xnpipe_m_size(mh);
+		fn(mh, xstate);
+	}
+
+	/* We must return the overall count of bytes flushed. */
+	return n;
+}
+
+/*
+ * Move the specified queue contents to a private queue, then call the
+ * flush handler to purge it. The latter is run without locking.
+ * Returns the number of bytes flushed. Must be entered with nklock
+ * held, interrupts off.
+ */
+#define xnpipe_flushq(__state, __q, __f, __s)				\
+({									\
+	struct xnqueue __privq;						\
+	ssize_t n;							\
+									\
+	initq(&__privq);						\
+	moveq(&__privq, &(state)->__q);					\
+	xnlock_put_irqrestore(&nklock, (__s));				\
+	n = xnpipe_flush_bufq((__state)->ops.__f, &__privq, (__state)->xstate);	\
+	xnlock_get_irqsave(&nklock, (__s));				\
+									\
+	n;								\
+})
+
 static void xnpipe_wakeup_proc(void *cookie)
 {
+	struct xnpipe_ringbuf *ring;
 	struct xnpipe_state *state;
 	struct xnholder *h, *nh;
 	u_long rbits;
@@ -146,6 +194,27 @@ static void xnpipe_wakeup_proc(void *cookie)
 
 	xnlock_get_irqsave(&nklock, s);
 
+	/*
+	 * Release the messages which have been copied to a shared
+	 * ring by the Xenomai side, since the latter may not call
+	 * the free handler directly.
+	 */
+	if (xnpipe_ring_gc) {
+		xnpipe_ring_gc = 0;
+		for (state = &xnpipe_states[0];
+		     state < &xnpipe_states[XNPIPE_NDEVS]; state++) {
+			if (!emptyq_p(&state->freeq))
+				xnpipe_flushq(state, freeq, free_obuf, s);
+			ring = state->orphan;
+			if (ring && ring->nwriters == 0) {
+				state->orphan = NULL;
+				xnlock_put_irqrestore(&nklock, s);
+				xnpipe_put_ring(ring);
+				xnlock_get_irqsave(&nklock, s);
+			}
+		}
+	}
+
 	nh = getheadq(&xnpipe_sleepq);
 	while ((h = nh) != NULL) {
 		nh = nextq(&xnpipe_sleepq, h);
@@ -212,44 +281,223 @@ static inline void xnpipe_schedule_request(void) /* hw IRQs off */
 	__rthal_apc_schedule(xnpipe_wakeup_apc);
 }
 
-static inline ssize_t xnpipe_flush_bufq(void (*fn)(void *buf, void *xstate),
-					struct xnqueue *q,
-					void *xstate)
+/* Must be entered with nklock held, interrupts off. */
+static inline void xnpipe_kick_reader(struct xnpipe_state *state,
+				      size_t avail)
 {
-	struct xnpipe_mh *mh;
-	struct xnholder *h;
-	ssize_t n = 0;
+	int need_sched = 0;
 
-	/* Queue is private, no locking is required. */
-	while ((h = getq(q)) != NULL) {
-		mh = link2mh(h);
-		n += xnpipe_m_size(mh);
-		fn(mh, xstate);
+	/* Let the reader batch its input, up to the wakeup threshold. */
+	if (avail < state->wmark)
+		return;
+
+	if (testbits(state->status, XNPIPE_USER_WREAD)) {
+		/*
+		 * Wake up the regular Linux task waiting for input
+		 * from the Xenomai side.
+		 */
+		__setbits(state->status, XNPIPE_USER_WREAD_READY);
+		need_sched = 1;
 	}
 
-	/* We must return the overall count of bytes flushed. */
-	return n;
+	if (state->asyncq) {	/* Schedule asynch sig. */
+		__setbits(state->status, XNPIPE_USER_SIGIO);
+		need_sched = 1;
+	}
+
+	if (need_sched)
+		xnpipe_schedule_request();
+}
+
+static struct xnpipe_ringbuf *xnpipe_alloc_ring(size_t size)
+{
+	struct xnpipe_ringbuf *ring;
+	unsigned long vaddr;
+	void *mem;
+
+	ring = kmalloc(sizeof(*ring), GFP_KERNEL);
+	if (ring == NULL)
+		return NULL;
+
+	/* The control block gets a page of its own. */
+	ring->memsize = PAGE_SIZE + size;
+	mem = vmalloc(ring->memsize);
+	if (mem == NULL) {
+		kfree(ring);
+		return NULL;
+	}
+
+	/* Don't leak stale kernel data to userland. */
+	memset(mem, 0, ring->memsize);
+
+	for (vaddr = (unsigned long)mem;
+	     vaddr < (unsigned long)mem + ring->memsize; vaddr += PAGE_SIZE)
+		SetPageReserved(vmalloc_to_page((void *)vaddr));
+
+	ring->ctl = mem;
+	ring->ctl->size = size;
+	ring->ctl->offset = PAGE_SIZE;
+	ring->data = mem + PAGE_SIZE;
+	ring->size = size;
+	ring->resv = 0;
+	ring->nwriters = 0;
+	ring->closing = 0;
+	atomic_set(&ring->refcnt, 1);
+
+	return ring;
+}
+
+static void xnpipe_put_ring(struct xnpipe_ringbuf *ring)
+{
+	unsigned long vaddr, vabase;
+
+	if (!atomic_dec_and_test(&ring->refcnt))
+		return;
+
+	vabase = (unsigned long)ring->ctl;
+	for (vaddr = vabase; vaddr < vabase + ring->memsize; vaddr += PAGE_SIZE)
+		ClearPageReserved(vmalloc_to_page((void *)vaddr));
+
+	vfree(ring->ctl);
+	kfree(ring);
+}
+
+static inline unsigned long xnpipe_ring_tail(struct xnpipe_ringbuf *ring)
+{
+	/* Updated by the reader, concurrently. */
+	return *(volatile unsigned long *)&ring->ctl->tail;
 }
 
 /*
- * Move the specified queue contents to a private queue, then call the
- * flush handler to purge it. The latter is run without locking.
- * Returns the number of bytes flushed. Must be entered with nklock
- * held, interrupts off.
+ * Reserve room for a record of @size bytes in the shared ring. The
+ * control block may be scribbled over by userland, so we only trust
+ * our own copies of the ring geometry and head index. Must be
+ * entered with nklock held, interrupts off.
  */
-#define xnpipe_flushq(__state, __q, __f, __s)				\
-({									\
-	struct xnqueue __privq;						\
-	ssize_t n;							\
-									\
-	initq(&__privq);						\
-	moveq(&__privq, &(state)->__q);					\
-	xnlock_put_irqrestore(&nklock, (__s));				\
-	n = xnpipe_flush_bufq((__state)->ops.__f, &__privq, (__state)->xstate);	\
-	xnlock_get_irqsave(&nklock, (__s));				\
-									\
-	n;								\
-})
+static ssize_t __xnpipe_ring_reserve(struct xnpipe_state *state,
+				     size_t size, void **datap)
+{
+	struct xnpipe_ringbuf *ring = state->ring;
+	unsigned long off, room, used, len, pad;
+	struct xnpipe_rec *rec;
+
+	if (ring == NULL || ring->closing)
+		return -ENXIO;
+
+	/*
+	 * Records never wrap, so the largest one must fit along
+	 * with a padding record. Check the size first, its record
+	 * length could wrap.
+	 */
+	if (size > ring->size / 2)
+		return -EINVAL;
+
+	len = xnpipe_rec_len(size);
+	if (len > ring->size / 2)
+		return -EINVAL;
+
+	off = ring->resv & (ring->size - 1);
+	room = ring->size - off;
+	pad = room < len ? room : 0;
+	used = ring->resv - xnpipe_ring_tail(ring);
+	if (used > ring->size || ring->size - used < pad + len)
+		return -ENOMEM;
+
+	if (pad) {
+		rec = (struct xnpipe_rec *)(ring->data + off);
+		rec->size = pad - sizeof(*rec);
+		rec->flags = XNPIPE_REC_PAD;
+		ring->resv += pad;
+		off = 0;
+	}
+
+	rec = (struct xnpipe_rec *)(ring->data + off);
+	rec->size = size;
+	rec->flags = 0;
+	ring->resv += len;
+	ring->nwriters++;
+	*datap = rec + 1;
+
+	return (ssize_t)size;
+}
+
+static inline int xnpipe_ring_owns(struct xnpipe_ringbuf *ring, void *data)
+{
+	return ring && (char *)data > ring->data &&
+		(char *)data < ring->data + ring->size;
+}
+
+/*
+ * The ring a record was reserved from may have been detached by
+ * xnpipe_release() meanwhile, in which case the late commit only
+ * drops the reservation. Must be entered with nklock held,
+ * interrupts off.
+ */
+static void __xnpipe_ring_commit(struct xnpipe_state *state,
+				 void *data, int cancel)
+{
+	struct xnpipe_rec *rec = (struct xnpipe_rec *)data - 1;
+	struct xnpipe_ringbuf *ring = state->ring;
+
+	if (!xnpipe_ring_owns(ring, data)) {
+		ring = state->orphan;
+		if (!xnpipe_ring_owns(ring, data))
+			return;
+		/* Let the APC handler release it, once unused. */
+		if (--ring->nwriters == 0) {
+			xnpipe_ring_gc = 1;
+			xnpipe_schedule_request();
+		}
+		return;
+	}
+
+	if (cancel)
+		rec->flags = XNPIPE_REC_PAD;
+
+	/*
+	 * Records are published once all pending reservations are
+	 * committed, so that the reader never sees a partially
+	 * written one.
+	 */
+	if (--ring->nwriters > 0)
+		return;
+
+	xnarch_memory_barrier();
+	ring->ctl->head = ring->resv;
+
+	xnpipe_kick_reader(state, ring->resv - xnpipe_ring_tail(ring));
+}
+
+/*
+ * Copy a message to the shared ring. The nklock is dropped while
+ * copying, the reservation keeps the ring memory around. Must be
+ * entered with nklock held, interrupts off; returns in the same
+ * state.
+ */
+static ssize_t __xnpipe_ring_copy(struct xnpipe_state *state,
+				  const void *buf, size_t size, spl_t s)
+{
+	ssize_t ret;
+	void *data;
+
+	ret = __xnpipe_ring_reserve(state, size, &data);
+	if (ret < 0)
+		return ret;
+
+	xnlock_put_irqrestore(&nklock, s);
+	memcpy(data, buf, size);
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!testbits(state->status, XNPIPE_KERN_CONN)) {
+		/* Disconnected meanwhile, the caller keeps the message. */
+		__xnpipe_ring_commit(state, data, 1);
+		return -EBADF;
+	}
+
+	__xnpipe_ring_commit(state, data, 0);
+
+	return ret;
+}
 
 static void *xnpipe_default_alloc_ibuf(size_t size, void *xstate)
 {
@@ -369,6 +617,7 @@ int xnpipe_disconnect(int minor)
 	__clrbits(state->status, XNPIPE_KERN_CONN);
 
 	state->ionrd -= xnpipe_flushq(state, outq, free_obuf, s);
+	xnpipe_flushq(state, freeq, free_obuf, s);
 
 	if (!testbits(state->status, XNPIPE_USER_CONN))
 		goto cleanup;
@@ -420,7 +669,7 @@ EXPORT_SYMBOL_GPL(xnpipe_disconnect);
 ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 {
 	struct xnpipe_state *state;
-	int need_sched = 0;
+	ssize_t ret;
 	spl_t s;
 
 	if (minor < 0 || minor >= XNPIPE_NDEVS)
@@ -441,6 +690,33 @@ ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 	inith(xnpipe_m_link(mh));
 	xnpipe_m_size(mh) = size - sizeof(*mh);
 	xnpipe_m_rdoff(mh) = 0;
+
+	if (state->ring) {
+		/*
+		 * The reader consumes from a shared ring: copy the
+		 * message there, and have it released later on by
+		 * the APC handler, since we may not call the free
+		 * handler from this context. Messages always go in
+		 * FIFO order through the ring. Since the reader
+		 * consumes records in place, the message counts as
+		 * output once it is in the ring.
+		 */
+		ret = __xnpipe_ring_copy(state, xnpipe_m_data(mh),
+					 xnpipe_m_size(mh), s);
+		if (ret != -ENXIO) {
+			if (ret >= 0) {
+				if (state->ops.output)
+					state->ops.output(mh, state->xstate);
+				appendq(&state->freeq, xnpipe_m_link(mh));
+				xnpipe_ring_gc = 1;
+				xnpipe_schedule_request();
+				ret = (ssize_t) size;
+			}
+			xnlock_put_irqrestore(&nklock, s);
+			return ret;
+		}
+	}
+
 	state->ionrd += xnpipe_m_size(mh);
 
 	if (flags & XNPIPE_URGENT)
@@ -448,27 +724,8 @@ ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 	else
 		appendq(&state->outq, xnpipe_m_link(mh));
 
-	if (!testbits(state->status, XNPIPE_USER_CONN)) {
-		xnlock_put_irqrestore(&nklock, s);
-		return (ssize_t) size;
-	}
-
-	if (testbits(state->status, XNPIPE_USER_WREAD)) {
-		/*
-		 * Wake up the regular Linux task waiting for input
-		 * from the Xenomai side.
-		 */
-		__setbits(state->status, XNPIPE_USER_WREAD_READY);
-		need_sched = 1;
-	}
-
-	if (state->asyncq) {	/* Schedule asynch sig. */
-		__setbits(state->status, XNPIPE_USER_SIGIO);
-		need_sched = 1;
-	}
-
-	if (need_sched)
-		xnpipe_schedule_request();
+	if (testbits(state->status, XNPIPE_USER_CONN))
+		xnpipe_kick_reader(state, state->ionrd);
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -479,6 +736,7 @@ EXPORT_SYMBOL_GPL(xnpipe_send);
 ssize_t xnpipe_mfixup(int minor, struct xnpipe_mh *mh, ssize_t size)
 {
 	struct xnpipe_state *state;
+	ssize_t ret;
 	spl_t s;
 
 	if (minor < 0 || minor >= XNPIPE_NDEVS)
@@ -496,6 +754,30 @@ ssize_t xnpipe_mfixup(int minor, struct xnpipe_mh *mh, ssize_t size)
 		return -EBADF;
 	}
 
+	if (state->ring) {
+		/*
+		 * The message has already been copied to the ring,
+		 * send the appended data as a record of its own, and
+		 * report it as such to the output handler.
+		 */
+		ret = __xnpipe_ring_copy(state,
+					 xnpipe_m_data(mh) + xnpipe_m_size(mh),
+					 size, s);
+		if (ret != -ENXIO) {
+			if (ret >= 0) {
+				if (state->ops.output) {
+					struct xnpipe_mh rec;
+					xnpipe_m_size(&rec) = size;
+					xnpipe_m_rdoff(&rec) = 0;
+					state->ops.output(&rec, state->xstate);
+				}
+				xnpipe_m_size(mh) += size;
+			}
+			xnlock_put_irqrestore(&nklock, s);
+			return ret;
+		}
+	}
+
 	xnpipe_m_size(mh) += size;
 	state->ionrd += size;
 
@@ -505,6 +787,59 @@ ssize_t xnpipe_mfixup(int minor, struct xnpipe_mh *mh, ssize_t size)
 }
 EXPORT_SYMBOL_GPL(xnpipe_mfixup);
 
+/**
+ * @internal
+ * Reserve room for a message in the ring shared with the Linux side
+ * of the pipe. On success, the caller should fill the @a size bytes
+ * at *@a datap, then call xnpipe_ring_commit() to publish them. This
+ * allows the Xenomai side to build messages in place, and the Linux
+ * side to consume them without any copy.
+ *
+ * Returns @a size on success, -ENXIO if no ring is attached to the
+ * pipe, in which case the caller should send a regular message
+ * instead, -ENOMEM if the ring is full, -EINVAL if the message is
+ * larger than half the ring, or -EBADF if the pipe is disconnected.
+ */
+ssize_t xnpipe_ring_reserve(int minor, size_t size, void **datap)
+{
+	struct xnpipe_state *state;
+	ssize_t ret;
+	spl_t s;
+
+	if (minor < 0 || minor >= XNPIPE_NDEVS)
+		return -ENODEV;
+
+	state = &xnpipe_states[minor];
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!testbits(state->status, XNPIPE_KERN_CONN))
+		ret = -EBADF;
+	else
+		ret = __xnpipe_ring_reserve(state, size, datap);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(xnpipe_ring_reserve);
+
+/**
+ * @internal
+ * Publish a message reserved by xnpipe_ring_reserve(). Passing a
+ * non-zero @a cancel value turns it into a padding record, which the
+ * reader skips.
+ */
+void xnpipe_ring_commit(int minor, void *data, int cancel)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	__xnpipe_ring_commit(&xnpipe_states[minor], data, cancel);
+	xnlock_put_irqrestore(&nklock, s);
+}
+EXPORT_SYMBOL_GPL(xnpipe_ring_commit);
+
 ssize_t xnpipe_recv(int minor, struct xnpipe_mh **pmh, xnticks_t timeout)
 {
 	struct xnpipe_state *state;
@@ -614,6 +949,7 @@ EXPORT_SYMBOL_GPL(xnpipe_flush);
 #define xnpipe_cleanup_user_conn(__state, __s)				\
 	do {								\
 		xnpipe_flushq((__state), outq, free_obuf, (__s));	\
+		xnpipe_flushq((__state), freeq, free_obuf, (__s));	\
 		xnpipe_flushq((__state), inq, free_ibuf, (__s));	\
 		__clrbits((__state)->status, XNPIPE_USER_CONN);		\
 		if (testbits((__state)->status, XNPIPE_KERN_LCLOSE)) {	\
@@ -656,10 +992,11 @@ static int xnpipe_open(struct inode *inode, struct file *file)
 	init_waitqueue_head(&state->readq);
 	init_waitqueue_head(&state->syncq);
 	state->wcount = 0;
+	state->wmark = 0;
 
 	__clrbits(state->status,
 		  XNPIPE_USER_ALL_WAIT | XNPIPE_USER_ALL_READY |
-		  XNPIPE_USER_SIGIO);
+		  XNPIPE_USER_SIGIO | XNPIPE_USER_BATCH);
 
 	if (!testbits(state->status, XNPIPE_KERN_CONN)) {
 		if (testbits(file->f_flags, O_NONBLOCK)) {
@@ -689,10 +1026,38 @@ static int xnpipe_open(struct inode *inode, struct file *file)
 static int xnpipe_release(struct inode *inode, struct file *file)
 {
 	struct xnpipe_state *state = file->private_data;
+	struct xnpipe_ringbuf *ring;
 	spl_t s;
+	int n;
 
 	xnlock_get_irqsave(&nklock, s);
 
+	/*
+	 * Detach the shared ring once the Xenomai side is done with
+	 * its pending reservations; user mappings keep the memory
+	 * alive until they go away. A writer may have been deleted
+	 * between reserve and commit, so we only wait for a while,
+	 * then leave the ring to the late committers.
+	 */
+	ring = state->ring;
+	if (ring) {
+		ring->closing = 1;
+		for (n = 0; ring->nwriters > 0 && n < XNPIPE_RING_DRAIN; n++) {
+			xnlock_put_irqrestore(&nklock, s);
+			msleep(1);
+			xnlock_get_irqsave(&nklock, s);
+		}
+		state->ring = NULL;
+		if (ring->nwriters > 0) {
+			if (state->orphan)
+				/* Writers never came back, leak it. */
+				xnlogerr("pipe %d: dropping stale ring\n",
+					 (int)xnminor_from_state(state));
+			state->orphan = ring;
+			ring = NULL;
+		}
+	}
+
 	xnpipe_dequeue_all(state, XNPIPE_USER_WREAD);
 	xnpipe_dequeue_all(state, XNPIPE_USER_WSYNC);
 
@@ -724,9 +1089,85 @@ static int xnpipe_release(struct inode *inode, struct file *file)
 	 */
 	xnlock_put_irqrestore(&nklock, s);
 
+	if (ring)
+		xnpipe_put_ring(ring);
+
 	return 0;
 }
 
+/*
+ * Batched read: copy as many whole messages as the user buffer can
+ * hold, each preceded by a record header and padded to
+ * XNPIPE_REC_ALIGN. Entered with nklock held and @mh pulled from the
+ * output queue, returns with nklock released.
+ */
+static ssize_t xnpipe_read_batch(struct xnpipe_state *state,
+				 struct xnpipe_mh *mh,
+				 char *buf, size_t count, spl_t s)
+{
+	size_t nbytes, len, inbytes = 0;
+	struct xnpipe_rec rec;
+	int err = 0, nfreed = 0;
+
+	for (;;) {
+		nbytes = xnpipe_m_size(mh) - xnpipe_m_rdoff(mh);
+		len = xnpipe_rec_len(nbytes);
+
+		if (inbytes + len > count) {
+			prependq(&state->outq, &mh->link);
+			if (inbytes == 0)
+				err = -EMSGSIZE;
+			break;
+		}
+
+		rec.size = nbytes;
+		rec.flags = 0;
+
+		xnlock_put_irqrestore(&nklock, s);
+		err = __copy_to_user(buf + inbytes, &rec, sizeof(rec)) ||
+			__copy_to_user(buf + inbytes + sizeof(rec),
+				       xnpipe_m_data(mh) + xnpipe_m_rdoff(mh),
+				       nbytes);
+		xnlock_get_irqsave(&nklock, s);
+
+		if (err) {
+			err = -EFAULT;
+			prependq(&state->outq, &mh->link);
+			break;
+		}
+
+		inbytes += len;
+		xnpipe_m_rdoff(mh) += nbytes;
+		state->ionrd -= nbytes;
+
+		if (xnpipe_m_size(mh) > xnpipe_m_rdoff(mh)) {
+			/* Data was appended meanwhile, pick it next time. */
+			prependq(&state->outq, &mh->link);
+			break;
+		}
+
+		if (state->ops.output)
+			state->ops.output(mh, state->xstate);
+		xnlock_put_irqrestore(&nklock, s);
+		state->ops.free_obuf(mh, state->xstate);
+		xnlock_get_irqsave(&nklock, s);
+		nfreed++;
+
+		mh = link2mh(getq(&state->outq));
+		if (mh == NULL)
+			break;
+	}
+
+	if (nfreed > 0 && testbits(state->status, XNPIPE_USER_WSYNC)) {
+		__setbits(state->status, XNPIPE_USER_WSYNC_READY);
+		xnpipe_schedule_request();
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return inbytes > 0 ? (ssize_t)inbytes : err;
+}
+
 static ssize_t xnpipe_read(struct file *file,
 			   char *buf, size_t count, loff_t *ppos)
 {
@@ -747,6 +1188,12 @@ static ssize_t xnpipe_read(struct file *file,
 		xnlock_put_irqrestore(&nklock, s);
 		return -EPIPE;
 	}
+
+	if (state->ring) {
+		/* Input must be consumed from the shared ring. */
+		xnlock_put_irqrestore(&nklock, s);
+		return -EINVAL;
+	}
 	/*
 	 * Queue probe and proc enqueuing must be seen atomically,
 	 * including from the Xenomai side.
@@ -771,6 +1218,9 @@ static ssize_t xnpipe_read(struct file *file,
 		}
 	}
 
+	if (testbits(state->status, XNPIPE_USER_BATCH))
+		return xnpipe_read_batch(state, mh, buf, count, s);
+
 	/*
 	 * We allow more data to be appended to the current message
 	 * bucket while its contents is being copied to the user
@@ -915,6 +1365,37 @@ static ssize_t xnpipe_write(struct file *file,
 	return (ssize_t)count;
 }
 
+static int xnpipe_attach_ring(struct xnpipe_state *state,
+			      unsigned long size)
+{
+	struct xnpipe_ringbuf *ring;
+	int ret = 0;
+	spl_t s;
+
+	if (size < PAGE_SIZE || (size & (size - 1)) != 0)
+		return -EINVAL;
+
+	ring = xnpipe_alloc_ring(size);
+	if (ring == NULL)
+		return -ENOMEM;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!testbits(state->status, XNPIPE_KERN_CONN))
+		ret = -EPIPE;
+	else if (state->ring || !emptyq_p(&state->outq))
+		ret = -EBUSY;
+	else
+		state->ring = ring;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (ret)
+		xnpipe_put_ring(ring);
+
+	return ret;
+}
+
 static DECLARE_IOCTL_HANDLER(xnpipe_ioctl, file, cmd, arg)
 {
 	struct xnpipe_state *state = file->private_data;
@@ -973,10 +1454,39 @@ static DECLARE_IOCTL_HANDLER(xnpipe_ioctl, file, cmd, arg)
 		xnpipe_asyncsig = arg;
 		break;
 
+	case XNPIPEIOC_RING:
+
+		return xnpipe_attach_ring(state, arg);
+
+	case XNPIPEIOC_BATCH:
+
+		xnlock_get_irqsave(&nklock, s);
+
+		if (arg)
+			__setbits(state->status, XNPIPE_USER_BATCH);
+		else
+			__clrbits(state->status, XNPIPE_USER_BATCH);
+
+		xnlock_put_irqrestore(&nklock, s);
+		break;
+
+	case XNPIPEIOC_SETWM:
+
+		state->wmark = arg;
+		break;
+
 	case FIONREAD:
 
-		n = testbits(state->status,
-			     XNPIPE_KERN_CONN) ? state->ionrd : 0;
+		xnlock_get_irqsave(&nklock, s);
+
+		if (!testbits(state->status, XNPIPE_KERN_CONN))
+			n = 0;
+		else if (state->ring)
+			n = state->ring->resv - xnpipe_ring_tail(state->ring);
+		else
+			n = state->ionrd;
+
+		xnlock_put_irqrestore(&nklock, s);
 
 		if (put_user(n, (int *)arg))
 			return -EFAULT;
@@ -1019,6 +1529,24 @@ static int xnpipe_fasync(int fd, struct file *file, int on)
 	return ret;
 }
 
+/* Must be entered with nklock held, interrupts off. */
+static inline int xnpipe_input_ready(struct xnpipe_state *state)
+{
+	struct xnpipe_ringbuf *ring = state->ring;
+	unsigned long avail;
+
+	if (ring == NULL)
+		return !emptyq_p(&state->outq) && state->ionrd >= state->wmark;
+
+	/*
+	 * Report bogus tail values as readable, so that the reader
+	 * gets a chance to notice.
+	 */
+	avail = ring->ctl->head - xnpipe_ring_tail(ring);
+
+	return avail > ring->size || avail >= (state->wmark ?: 1);
+}
+
 static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 {
 	struct xnpipe_state *state = file->private_data;
@@ -1034,7 +1562,7 @@ static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 	else
 		r_mask |= POLLHUP;
 
-	if (!emptyq_p(&state->outq))
+	if (xnpipe_input_ready(state))
 		r_mask |= (POLLIN | POLLRDNORM);
 	else
 		/*
@@ -1056,11 +1584,79 @@ static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 	return r_mask | w_mask;
 }
 
+static void xnpipe_vmopen(struct vm_area_struct *vma)
+{
+	struct xnpipe_ringbuf *ring = vma->vm_private_data;
+
+	atomic_inc(&ring->refcnt);
+}
+
+static void xnpipe_vmclose(struct vm_area_struct *vma)
+{
+	xnpipe_put_ring(vma->vm_private_data);
+}
+
+static struct vm_operations_struct xnpipe_vmops = {
+	.open = &xnpipe_vmopen,
+	.close = &xnpipe_vmclose
+};
+
+static int xnpipe_mmap(struct file *file, struct vm_area_struct *vma)
+{
+#ifdef CONFIG_MMU
+	struct xnpipe_state *state = file->private_data;
+	unsigned long size, vaddr, maddr;
+	struct xnpipe_ringbuf *ring;
+	spl_t s;
+
+	if (vma->vm_pgoff != 0)
+		return -EINVAL;
+
+	if ((vma->vm_flags & VM_WRITE) && !(vma->vm_flags & VM_SHARED))
+		return -EINVAL;	/* COW unsupported. */
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring = state->ring;
+	if (ring)
+		atomic_inc(&ring->refcnt);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (ring == NULL)
+		return -ENXIO;
+
+	size = vma->vm_end - vma->vm_start;
+	if (size > ring->memsize) {
+		xnpipe_put_ring(ring);
+		return -EINVAL;
+	}
+
+	vaddr = (unsigned long)ring->ctl;
+	for (maddr = vma->vm_start; maddr < vma->vm_end; maddr += PAGE_SIZE) {
+		if (xnarch_remap_vm_page(vma, maddr, vaddr)) {
+			xnpipe_put_ring(ring);
+			return -EAGAIN;
+		}
+		vaddr += PAGE_SIZE;
+	}
+
+	vma->vm_private_data = ring;
+	vma->vm_ops = &xnpipe_vmops;
+	xnarch_fault_range(vma);
+
+	return 0;
+#else /* !CONFIG_MMU */
+	return -ENODEV;
+#endif /* !CONFIG_MMU */
+}
+
 static struct file_operations xnpipe_fops = {
 	.owner = THIS_MODULE,
 	.read = xnpipe_read,
 	.write = xnpipe_write,
 	.poll = xnpipe_poll,
+	.mmap = xnpipe_mmap,
 	.unlocked_ioctl = xnpipe_ioctl,
 	.open = xnpipe_open,
 	.release = xnpipe_release,
@@ -1080,6 +1676,9 @@ int xnpipe_mount(void)
 		state->asyncq = NULL;
 		initq(&state->inq);
 		initq(&state->outq);
+		initq(&state->freeq);
+		state->ring = NULL;
+		state->orphan = NULL;
 	}
 
 	initq(&xnpipe_sleepq);
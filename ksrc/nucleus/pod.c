@@ -44,6 +44,7 @@
 #include <nucleus/stat.h>
 #include <nucleus/assert.h>
 #include <nucleus/select.h>
+#include <nucleus/vdso.h>
 #include <asm/xenomai/bits/pod.h>
 
 /*
@@ -1146,8 +1147,8 @@ void xnpod_delete_thread(xnthread_t *thread)
 	trace_mark(xn_nucleus, thread_delete, "thread %p thread_name %s",
 		   thread, xnthread_name(thread));
 
+	xnvfile_touch_remove(&nkpod->threadlist_tag, &thread->glink);
 	removeq(&nkpod->threadq, &thread->glink);
-	xnvfile_touch_tag(&nkpod->threadlist_tag);
 
 	if (xnthread_test_state(thread, XNREADY)) {
 		XENO_BUGON(NUCLEUS, xnthread_test_state(thread, XNTHREAD_BLOCK_BITS));
@@ -2064,6 +2065,51 @@ void xnpod_welcome_thread(xnthread_t *thread, int imask)
 }
 EXPORT_SYMBOL_GPL(xnpod_welcome_thread);
 
+#if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_XENO_OPT_STATS)
+/*
+ * Publish the exectime accounting data of a shadow thread to its
+ * user window, so that userland can read its own CPU time without
+ * issuing a syscall (CLOCK_THREAD_CPUTIME_ID).
+ */
+static inline void xnpod_update_user_window(xnsched_t *sched,
+					    xnthread_t *thread)
+{
+	struct xnthread_user_window *u_window = thread->u_window;
+
+	if (!xnthread_test_state(thread, XNSHADOW) || u_window == NULL)
+		return;
+
+	xnwrite_seqcount_begin(&u_window->seqcount);
+	u_window->exectime = xnthread_get_exectime(thread);
+	u_window->lastswitch = xnstat_exectime_get_last_switch(sched);
+	xnwrite_seqcount_end(&u_window->seqcount);
+}
+#else /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_OPT_STATS) */
+static inline void xnpod_update_user_window(xnsched_t *sched,
+					    xnthread_t *thread)
+{
+}
+#endif /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_XENO_OPT_STATS) */
+
+#if defined(CONFIG_XENO_OPT_PERVASIVE) && defined(CONFIG_SMP)
+/*
+ * Tell userland whether a shadow thread currently runs in primary
+ * mode, so that contenders for a fast mutex it owns may decide to
+ * spin instead of sleeping (see xeno_fastmutex_spin()).
+ */
+static inline void xnpod_update_user_oncpu(xnthread_t *thread, int oncpu)
+{
+	struct xnthread_user_window *u_window = thread->u_window;
+
+	if (xnthread_test_state(thread, XNSHADOW) && u_window)
+		u_window->oncpu = oncpu;
+}
+#else /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_SMP) */
+static inline void xnpod_update_user_oncpu(xnthread_t *thread, int oncpu)
+{
+}
+#endif /* !(CONFIG_XENO_OPT_PERVASIVE && CONFIG_SMP) */
+
 static inline void xnpod_switch_to(xnsched_t *sched,
 				   xnthread_t *prev, xnthread_t *next)
 {
@@ -2238,6 +2284,10 @@ reschedule:
 
 	xnstat_exectime_switch(sched, &next->stat.account);
 	xnstat_counter_inc(&next->stat.csw);
+	xnpod_update_user_window(sched, prev);
+	xnpod_update_user_window(sched, next);
+	xnpod_update_user_oncpu(prev, 0);
+	xnpod_update_user_oncpu(next, 1);
 
 	xnpod_switch_to(sched, prev, next);
 
@@ -2598,6 +2648,8 @@ int xnpod_trap_fault(xnarch_fltinfo_t *fltinfo)
 			   locking anyway. */
 			xnstat_counter_inc(&thread->stat.pf);
 
+		xnshadow_mswprof_trigger(thread, XNMSWPROF_TRIG_TRAP,
+					 xnarch_fault_trap(fltinfo));
 		xnshadow_relax(xnarch_fault_notify(fltinfo),
 			       SIGDEBUG_MIGRATE_FAULT);
 	}
@@ -2687,10 +2739,11 @@ int xnpod_enable_timesource(void)
 
 	nktbase.status = XNTBRUN;
 
-	xnlock_put_irqrestore(&nklock, s);
-
 	nktbase.wallclock_offset =
 		xnarch_get_host_time() - xnarch_get_cpu_time();
+	xnvdso_update_wallclock(nktbase.wallclock_offset);
+
+	xnlock_put_irqrestore(&nklock, s);
 
 	for (cpu = 0; cpu < xnarch_num_online_cpus(); cpu++) {
 
@@ -2881,6 +2934,8 @@ int xnpod_set_thread_periodic(xnthread_t *thread,
 	}
 
 	xntimer_set_sched(&thread->ptimer, thread->sched);
+	/* Release statistics only make sense for a given period. */
+	xnthread_reset_relstat(thread);
 
 	if (idate == XN_INFINITE) {
 		xntimer_start(&thread->ptimer, period, period, XN_RELATIVE);
@@ -2910,6 +2965,61 @@ int xnpod_set_thread_periodic(xnthread_t *thread,
 }
 EXPORT_SYMBOL_GPL(xnpod_set_thread_periodic);
 
+#ifdef CONFIG_XENO_OPT_STATS
+
+/*
+ * Account for a release point of the current thread, reached delta
+ * raw clock units after the expected date, with overruns periods
+ * missed meanwhile. nklock held, irqs off.
+ */
+static void xnpod_account_release(struct xnthread *thread, xntbase_t *tbase,
+				  xnsticks_t delta, unsigned long overruns)
+{
+	struct xnthread_relstat *rs = &thread->relstat;
+	xnticks_t lat;
+	int n;
+
+	if (overruns) {
+		/* Measure against the last missed release point. */
+		delta -= xntimer_interval(&thread->ptimer) * overruns;
+		rs->overruns += overruns;
+		if (overruns > rs->maxburst)
+			rs->maxburst = overruns;
+	}
+
+	/* Timer anticipation may wake us up slightly early. */
+	if (delta < 0)
+		delta = 0;
+
+	if (xntbase_periodic_p(tbase))
+		lat = xntbase_ticks2ns(tbase, delta);
+	else
+		lat = xnarch_tsc_to_ns(delta);
+
+	rs->releases++;
+	rs->latsum += lat;
+	if (lat > rs->latmax)
+		rs->latmax = lat;
+
+	/* Log2 buckets of microseconds, last one is open-ended. */
+	if (lat >= 1000ULL << (XNTHREAD_RELSTAT_BUCKETS - 2))
+		n = XNTHREAD_RELSTAT_BUCKETS - 1;
+	else
+		n = fls((unsigned long)lat / 1000);
+
+	rs->hist[n]++;
+}
+
+#else /* !CONFIG_XENO_OPT_STATS */
+
+static inline void xnpod_account_release(struct xnthread *thread,
+					 xntbase_t *tbase, xnsticks_t delta,
+					 unsigned long overruns)
+{
+}
+
+#endif /* CONFIG_XENO_OPT_STATS */
+
 /**
  * @fn int xnpod_wait_thread_period(unsigned long *overruns_r)
  * @brief Wait for the next periodic release point.
@@ -2917,6 +3027,13 @@ EXPORT_SYMBOL_GPL(xnpod_set_thread_periodic);
  * Make the current thread wait for the next periodic release point in
  * the processor time line.
  *
+ * When statistics collection is enabled (CONFIG_XENO_OPT_STATS), the
+ * release latency of the thread, i.e. its actual wakeup date minus
+ * the expected release date, and the count of missed release points
+ * are accounted in its release statistics, which are reset by
+ * xnpod_set_thread_periodic(). These are visible from
+ * /proc/xenomai/relstat.
+ *
  * @param overruns_r If non-NULL, @a overruns_r must be a pointer to a
  * memory location which will be written with the count of pending
  * overruns. This value is copied only when xnpod_wait_thread_period()
@@ -2955,6 +3072,7 @@ EXPORT_SYMBOL_GPL(xnpod_set_thread_periodic);
 int xnpod_wait_thread_period(unsigned long *overruns_r)
 {
 	xnticks_t now;
+	xnsticks_t delta;
 	unsigned long overruns = 0;
 	xnthread_t *thread;
 	xntbase_t *tbase;
@@ -2988,6 +3106,7 @@ int xnpod_wait_thread_period(unsigned long *overruns_r)
 		now = xntbase_get_rawclock(tbase);
 	}
 
+	delta = now - xntimer_pexpect(&thread->ptimer);
 	overruns = xntimer_get_overruns(&thread->ptimer, now);
 	if (overruns) {
 		err = -ETIMEDOUT;
@@ -2997,6 +3116,8 @@ int xnpod_wait_thread_period(unsigned long *overruns_r)
 			   thread, xnthread_name(thread), overruns);
 	}
 
+	xnpod_account_release(thread, tbase, delta, overruns);
+
 	if (likely(overruns_r != NULL))
 		*overruns_r = overruns;
 
@@ -3051,6 +3172,7 @@ EXPORT_SYMBOL_GPL(xnpod_wait_thread_period);
 
 int xnpod_set_thread_tslice(struct xnthread *thread, xnticks_t quantum)
 {
+	xntbase_t *tbase = xnthread_time_base(thread);
 	unsigned long oldmode;
 	int aperiodic;
 	spl_t s;
@@ -3062,7 +3184,7 @@ int xnpod_set_thread_tslice(struct xnthread *thread, xnticks_t quantum)
 		return -EINVAL;
 	}
 
-	aperiodic = !xntbase_periodic_p(xnthread_time_base(thread));
+	aperiodic = !xntbase_periodic_p(tbase);
 	thread->rrperiod = quantum;
 	thread->rrcredit = quantum;
 	oldmode = xnthread_test_state(thread, XNRRB);
@@ -3072,10 +3194,20 @@ int xnpod_set_thread_tslice(struct xnthread *thread, xnticks_t quantum)
 		if (aperiodic && !oldmode && nkpod->tsliced++ == 0)
 			xntimer_start(&nkpod->tslicer,
 				      nkvtick, nkvtick, XN_RELATIVE);
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+		else if (!aperiodic && !oldmode && tbase->tsliced++ == 0)
+			/* Time-slicing needs every tick. */
+			xntslave_rearm(base2slave(tbase));
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 	} else {
 		xnthread_clear_state(thread, XNRRB);
 		if (aperiodic && oldmode && --nkpod->tsliced == 0)
 			xntimer_stop(&nkpod->tslicer);
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+		else if (!aperiodic && oldmode)
+			/* Back to tickless on the next tick. */
+			tbase->tsliced--;
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 	}
 
 	xnlock_put_irqrestore(&nklock, s);
@@ -159,10 +159,6 @@ static struct xnthread *xnsched_rt_peek_rpi(struct xnsched *sched)
 
 struct xnvfile_directory sched_rt_vfroot;
 
-struct vfile_sched_rt_priv {
-	struct xnholder *curr;
-};
-
 struct vfile_sched_rt_data {
 	int cpu;
 	pid_t pid;
@@ -176,7 +172,6 @@ struct vfile_sched_rt_data {
 static struct xnvfile_snapshot_ops vfile_sched_rt_ops;
 
 static struct xnvfile_snapshot vfile_sched_rt = {
-	.privsz = sizeof(struct vfile_sched_rt_priv),
 	.datasz = sizeof(struct vfile_sched_rt_data),
 	.tag = &nkpod_struct.threadlist_tag,
 	.ops = &vfile_sched_rt_ops,
@@ -184,13 +179,12 @@ static struct xnvfile_snapshot vfile_sched_rt = {
 
 static int vfile_sched_rt_rewind(struct xnvfile_snapshot_iterator *it)
 {
-	struct vfile_sched_rt_priv *priv = xnvfile_iterator_priv(it);
 	int nrthreads = xnsched_class_rt.nthreads;
 
 	if (nrthreads == 0)
 		return -ESRCH;
 
-	priv->curr = getheadq(&nkpod->threadq);
+	xnvfile_cursor_rewind(it, &nkpod->threadq);
 
 	return nrthreads;
 }
@@ -198,15 +192,15 @@ static int vfile_sched_rt_rewind(struct xnvfile_snapshot_iterator *it)
 static int vfile_sched_rt_next(struct xnvfile_snapshot_iterator *it,
 			       void *data)
 {
-	struct vfile_sched_rt_priv *priv = xnvfile_iterator_priv(it);
 	struct vfile_sched_rt_data *p = data;
 	struct xnthread *thread;
+	struct xnholder *holder;
 
-	if (priv->curr == NULL)
+	holder = xnvfile_cursor_next(it);
+	if (holder == NULL)
 		return 0;	/* All done. */
 
-	thread = link2thread(priv->curr, glink);
-	priv->curr = nextq(&nkpod->threadq, priv->curr);
+	thread = link2thread(holder, glink);
 
 	if (thread->base_class != &xnsched_class_rt)
 		return VFILE_SEQ_SKIP;
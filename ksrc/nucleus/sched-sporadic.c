@@ -431,11 +431,6 @@ static void xnsched_sporadic_resume_rpi(struct xnthread *thread)
 
 struct xnvfile_directory sched_sporadic_vfroot;
 
-struct vfile_sched_sporadic_priv {
-	int nrthreads;
-	struct xnholder *curr;
-};
-
 struct vfile_sched_sporadic_data {
 	int cpu;
 	pid_t pid;
@@ -452,7 +447,6 @@ struct vfile_sched_sporadic_data {
 static struct xnvfile_snapshot_ops vfile_sched_sporadic_ops;
 
 static struct xnvfile_snapshot vfile_sched_sporadic = {
-	.privsz = sizeof(struct vfile_sched_sporadic_priv),
 	.datasz = sizeof(struct vfile_sched_sporadic_data),
 	.tag = &nkpod_struct.threadlist_tag,
 	.ops = &vfile_sched_sporadic_ops,
@@ -460,13 +454,12 @@ static struct xnvfile_snapshot vfile_sched_sporadic = {
 
 static int vfile_sched_sporadic_rewind(struct xnvfile_snapshot_iterator *it)
 {
-	struct vfile_sched_sporadic_priv *priv = xnvfile_iterator_priv(it);
 	int nrthreads = xnsched_class_sporadic.nthreads;
 
 	if (nrthreads == 0)
 		return -ESRCH;
 
-	priv->curr = getheadq(&nkpod->threadq);
+	xnvfile_cursor_rewind(it, &nkpod->threadq);
 
 	return nrthreads;
 }
@@ -474,15 +467,15 @@ static int vfile_sched_sporadic_rewind(struct xnvfile_snapshot_iterator *it)
 static int vfile_sched_sporadic_next(struct xnvfile_snapshot_iterator *it,
 				     void *data)
 {
-	struct vfile_sched_sporadic_priv *priv = xnvfile_iterator_priv(it);
 	struct vfile_sched_sporadic_data *p = data;
 	struct xnthread *thread;
+	struct xnholder *holder;
 
-	if (priv->curr == NULL)
+	holder = xnvfile_cursor_next(it);
+	if (holder == NULL)
 		return 0;	/* All done. */
 
-	thread = link2thread(priv->curr, glink);
-	priv->curr = nextq(&nkpod->threadq, priv->curr);
+	thread = link2thread(holder, glink);
 
 	if (thread->base_class != &xnsched_class_sporadic)
 		return VFILE_SEQ_SKIP;
@@ -296,10 +296,6 @@ EXPORT_SYMBOL_GPL(xnsched_tp_get_partition);
 
 struct xnvfile_directory sched_tp_vfroot;
 
-struct vfile_sched_tp_priv {
-	struct xnholder *curr;
-};
-
 struct vfile_sched_tp_data {
 	int cpu;
 	pid_t pid;
@@ -311,7 +307,6 @@ struct vfile_sched_tp_data {
 static struct xnvfile_snapshot_ops vfile_sched_tp_ops;
 
 static struct xnvfile_snapshot vfile_sched_tp = {
-	.privsz = sizeof(struct vfile_sched_tp_priv),
 	.datasz = sizeof(struct vfile_sched_tp_data),
 	.tag = &nkpod_struct.threadlist_tag,
 	.ops = &vfile_sched_tp_ops,
@@ -319,10 +314,9 @@ static struct xnvfile_snapshot vfile_sched_tp = {
 
 static int vfile_sched_tp_rewind(struct xnvfile_snapshot_iterator *it)
 {
-	struct vfile_sched_tp_priv *priv = xnvfile_iterator_priv(it);
 	int nrthreads = xnsched_class_tp.nthreads;
 
-	priv->curr = getheadq(&nkpod->threadq);
+	xnvfile_cursor_rewind(it, &nkpod->threadq);
 
 	return nrthreads;
 }
@@ -330,15 +324,15 @@ static int vfile_sched_tp_rewind(struct xnvfile_snapshot_iterator *it)
 static int vfile_sched_tp_next(struct xnvfile_snapshot_iterator *it,
 			       void *data)
 {
-	struct vfile_sched_tp_priv *priv = xnvfile_iterator_priv(it);
 	struct vfile_sched_tp_data *p = data;
 	struct xnthread *thread;
+	struct xnholder *holder;
 
-	if (priv->curr == NULL)
+	holder = xnvfile_cursor_next(it);
+	if (holder == NULL)
 		return 0;	/* All done. */
 
-	thread = link2thread(priv->curr, glink);
-	priv->curr = nextq(&nkpod->threadq, priv->curr);
+	thread = link2thread(holder, glink);
 
 	if (thread->base_class != &xnsched_class_tp)
 		return VFILE_SEQ_SKIP;
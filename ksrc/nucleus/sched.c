@@ -696,7 +696,6 @@ struct xnpholder *nextmlq(struct xnsched_mlq *q, struct xnpholder *h)
 static struct xnvfile_directory schedclass_vfroot;
 
 struct vfile_sched_priv {
-	struct xnholder *curr;
 	xnticks_t start_time;
 };
 
@@ -726,7 +725,7 @@ static int vfile_sched_rewind(struct xnvfile_snapshot_iterator *it)
 {
 	struct vfile_sched_priv *priv = xnvfile_iterator_priv(it);
 
-	priv->curr = getheadq(&nkpod->threadq);
+	xnvfile_cursor_rewind(it, &nkpod->threadq);
 	priv->start_time = xntbase_get_jiffies(&nktbase);
 
 	return countq(&nkpod->threadq);
@@ -738,12 +737,13 @@ static int vfile_sched_next(struct xnvfile_snapshot_iterator *it, void *data)
 	struct vfile_sched_data *p = data;
 	xnticks_t timeout, period;
 	struct xnthread *thread;
+	struct xnholder *holder;
 
-	if (priv->curr == NULL)
+	holder = xnvfile_cursor_next(it);
+	if (holder == NULL)
 		return 0;	/* All done. */
 
-	thread = link2thread(priv->curr, glink);
-	priv->curr = nextq(&nkpod->threadq, priv->curr);
+	thread = link2thread(holder, glink);
 
 	p->cpu = xnsched_cpu(thread->sched);
 	p->pid = xnthread_user_pid(thread);
@@ -821,7 +821,6 @@ static struct xnvfile_snapshot_ops vfile_sched_ops = {
 
 struct vfile_stat_priv {
 	int irq;
-	struct xnholder *curr;
 	struct xnintr_iterator intr_it;
 };
 
@@ -856,7 +855,7 @@ static int vfile_stat_rewind(struct xnvfile_snapshot_iterator *it)
 	 * The activity numbers on each valid interrupt descriptor are
 	 * grouped under a pseudo-thread.
 	 */
-	priv->curr = getheadq(&nkpod->threadq);
+	xnvfile_cursor_rewind(it, &nkpod->threadq);
 	priv->irq = 0;
 	irqnr = xnintr_query_init(&priv->intr_it) * XNARCH_NR_CPUS;
 
@@ -868,19 +867,20 @@ static int vfile_stat_next(struct xnvfile_snapshot_iterator *it, void *data)
 	struct vfile_stat_priv *priv = xnvfile_iterator_priv(it);
 	struct vfile_stat_data *p = data;
 	struct xnthread *thread;
+	struct xnholder *holder;
 	struct xnsched *sched;
 	xnticks_t period;
 	int ret;
 
-	if (priv->curr == NULL)
+	holder = xnvfile_cursor_next(it);
+	if (holder == NULL)
 		/*
 		 * We are done with actual threads, scan interrupt
 		 * descriptors.
 		 */
 		goto scan_irqs;
 
-	thread = link2thread(priv->curr, glink);
-	priv->curr = nextq(&nkpod->threadq, priv->curr);
+	thread = link2thread(holder, glink);
 
 	sched = thread->sched;
 	p->cpu = xnsched_cpu(sched);
@@ -912,8 +912,13 @@ scan_irqs:
 
 	ret = xnintr_query_next(priv->irq, &priv->intr_it, p->name);
 	if (ret) {
+		/*
+		 * The set of interrupt descriptors changed under our
+		 * feet, so we don't know which ones were collected
+		 * already: restart the whole collection.
+		 */
 		if (ret == -EAGAIN)
-			xnvfile_touch(it->vfile); /* force rewind. */
+			return -EAGAIN;
 		priv->irq++;
 		return VFILE_SEQ_SKIP;
 	}
@@ -1007,6 +1012,131 @@ static struct xnvfile_snapshot_ops vfile_acct_ops = {
 	.show = vfile_acct_show,
 };
 
+struct vfile_relstat_data {
+	int cpu;
+	pid_t pid;
+	xnticks_t period;
+	char name[XNOBJECT_NAME_LEN];
+	struct xnthread_relstat rs;
+};
+
+static struct xnvfile_snapshot_ops vfile_relstat_ops;
+
+static struct xnvfile_snapshot relstat_vfile = {
+	.datasz = sizeof(struct vfile_relstat_data),
+	.tag = &nkpod_struct.threadlist_tag,
+	.ops = &vfile_relstat_ops,
+};
+
+static int vfile_relstat_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	xnvfile_cursor_rewind(it, &nkpod->threadq);
+
+	return countq(&nkpod->threadq);
+}
+
+static int vfile_relstat_next(struct xnvfile_snapshot_iterator *it,
+			      void *data)
+{
+	struct vfile_relstat_data *p = data;
+	struct xnthread *thread;
+	struct xnholder *holder;
+	xntbase_t *tbase;
+
+	holder = xnvfile_cursor_next(it);
+	if (holder == NULL)
+		return 0;	/* All done. */
+
+	thread = link2thread(holder, glink);
+
+	/* Only report threads which have been periodic once. */
+	if (!xntimer_running_p(&thread->ptimer) &&
+	    thread->relstat.releases == 0)
+		return VFILE_SEQ_SKIP;
+
+	p->cpu = xnsched_cpu(thread->sched);
+	p->pid = xnthread_user_pid(thread);
+	memcpy(p->name, thread->name, sizeof(p->name));
+	xnthread_get_relstat(thread, &p->rs);
+
+	tbase = xnthread_time_base(thread);
+	if (!xntimer_running_p(&thread->ptimer))
+		p->period = 0;
+	else if (xntbase_periodic_p(tbase))
+		p->period = xntbase_ticks2ns(tbase,
+					     xntimer_interval(&thread->ptimer));
+	else
+		p->period = xnarch_tsc_to_ns(xntimer_interval(&thread->ptimer));
+
+	return 1;
+}
+
+static int vfile_relstat_show(struct xnvfile_snapshot_iterator *it,
+			      void *data)
+{
+	struct vfile_relstat_data *p = data;
+	xnticks_t avg = 0;
+	int n;
+
+	if (p == NULL) {
+		xnvfile_printf(it,
+			       "%-3s  %-6s %-10s %-10s %-10s %-6s %-8s %-8s"
+			       " %-8s %s\n",
+			       "CPU", "PID", "PERIOD(us)", "RELEASES", "MISSED",
+			       "BURST", "AVG(ns)", "MAX(ns)", "HIST(us)", "NAME");
+		return 0;
+	}
+
+	if (p->rs.releases)
+		avg = xnarch_div64(p->rs.latsum, p->rs.releases);
+
+	xnvfile_printf(it, "%3u  %-6d %-10Lu %-10lu %-10lu %-6lu %-8Lu %-8Lu ",
+		       p->cpu, p->pid, xnarch_ulldiv(p->period, 1000, NULL),
+		       p->rs.releases, p->rs.overruns, p->rs.maxburst,
+		       avg, (xnticks_t)p->rs.latmax);
+
+	/* One count per log2 bucket of microseconds, see relstat. */
+	for (n = 0; n < XNTHREAD_RELSTAT_BUCKETS; n++)
+		xnvfile_printf(it, n ? ",%lu" : "%lu", p->rs.hist[n]);
+
+	xnvfile_printf(it, " %s\n", p->name);
+
+	return 0;
+}
+
+static ssize_t vfile_relstat_store(struct xnvfile_input *input)
+{
+	struct xnholder *holder;
+	ssize_t ret;
+	long val;
+	spl_t s;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	/* Writing 0 clears the statistics of all threads. */
+	if (val != 0)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (holder = getheadq(&nkpod->threadq);
+	     holder; holder = nextq(&nkpod->threadq, holder))
+		xnthread_reset_relstat(link2thread(holder, glink));
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+static struct xnvfile_snapshot_ops vfile_relstat_ops = {
+	.rewind = vfile_relstat_rewind,
+	.next = vfile_relstat_next,
+	.show = vfile_relstat_show,
+	.store = vfile_relstat_store,
+};
+
 #endif /* CONFIG_XENO_OPT_STATS */
 
 int xnsched_init_proc(void)
@@ -1037,6 +1167,9 @@ int xnsched_init_proc(void)
 	ret = xnvfile_init_snapshot("acct", &acct_vfile, &nkvfroot);
 	if (ret)
 		return ret;
+	ret = xnvfile_init_snapshot("relstat", &relstat_vfile, &nkvfroot);
+	if (ret)
+		return ret;
 #endif /* CONFIG_XENO_OPT_STATS */
 
 	return 0;
@@ -1052,6 +1185,7 @@ void xnsched_cleanup_proc(void)
 	}
 
 #ifdef CONFIG_XENO_OPT_STATS
+	xnvfile_destroy_snapshot(&relstat_vfile);
 	xnvfile_destroy_snapshot(&acct_vfile);
 	xnvfile_destroy_snapshot(&stat_vfile);
 #endif /* CONFIG_XENO_OPT_STATS */
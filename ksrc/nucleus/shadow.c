@@ -56,6 +56,12 @@
 #include <asm/xenomai/features.h>
 #include <asm/xenomai/syscall.h>
 #include <asm/xenomai/bits/shadow.h>
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+#include <linux/uaccess.h>
+#ifdef CONFIG_HAVE_ARCH_TRACEHOOK
+#include <asm/syscall.h>
+#endif
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
 
 static int xn_gid_arg = -1;
 module_param_named(xenomai_gid, xn_gid_arg, int, 0644);
@@ -694,6 +700,10 @@ void __init xnheap_init_vdso(void)
 	if (nkvdso == NULL)
 		xnpod_fatal("Xenomai: cannot allocate memory for xnvdso!\n");
 
+	/* The semaphore heap is not zeroed, start from a sane state. */
+	xnseqcount_init(&nkvdso->wallclock_data.seqcount);
+	nkvdso->wallclock_data.offset = nktbase.wallclock_offset;
+
 	nkvdso->features = XNVDSO_FEATURES;
 }
 
@@ -916,6 +926,162 @@ static int gatekeeper_thread(void *data)
 	return 0;
 }
 
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+
+static int mswprof_enabled;
+
+#ifdef CONFIG_HAVE_ARCH_TRACEHOOK
+#define mswprof_linux_syscall(regs)	syscall_get_nr(current, regs)
+#else
+#define mswprof_linux_syscall(regs)	__xn_reg_mux(regs)
+#endif
+
+static unsigned mswprof_gen;
+
+/*
+ * Hash the user-space call chain which led to the mode switch. This
+ * must run over the Linux domain, since we may fault while peeking
+ * at the user stack. Where we don't know how to walk the frames, or
+ * for code built without frame pointers, only the syscall or fault
+ * site is hashed.
+ */
+static unsigned mswprof_hash(struct task_struct *p)
+{
+	unsigned long chain[XNMSWPROF_DEPTH + 1];
+	struct pt_regs *regs = task_pt_regs(p);
+	int depth = 0;
+#ifdef CONFIG_X86
+	unsigned long frame[2], fp;
+#endif
+
+	chain[depth++] = instruction_pointer(regs);
+
+#ifdef CONFIG_X86
+	fp = regs->bp;
+	pagefault_disable();
+	while (depth <= XNMSWPROF_DEPTH && fp) {
+		if (__copy_from_user_inatomic(frame, (void __user *)fp,
+					      sizeof(frame)))
+			break;
+		chain[depth++] = frame[1];
+		if (frame[0] <= fp)
+			break;
+		fp = frame[0];
+	}
+	pagefault_enable();
+#endif /* CONFIG_X86 */
+
+	return jhash2((uint32_t *)chain,
+		      depth * sizeof(chain[0]) / sizeof(uint32_t), 0);
+}
+
+static struct xnmswprof_site *
+mswprof_lookup(struct xnmswprof *prof, int event, unsigned trigger,
+	       unsigned hash)
+{
+	struct xnmswprof_site *site;
+	unsigned n, i;
+
+	n = (hash ^ trigger ^ event) % XNMSWPROF_SITES;
+
+	for (i = 0; i < XNMSWPROF_SITES; i++) {
+		site = prof->sites + (n + i) % XNMSWPROF_SITES;
+		if (site->count == 0) {
+			site->hash = hash;
+			site->trigger = trigger;
+			site->event = event;
+			return site;
+		}
+		if (site->hash == hash && site->trigger == trigger &&
+		    site->event == event)
+			return site;
+	}
+
+	return NULL;
+}
+
+/*
+ * Only the owner thread updates its profile, with interrupts off so
+ * that readers never spin on a preempted update.
+ */
+static void mswprof_record(struct xnthread *thread, int event, unsigned hash)
+{
+	struct xnmswprof *prof = &thread->mswprof;
+	struct xnmswprof_site *site;
+	xnticks_t now, stay;
+	spl_t s;
+
+	splhigh(s);
+
+	now = xnarch_get_cpu_tsc();
+	xnwrite_seqcount_begin(&prof->seq);
+
+	if (prof->gen != mswprof_gen) {
+		memset(prof->sites, 0, sizeof(prof->sites));
+		prof->lost = 0;
+		prof->cursite = -1;
+		prof->gen = mswprof_gen;
+	}
+
+	if (event == XNMSWPROF_HARDEN && prof->cursite >= 0) {
+		site = prof->sites + prof->cursite;
+		stay = now - prof->relaxed_at;
+		site->total += stay;
+		if (stay > site->max)
+			site->max = stay;
+	}
+
+	site = mswprof_lookup(prof, event, prof->trigger, hash);
+	if (site) {
+		site->count++;
+		prof->cursite = event == XNMSWPROF_HARDEN ?
+			-1 : site - prof->sites;
+	} else {
+		prof->lost++;
+		prof->cursite = -1;
+	}
+	prof->relaxed_at = now;
+	prof->trigger = 0;
+
+	xnwrite_seqcount_end(&prof->seq);
+
+	splexit(s);
+}
+
+static inline unsigned mswprof_harden_begin(void)
+{
+	return mswprof_enabled ? mswprof_hash(current) : 0;
+}
+
+static inline void mswprof_harden_end(struct xnthread *thread, unsigned hash)
+{
+	if (mswprof_enabled)
+		mswprof_record(thread, XNMSWPROF_HARDEN, hash);
+}
+
+static inline void mswprof_relax(struct xnthread *thread, int reason)
+{
+	if (mswprof_enabled)
+		mswprof_record(thread, reason, mswprof_hash(current));
+}
+
+#else /* !CONFIG_XENO_OPT_STATS_MSWPROF */
+
+static inline unsigned mswprof_harden_begin(void)
+{
+	return 0;
+}
+
+static inline void mswprof_harden_end(struct xnthread *thread, unsigned hash)
+{
+}
+
+static inline void mswprof_relax(struct xnthread *thread, int reason)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_STATS_MSWPROF */
+
 /*!
  * @internal
  * \fn int xnshadow_harden(void);
@@ -941,8 +1107,10 @@ int xnshadow_harden(void)
 	struct task_struct *this_task = current;
 	struct xnthread *thread;
 	struct xnsched *sched;
+	unsigned hash;
 	int cpu, err;
 
+	hash = mswprof_harden_begin();
 redo:
 	thread = xnshadow_thread(this_task);
 	if (!thread)
@@ -1052,6 +1220,8 @@ redo:
 	trace_mark(xn_nucleus, shadow_hardened, "thread %p thread_name %s",
 		   thread, xnthread_name(thread));
 
+	mswprof_harden_end(thread, hash);
+
 	/*
 	 * Recheck pending signals once again. As we block task wakeups during
 	 * the migration and do_sigwake_event ignores signals until XNRELAX is
@@ -1157,6 +1327,7 @@ void xnshadow_relax(int notify, int reason)
 			   prio ? SCHED_FIFO : SCHED_NORMAL, prio);
 
 	xnstat_counter_inc(&thread->stat.ssw);	/* Account for secondary mode switch. */
+	mswprof_relax(thread, reason);
 
 	if (notify) {
 		if (xnthread_test_state(thread, XNTRAPSW)) {
@@ -1277,8 +1448,8 @@ int xnshadow_map(xnthread_t *thread, xncompletion_t __user *u_completion,
 	struct xnthread_start_attr attr;
 	xnarch_cpumask_t affinity;
 	struct xnsys_ppd *sys_ppd;
+	struct xnthread_user_window *u_window;
 	unsigned int muxid, magic;
-	unsigned long *u_mode;
 	xnheap_t *sem_heap;
 	spl_t s;
 	int ret;
@@ -1324,10 +1495,16 @@ int xnshadow_map(xnthread_t *thread, xncompletion_t __user *u_completion,
 	xnlock_put_irqrestore(&nklock, s);
 
 	sem_heap = &sys_ppd->sem_heap;
-	u_mode = xnheap_alloc(sem_heap, sizeof(*u_mode));
-	if (!u_mode)
+	u_window = xnheap_alloc(sem_heap, sizeof(*u_window));
+	if (!u_window)
 		return -ENOMEM;
 
+	u_window->state = 0;
+	xnseqcount_init(&u_window->seqcount);
+	u_window->exectime = 0;
+	u_window->lastswitch = 0;
+	u_window->oncpu = 0;
+
 	/* Restrict affinity to a single CPU of nkaffinity & current set. */
 	xnarch_cpus_and(affinity, current->cpus_allowed, nkaffinity);
 	affinity = xnarch_cpumask_of_cpu(xnarch_first_cpu(affinity));
@@ -1341,8 +1518,9 @@ int xnshadow_map(xnthread_t *thread, xncompletion_t __user *u_completion,
 	xnarch_init_shadow_tcb(xnthread_archtcb(thread), thread,
 			       xnthread_name(thread));
 
-	thread->u_mode = u_mode;
-	__xn_put_user(xnheap_mapped_offset(sem_heap, u_mode), u_mode_offset);
+	thread->u_window = u_window;
+	thread->u_mode = &u_window->state;
+	__xn_put_user(xnheap_mapped_offset(sem_heap, u_window), u_mode_offset);
 
 	xnthread_set_state(thread, XNMAPPED);
 	xnpod_suspend_thread(thread, XNRELAX, XN_INFINITE, XN_RELATIVE, NULL);
@@ -1430,8 +1608,9 @@ void xnshadow_unmap(xnthread_t *thread)
 	rpi_pop(thread);
 
 	sys_ppd = xnsys_ppd_get(0);
-	if (thread->u_mode) {
-		xnheap_free(&sys_ppd->sem_heap, thread->u_mode);
+	if (thread->u_window) {
+		xnheap_free(&sys_ppd->sem_heap, thread->u_window);
+		thread->u_window = NULL;
 		thread->u_mode = NULL;
 	}
 
@@ -2141,6 +2320,223 @@ static int xnshadow_sys_current_info(struct pt_regs *regs)
 	return __xn_safe_copy_to_user(us_info, &info, sizeof(*us_info));
 }
 
+/*
+ * Run a series of skin calls on behalf of the current shadow, in a
+ * single trip to primary mode. Each entry is dispatched through the
+ * system call table of its skin, exactly like a regular trap would
+ * be, except that the scheduler is locked across the series, so that
+ * we reschedule once after the last call, instead of once per
+ * call. A call which blocks drops the lock until it resumes, as
+ * usual.
+ *
+ * Each entry goes through the checks of the regular dispatcher, but
+ * the caller never changes mode on behalf of a call: those which must
+ * run from secondary mode cannot be batched, and get -EPERM; adaptive
+ * calls only run their primary mode variant, -ENOSYS telling the
+ * caller to issue them separately instead. Non real-time shadows
+ * relax after a call which released their last resource, as usual.
+ *
+ * The count of processed entries is returned. We stop early upon a
+ * pending signal, so that it gets handled on our way back to user
+ * space; unprocessed entries are left untouched. We also stop when a
+ * call relaxed the caller, since the remaining ones were meant to run
+ * in primary mode; those get -EAGAIN, so that user space may
+ * resubmit them.
+ */
+static int xnshadow_sys_batch(struct pt_regs *regs)
+{
+	struct xnsys_batch_entry __user *u_entries;
+	xnthread_t *cur = xnshadow_thread(current);
+	struct xnsys_batch_entry entry;
+	int nr, n, i, muxid, muxop, ret;
+	struct pt_regs xregs;
+	u_long sysflags;
+	long result;
+	spl_t s;
+
+	u_entries = (struct xnsys_batch_entry __user *)__xn_reg_arg1(regs);
+	nr = __xn_reg_arg2(regs);
+
+	if (nr < 0 || nr > XNSYS_BATCH_MAX)
+		return -EINVAL;
+
+	xnpod_lock_sched();
+
+	for (n = 0, ret = 0; n < nr; n++) {
+		if (__xn_safe_copy_from_user(&entry, &u_entries[n],
+					     sizeof(entry))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		memset(&xregs, 0, sizeof(xregs));
+		__xn_reg_mux(&xregs) = entry.muxcode;
+		__xn_reg_arg1(&xregs) = entry.args[0];
+		__xn_reg_arg2(&xregs) = entry.args[1];
+		__xn_reg_arg3(&xregs) = entry.args[2];
+		__xn_reg_arg4(&xregs) = entry.args[3];
+		__xn_reg_arg5(&xregs) = entry.args[4];
+
+		muxid = __xn_mux_id(&xregs);
+		muxop = __xn_mux_op(&xregs);
+
+		/* Nucleus services cannot be batched. */
+		if (!__xn_reg_mux_p(&xregs) || muxid <= 0 ||
+		    muxid >= XENOMAI_MUX_NR || muxtable[muxid].props == NULL ||
+		    muxop < 0 || muxop >= muxtable[muxid].props->nrcalls) {
+			entry.result = -ENOSYS;
+			goto next;
+		}
+
+		sysflags = muxtable[muxid].props->systab[muxop].flags;
+
+		xnshadow_mswprof_trigger(cur, XNMSWPROF_TRIG_XENO,
+					 (muxid << 8) | muxop);
+
+		/*
+		 * Same mode resolution as do_hisyscall_event() for a
+		 * shadow running in primary mode, except that we
+		 * never switch: conforming calls run from the Xenomai
+		 * domain, calls which would relax the caller (this
+		 * includes the switchback ones) are refused.
+		 */
+		if ((sysflags & __xn_exec_conforming) != 0)
+			sysflags |= __xn_exec_histage;
+
+		if ((sysflags & (__xn_exec_lostage|__xn_exec_switchback)) != 0) {
+			entry.result = -EPERM;
+			goto next;
+		}
+
+		entry.result = muxtable[muxid].props->systab[muxop].svc(&xregs);
+
+		/*
+		 * Non real-time shadows leave primary mode as soon as
+		 * they release their last resource, which ends the
+		 * batch below.
+		 */
+		if (!xnpod_root_p() &&
+		    xnthread_test_state(cur, XNOTHER) &&
+		    xnthread_get_rescnt(cur) == 0)
+			xnshadow_relax(0, 0);
+
+		/* Update the userland-visible state. */
+		if (cur->u_mode)
+			*cur->u_mode = cur->state;
+	next:
+		if (__xn_safe_copy_to_user(&u_entries[n].result, &entry.result,
+					   sizeof(entry.result))) {
+			ret = -EFAULT;
+			break;
+		}
+
+		if (xnpod_root_p()) {
+			result = -EAGAIN;
+			for (i = n + 1; i < nr; i++)
+				if (__xn_safe_copy_to_user(&u_entries[i].result,
+							   &result,
+							   sizeof(result)))
+					break;
+			n++;
+			break;
+		}
+
+		if (signal_pending(current) || xnthread_amok_p(cur)) {
+			n++;
+			break;
+		}
+	}
+
+	if (xnpod_root_p()) {
+		/*
+		 * The scheduler lock belongs to our shadow, which is
+		 * no longer current on this CPU, so
+		 * xnpod_unlock_sched() would release the root
+		 * thread's instead; drop it directly.
+		 */
+		xnlock_get_irqsave(&nklock, s);
+		if (--xnthread_lock_count(cur) == 0)
+			xnthread_clear_state(cur, XNLOCK);
+		xnlock_put_irqrestore(&nklock, s);
+	} else
+		xnpod_unlock_sched();
+
+	return n > 0 ? n : ret;
+}
+
+/*
+ * Park/unpark let user-space keep pools of pre-mapped shadows around,
+ * and hand them work with a single call: an idle thread parks itself,
+ * the dispatcher then unparks it, optionally moving it to a new
+ * priority level in the same pass. An unpark request which precedes
+ * the matching park is remembered, so that the latter returns
+ * immediately.
+ *
+ * Parked threads sleep on their own synch object, so that the
+ * regular suspend/resume services and park/unpark do not interfere.
+ */
+#define XNSHADOW_UNPARKED	0x1
+
+static int xnshadow_sys_park(struct pt_regs *regs)
+{
+	xnthread_t *cur = xnshadow_thread(current);
+	int ret = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if ((cur->parkstate & XNSHADOW_UNPARKED) == 0) {
+		xnsynch_sleep_on(&cur->parksynch, XN_INFINITE, XN_RELATIVE);
+		if ((cur->parkstate & XNSHADOW_UNPARKED) == 0)
+			ret = -EINTR;
+	}
+
+	cur->parkstate &= ~XNSHADOW_UNPARKED;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+static int xnshadow_sys_unpark(struct pt_regs *regs)
+{
+	xnhandle_t threadh = __xn_reg_arg1(regs);
+	union xnsched_policy_param param;
+	int prio = __xn_reg_arg2(regs);
+	xnthread_t *thread;
+	int ret = 0;
+	spl_t s;
+
+	if (prio >= 0 && (prio < XNSCHED_RT_MIN_PRIO ||
+			  prio > XNSCHED_RT_MAX_PRIO))
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	thread = xnthread_lookup(threadh);
+	/* Only threads from the caller's process may be unparked. */
+	if (thread == NULL || !xnthread_test_state(thread, XNSHADOW) ||
+	    xnthread_user_task(thread) == NULL ||
+	    xnthread_user_task(thread)->mm != current->mm) {
+		ret = -ESRCH;
+		goto unlock_and_exit;
+	}
+
+	if (prio >= 0) {
+		param.rt.prio = prio;
+		xnpod_set_thread_schedparam(thread, &xnsched_class_rt, &param);
+	}
+
+	thread->parkstate |= XNSHADOW_UNPARKED;
+	if (xnsynch_wakeup_one_sleeper(&thread->parksynch))
+		xnpod_schedule();
+
+unlock_and_exit:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
 static xnsysent_t __systab[] = {
 	[__xn_sys_migrate] = {&xnshadow_sys_migrate, __xn_exec_current},
 	[__xn_sys_arch] = {&xnshadow_sys_arch, __xn_exec_any},
@@ -2154,6 +2550,9 @@ static xnsysent_t __systab[] = {
 	[__xn_sys_current_info] =
 		{&xnshadow_sys_current_info, __xn_exec_shadow},
 	[__xn_sys_mayday] = {&xnshadow_sys_mayday, __xn_exec_any|__xn_exec_norestart},
+	[__xn_sys_batch] = {&xnshadow_sys_batch, __xn_exec_primary|__xn_exec_norestart},
+	[__xn_sys_park] = {&xnshadow_sys_park, __xn_exec_primary},
+	[__xn_sys_unpark] = {&xnshadow_sys_unpark, __xn_exec_any},
 };
 
 static void post_ppd_release(struct xnheap *h)
@@ -2279,6 +2678,10 @@ int do_hisyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 
 	sysflags = muxtable[muxid].props->systab[muxop].flags;
 
+	if (thread)
+		xnshadow_mswprof_trigger(thread, XNMSWPROF_TRIG_XENO,
+					 (muxid << 8) | muxop);
+
 	if ((sysflags & __xn_exec_shadow) != 0 && thread == NULL) {
 	no_permission:
 		if (XENO_DEBUG(NUCLEUS))
@@ -2379,9 +2782,16 @@ int do_hisyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 
       ret_handled:
 
-	/* Update the userland-visible state. */
-	if (thread && thread->u_mode)
-		*thread->u_mode = thread->state;
+	if (thread) {
+		/*
+		 * The syscall is over, any later switch is not its
+		 * doing.
+		 */
+		xnshadow_mswprof_clear(thread);
+		/* Update the userland-visible state. */
+		if (thread->u_mode)
+			*thread->u_mode = thread->state;
+	}
 
 	trace_mark(xn_nucleus, syscall_histage_exit,
 		   "ret %ld", __xn_reg_rval(regs));
@@ -2419,6 +2829,8 @@ int do_hisyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 	 * it. Before we let it go, ensure that the current thread has
 	 * properly entered the Linux domain.
 	 */
+	xnshadow_mswprof_trigger(thread, XNMSWPROF_TRIG_LINUX,
+				 mswprof_linux_syscall(regs));
 	xnshadow_relax(1, SIGDEBUG_MIGRATE_SYSCALL);
 
 	goto propagate_syscall;
@@ -2494,6 +2906,10 @@ int do_losyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 
 	sysflags = muxtable[muxid].props->systab[muxop].flags;
 
+	if (thread)
+		xnshadow_mswprof_trigger(thread, XNMSWPROF_TRIG_XENO,
+					 (muxid << 8) | muxop);
+
 	if ((sysflags & __xn_exec_conforming) != 0)
 		sysflags |= (thread ? __xn_exec_histage : __xn_exec_lostage);
 
@@ -2549,9 +2965,16 @@ int do_losyscall_event(unsigned event, rthal_pipeline_stage_t *stage,
 
       ret_handled:
 
-	/* Update the userland-visible state. */
-	if (thread && thread->u_mode)
-		*thread->u_mode = thread->state;
+	if (thread) {
+		/*
+		 * The syscall is over, any later switch is not its
+		 * doing.
+		 */
+		xnshadow_mswprof_clear(thread);
+		/* Update the userland-visible state. */
+		if (thread->u_mode)
+			*thread->u_mode = thread->state;
+	}
 
 	trace_mark(xn_nucleus, syscall_lostage_exit,
 		   "ret %ld", __xn_reg_rval(regs));
@@ -2866,9 +3289,209 @@ static struct xnvfile_regular_ops iface_vfile_ops = {
 	.show = iface_vfile_show,
 };
 
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+
+struct mswprof_vfile_data {
+	pid_t pid;
+	char name[XNOBJECT_NAME_LEN];
+	unsigned long lost;
+	int nrsites;
+	struct {
+		struct xnmswprof_site s;
+		char trigger[XNOBJECT_NAME_LEN];
+	} sites[XNMSWPROF_SITES];
+};
+
+static struct xnvfile_snapshot_ops mswprof_vfile_ops;
+
+static struct xnvfile_snapshot mswprof_vfile = {
+	.datasz = sizeof(struct mswprof_vfile_data),
+	.tag = &nkpod_struct.threadlist_tag,
+	.ops = &mswprof_vfile_ops,
+};
+
+static const char *mswprof_event_names[] = {
+	[SIGDEBUG_UNDEFINED] = "other",
+	[SIGDEBUG_MIGRATE_SIGNAL] = "signal",
+	[SIGDEBUG_MIGRATE_SYSCALL] = "syscall",
+	[SIGDEBUG_MIGRATE_FAULT] = "fault",
+	[SIGDEBUG_MIGRATE_PRIOINV] = "prioinv",
+	[SIGDEBUG_NOMLOCK] = "nomlock",
+	[SIGDEBUG_WATCHDOG] = "watchdog",
+	[SIGDEBUG_RESCNT_IMBALANCE] = "rescnt",
+};
+
+static void mswprof_format_trigger(char *buf, unsigned trigger)
+{
+	unsigned code = xnmswprof_trigger_code(trigger);
+	struct xnskin_props *props;
+
+	switch (xnmswprof_trigger_class(trigger)) {
+	case XNMSWPROF_TRIG_XENO:
+		props = muxtable[(code >> 8) % XENOMAI_MUX_NR].props;
+		if (props && props->name)
+			snprintf(buf, XNOBJECT_NAME_LEN, "%s/%u",
+				 props->name, code & 0xff);
+		else
+			snprintf(buf, XNOBJECT_NAME_LEN, "mux%u/%u",
+				 code >> 8, code & 0xff);
+		break;
+	case XNMSWPROF_TRIG_LINUX:
+		snprintf(buf, XNOBJECT_NAME_LEN, "linux/%u", code);
+		break;
+	case XNMSWPROF_TRIG_TRAP:
+		snprintf(buf, XNOBJECT_NAME_LEN, "trap/%u", code);
+		break;
+	default:
+		strcpy(buf, "-");
+	}
+}
+
+static int mswprof_vfile_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	xnvfile_cursor_rewind(it, &nkpod->threadq);
+
+	return countq(&nkpod->threadq);
+}
+
+static int mswprof_vfile_next(struct xnvfile_snapshot_iterator *it,
+			      void *data)
+{
+	struct mswprof_vfile_data *p = data;
+	struct xnmswprof_site sites[XNMSWPROF_SITES];
+	struct xnthread *thread;
+	struct xnholder *holder;
+	struct xnmswprof *prof;
+	unsigned seq, gen;
+	int n;
+
+	holder = xnvfile_cursor_next(it);
+	if (holder == NULL)
+		return 0;	/* All done. */
+
+	thread = link2thread(holder, glink);
+
+	if (!xnthread_test_state(thread, XNSHADOW))
+		return VFILE_SEQ_SKIP;
+
+	/*
+	 * The owner updates its profile locklessly and with
+	 * interrupts off, so we may only race with an update
+	 * running on another CPU, which is short.
+	 */
+	prof = &thread->mswprof;
+	do {
+		seq = xnread_seqcount_begin(&prof->seq);
+		memcpy(sites, prof->sites, sizeof(sites));
+		p->lost = prof->lost;
+		gen = prof->gen;
+	} while (xnread_seqcount_retry(&prof->seq, seq));
+
+	/* Stale data awaiting a lazy reset does not count. */
+	if (gen != mswprof_gen)
+		return VFILE_SEQ_SKIP;
+
+	p->pid = xnthread_user_pid(thread);
+	memcpy(p->name, thread->name, sizeof(p->name));
+	p->nrsites = 0;
+
+	for (n = 0; n < XNMSWPROF_SITES; n++) {
+		if (sites[n].count == 0)
+			continue;
+		p->sites[p->nrsites].s = sites[n];
+		mswprof_format_trigger(p->sites[p->nrsites].trigger,
+				       sites[n].trigger);
+		p->nrsites++;
+	}
+
+	if (p->nrsites == 0 && p->lost == 0)
+		return VFILE_SEQ_SKIP;
+
+	return 1;
+}
+
+static int mswprof_vfile_show(struct xnvfile_snapshot_iterator *it,
+			      void *data)
+{
+	struct mswprof_vfile_data *p = data;
+	struct xnmswprof_site *site;
+	const char *event;
+	int n;
+
+	if (p == NULL) {
+		xnvfile_printf(it,
+			       "%-6s %-8s %-16s %-8s %-10s %-12s %-12s %s\n",
+			       "PID", "EVENT", "TRIGGER", "HASH", "COUNT",
+			       "TOTAL(ns)", "MAX(ns)", "NAME");
+		return 0;
+	}
+
+	for (n = 0; n < p->nrsites; n++) {
+		site = &p->sites[n].s;
+		if (site->event == XNMSWPROF_HARDEN)
+			event = "harden";
+		else if (site->event < ARRAY_SIZE(mswprof_event_names))
+			event = mswprof_event_names[site->event];
+		else
+			event = "?";
+		xnvfile_printf(it,
+			       "%-6d %-8s %-16s %.8x %-10lu %-12Lu %-12Lu %s\n",
+			       p->pid, event, p->sites[n].trigger, site->hash,
+			       site->count, xnarch_tsc_to_ns(site->total),
+			       xnarch_tsc_to_ns(site->max), p->name);
+	}
+
+	if (p->lost)
+		xnvfile_printf(it,
+			       "%-6d %-8s %-16s %.8x %-10lu %-12Lu %-12Lu %s\n",
+			       p->pid, "lost", "-", 0, p->lost, 0ULL, 0ULL,
+			       p->name);
+
+	return 0;
+}
+
+static ssize_t mswprof_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	switch (val) {
+	case 0:
+		mswprof_enabled = 0;
+		break;
+	case 1:
+		mswprof_enabled = 1;
+		break;
+	case 2:
+		/* Threads drop their profile lazily. */
+		mswprof_gen++;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	return ret;
+}
+
+static struct xnvfile_snapshot_ops mswprof_vfile_ops = {
+	.rewind = mswprof_vfile_rewind,
+	.next = mswprof_vfile_next,
+	.show = mswprof_vfile_show,
+	.store = mswprof_vfile_store,
+};
+
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
+
 void xnshadow_init_proc(void)
 {
 	xnvfile_init_dir("interfaces", &iface_vfroot, &nkvfroot);
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+	xnvfile_init_snapshot("mswprof", &mswprof_vfile, &nkvfroot);
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
 }
 
 void xnshadow_cleanup_proc(void)
@@ -2879,6 +3502,9 @@ void xnshadow_cleanup_proc(void)
 		if (muxtable[muxid].props && muxtable[muxid].props->name)
 			xnvfile_destroy_regular(&muxtable[muxid].vfile);
 
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+	xnvfile_destroy_snapshot(&mswprof_vfile);
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
 	xnvfile_destroy_dir(&iface_vfroot);
 }
 
@@ -126,11 +126,18 @@ int xnthread_init(struct xnthread *thread,
 	thread->wchan = NULL;
 	thread->wwake = NULL;
 	thread->wcontext = NULL;
+	thread->parkstate = 0;
+	xnsynch_init(&thread->parksynch, XNSYNCH_FIFO, NULL);
 	thread->hrescnt = 0;
 	thread->errcode = 0;
 	thread->registry.handle = XN_NO_HANDLE;
 	thread->registry.waitkey = NULL;
 	memset(&thread->stat, 0, sizeof(thread->stat));
+	xnthread_reset_relstat(thread);
+#ifdef CONFIG_XENO_OPT_STATS_MSWPROF
+	memset(&thread->mswprof, 0, sizeof(thread->mswprof));
+	thread->mswprof.cursite = -1;
+#endif /* CONFIG_XENO_OPT_STATS_MSWPROF */
 
 	/* These will be filled by xnpod_start_thread() */
 	thread->imask = 0;
@@ -148,6 +155,10 @@ int xnthread_init(struct xnthread *thread,
 #ifdef CONFIG_XENO_OPT_SELECT
 	thread->selector = NULL;
 #endif /* CONFIG_XENO_OPT_SELECT */
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	thread->u_mode = NULL;
+	thread->u_window = NULL;
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
 	initpq(&thread->claimq);
 
 	thread->sched = sched;
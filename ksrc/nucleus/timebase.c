@@ -54,6 +54,7 @@
 #include <nucleus/pod.h>
 #include <nucleus/timer.h>
 #include <nucleus/module.h>
+#include <nucleus/vdso.h>
 
 DEFINE_XNQUEUE(nktimebaseq);
 
@@ -149,6 +150,10 @@ int xntbase_alloc(const char *name, u_long period, u_long flags,
 	base->wallclock_offset = 0;
 	base->jiffies = 0;
 	base->hook = NULL;
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+	base->tickdate = 0;
+	base->tsliced = 0;
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 	base->ops = &nktimer_ops_periodic;
 	base->name = name;
 	inith(&base->link);
@@ -259,6 +264,7 @@ int xntbase_update(xntbase_t *base, u_long period)
 		return -EINVAL;
 
 	xnlock_get_irqsave(&nklock, s);
+	xntbase_sync_jiffies(base);
 	base->tickvalue = period;
 	base->ticks2sec = 1000000000UL / period;
 	xntslave_update(base2slave(base), period);
@@ -399,6 +405,9 @@ void xntbase_start(xntbase_t *base)
 		__setbits(base->status, XNTBSET);
 	}
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+	base->tickdate = start_date;
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 	start_date += base->tickvalue;
 	__setbits(base->status, XNTBRUN);
 
@@ -437,11 +446,18 @@ EXPORT_SYMBOL_GPL(xntbase_start);
 
 void xntbase_stop(xntbase_t *base)
 {
+	spl_t s;
+
 	if (base == &nktbase || !xntbase_enabled_p(base))
 		return;
 
 	xntslave_stop(base2slave(base));
+
+	xnlock_get_irqsave(&nklock, s);
+	/* Freeze the tick count of tickless time bases. */
+	xntbase_sync_jiffies(base);
 	__clrbits(base->status, XNTBRUN | XNTBSET);
+	xnlock_put_irqrestore(&nklock, s);
 
 	trace_mark(xn_nucleus, tbase_stop, "base %s", base->name);
 }
@@ -496,6 +512,53 @@ void xntbase_tick(xntbase_t *base)
 }
 EXPORT_SYMBOL_GPL(xntbase_tick);
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+
+/*!
+ * \fn void xntbase_set_hook(xntbase_t *base, void (*hook)(void))
+ * \brief Install a tick hook on a time base.
+ *
+ * The hook is called instead of the regular tick handler on every
+ * clock tick of @a base, and is expected to announce the tick by a
+ * call to xntbase_tick(). A tickless time base is clocked on every
+ * tick as long as a hook is installed, its tick count only advancing
+ * upon xntbase_tick() calls from then on.
+ *
+ * @param base The address of the time base descriptor.
+ *
+ * @param hook The hook routine, or NULL to remove the current hook.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+void xntbase_set_hook(xntbase_t *base, void (*hook)(void))
+{
+	spl_t s;
+
+	if (base == &nktbase) {
+		base->hook = hook;
+		return;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+	xntbase_sync_jiffies(base);
+	base->tickdate = xnarch_get_cpu_time();
+	base->hook = hook;
+	xntslave_rearm(base2slave(base));
+	xnlock_put_irqrestore(&nklock, s);
+}
+EXPORT_SYMBOL_GPL(xntbase_set_hook);
+
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
 xnticks_t xntbase_ns2ticks_ceil(xntbase_t *base, xntime_t t)
 {
 	return xnarch_ulldiv(t + xntbase_get_tickval(base) - 1,
@@ -599,6 +662,7 @@ void xntbase_adjust_time(xntbase_t *base, xnsticks_t delta)
 #endif /* CONFIG_XENO_OPT_TIMING_PERIODIC */
 		/* Update all non-isolated bases in the system. */
 		nktbase.wallclock_offset += xntbase_ticks2ns(base, delta);
+		xnvdso_update_wallclock(nktbase.wallclock_offset);
 		xntimer_adjust_all_aperiodic(xntbase_ticks2ns(base, delta));
 
 #ifdef CONFIG_XENO_OPT_TIMING_PERIODIC
@@ -672,7 +736,7 @@ static int tbase_vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 
 	xnobject_copy_name(p->name, base->name);
 	p->tickvalue = base->tickvalue;
-	p->jiffies = base->jiffies;
+	p->jiffies = xntbase_get_jiffies(base);
 	p->enabled = xntbase_enabled_p(base);
 	p->set = xntbase_timeset_p(base);
 	p->isolated = xntbase_isolated_p(base);
@@ -144,6 +144,35 @@ static inline void xntimer_next_remote_shot(xnsched_t *sched)
 	xnarch_send_timer_ipi(xnarch_cpumask_of_cpu(xnsched_cpu(sched)));
 }
 
+/*
+ * Move the expiry date of a timer with slack later, either to the
+ * earliest date of a queued timer which falls within the slack
+ * window, or up to the next multiple of the slack granularity.
+ * Timers with nearby deadlines end up sharing the same date, so that
+ * they are all fired from a single shot.
+ *
+ * Looking for a peer walks the whole timer queue of the CPU, which
+ * is why slack is meant for a few low-importance timers only.
+ */
+static inline xnticks_t xntimer_coalesce(xntimer_t *timer, xnticks_t date)
+{
+	xntimerq_t *q = &timer->sched->timerqueue;
+	xnticks_t grid = timer->slackgrid;
+	xntimerh_t *h, *peer = NULL;
+	xntimerq_it_t it;
+
+	for (h = xntimerq_it_begin(q, &it); h; h = xntimerq_it_next(q, &it, h))
+		if (xntimerh_date(h) >= date &&
+		    xntimerh_date(h) - date <= timer->slack &&
+		    (peer == NULL || xntimerh_date(h) < xntimerh_date(peer)))
+			peer = h;
+
+	if (peer)
+		return xntimerh_date(peer);
+
+	return (date + grid - 1) & ~(grid - 1);
+}
+
 static void
 xntimer_adjust_aperiodic(xntimer_t *timer, xnsticks_t delta)
 {
@@ -253,6 +282,9 @@ int xntimer_start_aperiodic(xntimer_t *timer,
 		break;
 	}
 
+	if (timer->slack)
+		date = xntimer_coalesce(timer, date);
+
 	xntimerh_date(&timer->aplink) = date;
 
 	timer->interval = XN_INFINITE;
@@ -439,15 +471,97 @@ static void xntimer_move_aperiodic(xntimer_t *timer)
 
 #ifdef CONFIG_XENO_OPT_TIMING_PERIODIC
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+
+/*
+ * Tickless slave time bases: unless a tick hook is installed, the
+ * cascading timer of each CPU is set in one-shot mode for the next
+ * tick some timer of the local wheel is due at, and the elapsed
+ * ticks are caught up with when it fires. Time bases running
+ * round-robin threads are still clocked on every tick.
+ */
+
+static void xntslave_shot(xntslave_t *slave, int cpu, xnticks_t jiffy)
+{
+	struct percpu_cascade *pc = &slave->cascade[cpu];
+	xntbase_t *base = &slave->base;
+	xnticks_t date;
+
+	pc->nextjiffy = jiffy;
+	pc->armed = 1;
+
+	/* Spread ticks by timer latency, as in periodic mode. */
+	date = base->tickdate + cpu * nklatency +
+		(xnsticks_t)(jiffy - base->jiffies) * base->tickvalue;
+
+	/* Ticks we are late for are processed right away. */
+	if (xntimer_start(&pc->timer, date, XN_INFINITE, XN_ABSOLUTE))
+		xntimer_start(&pc->timer, 0, XN_INFINITE, XN_RELATIVE);
+}
+
+static void xntslave_program(xntslave_t *slave, int cpu)
+{
+	struct percpu_cascade *pc = &slave->cascade[cpu];
+	xntbase_t *base = &slave->base;
+	xntlholder_t *holder;
+	xnticks_t date, next;
+	int n, found = 0;
+
+	if (base->hook || !xntbase_enabled_p(base))
+		return;
+
+	if (base->tsliced) {
+		xntslave_shot(slave, cpu, base->jiffies + 1);
+		return;
+	}
+
+	/* Each slot is ordered by date, look for the earliest head. */
+	for (n = 0, next = 0; n < XNTIMER_WHEELSIZE; n++) {
+		holder = xntlist_head(&pc->wheel[n]);
+		if (holder == NULL)
+			continue;
+		date = xntlholder_date(holder);
+		if (!found || (xnsticks_t)(date - next) < 0)
+			next = date;
+		found = 1;
+	}
+
+	if (found)
+		xntslave_shot(slave, cpu, next);
+	else if (pc->armed) {
+		pc->armed = 0;
+		xntimer_stop(&pc->timer);
+	}
+}
+
+static inline void xntslave_enqueued(xntslave_t *slave, int cpu,
+				     xnticks_t date)
+{
+	struct percpu_cascade *pc = &slave->cascade[cpu];
+	xntbase_t *base = &slave->base;
+
+	if (base->hook || !xntbase_enabled_p(base))
+		return;
+
+	if (!pc->armed || (xnsticks_t)(date - pc->nextjiffy) < 0)
+		xntslave_shot(slave, cpu, date);
+}
+
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
 static inline void xntimer_enqueue_periodic(xntimer_t *timer)
 {
 	unsigned slot = (xntlholder_date(&timer->plink) & XNTIMER_WHEELMASK);
 	unsigned cpu = xnsched_cpu(timer->sched);
-	struct percpu_cascade *pc = &base2slave(timer->base)->cascade[cpu];
+	xntslave_t *slave = base2slave(timer->base);
+	struct percpu_cascade *pc = &slave->cascade[cpu];
 	/* Just prepend the new timer to the proper slot. */
 	xntlist_insert(&pc->wheel[slot], &timer->plink);
 	__clrbits(timer->status, XNTIMER_DEQUEUED);
 	xnstat_counter_inc(&timer->scheduled);
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+	xntslave_enqueued(slave, cpu, xntlholder_date(&timer->plink));
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 }
 
 static inline void xntimer_dequeue_periodic(xntimer_t *timer)
@@ -476,14 +590,14 @@ static int xntimer_start_periodic(xntimer_t *timer,
 	case XN_RELATIVE:
 		if ((xnsticks_t)value < 0)
 			return -ETIMEDOUT;
-		value += timer->base->jiffies;
+		value += xntbase_get_jiffies(timer->base);
 		break;
 	case XN_REALTIME:
 		__setbits(timer->status, XNTIMER_REALTIME);
 		value -= timer->base->wallclock_offset;
 		/* fall through */
 	default: /* XN_ABSOLUTE || XN_REALTIME */
-		if ((xnsticks_t)(value - timer->base->jiffies) <= 0)
+		if ((xnsticks_t)(value - xntbase_get_jiffies(timer->base)) <= 0)
 			return -ETIMEDOUT;
 		break;
 	}
@@ -514,7 +628,7 @@ static xnticks_t xntimer_get_date_periodic(xntimer_t *timer)
 
 static xnticks_t xntimer_get_timeout_periodic(xntimer_t *timer)
 {
-	return xntlholder_date(&timer->plink) - timer->base->jiffies;
+	return xntlholder_date(&timer->plink) - xntbase_get_jiffies(timer->base);
 }
 
 static xnticks_t xntimer_get_interval_periodic(xntimer_t *timer)
@@ -563,23 +677,15 @@ static void xntimer_move_periodic(xntimer_t *timer)
  * @note Only active timers are inserted into the timer wheel.
  */
 
-void xntimer_tick_periodic_inner(xntslave_t *slave)
+static void xntimer_expire_slot(xntslave_t *slave, xnsched_t *sched,
+				xnticks_t jiffy)
 {
-	xnsched_t *sched = xnpod_current_sched();
 	xntbase_t *base = &slave->base;
 	xntlholder_t *holder;
 	xnqueue_t *timerq;
 	xntimer_t *timer;
 
-	/*
-	 * Update the periodic clocks keeping the things strictly
-	 * monotonous (this routine is run on every cpu, but only CPU
-	 * XNTIMER_KEEPER_ID should do this).
-	 */
-	if (sched == xnpod_sched_slot(XNTIMER_KEEPER_ID))
-		++base->jiffies;
-
-	timerq = &slave->cascade[xnsched_cpu(sched)].wheel[base->jiffies & XNTIMER_WHEELMASK];
+	timerq = &slave->cascade[xnsched_cpu(sched)].wheel[jiffy & XNTIMER_WHEELMASK];
 
 	while ((holder = xntlist_head(timerq)) != NULL) {
 		timer = plink2timer(holder);
@@ -601,6 +707,63 @@ void xntimer_tick_periodic_inner(xntslave_t *slave)
 		xntlholder_date(&timer->plink) = base->jiffies + timer->interval;
 		xntimer_enqueue_periodic(timer);
 	}
+}
+
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+
+static void xntslave_tick(xntslave_t *slave)
+{
+	xnsched_t *sched = xnpod_current_sched();
+	struct percpu_cascade *pc = &slave->cascade[xnsched_cpu(sched)];
+	xntbase_t *base = &slave->base;
+	xnticks_t jiffy;
+	int n;
+
+	xntbase_sync_jiffies(base);
+
+	/*
+	 * Timers reloaded from their handler are due after the
+	 * current tick, prevent them from reprogramming the cascading
+	 * timer until we are done.
+	 */
+	pc->nextjiffy = base->jiffies;
+	pc->armed = 1;
+
+	/* Catch up with the ticks we skipped, one wheel turn at most. */
+	for (n = 0, jiffy = pc->lastjiffy;
+	     n < XNTIMER_WHEELSIZE && jiffy != base->jiffies; n++)
+		xntimer_expire_slot(slave, sched, ++jiffy);
+
+	pc->lastjiffy = base->jiffies;
+
+	xnsched_tick(sched->curr, base); /* Do time-slicing if required. */
+
+	xntslave_program(slave, xnsched_cpu(sched));
+}
+
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
+void xntimer_tick_periodic_inner(xntslave_t *slave)
+{
+	xnsched_t *sched = xnpod_current_sched();
+	xntbase_t *base = &slave->base;
+
+	/*
+	 * Update the periodic clocks keeping the things strictly
+	 * monotonous (this routine is run on every cpu, but only CPU
+	 * XNTIMER_KEEPER_ID should do this).
+	 */
+	if (sched == xnpod_sched_slot(XNTIMER_KEEPER_ID))
+		++base->jiffies;
+
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+	if (base->hook == NULL) {
+		xntslave_tick(slave);
+		return;
+	}
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
+	xntimer_expire_slot(slave, sched, base->jiffies);
 
 	xnsched_tick(sched->curr, base); /* Do time-slicing if required. */
 }
@@ -613,13 +776,17 @@ void xntimer_tick_periodic(xntimer_t *mtimer)
 	if (unlikely(base->hook != NULL))
 		base->hook();
 	else
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+		xntslave_tick(slave);
+#else /* !CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 		xntimer_tick_periodic_inner(slave);
+#endif /* !CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 }
 
 static void
 xntimer_adjust_periodic(xntimer_t *timer, xnsticks_t delta)
 {
-	xnticks_t now = timer->base->jiffies;
+	xnticks_t now = xntbase_get_jiffies(timer->base);
 	xnsticks_t diff;
 	xntlholder_date(&timer->plink) -= delta;
 	diff = now - xntlholder_date(&timer->plink);
@@ -682,6 +849,11 @@ void xntslave_init(xntslave_t *slave)
 		xntimer_set_name(&pc->timer, slave->base.name);
 		xntimer_set_priority(&pc->timer, XNTIMER_HIPRIO);
 		xntimer_set_sched(&pc->timer, xnpod_sched_slot(cpu));
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+		pc->lastjiffy = 0;
+		pc->nextjiffy = 0;
+		pc->armed = 0;
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 	}
 }
 
@@ -720,6 +892,11 @@ void xntslave_update(xntslave_t *slave, xnticks_t interval)
 		struct percpu_cascade *pc = &slave->cascade[cpu];
 		xntimer_interval(&pc->timer) = interval;
 	}
+
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+	/* Pending shots were computed from the former period. */
+	xntslave_rearm(slave);
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 }
 
 void xntslave_start(xntslave_t *slave, xnticks_t start, xnticks_t interval)
@@ -729,6 +906,14 @@ void xntslave_start(xntslave_t *slave, xnticks_t start, xnticks_t interval)
 
 	trace_mark(xn_nucleus, tbase_start, "base %s", slave->base.name);
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+	xnlock_get_irqsave(&nklock, s);
+	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++)
+		slave->cascade[cpu].lastjiffy = slave->base.jiffies;
+	/* The first tick date was set by xntbase_start(). */
+	xntslave_rearm(slave);
+	xnlock_put_irqrestore(&nklock, s);
+#else /* !CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++) {
 
 		struct percpu_cascade *pc = &slave->cascade[cpu];
@@ -739,6 +924,7 @@ void xntslave_start(xntslave_t *slave, xnticks_t start, xnticks_t interval)
 			      interval, XN_ABSOLUTE);
 		xnlock_put_irqrestore(&nklock, s);
 	}
+#endif /* !CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 }
 
 void xntslave_stop(xntslave_t *slave)
@@ -753,10 +939,50 @@ void xntslave_stop(xntslave_t *slave)
 		struct percpu_cascade *pc = &slave->cascade[cpu];
 		xnlock_get_irqsave(&nklock, s);
 		xntimer_stop(&pc->timer);
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+		pc->armed = 0;
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
 		xnlock_put_irqrestore(&nklock, s);
 	}
 }
 
+#ifdef CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS
+
+/*
+ * Reprogram the cascading timers of a running time base after its
+ * clocking requirements changed, i.e. a hook was installed or
+ * removed, the period was updated, or time-slicing started. nklock
+ * must be held.
+ */
+void xntslave_rearm(xntslave_t *slave)
+{
+	xntbase_t *base = &slave->base;
+	int nr_cpus, cpu;
+
+	if (!xntbase_enabled_p(base))
+		return;
+
+	for (cpu = 0, nr_cpus = xnarch_num_online_cpus(); cpu < nr_cpus; cpu++) {
+
+		struct percpu_cascade *pc = &slave->cascade[cpu];
+
+		if (base->hook == NULL) {
+			xntimer_stop(&pc->timer);
+			pc->armed = 0;
+			xntslave_program(slave, cpu);
+			continue;
+		}
+
+		/* Hooks are called on every tick, as in periodic mode. */
+		pc->armed = 1;
+		xntimer_start(&pc->timer, xnarch_get_cpu_time() +
+			      base->tickvalue + cpu * nklatency,
+			      base->tickvalue, XN_ABSOLUTE);
+	}
+}
+
+#endif /* CONFIG_XENO_OPT_TIMING_PERIODIC_TICKLESS */
+
 void xntslave_adjust(xntslave_t *slave, xnsticks_t delta)
 {
 	int nr_cpus, cpu, n;
@@ -856,6 +1082,8 @@ void __xntimer_init(xntimer_t *timer, xntbase_t *base,
 	timer->status = XNTIMER_DEQUEUED;
 	timer->handler = handler;
 	timer->interval = 0;
+	timer->slack = 0;
+	timer->slackgrid = 1;
 	timer->sched = xnpod_current_sched();
 
 #ifdef CONFIG_XENO_OPT_STATS
@@ -993,6 +1221,59 @@ EXPORT_SYMBOL_GPL(xntimer_migrate);
 
 #endif /* CONFIG_SMP */
 
+/**
+ * @fn void xntimer_set_slack(xntimer_t *timer, xnticks_t slack)
+ * @brief Set the expiry slack of a timer.
+ *
+ * Allow a timer to elapse up to @a slack nanoseconds past its
+ * programmed date, so that the nucleus may fire it from the same
+ * shot as other timers with nearby dates, instead of programming a
+ * separate one. This is meant for low-importance timers; timing
+ * critical ones should keep a zero slack, which is the default.
+ *
+ * The timer is moved to the earliest date of any timer already
+ * queued on the same CPU within the slack window, or else aligned on
+ * a power-of-two grid no coarser than the slack, so that timers with
+ * a similar slack tend to share dates. Since finding a peer walks the
+ * timer queue, slack should only be granted to a few timers.
+ *
+ * The slack applies from the next call to xntimer_start(). For
+ * periodic timers, only the first release point is shifted, later
+ * ones follow at the regular interval from there. Timers bound to a
+ * periodic time base ignore the slack, since they already elapse on
+ * tick boundaries.
+ *
+ * @param timer The address of a valid timer descriptor.
+ *
+ * @param slack The tolerated delay, in nanoseconds. Zero disables
+ * coalescing.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+void xntimer_set_slack(xntimer_t *timer, xnticks_t slack)
+{
+	xnticks_t grid = 1;
+
+	slack = xnarch_ns_to_tsc(slack);
+
+	/* Coalesce on the largest power of two not above the slack. */
+	while (grid <= slack / 2)
+		grid <<= 1;
+
+	timer->slack = slack;
+	timer->slackgrid = grid;
+}
+EXPORT_SYMBOL_GPL(xntimer_set_slack);
+
 /**
  * Get the count of overruns for the last tick.
  *
@@ -52,7 +52,9 @@
  * collection phase is not strictly atomic as a whole, but only
  * protected at record level. The vfile implementation can be notified
  * of updates to the underlying data set, and restart the collection
- * from scratch until the snapshot is fully consistent.
+ * from scratch until the snapshot is fully consistent. Alternatively,
+ * vfiles scanning a queue through a snapshot cursor are collected
+ * incrementally, in which case updates never restart the collection.
  *
  * - regular sequential file (struct xnvfile_regular). This is
  * basically an encapsulated sequential file object as available from
@@ -144,12 +146,71 @@ static void vfile_snapshot_free(struct xnvfile_snapshot_iterator *it, void *buf)
 	kfree(buf);
 }
 
+/* Incremental snapshot buffers grow by this number of records. */
+#define VFILE_SNAPSHOT_CHUNK  64
+
+/**
+ * @fn void xnvfile_cursor_rewind(struct xnvfile_snapshot_iterator *it, struct xnqueue *q)
+ * @brief Start an incremental scan of a queue.
+ *
+ * This service moves the cursor of a snapshot iterator to the head
+ * of @a q, registering it with the revision tag of the vfile if not
+ * already done. It is meant to be called from the @ref
+ * snapshot_rewind "rewind() handler", the @ref snapshot_next "next()
+ * handler" then fetching the elements to collect with
+ * xnvfile_cursor_next(). Code removing elements from @a q must use
+ * xnvfile_touch_remove() on the same tag instead of
+ * xnvfile_touch_tag().
+ *
+ * @param it A pointer to the current snapshot iterator.
+ *
+ * @param q The queue to scan.
+ *
+ * @note The nucleus lock must be held.
+ */
+void xnvfile_cursor_rewind(struct xnvfile_snapshot_iterator *it,
+			   struct xnqueue *q)
+{
+	struct xnvfile_rev_tag *tag = it->vfile->tag;
+	struct xnvfile_cursor *c = &it->cursor;
+
+	if (c->q == NULL) {
+		c->next = tag->cursors;
+		tag->cursors = c;
+	}
+
+	c->q = q;
+	c->curr = getheadq(q);
+}
+EXPORT_SYMBOL_GPL(xnvfile_cursor_rewind);
+
+static void vfile_cursor_release(struct xnvfile_snapshot_iterator *it)
+{
+	struct xnvfile_cursor *c = &it->cursor, **cp;
+	spl_t s;
+
+	if (c->q == NULL)
+		return;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (cp = &it->vfile->tag->cursors; *cp; cp = &(*cp)->next)
+		if (*cp == c) {
+			*cp = c->next;
+			break;
+		}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	c->q = NULL;
+}
+
 static int vfile_snapshot_open(struct inode *inode, struct file *file)
 {
 	struct xnvfile_snapshot *vfile = PDE_DATA(inode);
 	struct xnvfile_snapshot_ops *ops = vfile->ops;
 	struct xnvfile_snapshot_iterator *it;
-	int revtag, ret, nrdata;
+	int revtag, ret, nrdata, nrmax;
 	struct seq_file *seq;
 	caddr_t data;
 
@@ -234,6 +295,7 @@ redo:
 		XENO_BUGON(NUCLEUS, ops->end == NULL);
 		data = ops->begin(it);
 		if (data == NULL) {
+			vfile_cursor_release(it);
 			kfree(it);
 			return -ENOMEM;
 		}
@@ -245,6 +307,7 @@ redo:
 		/* We have a hint for auto-allocation. */
 		data = kmalloc(vfile->datasz * nrdata, GFP_KERNEL);
 		if (data == NULL) {
+			vfile_cursor_release(it);
 			kfree(it);
 			return -ENOMEM;
 		}
@@ -261,17 +324,36 @@ redo:
 	if (data == NULL)
 		goto finish;
 
+	nrmax = nrdata;
+
 	/*
 	 * Take a snapshot of the vfile contents, redo if the revision
-	 * tag of the scanned data set changed concurrently.
+	 * tag of the scanned data set changed concurrently, unless
+	 * we are scanning it incrementally, or ->next() asked for it.
 	 */
 	for (;;) {
+		/* Internal buffers grow as the scanned queue does. */
+		if (it->cursor.q && ops->begin == NULL && it->nrdata == nrmax) {
+			data = kmalloc(vfile->datasz *
+				       (nrmax + VFILE_SNAPSHOT_CHUNK), GFP_KERNEL);
+			if (data == NULL) {
+				ret = -ENOMEM;
+				break;
+			}
+			memcpy(data, it->databuf, vfile->datasz * nrmax);
+			kfree(it->databuf);
+			it->databuf = data;
+			data += vfile->datasz * nrmax;
+			nrmax += VFILE_SNAPSHOT_CHUNK;
+		}
 		ret = vfile->entry.lockops->get(&vfile->entry);
 		if (ret)
 			break;
-		if (vfile->tag->rev != revtag)
+		if (vfile->tag->rev != revtag && it->cursor.q == NULL)
 			goto redo;
 		ret = ops->next(it, data);
+		if (ret == -EAGAIN)
+			goto redo;
 		vfile->entry.lockops->put(&vfile->entry);
 		if (ret <= 0)
 			break;
@@ -284,6 +366,7 @@ redo:
 	if (ret < 0) {
 		seq_release(inode, file);
 	fail:
+		vfile_cursor_release(it);
 		if (it->databuf)
 			it->endfn(it, it->databuf);
 		kfree(it);
@@ -291,6 +374,7 @@ redo:
 	}
 
 finish:
+	vfile_cursor_release(it);
 	seq = file->private_data;
 	it->seq = seq;
 	seq->private = it;
@@ -470,6 +470,73 @@ int rt_alarm_stop(RT_ALARM *alarm)
 	return err;
 }
 
+/**
+ * @fn int rt_alarm_set_slack(RT_ALARM *alarm, RTIME slack)
+ * @brief Set the expiry slack of an alarm.
+ *
+ * Allow an alarm to trigger up to @a slack clock ticks past its
+ * programmed dates, so that the nucleus may fire it along with other
+ * timers elapsing nearby, instead of programming a separate hardware
+ * shot for it. This is meant for low-importance alarms; timing
+ * critical ones should keep the default null slack.
+ *
+ * The slack applies from the next call to rt_alarm_start(). For
+ * periodic alarms, only the first shot is shifted, subsequent ones
+ * follow at the regular interval from there.
+ *
+ * @param alarm The descriptor address of the affected alarm.
+ *
+ * @param slack The tolerated delay, expressed in clock ticks (see
+ * note). A null value disables coalescing.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a alarm is not a alarm descriptor.
+ *
+ * - -EIDRM is returned if @a alarm is a deleted alarm descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ *
+ * @note The @a slack value will be interpreted as jiffies if the
+ * native skin is bound to a periodic time base (see
+ * CONFIG_XENO_OPT_NATIVE_PERIOD), or nanoseconds otherwise. Alarms
+ * bound to a periodic time base always elapse on tick boundaries, so
+ * the slack has no effect on them.
+ */
+
+int rt_alarm_set_slack(RT_ALARM *alarm, RTIME slack)
+{
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	alarm = xeno_h2obj_validate(alarm, XENO_ALARM_MAGIC, RT_ALARM);
+
+	if (!alarm) {
+		err = xeno_handle_error(alarm, XENO_ALARM_MAGIC, RT_ALARM);
+		goto unlock_and_exit;
+	}
+
+	xntimer_set_slack(&alarm->timer_base,
+			  xntbase_ticks2ns(__native_tbase, slack));
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
 /**
  * @fn int rt_alarm_inquire(RT_ALARM *alarm, RT_ALARM_INFO *info)
  * @brief Inquire about an alarm.
@@ -625,4 +692,5 @@ EXPORT_SYMBOL_GPL(rt_alarm_create);
 EXPORT_SYMBOL_GPL(rt_alarm_delete);
 EXPORT_SYMBOL_GPL(rt_alarm_start);
 EXPORT_SYMBOL_GPL(rt_alarm_stop);
+EXPORT_SYMBOL_GPL(rt_alarm_set_slack);
 EXPORT_SYMBOL_GPL(rt_alarm_inquire);
@@ -184,7 +184,7 @@ int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global)
 #ifdef CONFIG_XENO_FASTSYNCH
 	/* Allocate lock memory for in-kernel use */
 	fastlock = xnheap_alloc(&xnsys_ppd_get(global)->sem_heap,
-				sizeof(*fastlock));
+				sizeof(struct xnsynch_fastmutex));
 
 	if (!fastlock)
 		return -ENOMEM;
@@ -194,6 +194,9 @@ int rt_mutex_create_inner(RT_MUTEX *mutex, const char *name, int global)
 #endif /* CONFIG_XENO_FASTSYNCH */
 
 	xnsynch_init(&mutex->synch_base, flags, fastlock);
+#ifdef CONFIG_XENO_FASTSYNCH
+	xnsynch_init_fastmutex((struct xnsynch_fastmutex *)fastlock, 0, !global);
+#endif /* CONFIG_XENO_FASTSYNCH */
 	mutex->handle = 0;	/* i.e. (still) unregistered mutex. */
 	mutex->magic = XENO_MUTEX_MAGIC;
 	mutex->lockcnt = 0;
@@ -640,6 +643,7 @@ int rt_mutex_release(RT_MUTEX *mutex)
 int rt_mutex_inquire(RT_MUTEX *mutex, RT_MUTEX_INFO *info)
 {
 #ifdef CONFIG_XENO_FASTSYNCH
+	struct xnsynch_fastmutex *fm;
 	xnhandle_t lock_state;
 #endif /* CONFIG_XENO_FASTSYNCH */
 	xnthread_t *owner;
@@ -659,8 +663,13 @@ int rt_mutex_inquire(RT_MUTEX *mutex, RT_MUTEX_INFO *info)
 	info->nwaiters = xnsynch_nsleepers(&mutex->synch_base);
 
 #ifndef CONFIG_XENO_FASTSYNCH
+	info->contended = info->spun = info->slow = 0;
 	owner = xnsynch_owner(&mutex->synch_base);
 #else /* CONFIG_XENO_FASTSYNCH */
+	fm = (struct xnsynch_fastmutex *)mutex->synch_base.fastlock;
+	info->contended = xnarch_atomic_get(&fm->stats.contended);
+	info->spun = xnarch_atomic_get(&fm->stats.spun);
+	info->slow = xnarch_atomic_get(&fm->stats.slow);
 	lock_state = xnarch_atomic_get(mutex->synch_base.fastlock);
 	info->locked = (lock_state != XN_NO_HANDLE);
 	owner = (info->locked) ?
@@ -681,6 +690,69 @@ int rt_mutex_inquire(RT_MUTEX *mutex, RT_MUTEX_INFO *info)
 	return err;
 }
 
+/**
+ * @fn int rt_mutex_set_adaptive(RT_MUTEX *mutex, int adaptive)
+ *
+ * @brief Set the adaptive mode of a mutex.
+ *
+ * When a user-space task finds an adaptive mutex locked by a task
+ * running in primary mode on another CPU, it spins for a short while
+ * (see CONFIG_XENO_OPT_SYNCH_SPIN), waiting for the owner to release
+ * the mutex, before sleeping in the kernel. This saves two context
+ * switches when critical sections are short. Only anonymous mutexes
+ * may spin, on SMP systems; otherwise this mode has no effect.
+ *
+ * The outcome of contended acquisitions is accounted for, and may be
+ * retrieved by a call to rt_mutex_inquire().
+ *
+ * @param mutex The descriptor address of the affected mutex.
+ *
+ * @param adaptive Non-zero to enable spinning upon contention, zero
+ * to disable it.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EINVAL is returned if @a mutex is not a mutex descriptor.
+ *
+ * - -EIDRM is returned if @a mutex is a deleted mutex descriptor.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task
+ *
+ * Rescheduling: never.
+ */
+
+int rt_mutex_set_adaptive(RT_MUTEX *mutex, int adaptive)
+{
+	int err = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	mutex = xeno_h2obj_validate(mutex, XENO_MUTEX_MAGIC, RT_MUTEX);
+
+	if (!mutex) {
+		err = xeno_handle_error(mutex, XENO_MUTEX_MAGIC, RT_MUTEX);
+		goto unlock_and_exit;
+	}
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	((struct xnsynch_fastmutex *)mutex->synch_base.fastlock)->adaptive =
+		!!adaptive;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+      unlock_and_exit:
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
 /**
  * @fn int rt_mutex_bind(RT_MUTEX *mutex,const char *name,RTIME timeout)
  *
@@ -773,3 +845,4 @@ EXPORT_SYMBOL_GPL(rt_mutex_acquire);
 EXPORT_SYMBOL_GPL(rt_mutex_acquire_until);
 EXPORT_SYMBOL_GPL(rt_mutex_release);
 EXPORT_SYMBOL_GPL(rt_mutex_inquire);
+EXPORT_SYMBOL_GPL(rt_mutex_set_adaptive);
@@ -231,6 +231,18 @@ void __native_pipe_pkg_cleanup(void)
  * pipe. Passing 0 means that all message allocations for this pipe are
  * performed on the system heap.
  *
+ * For high output rates, the Linux side may attach a shared ring to
+ * the special device using the XNPIPEIOC_RING ioctl, passing its size
+ * (a power of two, at least one page), then map it with mmap(2). The
+ * ring starts with a control block (struct xnpipe_ring) followed by
+ * the data area, where rt_pipe_write() and rt_pipe_stream() copy the
+ * output as a sequence of records (struct xnpipe_rec). The reader
+ * consumes them in place, then advances the tail index; poll(2) and
+ * the XNPIPEIOC_SETWM ioctl allow it to sleep until a given amount of
+ * data is available. Alternatively, the XNPIPEIOC_BATCH ioctl has
+ * read(2) return as many messages as the user buffer can hold, using
+ * the same record format.
+ *
  * @return 0 is returned upon success. Otherwise:
  *
  * - -ENOMEM is returned if the system fails to get enough dynamic
@@ -734,6 +746,7 @@ ssize_t rt_pipe_read(RT_PIPE *pipe, void *buf, size_t size, RTIME timeout)
 ssize_t rt_pipe_send(RT_PIPE *pipe, RT_PIPE_MSG *msg, size_t size, int mode)
 {
 	ssize_t n = 0;
+	int minor;
 	spl_t s;
 
 	xnlock_get_irqsave(&nklock, s);
@@ -742,19 +755,55 @@ ssize_t rt_pipe_send(RT_PIPE *pipe, RT_PIPE_MSG *msg, size_t size, int mode)
 
 	if (!pipe) {
 		n = xeno_handle_error(pipe, XENO_PIPE_MAGIC, RT_PIPE);
-		goto unlock_and_exit;
+		xnlock_put_irqrestore(&nklock, s);
+		return n;
 	}
 
+	minor = pipe->minor;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	/*
+	 * xnpipe_send() checks the connection state by itself, and
+	 * may copy the message to a shared ring, which it does
+	 * without holding the nklock: don't hold it across the call.
+	 */
 	if (size > 0)
 		/* We need to add the size of the message header here. */
-		n = xnpipe_send(pipe->minor, msg, size + sizeof(RT_PIPE_MSG),
-				mode);
+		n = xnpipe_send(minor, msg, size + sizeof(RT_PIPE_MSG), mode);
 
-      unlock_and_exit:
+	return n <= 0 ? n : n - sizeof(RT_PIPE_MSG);
+}
+
+static ssize_t __pipe_write_ring(RT_PIPE *pipe, const void *buf, size_t size)
+{
+	ssize_t ret;
+	void *data;
+	int minor;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	pipe = xeno_h2obj_validate(pipe, XENO_PIPE_MAGIC, RT_PIPE);
+	if (!pipe) {
+		ret = xeno_handle_error(pipe, XENO_PIPE_MAGIC, RT_PIPE);
+		xnlock_put_irqrestore(&nklock, s);
+		return ret;
+	}
+
+	minor = pipe->minor;
+	ret = xnpipe_ring_reserve(minor, size, &data);
 
 	xnlock_put_irqrestore(&nklock, s);
 
-	return n <= 0 ? n : n - sizeof(RT_PIPE_MSG);
+	if (ret < 0)
+		return ret;
+
+	/* Copy to the shared ring without holding the nklock. */
+	memcpy(data, buf, size);
+	xnpipe_ring_commit(minor, data, 0);
+
+	return ret;
 }
 
  /**
@@ -816,6 +865,11 @@ ssize_t rt_pipe_send(RT_PIPE *pipe, RT_PIPE_MSG *msg, size_t size, int mode)
  * associated special device is allowed. The output will be buffered
  * until then, only restricted by the available memory in the relevant
  * buffer pool (see rt_pipe_create()).
+ *
+ * @note When the Linux side has attached a shared ring to the pipe,
+ * the data is copied straight to it; in this mode, P_URGENT is
+ * ignored, messages larger than half the ring are rejected with
+ * -EINVAL, and -ENOMEM is returned when the ring is full.
  */
 
 ssize_t rt_pipe_write(RT_PIPE *pipe, const void *buf, size_t size, int mode)
@@ -826,6 +880,10 @@ ssize_t rt_pipe_write(RT_PIPE *pipe, const void *buf, size_t size, int mode)
 	if (size == 0)
 		return 0;
 
+	nbytes = __pipe_write_ring(pipe, buf, size);
+	if (nbytes != -ENXIO)
+		return nbytes;
+
 	msg = rt_pipe_alloc(pipe, size);
 
 	if (!msg)
@@ -895,6 +953,10 @@ ssize_t rt_pipe_write(RT_PIPE *pipe, const void *buf, size_t size, int mode)
  * associated special device is allowed. The output will be buffered
  * until then, only restricted by the available memory in the relevant
  * buffer pool (see rt_pipe_create()).
+ *
+ * @note When the Linux side has attached a shared ring to the pipe,
+ * the data is copied straight to it as a single record, bypassing
+ * the streaming buffer, which is then not required.
  */
 
 ssize_t rt_pipe_stream(RT_PIPE *pipe, const void *buf, size_t size)
@@ -903,6 +965,12 @@ ssize_t rt_pipe_stream(RT_PIPE *pipe, const void *buf, size_t size)
  	size_t fillptr;
 	spl_t s;
 
+	if (size > 0) {
+		outbytes = __pipe_write_ring(pipe, buf, size);
+		if (outbytes != -ENXIO)
+			return outbytes;
+	}
+
 #if CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ <= 0
 	return -ENOSYS;
 #else /* CONFIG_XENO_OPT_NATIVE_PIPE_BUFSZ > 0 */
@@ -898,11 +898,112 @@ out:
 	return err;
 }
 
+/*
+ * int __rt_task_reply_receive(int flowid,
+ *                             RT_TASK_MCB *mcb_s,
+ *                             RT_TASK_MCB *mcb_r,
+ *                             RTIME *timeoutp)
+ */
+
+static int __rt_task_reply_receive(struct pt_regs *regs)
+{
+	char tmp_buf_s[RT_MCB_FSTORE_LIMIT], tmp_buf_r[RT_MCB_FSTORE_LIMIT];
+	caddr_t tmp_area_s = NULL, tmp_area_r = NULL, data_r;
+	RT_TASK_MCB mcb_s, mcb_r;
+	RTIME timeout;
+	int flowid, err;
+
+	flowid = __xn_reg_arg1(regs);
+
+	if (__xn_reg_arg2(regs)) {
+		if (__xn_safe_copy_from_user(&mcb_s,
+					     (void __user *)__xn_reg_arg2(regs),
+					     sizeof(mcb_s)))
+			return -EFAULT;
+	} else {
+		mcb_s.data = NULL;
+		mcb_s.size = 0;
+		mcb_s.opcode = 0;
+	}
+
+	if (__xn_safe_copy_from_user(&mcb_r, (void __user *)__xn_reg_arg3(regs),
+				     sizeof(mcb_r)))
+		return -EFAULT;
+
+	if (__xn_safe_copy_from_user(&timeout, (void __user *)__xn_reg_arg4(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	/* Same optimization as in __rt_task_send(), for both messages. */
+
+	if (mcb_s.size > 0) {
+		if (mcb_s.size <= sizeof(tmp_buf_s))
+			tmp_area_s = tmp_buf_s;
+		else {
+			tmp_area_s = xnmalloc(mcb_s.size);
+
+			if (!tmp_area_s)
+				return -ENOMEM;
+		}
+
+		if (__xn_safe_copy_from_user(tmp_area_s,
+					     (void __user *)mcb_s.data,
+					     mcb_s.size)) {
+			err = -EFAULT;
+			goto out;
+		}
+
+		mcb_s.data = tmp_area_s;
+	}
+
+	data_r = mcb_r.data;
+
+	if (mcb_r.size > 0) {
+		if (mcb_r.size <= sizeof(tmp_buf_r))
+			tmp_area_r = tmp_buf_r;
+		else {
+			tmp_area_r = xnmalloc(mcb_r.size);
+
+			if (!tmp_area_r) {
+				err = -ENOMEM;
+				goto out;
+			}
+		}
+
+		mcb_r.data = tmp_area_r;
+	}
+
+	err = rt_task_reply_receive(flowid, &mcb_s, &mcb_r, timeout);
+
+	if (err > 0 && mcb_r.size > 0) {
+		if (__xn_safe_copy_to_user((void __user *)data_r, mcb_r.data,
+					   mcb_r.size)) {
+			err = -EFAULT;
+			goto out;
+		}
+	}
+
+	mcb_r.data = data_r;
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg3(regs), &mcb_r,
+				   sizeof(mcb_r)))
+		err = -EFAULT;
+
+out:
+	if (tmp_area_s && tmp_area_s != tmp_buf_s)
+		xnfree(tmp_area_s);
+	if (tmp_area_r && tmp_area_r != tmp_buf_r)
+		xnfree(tmp_area_r);
+
+	return err;
+}
+
 #else /* !CONFIG_XENO_OPT_NATIVE_MPS */
 
 #define __rt_task_send     __rt_call_not_available
 #define __rt_task_receive  __rt_call_not_available
 #define __rt_task_reply    __rt_call_not_available
+#define __rt_task_reply_receive __rt_call_not_available
 
 #endif /* CONFIG_XENO_OPT_NATIVE_MPS */
 
@@ -2952,6 +3053,33 @@ static int __rt_alarm_stop(struct pt_regs *regs)
 	return rt_alarm_stop(alarm);
 }
 
+/*
+ * int __rt_alarm_set_slack(RT_ALARM_PLACEHOLDER *ph,
+ *			    RTIME slack)
+ */
+
+static int __rt_alarm_set_slack(struct pt_regs *regs)
+{
+	RT_ALARM_PLACEHOLDER ph;
+	RT_ALARM *alarm;
+	RTIME slack;
+
+	if (__xn_safe_copy_from_user(&ph, (void __user *)__xn_reg_arg1(regs),
+				     sizeof(ph)))
+		return -EFAULT;
+
+	alarm = (RT_ALARM *)xnregistry_fetch(ph.opaque);
+
+	if (!alarm)
+		return -ESRCH;
+
+	if (__xn_safe_copy_from_user(&slack, (void __user *)__xn_reg_arg2(regs),
+				     sizeof(slack)))
+		return -EFAULT;
+
+	return rt_alarm_set_slack(alarm, slack);
+}
+
 /*
  * int __rt_alarm_wait(RT_ALARM_PLACEHOLDER *ph)
  */
@@ -3039,6 +3167,7 @@ static int __rt_alarm_inquire(struct pt_regs *regs)
 #define __rt_alarm_delete     __rt_call_not_available
 #define __rt_alarm_start      __rt_call_not_available
 #define __rt_alarm_stop       __rt_call_not_available
+#define __rt_alarm_set_slack  __rt_call_not_available
 #define __rt_alarm_wait       __rt_call_not_available
 #define __rt_alarm_inquire    __rt_call_not_available
 
@@ -3485,6 +3614,46 @@ static int __rt_pipe_read(struct pt_regs *regs)
  *                     int mode)
  */
 
+/*
+ * Copy the user data straight to the ring shared with the Linux side
+ * of the pipe, if any. Returns -ENXIO when no ring is attached, in
+ * which case the caller should send a regular message.
+ */
+static ssize_t __rt_pipe_write_ring(RT_PIPE *pipe,
+				    void __user *u_buf, size_t size)
+{
+	ssize_t ret;
+	void *data;
+	int minor;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	pipe = xeno_h2obj_validate(pipe, XENO_PIPE_MAGIC, RT_PIPE);
+	if (!pipe) {
+		/* Let the regular path report the error. */
+		xnlock_put_irqrestore(&nklock, s);
+		return -ENXIO;
+	}
+
+	minor = pipe->minor;
+	ret = xnpipe_ring_reserve(minor, size, &data);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (ret < 0)
+		return ret;
+
+	if (__xn_safe_copy_from_user(data, u_buf, size)) {
+		xnpipe_ring_commit(minor, data, 1);
+		return -EFAULT;
+	}
+
+	xnpipe_ring_commit(minor, data, 0);
+
+	return ret;
+}
+
 static int __rt_pipe_write(struct pt_regs *regs)
 {
 	RT_PIPE_PLACEHOLDER ph;
@@ -3510,6 +3679,11 @@ static int __rt_pipe_write(struct pt_regs *regs)
 		/* Try flushing the streaming buffer in any case. */
 		return rt_pipe_send(pipe, NULL, 0, mode);
 
+	err = __rt_pipe_write_ring(pipe, (void __user *)__xn_reg_arg2(regs),
+				   size);
+	if (err != -ENXIO)
+		return err;
+
 	msg = rt_pipe_alloc(pipe, size);
 
 	if (!msg)
@@ -3562,6 +3736,11 @@ static int __rt_pipe_stream(struct pt_regs *regs)
 		/* Try flushing the streaming buffer in any case. */
 		return rt_pipe_stream(pipe, NULL, 0);
 
+	err = __rt_pipe_write_ring(pipe, (void __user *)__xn_reg_arg2(regs),
+				   size);
+	if (err != -ENXIO)
+		return err;
+
 	/* Try using a local fast buffer if the sent data fits into it. */
 
 	if (size <= sizeof(tmp_buf)) {
@@ -4170,6 +4349,9 @@ static xnsysent_t __systab[] = {
 	[__native_buffer_write] = {&__rt_buffer_write, __xn_exec_conforming},
 	[__native_buffer_clear] = {&__rt_buffer_clear, __xn_exec_any},
 	[__native_buffer_inquire] = {&__rt_buffer_inquire, __xn_exec_any},
+	[__native_alarm_set_slack] = {&__rt_alarm_set_slack, __xn_exec_any},
+	[__native_task_reply_receive] =
+	    {&__rt_task_reply_receive, __xn_exec_primary},
 };
 
 static struct xnskin_props __props = {
@@ -823,6 +823,11 @@ int rt_task_set_periodic(RT_TASK *task, RTIME idate, RTIME period)
  * which cannot sleep (e.g. interrupt, non-realtime or scheduler
  * locked).
  *
+ * When statistics collection is enabled in the nucleus, the release
+ * latency and missed release points are accounted on each call. These
+ * statistics are reset by rt_task_set_periodic(), and returned in the
+ * relstat field of the RT_TASK_INFO structure by rt_task_inquire().
+ *
  * Environments:
  *
  * This service can be called from:
@@ -1199,6 +1204,7 @@ int rt_task_inquire(RT_TASK *task, RT_TASK_INFO *info)
 	info->modeswitches = xnstat_counter_get(&task->thread_base.stat.ssw);
 	info->ctxswitches = xnstat_counter_get(&task->thread_base.stat.csw);
 	info->pagefaults = xnstat_counter_get(&task->thread_base.stat.pf);
+	xnthread_get_relstat(&task->thread_base, &info->relstat);
 
       unlock_and_exit:
 
@@ -1886,6 +1892,74 @@ ssize_t rt_task_send(RT_TASK *task,
 	return err;
 }
 
+static int rt_task_receive_inner(RT_TASK *server,
+				 RT_TASK_MCB *mcb_r, RTIME timeout)
+{
+	RT_TASK *client;
+	xnpholder_t *holder;
+	xnflags_t info;
+	size_t rsize;
+
+	/* Fetch the first available message, but don't wake up the
+	   client until our caller invokes rt_task_reply(). IOW,
+	   rt_task_receive() will fetch back the exact same message
+	   until rt_task_reply() is called to release the client. */
+	holder = getheadpq(xnsynch_wait_queue(&server->msendq));
+
+	if (holder)
+		goto pull_message;
+
+	if (timeout == TM_NONBLOCK)
+		return -EWOULDBLOCK;
+
+	if (xnpod_unblockable_p())
+		return -EPERM;
+
+	/*
+	 * We loop to care for spurious wakeups, in case the
+	 * client times out before we unblock.
+	 */
+	do {
+		/*
+		 * Wait on our receive slot for some client to enqueue
+		 * itself in our send queue.
+		 */
+		info = xnsynch_sleep_on(&server->mrecv, timeout, XN_RELATIVE);
+		/*
+		 * XNRMID cannot happen, since well, the current task
+		 * would be the deleted object, so...
+		 */
+		if (info & XNTIMEO)
+			return -ETIMEDOUT;	/* Timeout. */
+		if (info & XNBREAK)
+			return -EINTR;	/* Unblocked. */
+	} while (!xnsynch_pended_p(&server->msendq));
+
+	holder = getheadpq(xnsynch_wait_queue(&server->msendq));
+	/* There must be a valid holder since we waited for it. */
+
+      pull_message:
+
+	client = thread2rtask(link2thread(holder, plink));
+
+	rsize = client->wait_args.mps.mcb_s.size;
+
+	mcb_r->opcode = client->wait_args.mps.mcb_s.opcode;
+
+	if (rsize > mcb_r->size) {
+		mcb_r->size = rsize;
+		return -ENOBUFS;
+	}
+
+	if (rsize > 0)
+		memcpy(mcb_r->data, client->wait_args.mps.mcb_s.data, rsize);
+
+	mcb_r->size = rsize;
+
+	/* The flow identifier can't be either null or negative. */
+	return client->wait_args.mps.mcb_s.flowid;
+}
+
 /**
  * @fn int rt_task_receive(RT_TASK_MCB *mcb_r,RTIME timeout)
  * @brief Receive a message from a task.
@@ -1966,88 +2040,76 @@ ssize_t rt_task_send(RT_TASK *task,
 
 int rt_task_receive(RT_TASK_MCB *mcb_r, RTIME timeout)
 {
-	RT_TASK *server, *client;
-	xnpholder_t *holder;
-	xnflags_t info;
-	size_t rsize;
 	int err;
 	spl_t s;
 
 	if (!xnpod_primary_p())
 		return -EPERM;
 
-	server = xeno_current_task();
-
 	xnlock_get_irqsave(&nklock, s);
+	err = rt_task_receive_inner(xeno_current_task(), mcb_r, timeout);
+	xnlock_put_irqrestore(&nklock, s);
 
-	/* Fetch the first available message, but don't wake up the
-	   client until our caller invokes rt_task_reply(). IOW,
-	   rt_task_receive() will fetch back the exact same message
-	   until rt_task_reply() is called to release the client. */
-	holder = getheadpq(xnsynch_wait_queue(&server->msendq));
+	return err;
+}
 
-	if (holder)
-		goto pull_message;
+static int rt_task_reply_inner(RT_TASK *server, int flowid,
+			       RT_TASK_MCB *mcb_s, RT_TASK **clientp)
+{
+	RT_TASK *client;
+	xnpholder_t *holder;
+	size_t rsize;
+	int err;
 
-	if (timeout == TM_NONBLOCK) {
-		err = -EWOULDBLOCK;
-		goto unlock_and_exit;
-	}
+	for (holder = getheadpq(xnsynch_wait_queue(&server->msendq)),
+		     client = NULL; holder != NULL;
+	     holder = nextpq(xnsynch_wait_queue(&server->msendq), holder)) {
+		client = thread2rtask(link2thread(holder, plink));
 
-	if (xnpod_unblockable_p()) {
-		err = -EPERM;
-		goto unlock_and_exit;
-	}
+		/* Check the flow identifier, just in case the client
+		   has vanished away while we were processing its last
+		   message. Each sent message carries a distinct flow
+		   identifier from other clients wrt to a given
+		   server. */
 
-	/*
-	 * We loop to care for spurious wakeups, in case the
-	 * client times out before we unblock.
-	 */
-	do {
-		/*
-		 * Wait on our receive slot for some client to enqueue
-		 * itself in our send queue.
-		 */
-		info = xnsynch_sleep_on(&server->mrecv, timeout, XN_RELATIVE);
-		/*
-		 * XNRMID cannot happen, since well, the current task
-		 * would be the deleted object, so...
-		 */
-		if (info & XNTIMEO) {
-			err = -ETIMEDOUT;	/* Timeout. */
-			goto unlock_and_exit;
-		}
-		if (info & XNBREAK) {
-			err = -EINTR;	/* Unblocked. */
-			goto unlock_and_exit;
+		if (client->wait_args.mps.mcb_s.flowid == flowid) {
+			/* Note that the following will cause the
+			   client to be unblocked without transferring
+			   the ownership of the msendq object which
+			   must always belong to the server. */
+			xnpod_unblock_thread(&client->thread_base);
+			break;
 		}
-	} while (!xnsynch_pended_p(&server->msendq));
+		client = NULL;
+	}
 
-	holder = getheadpq(xnsynch_wait_queue(&server->msendq));
-	/* There must be a valid holder since we waited for it. */
+	if (!client)
+		return -ENXIO;
 
-      pull_message:
+	/* Copy the reply data to a location where the client can find
+	   it. */
 
-	client = thread2rtask(link2thread(holder, plink));
+	rsize = mcb_s ? mcb_s->size : 0;
+	err = 0;
 
-	rsize = client->wait_args.mps.mcb_s.size;
+	if (client->wait_args.mps.mcb_r.size >= rsize) {
+		/* Sending back a NULL or zero-length reply is
+		   perfectly valid; it just means to unblock the
+		   client without passing it back any reply data. */
 
-	if (rsize <= mcb_r->size) {
 		if (rsize > 0)
-			memcpy(mcb_r->data, client->wait_args.mps.mcb_s.data,
+			memcpy(client->wait_args.mps.mcb_r.data, mcb_s->data,
 			       rsize);
-
-		/* The flow identifier can't be either null or negative. */
-		err = client->wait_args.mps.mcb_s.flowid;
 	} else
+		/* The client will get the same error code. */
 		err = -ENOBUFS;
 
-	mcb_r->opcode = client->wait_args.mps.mcb_s.opcode;
-	mcb_r->size = rsize;
-
-      unlock_and_exit:
+	/* Fill in the reply block. */
+	client->wait_args.mps.mcb_r.flowid = flowid;
+	client->wait_args.mps.mcb_r.size = rsize;
+	client->wait_args.mps.mcb_r.opcode = mcb_s ? mcb_s->opcode : 0;
 
-	xnlock_put_irqrestore(&nklock, s);
+	*clientp = client;
 
 	return err;
 }
@@ -2121,9 +2183,7 @@ int rt_task_receive(RT_TASK_MCB *mcb_r, RTIME timeout)
 
 int rt_task_reply(int flowid, RT_TASK_MCB *mcb_s)
 {
-	RT_TASK *server, *client;
-	xnpholder_t *holder;
-	size_t rsize;
+	RT_TASK *client;
 	int err;
 	spl_t s;
 
@@ -2133,64 +2193,116 @@ int rt_task_reply(int flowid, RT_TASK_MCB *mcb_s)
 	if (flowid <= 0)
 		return -EINVAL;
 
-	server = xeno_current_task();
-
 	xnlock_get_irqsave(&nklock, s);
 
-	for (holder = getheadpq(xnsynch_wait_queue(&server->msendq)),
-		     client = NULL; holder != NULL;
-	     holder = nextpq(xnsynch_wait_queue(&server->msendq), holder)) {
-		client = thread2rtask(link2thread(holder, plink));
+	err = rt_task_reply_inner(xeno_current_task(), flowid, mcb_s, &client);
+	if (err != -ENXIO)
+		/* Falldown through the rescheduling is wanted upon
+		   -ENOBUFS, the client has been released. */
+		xnpod_schedule();
 
-		/* Check the flow identifier, just in case the client
-		   has vanished away while we were processing its last
-		   message. Each sent message carries a distinct flow
-		   identifier from other clients wrt to a given
-		   server. */
+	xnlock_put_irqrestore(&nklock, s);
 
-		if (client->wait_args.mps.mcb_s.flowid == flowid) {
-			/* Note that the following will cause the
-			   client to be unblocked without transferring
-			   the ownership of the msendq object which
-			   must always belong to the server. */
-			xnpod_unblock_thread(&client->thread_base);
-			break;
-		}
-	}
+	return err;
+}
 
-	if (!client) {
-		err = -ENXIO;
-		goto unlock_and_exit;
+/*
+ * Direct handoff: move a client we just released to the front of its
+ * priority group, so that it runs as soon as the server sleeps on the
+ * same CPU, instead of queuing behind its peers.
+ */
+static inline void rt_task_handoff(RT_TASK *server, RT_TASK *client)
+{
+	xnthread_t *thread = &client->thread_base;
+
+	if (thread->sched == server->thread_base.sched &&
+	    xnthread_test_state(thread, XNREADY)) {
+		xnsched_dequeue(thread);
+		xnsched_requeue(thread);
 	}
+}
 
-	/* Copy the reply data to a location where the client can find
-	   it. */
+/**
+ * @fn int rt_task_reply_receive(int flowid,RT_TASK_MCB *mcb_s,RT_TASK_MCB *mcb_r,RTIME timeout)
+ * @brief Reply to a task, then wait for the next message.
+ *
+ * This service combines rt_task_reply() and rt_task_receive() in a
+ * single call, which is the usual loop of a server task. The client
+ * of the current transaction is released, then the caller waits for
+ * the next message, all in a single scheduling pass.
+ *
+ * If the caller has to wait for the next message, the released
+ * client is moved to the front of its priority group when it runs on
+ * the same CPU as the caller, so that the CPU is handed over to it
+ * directly. This never allows the client to run before threads of
+ * higher priority.
+ *
+ * @param flowid The flow identifier returned by a previous call to
+ * rt_task_receive() or rt_task_reply_receive(). Zero means that there
+ * is no transaction to terminate, in which case this service behaves
+ * like rt_task_receive().
+ *
+ * @param mcb_s The address of an optional message control block
+ * referring to the message to be sent back, as with rt_task_reply().
+ *
+ * @param mcb_r The address of a message control block referring to
+ * the receive message area, as with rt_task_receive().
+ *
+ * @param timeout The number of clock ticks to wait for the next
+ * message, as with rt_task_receive().
+ *
+ * @return A strictly positive value is returned upon success,
+ * representing the flow identifier of the message received.
+ * Otherwise, the error codes of rt_task_reply() are returned if the
+ * reply failed, in which case no message is received. Errors from
+ * rt_task_receive() are returned if waiting for the next message
+ * failed, in which case the reply has been delivered nevertheless.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel-based task
+ * - User-space task (switches to primary mode)
+ *
+ * Rescheduling: Always.
+ */
 
-	rsize = mcb_s ? mcb_s->size : 0;
-	err = 0;
+int rt_task_reply_receive(int flowid, RT_TASK_MCB *mcb_s,
+			  RT_TASK_MCB *mcb_r, RTIME timeout)
+{
+	RT_TASK *server, *client = NULL;
+	int err;
+	spl_t s;
 
-	if (client->wait_args.mps.mcb_r.size >= rsize) {
-		/* Sending back a NULL or zero-length reply is
-		   perfectly valid; it just means to unblock the
-		   client without passing it back any reply data. */
+	if (!xnpod_primary_p())
+		return -EPERM;
 
-		if (rsize > 0)
-			memcpy(client->wait_args.mps.mcb_r.data, mcb_s->data,
-			       rsize);
-	} else
-		/* The client will get the same error code. Falldown
-		   through the rescheduling is wanted. */
-		err = -ENOBUFS;
+	if (flowid < 0)
+		return -EINVAL;
 
-	/* Fill in the reply block. */
-	client->wait_args.mps.mcb_r.flowid = flowid;
-	client->wait_args.mps.mcb_r.size = rsize;
-	client->wait_args.mps.mcb_r.opcode = mcb_s ? mcb_s->opcode : 0;
+	server = xeno_current_task();
 
-	/* That's it, we just need to start the rescheduling procedure
-	   now. */
+	xnlock_get_irqsave(&nklock, s);
 
-	xnpod_schedule();
+	if (flowid > 0) {
+		err = rt_task_reply_inner(server, flowid, mcb_s, &client);
+		if (err) {
+			if (err != -ENXIO)
+				xnpod_schedule();
+			goto unlock_and_exit;
+		}
+		if (!xnsynch_pended_p(&server->msendq))
+			rt_task_handoff(server, client);
+	}
+
+	err = rt_task_receive_inner(server, mcb_r, timeout);
+	/*
+	 * If we did not sleep, the client we released may still have
+	 * to preempt us.
+	 */
+	if (client)
+		xnpod_schedule();
 
       unlock_and_exit:
 
@@ -2551,4 +2663,5 @@ EXPORT_SYMBOL_GPL(rt_task_slice);
 EXPORT_SYMBOL_GPL(rt_task_send);
 EXPORT_SYMBOL_GPL(rt_task_receive);
 EXPORT_SYMBOL_GPL(rt_task_reply);
+EXPORT_SYMBOL_GPL(rt_task_reply_receive);
 #endif /* CONFIG_XENO_OPT_NATIVE_MPS */
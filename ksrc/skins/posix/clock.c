@@ -160,6 +160,43 @@ retry:
 #endif
 }
 
+/*
+ * Primary mode execution time of the current thread, which is still
+ * accumulating if the caller runs in primary mode.
+ */
+static int do_clock_thread_cputime(struct timespec *tp)
+{
+#ifdef CONFIG_XENO_OPT_STATS
+	xnthread_t *cur = xnpod_current_thread();
+	xnticks_t exectime;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!xnthread_test_state(cur, XNROOT))
+		exectime = xnthread_get_exectime(cur) +
+			xnstat_exectime_now() - xnthread_get_lastswitch(cur);
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+	else if ((cur = xnshadow_thread(current)) != NULL)
+		/* Relaxed shadow: primary mode time is frozen. */
+		exectime = xnthread_get_exectime(cur);
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+	else {
+		xnlock_put_irqrestore(&nklock, s);
+		return -EINVAL;
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	tp->tv_sec = xnarch_uldivrem(xnarch_tsc_to_ns(exectime),
+				     ONE_BILLION, &tp->tv_nsec);
+
+	return 0;
+#else /* !CONFIG_XENO_OPT_STATS */
+	return -EINVAL;
+#endif /* !CONFIG_XENO_OPT_STATS */
+}
+
 /**
  * Read the specified clock.
  *
@@ -173,9 +210,12 @@ retry:
  * - CLOCK_HOST_REALTIME, the clock value as seen by the host, typically
  *   Linux. Resolution and precision depend on the host, but it is guaranteed
  *   that both, host and Xenomai, see the same information.
+ * - CLOCK_THREAD_CPUTIME_ID, the amount of time the calling thread spent
+ *   running in primary mode. This clock is only available when the nucleus
+ *   collects statistics (CONFIG_XENO_OPT_STATS).
  *
  * @param clock_id clock identifier, either CLOCK_REALTIME, CLOCK_MONOTONIC,
- *        or CLOCK_HOST_REALTIME;
+ *        CLOCK_HOST_REALTIME or CLOCK_THREAD_CPUTIME_ID;
  *
  * @param tp the address where the value of the specified clock will be stored.
  *
@@ -210,6 +250,13 @@ int clock_gettime(clockid_t clock_id, struct timespec *tp)
 		}
 		break;
 
+	case CLOCK_THREAD_CPUTIME_ID:
+		if (do_clock_thread_cputime(tp) != 0) {
+			thread_set_errno(EINVAL);
+			return -1;
+		}
+		break;
+
 	default:
 		thread_set_errno(EINVAL);
 		return -1;
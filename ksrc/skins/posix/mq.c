@@ -37,6 +37,7 @@
 #include <posix/thread.h>	/* errno. */
 #include <posix/sig.h>		/* pse51_siginfo_t. */
 #ifdef __KERNEL__
+#include <linux/log2.h>
 #include <linux/fs.h>		/* Make sure ERR_PTR is defined for all kernel versions */
 #include <posix/apc.h>
 #endif /* __KERNEL__ */
@@ -57,6 +58,18 @@ struct pse51_mq {
 	char *mem;
 	xnqueue_t avail;
 
+	/* Zero-copy queues only (MQ_ZEROCOPY). */
+	xnheap_t *zcheap;
+	struct pse51_mq_zcring *zcring;
+	/*
+	 * Private copy of the ring geometry: the header lives in
+	 * memory user-space may write to, so we never index through
+	 * it.
+	 */
+	char *zcslots;
+	unsigned long zcnslots;
+	unsigned long zcslotsize;
+
 	/* mq_notify */
 	pse51_siginfo_t si;
 	mqd_t target_qd;
@@ -100,10 +113,116 @@ static void pse51_mq_msg_free(pse51_mq_t * mq, pse51_msg_t * msg)
 	prependq(&mq->avail, holder);	/* For earliest re-use of the block. */
 }
 
-static int pse51_mq_init(pse51_mq_t * mq, const struct mq_attr *attr)
+#if defined(__KERNEL__) && defined(CONFIG_XENO_OPT_PERVASIVE)
+
+static inline struct pse51_mq_zcslot *
+pse51_mq_zc_slot(pse51_mq_t *mq, unsigned long pos)
+{
+	return (struct pse51_mq_zcslot *)
+		(mq->zcslots + (pos & (mq->zcnslots - 1)) * mq->zcslotsize);
+}
+
+static void pse51_mq_zc_release(struct xnheap *heap)
+{
+	xnfree(heap);
+}
+
+static int pse51_mq_zc_init(pse51_mq_t *mq, const char *name,
+			    const struct mq_attr *attr)
+{
+	unsigned long ringsize, slotsize, memsize, nslots, i;
+	struct pse51_mq_zcring *ring;
+	xnheap_t *heap;
+	int err;
+
+	/*
+	 * Slots are indexed by masking free-running positions, which
+	 * requires a power of two; the queue capacity reported by
+	 * mq_getattr() is rounded up accordingly.
+	 */
+	if (attr->mq_maxmsg > ULONG_MAX / 2 + 1)
+		return ENOSPC;
+	nslots = roundup_pow_of_two(attr->mq_maxmsg);
+	ringsize = xnheap_align(sizeof(*ring), XNHEAP_MINALIGNSZ);
+	slotsize = xnheap_align(sizeof(struct pse51_mq_zcslot)
+				+ attr->mq_msgsize, XNHEAP_MINALIGNSZ);
+	if (slotsize < attr->mq_msgsize ||
+	    nslots > (ULONG_MAX - ringsize) / slotsize)
+		return ENOSPC;
+	memsize = ringsize + slotsize * nslots;
+
+	heap = (xnheap_t *)xnmalloc(sizeof(*heap));
+	if (!heap)
+		return ENOSPC;
+
+	err = xnheap_init_mapped(heap, xnheap_rounded_size(memsize, PAGE_SIZE),
+				 XNARCH_SHARED_HEAP_FLAGS);
+	if (err) {
+		xnfree(heap);
+		return ENOSPC;
+	}
+
+	xnheap_set_label(heap, "posix mq: %s", name);
+
+	ring = (struct pse51_mq_zcring *)xnheap_alloc(heap, memsize);
+	if (!ring) {
+		xnheap_destroy_mapped(heap, &pse51_mq_zc_release, NULL);
+		return ENOSPC;
+	}
+
+	xnarch_atomic_set(&ring->head, 0);
+	xnarch_atomic_set(&ring->tail, 0);
+	xnarch_atomic_set(&ring->rwaiters, 0);
+	xnarch_atomic_set(&ring->swaiters, 0);
+	ring->nslots = nslots;
+	ring->slotsize = slotsize;
+	ring->msgsize = attr->mq_msgsize;
+	ring->slots = ringsize;
+
+	mq->zcheap = heap;
+	mq->zcring = ring;
+	mq->zcslots = (char *)ring + ringsize;
+	mq->zcnslots = nslots;
+	mq->zcslotsize = slotsize;
+
+	/* Every slot is initially free for the producer of its index. */
+	for (i = 0; i < nslots; i++)
+		xnarch_atomic_set(&pse51_mq_zc_slot(mq, i)->seq, i);
+
+	return 0;
+}
+
+static void pse51_mq_zc_destroy(pse51_mq_t *mq)
+{
+	/*
+	 * Participants may still have the heap mapped, in which case
+	 * the actual release is deferred until the last mapping goes
+	 * away.
+	 */
+	xnheap_free(mq->zcheap, mq->zcring);
+	xnheap_destroy_mapped(mq->zcheap, &pse51_mq_zc_release, NULL);
+}
+
+#else /* !(__KERNEL__ && CONFIG_XENO_OPT_PERVASIVE) */
+
+static inline int pse51_mq_zc_init(pse51_mq_t *mq, const char *name,
+				   const struct mq_attr *attr)
+{
+	return ENOSYS;
+}
+
+static inline void pse51_mq_zc_destroy(pse51_mq_t *mq)
+{
+}
+
+#endif /* !(__KERNEL__ && CONFIG_XENO_OPT_PERVASIVE) */
+
+static int pse51_mq_init(pse51_mq_t * mq, const char *name,
+			 const struct mq_attr *attr, int oflags)
 {
 	unsigned i, msgsize, memsize;
 	char *mem;
+	int err;
 
 	if (xnpod_asynch_p() || !xnpod_root_p())
 		return EPERM;
@@ -120,13 +239,25 @@ static int pse51_mq_init(pse51_mq_t * mq, const struct mq_attr *attr)
 		msgsize +=
 		    sizeof(unsigned long) - (msgsize % sizeof(unsigned long));
 
-	memsize = msgsize * attr->mq_maxmsg;
-	memsize = PAGE_ALIGN(memsize);
+	mq->zcheap = NULL;
+	mq->zcring = NULL;
 
-	mem = (char *)xnarch_alloc_host_mem(memsize);
+	if (oflags & MQ_ZEROCOPY) {
+		/* Messages live in the mapped ring, not in a kernel pool. */
+		err = pse51_mq_zc_init(mq, name, attr);
+		if (err)
+			return err;
+		memsize = 0;
+		mem = NULL;
+	} else {
+		memsize = msgsize * attr->mq_maxmsg;
+		memsize = PAGE_ALIGN(memsize);
 
-	if (!mem)
-		return ENOSPC;
+		mem = (char *)xnarch_alloc_host_mem(memsize);
+
+		if (!mem)
+			return ENOSPC;
+	}
 
 	mq->memsize = memsize;
 	initpq(&mq->queued);
@@ -136,12 +267,14 @@ static int pse51_mq_init(pse51_mq_t * mq, const struct mq_attr *attr)
 
 	/* Fill the pool. */
 	initq(&mq->avail);
-	for (i = 0; i < attr->mq_maxmsg; i++) {
+	for (i = 0; mem && i < attr->mq_maxmsg; i++) {
 		pse51_msg_t *msg = (pse51_msg_t *) (mem + i * msgsize);
 		pse51_mq_msg_free(mq, msg);
 	}
 
 	mq->attr = *attr;
+	if (mq->zcring)
+		mq->attr.mq_maxmsg = mq->zcnslots;
 	mq->target = NULL;
 	xnselect_init(&mq->read_select);
 	xnselect_init(&mq->write_select);
@@ -161,6 +294,12 @@ static void pse51_mq_destroy(pse51_mq_t *mq)
 	xnlock_put_irqrestore(&nklock, s);
 	xnselect_destroy(&mq->read_select);
 	xnselect_destroy(&mq->write_select);
+
+	if (mq->zcring) {
+		/* Zero-copy queues are only dropped from the root domain. */
+		pse51_mq_zc_destroy(mq);
+		goto out;
+	}
 #ifdef __KERNEL__
 	if (!xnpod_root_p())
 		pse51_schedule_lostage(PSE51_LO_FREE_REQ, mq->mem, mq->memsize);
@@ -168,6 +307,7 @@ static void pse51_mq_destroy(pse51_mq_t *mq)
 #endif /* __KERNEL__ */
 		xnarch_free_host_mem(mq->mem, mq->memsize);
 
+  out:
 	if (resched)
 		xnpod_schedule();
 }
@@ -210,6 +350,18 @@ static void pse51_mq_destroy(pse51_mq_t *mq)
  * meaning. However, for portability, using a name which starts with a slash and
  * contains no other slash is recommended.
  *
+ * As a Xenomai extension, user-space callers may set the MQ_ZEROCOPY bit in @a
+ * oflags to create a zero-copy message queue: its message slots and indices are
+ * then placed in a heap mapped into every process opening the queue, so that
+ * senders build messages in place with mq_reserve_np()/mq_commit_np() and
+ * receivers consume them in place with mq_fetch_np()/mq_release_np(). The
+ * kernel is entered only to block on a full or empty queue, or to wake up a
+ * blocked peer. Messages in a zero-copy queue are delivered in FIFO order, the
+ * priority argument of mq_send() is ignored. Every opener of a zero-copy queue
+ * must pass MQ_ZEROCOPY, and conversely. The capacity of a zero-copy queue is
+ * @a mq_maxmsg rounded up to the next power of two, which is the value
+ * mq_getattr() then reports.
+ *
  * @param name name of the message queue to open;
  *
  * @param oflags flags.
@@ -225,7 +377,9 @@ static void pse51_mq_destroy(pse51_mq_t *mq)
  *   in the system heap to create the queue, try increasing
  *   CONFIG_XENO_OPT_SYS_HEAPSZ;
  * - EPERM, attempting to create a message queue from an invalid context;
- * - EINVAL, the @a attr argument is invalid;
+ * - EINVAL, the @a attr argument is invalid, or the MQ_ZEROCOPY bit in @a
+ *   oflags does not match the type of an existing message queue;
+ * - ENOSYS, MQ_ZEROCOPY was passed but zero-copy queues are not supported;
  * - EMFILE, too many descriptors are currently open.
  *
  * @par Valid contexts:
@@ -272,7 +426,7 @@ mqd_t mq_open(const char *name, int oflags, ...)
 	attr = va_arg(ap, struct mq_attr *);
 	va_end(ap);
 
-	err = pse51_mq_init(mq, attr);
+	err = pse51_mq_init(mq, name, attr, oflags);
 	if (err)
 		goto err_free_mq;
 
@@ -303,6 +457,11 @@ mqd_t mq_open(const char *name, int oflags, ...)
 
 	/* Whether found or created, here we have a valid message queue. */
   got_mq:
+	if (!(oflags & MQ_ZEROCOPY) != !mq->zcring) {
+		err = EINVAL;
+		goto err_lock_put_mq;
+	}
+
 	err = pse51_desc_create(&desc, &mq->nodebase,
 				oflags & (O_NONBLOCK | PSE51_PERMS_MASK));
 	if (err)
@@ -467,6 +626,18 @@ int mq_unlink(const char *name)
 	return 0;
 }
 
+static long pse51_mq_curmsgs(pse51_mq_t *mq)
+{
+	struct pse51_mq_zcring *ring = mq->zcring;
+
+	if (!ring)
+		return countpq(&mq->queued);
+
+	/* Approximate: also counts messages being built in place. */
+	return (long)(xnarch_atomic_get(&ring->head)
+		      - xnarch_atomic_get(&ring->tail));
+}
+
 static pse51_msg_t *pse51_mq_trysend(pse51_mq_t **mqp,
 				     pse51_desc_t *desc, size_t len)
 {
@@ -480,6 +651,9 @@ static pse51_msg_t *pse51_mq_trysend(pse51_mq_t **mqp,
 	if (flags != O_WRONLY && flags != O_RDWR)
 		return ERR_PTR(-EBADF);
 
+	if (mq->zcring)
+		return ERR_PTR(-EOPNOTSUPP);
+
 	if (len > mq->attr.mq_msgsize)
 		return ERR_PTR(-EMSGSIZE);
 
@@ -508,6 +682,9 @@ static pse51_msg_t *pse51_mq_tryrcv(pse51_mq_t **mqp,
 	if (flags != O_RDONLY && flags != O_RDWR)
 		return ERR_PTR(-EBADF);
 
+	if (mq->zcring)
+		return ERR_PTR(-EOPNOTSUPP);
+
 	if (len < mq->attr.mq_msgsize)
 		return ERR_PTR(-EMSGSIZE);
 
@@ -755,6 +932,214 @@ int pse51_mq_finish_rcv(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg)
 	return err;
 }
 
+#if defined(__KERNEL__) && defined(CONFIG_XENO_OPT_PERVASIVE)
+
+/*
+ * Tell whether the ring of a zero-copy queue has a free slot
+ * (PSE51_MQ_ZCSEND) or a pending message (PSE51_MQ_ZCRECV) at the
+ * current position. A position already moved on by another
+ * participant also counts as ready, since the caller should retry.
+ */
+static int pse51_mq_zc_ready(pse51_mq_t *mq, int dir)
+{
+	struct pse51_mq_zcring *ring = mq->zcring;
+	unsigned long pos, seq;
+
+	if (dir == PSE51_MQ_ZCRECV) {
+		pos = xnarch_atomic_get(&ring->tail);
+		seq = xnarch_atomic_get(&pse51_mq_zc_slot(mq, pos)->seq);
+		return (long)(seq - (pos + 1)) >= 0;
+	}
+
+	pos = xnarch_atomic_get(&ring->head);
+	seq = xnarch_atomic_get(&pse51_mq_zc_slot(mq, pos)->seq);
+
+	return (long)(seq - pos) >= 0;
+}
+
+static int pse51_mq_zc_get(pse51_mq_t **mqp, mqd_t fd, int dir)
+{
+	pse51_desc_t *desc;
+	unsigned flags;
+	pse51_mq_t *mq;
+	int err;
+
+	err = pse51_desc_get(&desc, fd, PSE51_MQ_MAGIC);
+	if (err)
+		return -err;
+
+	mq = node2mq(pse51_desc_node(desc));
+	if (!mq->zcring)
+		return -EINVAL;
+
+	flags = pse51_desc_getflags(desc) & PSE51_PERMS_MASK;
+	if (dir == PSE51_MQ_ZCRECV) {
+		if (flags != O_RDONLY && flags != O_RDWR)
+			return -EBADF;
+	} else if (flags != O_WRONLY && flags != O_RDWR)
+		return -EBADF;
+
+	*mqp = mq;
+
+	return (pse51_desc_getflags(desc) & O_NONBLOCK) ? 1 : 0;
+}
+
+int pse51_mq_zcinfo(mqd_t fd, struct pse51_mq_zcinfo *info)
+{
+	pse51_desc_t *desc;
+	pse51_mq_t *mq;
+	int err;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	err = -pse51_desc_get(&desc, fd, PSE51_MQ_MAGIC);
+	if (err)
+		goto unlock_and_exit;
+
+	mq = node2mq(pse51_desc_node(desc));
+	if (!mq->zcring) {
+		err = -EINVAL;
+		goto unlock_and_exit;
+	}
+
+	info->hdesc.handle = (unsigned long)mq->zcheap;
+	info->hdesc.size = xnheap_extentsize(mq->zcheap);
+	info->hdesc.area = xnheap_base_memory(mq->zcheap);
+	info->hdesc.used = xnheap_used_mem(mq->zcheap);
+	info->ringoff = xnheap_mapped_offset(mq->zcheap, mq->zcring);
+
+  unlock_and_exit:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+/*
+ * Block the caller until the ring of a zero-copy queue has room
+ * (PSE51_MQ_ZCSEND) or a message (PSE51_MQ_ZCRECV). Returns 0 when
+ * the caller should retry its user-space operation.
+ */
+int pse51_mq_zcwait(mqd_t fd, int dir, const struct timespec *abs_timeoutp)
+{
+	xnthread_t *cur = xnpod_current_thread();
+	struct pse51_mq_zcring *ring;
+	xnticks_t to = XN_INFINITE;
+	xnarch_atomic_t *waiters;
+	xnsynch_t *synch;
+	pse51_mq_t *mq;
+	int err;
+	spl_t s;
+
+	if (xnpod_unblockable_p())
+		return -EPERM;
+
+	if (abs_timeoutp) {
+		if ((unsigned long)abs_timeoutp->tv_nsec >= ONE_BILLION)
+			return -EINVAL;
+
+		to = ts2ticks_ceil(abs_timeoutp) + 1;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+
+	err = pse51_mq_zc_get(&mq, fd, dir);
+	if (err < 0)
+		goto unlock_and_exit;
+
+	ring = mq->zcring;
+	if (dir == PSE51_MQ_ZCRECV) {
+		waiters = &ring->rwaiters;
+		synch = &mq->receivers;
+	} else {
+		waiters = &ring->swaiters;
+		synch = &mq->senders;
+	}
+
+	/*
+	 * Advertise ourselves before checking the ring again: a peer
+	 * updating the ring then reading the waiter count either sees
+	 * us and wakes us up, or we see its update here.
+	 */
+	xnarch_atomic_set(waiters, xnarch_atomic_get(waiters) + 1);
+	xnarch_memory_barrier();
+
+	if (pse51_mq_zc_ready(mq, dir)) {
+		err = 0;
+		goto dec_and_exit;
+	}
+
+	if (err) {		/* i.e. O_NONBLOCK */
+		err = -EAGAIN;
+		goto dec_and_exit;
+	}
+
+	thread_cancellation_point(cur);
+
+	if (abs_timeoutp)
+		xnsynch_sleep_on(synch, to, XN_REALTIME);
+	else
+		xnsynch_sleep_on(synch, to, XN_RELATIVE);
+
+	thread_cancellation_point(cur);
+
+	if (xnthread_test_info(cur, XNRMID)) {
+		/* The queue is gone, so is the ring. */
+		err = -EBADF;
+		goto unlock_and_exit;
+	}
+
+	if (xnthread_test_info(cur, XNTIMEO))
+		err = -ETIMEDOUT;
+	else if (xnthread_test_info(cur, XNBREAK))
+		err = -EINTR;
+	else
+		err = 0;
+
+	/* The descriptor may have been closed while we slept. */
+	if (pse51_mq_zc_get(&mq, fd, dir) < 0 || mq->zcring != ring) {
+		err = -EBADF;
+		goto unlock_and_exit;
+	}
+
+  dec_and_exit:
+	xnarch_atomic_set(waiters, xnarch_atomic_get(waiters) - 1);
+  unlock_and_exit:
+	xnlock_put_irqrestore(&nklock, s);
+
+	return err;
+}
+
+int pse51_mq_zcwake(mqd_t fd, int dir)
+{
+	xnsynch_t *synch;
+	pse51_mq_t *mq;
+	int err, resched;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	/* The waker is a sender when waking up receivers, and conversely. */
+	err = pse51_mq_zc_get(&mq, fd, dir == PSE51_MQ_ZCRECV ?
+			      PSE51_MQ_ZCSEND : PSE51_MQ_ZCRECV);
+	if (err < 0) {
+		xnlock_put_irqrestore(&nklock, s);
+		return err;
+	}
+
+	synch = dir == PSE51_MQ_ZCRECV ? &mq->receivers : &mq->senders;
+	resched = xnsynch_wakeup_one_sleeper(synch) != NULL;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (resched)
+		xnpod_schedule();
+
+	return 0;
+}
+
+#endif /* __KERNEL__ && CONFIG_XENO_OPT_PERVASIVE */
+
 /**
  * Send a message to a message queue.
  *
@@ -1069,7 +1454,7 @@ int mq_getattr(mqd_t fd, struct mq_attr *attr)
 	mq = node2mq(pse51_desc_node(desc));
 	*attr = mq->attr;
 	attr->mq_flags = pse51_desc_getflags(desc);
-	attr->mq_curmsgs = countpq(&mq->queued);
+	attr->mq_curmsgs = pse51_mq_curmsgs(mq);
 	xnlock_put_irqrestore(&nklock, s);
 
 	return 0;
@@ -1126,7 +1511,7 @@ int mq_setattr(mqd_t fd,
 	if (oattr) {
 		*oattr = mq->attr;
 		oattr->mq_flags = pse51_desc_getflags(desc);
-		oattr->mq_curmsgs = countpq(&mq->queued);
+		oattr->mq_curmsgs = pse51_mq_curmsgs(mq);
 	}
 	flags = (pse51_desc_getflags(desc) & PSE51_PERMS_MASK)
 	    | (attr->mq_flags & ~PSE51_PERMS_MASK);
@@ -1206,6 +1591,11 @@ int mq_notify(mqd_t fd, const struct sigevent *evp)
 
 	mq = node2mq(pse51_desc_node(desc));
 
+	if (mq->zcring) {
+		err = EOPNOTSUPP;
+		goto unlock_and_error;
+	}
+
 	if (mq->target && mq->target != thread) {
 		err = EBUSY;
 		goto unlock_and_error;
@@ -1256,6 +1646,11 @@ int pse51_mq_select_bind(mqd_t fd, struct xnselector *selector,
 
 	mq = node2mq(pse51_desc_node(desc));
 
+	if (mq->zcring) {
+		err = -EOPNOTSUPP;
+		goto unlock_and_error;
+	}
+
 	switch(type) {
 	case XNSELECT_READ:
 		err = -EBADF;
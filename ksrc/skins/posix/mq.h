@@ -30,6 +30,12 @@ int pse51_mq_finish_rcv(mqd_t fd, pse51_mq_t *mq, pse51_msg_t *msg);
 
 void pse51_mq_uqds_cleanup(pse51_queues_t *q);
 
+int pse51_mq_zcinfo(mqd_t fd, struct pse51_mq_zcinfo *info);
+
+int pse51_mq_zcwait(mqd_t fd, int dir, const struct timespec *abs_timeoutp);
+
+int pse51_mq_zcwake(mqd_t fd, int dir);
+
 #endif /* CONFIG_XENO_OPT_PERVASIVE */
 
 int pse51_mq_pkg_init(void);
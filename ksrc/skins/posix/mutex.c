@@ -114,6 +114,11 @@ int pse51_mutex_init_internal(struct __shadow_mutex *shadow,
 
 	mutex->magic = PSE51_MUTEX_MAGIC;
 	xnsynch_init(&mutex->synchbase, synch_flags, ownerp);
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (ownerp)
+		xnsynch_init_fastmutex((struct xnsynch_fastmutex *)ownerp,
+				       attr->adaptive, !attr->pshared);
+#endif /* CONFIG_XENO_FASTSYNCH */
 	inith(&mutex->link);
 	mutex->attr = *attr;
 	mutex->owningq = kq;
@@ -186,7 +191,7 @@ int pthread_mutex_init(pthread_mutex_t *mx, const pthread_mutexattr_t *attr)
 #ifdef CONFIG_XENO_FASTSYNCH
 	ownerp = (xnarch_atomic_t *)
 		xnheap_alloc(&xnsys_ppd_get(attr->pshared)->sem_heap,
-			     sizeof(xnarch_atomic_t));
+			     sizeof(struct xnsynch_fastmutex));
 	if (!ownerp) {
 		xnfree(mutex);
 		return EAGAIN;
@@ -27,7 +27,8 @@ static const pthread_mutexattr_t default_mutex_attr = {
 	magic: PSE51_MUTEX_ATTR_MAGIC,
 	type: PTHREAD_MUTEX_NORMAL,
 	protocol: PTHREAD_PRIO_NONE,
-	pshared: PTHREAD_PROCESS_PRIVATE
+	pshared: PTHREAD_PROCESS_PRIVATE,
+	adaptive: 0
 };
 
 /**
@@ -37,7 +38,8 @@ static const pthread_mutexattr_t default_mutex_attr = {
  * values for all attributes. Default value are :
  * - for the @a type attribute, @a PTHREAD_MUTEX_NORMAL;
  * - for the @a protocol attribute, @a PTHREAD_PRIO_NONE;
- * - for the @a pshared attribute, @a PTHREAD_PROCESS_PRIVATE.
+ * - for the @a pshared attribute, @a PTHREAD_PROCESS_PRIVATE;
+ * - for the @a adaptive attribute, 0.
  *
  * If this service is called specifying a mutex attributes object that was
  * already initialized, the attributes object is reinitialized.
@@ -420,6 +422,91 @@ int pthread_mutexattr_setpshared(pthread_mutexattr_t *attr, int pshared)
 }
 
 
+/**
+ * Get the adaptive attribute of a mutex attributes object.
+ *
+ * This service stores, at the address @a adaptive, the value of the @a
+ * adaptive attribute in the mutex attributes object @a attr. See
+ * pthread_mutexattr_setadaptive_np() for the meaning of this attribute.
+ *
+ * @param attr an initialized mutex attributes object;
+ *
+ * @param adaptive address where the value of the @a adaptive attribute will be
+ * stored on success.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - EINVAL, the @a adaptive address is invalid;
+ * - EINVAL, the mutex attributes object @a attr is invalid.
+ *
+ */
+int pthread_mutexattr_getadaptive_np(const pthread_mutexattr_t *attr,
+				     int *adaptive)
+{
+	spl_t s;
+
+	if (!adaptive || !attr)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	*adaptive = attr->adaptive;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
+/**
+ * Set the adaptive attribute of a mutex attributes object.
+ *
+ * This service sets the @a adaptive attribute of the mutex attributes object
+ * @a attr.
+ *
+ * When a user-space thread finds an adaptive mutex locked by a thread
+ * running in primary mode on another CPU, it spins for a short while
+ * (see CONFIG_XENO_OPT_SYNCH_SPIN), waiting for the owner to release
+ * the mutex, before sleeping in the kernel. This saves two context
+ * switches when critical sections are short. Only process-private
+ * mutexes may spin, on SMP systems; otherwise this attribute has no
+ * effect.
+ *
+ * @param attr an initialized mutex attributes object.
+ *
+ * @param adaptive non-zero to enable spinning upon contention, zero to
+ * disable it.
+ *
+ * @return 0 on success,
+ * @return an error status if:
+ * - EINVAL, the mutex attributes object @a attr is invalid.
+ *
+ */
+int pthread_mutexattr_setadaptive_np(pthread_mutexattr_t *attr, int adaptive)
+{
+	spl_t s;
+
+	if (!attr)
+		return EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(attr,PSE51_MUTEX_ATTR_MAGIC,pthread_mutexattr_t)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return EINVAL;
+	}
+
+	attr->adaptive = !!adaptive;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
 /*@}*/
 
 EXPORT_SYMBOL_GPL(pthread_mutexattr_init);
@@ -430,3 +517,5 @@ EXPORT_SYMBOL_GPL(pthread_mutexattr_getprotocol);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_setprotocol);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_getpshared);
 EXPORT_SYMBOL_GPL(pthread_mutexattr_setpshared);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_getadaptive_np);
+EXPORT_SYMBOL_GPL(pthread_mutexattr_setadaptive_np);
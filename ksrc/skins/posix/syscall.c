@@ -408,6 +408,28 @@ static int __pthread_wait_np(struct pt_regs *regs)
 	return err;
 }
 
+static int __pthread_getrelstat_np(struct pt_regs *regs)
+{
+	pthread_relstat_np_t stat;
+	struct pse51_hkey hkey;
+	pthread_t k_tid;
+	int err;
+
+	hkey.u_tid = __xn_reg_arg1(regs);
+	hkey.mm = current->mm;
+	k_tid = __pthread_find(&hkey);
+
+	if (!k_tid)
+		return -ESRCH;
+
+	err = -pthread_getrelstat_np(k_tid, &stat);
+	if (err)
+		return err;
+
+	return __xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				      &stat, sizeof(stat));
+}
+
 static int __pthread_set_mode_np(struct pt_regs *regs)
 {
 	xnflags_t clrmask, setmask;
@@ -978,6 +1000,45 @@ static int __pthread_mutexattr_setpshared(struct pt_regs *regs)
 	return __xn_safe_copy_to_user((void __user *)uattrp, &attr, sizeof(*uattrp));
 }
 
+static int __pthread_mutexattr_getadaptive_np(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, adaptive, *uadaptivep;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	uadaptivep = (int *)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_getadaptive_np(&attr, &adaptive);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)uadaptivep,
+				      &adaptive, sizeof(*uadaptivep));
+}
+
+static int __pthread_mutexattr_setadaptive_np(struct pt_regs *regs)
+{
+	pthread_mutexattr_t attr, *uattrp;
+	int err, adaptive;
+
+	uattrp = (pthread_mutexattr_t *) __xn_reg_arg1(regs);
+
+	adaptive = (int)__xn_reg_arg2(regs);
+
+	if (__xn_safe_copy_from_user(&attr, (void __user *)uattrp, sizeof(attr)))
+		return -EFAULT;
+
+	err = pthread_mutexattr_setadaptive_np(&attr, adaptive);
+	if (err)
+		return -err;
+
+	return __xn_safe_copy_to_user((void __user *)uattrp, &attr, sizeof(*uattrp));
+}
+
 #ifndef CONFIG_XENO_FASTSYNCH
 static int __pthread_mutex_init(struct pt_regs *regs)
 {
@@ -1237,7 +1298,7 @@ static int __pthread_mutex_init(struct pt_regs *regs)
 
 	ownerp = (xnarch_atomic_t *)
 		xnheap_alloc(&xnsys_ppd_get(attr->pshared)->sem_heap,
-			     sizeof(xnarch_atomic_t));
+			     sizeof(struct xnsynch_fastmutex));
 	if (!ownerp) {
 		xnfree(mutex);
 		return -EAGAIN;
@@ -2100,6 +2161,74 @@ static int __mq_notify(struct pt_regs *regs)
 	return 0;
 }
 
+/* mq_zcinfo(q, &info) */
+static int __mq_zcinfo(struct pt_regs *regs)
+{
+	struct pse51_mq_zcinfo info;
+	pse51_assoc_t *assoc;
+	pse51_queues_t *q;
+	int err;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_lookup(&q->uqds, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	err = pse51_mq_zcinfo(assoc2ufd(assoc)->kfd, &info);
+	if (err)
+		return err;
+
+	return __xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				      &info, sizeof(info));
+}
+
+/* mq_zcwait(q, dir, timeout) */
+static int __mq_zcwait(struct pt_regs *regs)
+{
+	struct timespec timeout, *timeoutp;
+	pse51_assoc_t *assoc;
+	pse51_queues_t *q;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_lookup(&q->uqds, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	if (__xn_reg_arg3(regs)) {
+		if (__xn_safe_copy_from_user(&timeout, (struct timespec __user *)
+					     __xn_reg_arg3(regs), sizeof(timeout)))
+			return -EFAULT;
+		timeoutp = &timeout;
+	} else
+		timeoutp = NULL;
+
+	return pse51_mq_zcwait(assoc2ufd(assoc)->kfd,
+			       __xn_reg_arg2(regs), timeoutp);
+}
+
+/* mq_zcwake(q, dir) */
+static int __mq_zcwake(struct pt_regs *regs)
+{
+	pse51_assoc_t *assoc;
+	pse51_queues_t *q;
+
+	q = pse51_queues();
+	if (!q)
+		return -EPERM;
+
+	assoc = pse51_assoc_lookup(&q->uqds, (u_long)__xn_reg_arg1(regs));
+	if (!assoc)
+		return -EBADF;
+
+	return pse51_mq_zcwake(assoc2ufd(assoc)->kfd, __xn_reg_arg2(regs));
+}
+
 #ifdef CONFIG_XENO_OPT_POSIX_INTR
 
 static int __pse51_intr_handler(xnintr_t *cookie)
@@ -2317,6 +2446,20 @@ static int __timer_getoverrun(struct pt_regs *regs)
 	return rc >= 0 ? rc : -thread_get_errno();
 }
 
+static int __timer_setslack_np(struct pt_regs *regs)
+{
+	struct timespec slack;
+
+	if (__xn_safe_copy_from_user(&slack, (void __user *)__xn_reg_arg2(regs),
+				     sizeof(slack)))
+		return -EFAULT;
+
+	if (timer_setslack_np((timer_t) __xn_reg_arg1(regs), &slack))
+		return -thread_get_errno();
+
+	return 0;
+}
+
 #ifdef CONFIG_XENO_OPT_POSIX_SELECT
 static int fd_valid_p(int fd)
 {
@@ -2884,6 +3027,8 @@ static xnsysent_t __systab[] = {
 	[__pse51_thread_make_periodic] =
 	    {&__pthread_make_periodic_np, __xn_exec_conforming},
 	[__pse51_thread_wait] = {&__pthread_wait_np, __xn_exec_primary},
+	[__pse51_thread_getrelstat_np] =
+	    {&__pthread_getrelstat_np, __xn_exec_any},
 	[__pse51_thread_set_mode] = {&__pthread_set_mode_np, __xn_exec_primary},
 	[__pse51_thread_set_name] = {&__pthread_set_name_np, __xn_exec_any},
 	[__pse51_thread_kill] = {&__pthread_kill, __xn_exec_any},
@@ -2931,6 +3076,9 @@ static xnsysent_t __systab[] = {
 	[__pse51_mq_receive] = {&__mq_receive, __xn_exec_primary},
 	[__pse51_mq_timedreceive] = {&__mq_timedreceive, __xn_exec_primary},
 	[__pse51_mq_notify] = {&__mq_notify, __xn_exec_primary},
+	[__pse51_mq_zcinfo] = {&__mq_zcinfo, __xn_exec_any},
+	[__pse51_mq_zcwait] = {&__mq_zcwait, __xn_exec_primary},
+	[__pse51_mq_zcwake] = {&__mq_zcwake, __xn_exec_any},
 	[__pse51_intr_attach] = {&__intr_attach, __xn_exec_any},
 	[__pse51_intr_detach] = {&__intr_detach, __xn_exec_any},
 	[__pse51_intr_wait] = {&__intr_wait, __xn_exec_primary},
@@ -2940,6 +3088,7 @@ static xnsysent_t __systab[] = {
 	[__pse51_timer_settime] = {&__timer_settime, __xn_exec_primary},
 	[__pse51_timer_gettime] = {&__timer_gettime, __xn_exec_any},
 	[__pse51_timer_getoverrun] = {&__timer_getoverrun, __xn_exec_any},
+	[__pse51_timer_setslack_np] = {&__timer_setslack_np, __xn_exec_any},
 	[__pse51_shm_open] = {&__shm_open, __xn_exec_lostage},
 	[__pse51_shm_unlink] = {&__shm_unlink, __xn_exec_lostage},
 	[__pse51_shm_close] = {&__shm_close, __xn_exec_lostage},
@@ -2963,6 +3112,10 @@ static xnsysent_t __systab[] = {
 	    {&__pthread_mutexattr_getpshared, __xn_exec_any},
 	[__pse51_mutexattr_setpshared] =
 	    {&__pthread_mutexattr_setpshared, __xn_exec_any},
+	[__pse51_mutexattr_getadaptive_np] =
+	    {&__pthread_mutexattr_getadaptive_np, __xn_exec_any},
+	[__pse51_mutexattr_setadaptive_np] =
+	    {&__pthread_mutexattr_setadaptive_np, __xn_exec_any},
 	[__pse51_condattr_init] = {&__pthread_condattr_init, __xn_exec_any},
 	[__pse51_condattr_destroy] =
 	    {&__pthread_condattr_destroy, __xn_exec_any},
@@ -634,6 +634,48 @@ int pthread_wait_np(unsigned long *overruns_r)
 	return err;
 }
 
+/**
+ * Get the release statistics of a periodic thread.
+ *
+ * This service returns the statistics the nucleus keeps about the
+ * periodic releases of @a thread, each time it calls
+ * pthread_wait_np(): the count of release points reached and missed,
+ * the longest run of missed release points, the worst and cumulated
+ * release latencies, and an histogram of the release latency.
+ *
+ * The statistics are reset each time pthread_make_periodic_np() is
+ * called for @a thread. They are only collected when the nucleus is
+ * built with CONFIG_XENO_OPT_STATS; otherwise, all counts are zero.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param thread thread identifier;
+ *
+ * @param stat address where the statistics are returned.
+ *
+ * @return 0 on success;
+ * @return an error number if:
+ * - ESRCH, @a thread is invalid.
+ *
+ */
+int pthread_getrelstat_np(pthread_t thread, pthread_relstat_np_t *stat)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	if (!pse51_obj_active(thread, PSE51_THREAD_MAGIC, struct pse51_thread)) {
+		xnlock_put_irqrestore(&nklock, s);
+		return ESRCH;
+	}
+
+	xnthread_get_relstat(&thread->threadbase, stat);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+
 /**
  * Set the mode of the current thread.
  *
@@ -807,5 +849,6 @@ EXPORT_SYMBOL_GPL(pthread_join);
 EXPORT_SYMBOL_GPL(pthread_self);
 EXPORT_SYMBOL_GPL(pthread_make_periodic_np);
 EXPORT_SYMBOL_GPL(pthread_wait_np);
+EXPORT_SYMBOL_GPL(pthread_getrelstat_np);
 EXPORT_SYMBOL_GPL(pthread_set_name_np);
 EXPORT_SYMBOL_GPL(pthread_set_mode_np);
@@ -554,6 +554,75 @@ int timer_getoverrun(timer_t timerid)
 	return -1;
 }
 
+/**
+ * Set the expiry slack of a timer.
+ *
+ * This service allows the timer @a timerid to expire up to @a slack
+ * past its programmed expiration dates, so that the nucleus may fire
+ * it along with other timers elapsing nearby, instead of programming
+ * a separate hardware shot for it. This is meant for low-importance
+ * timers, e.g. housekeeping activities; timing critical ones should
+ * keep the default null slack.
+ *
+ * The slack applies from the next call to timer_settime(). Timers are
+ * created with a null slack.
+ *
+ * This service is a non-portable extension of the POSIX interface.
+ *
+ * @param timerid timer identifier;
+ *
+ * @param slack tolerated expiry delay, a null value disables coalescing.
+ *
+ * @retval 0 on success;
+ * @retval -1 with @a errno set if:
+ * - EINVAL, @a timerid is invalid;
+ * - EINVAL, @a slack is an invalid time interval;
+ * - EPERM, the timer @a timerid does not belong to the current process.
+ */
+int timer_setslack_np(timer_t timerid, const struct timespec *slack)
+{
+	struct pse51_timer *timer;
+	spl_t s;
+	int err;
+
+	if ((unsigned)timerid >= PSE51_TIMER_MAX ||
+	    (unsigned long)slack->tv_nsec >= ONE_BILLION ||
+	    slack->tv_sec < 0) {
+		err = EINVAL;
+		goto error;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+
+	timer = &timer_pool[(unsigned long)timerid];
+
+	if (!xntimer_active_p(&timer->timerbase)) {
+		err = EINVAL;
+		goto unlock_and_error;
+	}
+
+#if XENO_DEBUG(POSIX)
+	if (timer->owningq != pse51_kqueues(0)) {
+		err = EPERM;
+		goto unlock_and_error;
+	}
+#endif /* XENO_DEBUG(POSIX) */
+
+	xntimer_set_slack(&timer->timerbase,
+			  (xnticks_t)slack->tv_sec * ONE_BILLION +
+			  slack->tv_nsec);
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+
+  unlock_and_error:
+	xnlock_put_irqrestore(&nklock, s);
+  error:
+	thread_set_errno(err);
+	return -1;
+}
+
 void pse51_timer_init_thread(pthread_t new_thread)
 {
 	initq(&new_thread->timersq);
@@ -617,3 +686,4 @@ EXPORT_SYMBOL_GPL(timer_delete);
 EXPORT_SYMBOL_GPL(timer_settime);
 EXPORT_SYMBOL_GPL(timer_gettime);
 EXPORT_SYMBOL_GPL(timer_getoverrun);
+EXPORT_SYMBOL_GPL(timer_setslack_np);
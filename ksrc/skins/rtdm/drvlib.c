@@ -1612,6 +1612,9 @@ EXPORT_SYMBOL_GPL(rtdm_mutex_timedlock);
  *
  * - -EBUSY is returned if the specified IRQ line is already in use.
  *
+ * - -ENOMEM is returned if the interrupt statistics could not be
+ * allocated.
+ *
  * Environments:
  *
  * This service can be called from:
@@ -1644,6 +1647,74 @@ int rtdm_irq_request(rtdm_irq_t *irq_handle, unsigned int irq_no,
 
 EXPORT_SYMBOL_GPL(rtdm_irq_request);
 
+/**
+ * @brief Register a threaded interrupt handler
+ *
+ * This function works like rtdm_irq_request(), except that @a handler
+ * is not invoked from the interrupt context. The interrupt context
+ * only masks the IRQ line and wakes up a dedicated kernel task running
+ * at priority @a prio, which calls @a handler then re-enables the
+ * line. Therefore, the handler only delays tasks with lower
+ * priorities. Wakeup latencies and handler durations are reported for
+ * each threaded IRQ in /proc/xenomai/irq.
+ *
+ * @param[in,out] irq_handle IRQ handle
+ * @param[in] irq_no Line number of the addressed IRQ
+ * @param[in] handler Interrupt handler
+ * @param[in] flags Registration flags, see @ref RTDM_IRQTYPE_xxx for details.
+ * RTDM_IRQTYPE_SHARED is not supported.
+ * @param[in] device_name Device name to show up in real-time IRQ lists
+ * @param[in] arg Pointer to be passed to the interrupt handler on invocation
+ * @param[in] prio Priority of the handler task, see also
+ * @ref taskprio "Task Priority Range"
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if an invalid parameter was passed, or if
+ * RTDM_IRQTYPE_SHARED is set in @a flags.
+ *
+ * - -ENOMEM is returned if the handler task could not be created.
+ *
+ * - -EBUSY is returned if the specified IRQ line is already in use.
+ *
+ * @note The handler runs with interrupts enabled. Locks it shares with
+ * other contexts must be acquired via rtdm_lock_get_irqsave().
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: never.
+ */
+int rtdm_irq_request_threaded(rtdm_irq_t *irq_handle, unsigned int irq_no,
+			      rtdm_irq_handler_t handler, unsigned long flags,
+			      const char *device_name, void *arg, int prio)
+{
+	int err;
+
+	XENO_ASSERT(RTDM, xnpod_root_p(), return -EPERM;);
+
+	err = xnintr_init(irq_handle, device_name, irq_no, handler, NULL,
+			  flags);
+	if (err)
+		return err;
+
+	err = xnintr_attach_threaded(irq_handle, arg, prio);
+	if (err)
+		return err;
+
+	err = xnintr_enable(irq_handle);
+	if (err)
+		xnintr_detach(irq_handle);
+
+	return err;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_irq_request_threaded);
+
 #ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
  * @brief Release an interrupt handler
@@ -1723,6 +1794,30 @@ int rtdm_irq_enable(rtdm_irq_t *irq_handle);
  * Rescheduling: never.
  */
 int rtdm_irq_disable(rtdm_irq_t *irq_handle);
+
+/**
+ * @brief Set the ownership probe of a shared interrupt
+ *
+ * On IRQ lines shared with other real-time drivers, the probe is
+ * called before the interrupt handler, which is skipped if the probe
+ * returns zero. It should check cheaply whether the device raised the
+ * IRQ, e.g. by reading a single status register. The handlers of a
+ * shared level-triggered line are called until one of them returns
+ * RTDM_IRQ_HANDLED, busiest devices first.
+ *
+ * @param[in,out] irq_handle IRQ handle as returned by rtdm_irq_request()
+ * @param[in] probe Probe routine, or NULL to remove it
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_irq_set_probe(rtdm_irq_t *irq_handle, rtdm_irq_handler_t probe);
 #endif /* DOXYGEN_CPP */
 
 /** @} Interrupt Management Services */
@@ -23,6 +23,7 @@
 #include <nucleus/pod.h>
 #include <nucleus/ppd.h>
 #include <rtdm/rtdm_driver.h>
+#include <rtdm/ring.h>
 
 #include <linux/list.h>
 #include <linux/sem.h>
@@ -36,6 +37,8 @@
 #define DEF_DEVNAME_HASHTAB_SIZE	256	/* entries in name hash table */
 #define DEF_PROTO_HASHTAB_SIZE		256	/* entries in protocol hash table */
 
+struct rtdm_ring;
+
 struct rtdm_fildes {
 	struct rtdm_dev_context *context;
 };
@@ -45,6 +48,9 @@ struct rtdm_process {
 	char name[32];
 	pid_t pid;
 #endif /* CONFIG_XENO_OPT_VFILE */
+#ifdef CONFIG_XENO_OPT_RTDM_RING
+	struct rtdm_ring *rings[RTDM_RING_MAX];
+#endif /* CONFIG_XENO_OPT_RTDM_RING */
 
 	xnshadow_ppd_t ppd;
 };
@@ -104,4 +110,19 @@ static void rtdm_proc_unregister_device(struct rtdm_device *device)
 
 void rtdm_apc_handler(void *cookie);
 
+#ifdef CONFIG_XENO_OPT_RTDM_RING
+int rtdm_ring_setup(struct rtdm_process *process,
+		    const struct rtdm_ring_params *params,
+		    struct rtdm_ring_info *info);
+int rtdm_ring_enter(struct rtdm_process *process, int id,
+		    unsigned int to_submit, unsigned int min_complete,
+		    nanosecs_rel_t timeout);
+int rtdm_ring_destroy(struct rtdm_process *process, int id);
+void rtdm_ring_cleanup(struct rtdm_process *process);
+#else /* !CONFIG_XENO_OPT_RTDM_RING */
+static inline void rtdm_ring_cleanup(struct rtdm_process *process)
+{
+}
+#endif /* !CONFIG_XENO_OPT_RTDM_RING */
+
 #endif /* _RTDM_INTERNAL_H */
@@ -0,0 +1,639 @@
+/**
+ * @file
+ * Real-Time Driver Model for Xenomai, packet buffer services
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * @ingroup driverapi
+ * @defgroup rtdmpbuf Packet Buffer Services
+ *
+ * Packet buffers are fixed-size, reference counted memory blocks
+ * which drivers and protocols may hand over to each other instead of
+ * copying the data they carry. Buffers are obtained from pools, each
+ * pool keeping a free list per CPU so that allocations and releases
+ * on different CPUs do not contend. Buffers may reserve headroom for
+ * prepending protocol headers, and be linked into scatter chains to
+ * carry frames larger than a single buffer.
+ *
+ * The payload area of a pool is a single virtually contiguous block,
+ * which can be mapped to a user-space process. A buffer is then
+ * designated to that process by its offset in the mapping (see
+ * rtdm_pbuf_offset()).
+ *
+ * @{
+ */
+
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/mman.h>
+
+#include <rtdm/rtdm_driver.h>
+
+struct rtdm_pbuf_cpu {
+	rtdm_lock_t lock;
+	struct rtdm_pbuf *free;
+} ____cacheline_aligned_in_smp;
+
+static void rtdm_pbuf_release(struct rtdm_pbuf_pool *pool,
+			      struct rtdm_pbuf *pbuf)
+{
+	struct rtdm_pbuf_cpu *c = &pool->cpus[xnarch_current_cpu()];
+	rtdm_lockctx_t s;
+
+	rtdm_lock_get_irqsave(&c->lock, s);
+	pbuf->nextfree = c->free;
+	c->free = pbuf;
+	rtdm_lock_put_irqrestore(&c->lock, s);
+
+	/* Only count the buffer once it is visible to allocators. */
+	atomic_inc(&pool->avail);
+}
+
+/*
+ * Pull one buffer from the free lists, starting with the one of the
+ * current CPU. The caller must have reserved it by decrementing
+ * pool->avail, so that one list has to hold a buffer for it.
+ */
+static struct rtdm_pbuf *rtdm_pbuf_grab(struct rtdm_pbuf_pool *pool)
+{
+	struct rtdm_pbuf *pbuf = NULL;
+	struct rtdm_pbuf_cpu *c;
+	rtdm_lockctx_t s;
+	int cpu, n;
+
+	cpu = xnarch_current_cpu();
+
+	for (;;) {
+		for (n = 0; n < XNARCH_NR_CPUS; n++) {
+			c = &pool->cpus[(cpu + n) % XNARCH_NR_CPUS];
+			if (c->free == NULL)
+				continue;
+			rtdm_lock_get_irqsave(&c->lock, s);
+			pbuf = c->free;
+			if (pbuf)
+				c->free = pbuf->nextfree;
+			rtdm_lock_put_irqrestore(&c->lock, s);
+			if (pbuf)
+				return pbuf;
+		}
+		/* A release is in flight, retry. */
+		cpu_relax();
+	}
+}
+
+static void rtdm_pbuf_setup(struct rtdm_pbuf *pbuf, size_t headroom)
+{
+	pbuf->next = NULL;
+	pbuf->data = pbuf->head + headroom;
+	pbuf->len = 0;
+	atomic_set(&pbuf->refs, 1);
+}
+
+/**
+ * @brief Initialize a packet buffer pool
+ *
+ * @param[in,out] pool Pool descriptor
+ * @param[in] nr_bufs Number of buffers in the pool
+ * @param[in] buf_size Size of each buffer, including headroom. It is
+ * rounded up to the cache line size.
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EINVAL is returned if @a nr_bufs or @a buf_size is zero.
+ *
+ * - -ENOMEM is returned if the pool memory could not be allocated.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: never.
+ */
+int rtdm_pbuf_pool_init(struct rtdm_pbuf_pool *pool,
+			unsigned int nr_bufs, size_t buf_size)
+{
+	struct rtdm_pbuf *pbuf;
+	unsigned int n;
+	int cpu;
+
+	XENO_ASSERT(RTDM, xnpod_root_p(), return -EPERM;);
+
+	if (nr_bufs == 0 || buf_size == 0)
+		return -EINVAL;
+
+	buf_size = L1_CACHE_ALIGN(buf_size);
+	pool->buf_size = buf_size;
+	pool->nr_bufs = nr_bufs;
+	pool->area_size = PAGE_ALIGN(nr_bufs * buf_size);
+
+	pool->area = vmalloc(pool->area_size);
+	if (pool->area == NULL)
+		return -ENOMEM;
+
+	/* The area may be mapped to user-space, don't leak stale data. */
+	memset(pool->area, 0, pool->area_size);
+
+	pool->descs = vmalloc(nr_bufs * sizeof(*pool->descs));
+	if (pool->descs == NULL)
+		goto fail_descs;
+
+	pool->cpus = kmalloc(XNARCH_NR_CPUS * sizeof(*pool->cpus), GFP_KERNEL);
+	if (pool->cpus == NULL)
+		goto fail_cpus;
+
+	for (cpu = 0; cpu < XNARCH_NR_CPUS; cpu++) {
+		rtdm_lock_init(&pool->cpus[cpu].lock);
+		pool->cpus[cpu].free = NULL;
+	}
+
+	/* Spread the buffers over the free lists of online CPUs. */
+	for (n = 0; n < nr_bufs; )
+		for_each_online_cpu(cpu) {
+			if (n == nr_bufs)
+				break;
+			if (cpu >= XNARCH_NR_CPUS)
+				continue;
+			pbuf = &pool->descs[n];
+			pbuf->pool = pool;
+			pbuf->head = pool->area + n * buf_size;
+			INIT_LIST_HEAD(&pbuf->link);
+			pbuf->nextfree = pool->cpus[cpu].free;
+			pool->cpus[cpu].free = pbuf;
+			n++;
+		}
+
+	atomic_set(&pool->avail, nr_bufs);
+
+	return 0;
+
+fail_cpus:
+	vfree(pool->descs);
+fail_descs:
+	vfree(pool->area);
+
+	return -ENOMEM;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_pool_init);
+
+/**
+ * @brief Destroy a packet buffer pool
+ *
+ * @param[in,out] pool Pool descriptor
+ *
+ * @note The caller is responsible for making sure that no buffer of
+ * the pool is still in use, and that no user-space mapping of the pool
+ * remains.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_pbuf_pool_destroy(struct rtdm_pbuf_pool *pool)
+{
+	XENO_ASSERT(RTDM, xnpod_root_p(), return;);
+
+	kfree(pool->cpus);
+	vfree(pool->descs);
+	vfree(pool->area);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_pool_destroy);
+
+/**
+ * @brief Allocate a packet buffer
+ *
+ * @param[in] pool Pool to allocate from
+ * @param[in] headroom Number of bytes to reserve in front of the
+ * payload, for prepending headers with rtdm_pbuf_push()
+ *
+ * @return The buffer, with a reference count of one and an empty
+ * payload, or NULL if the pool is exhausted or @a headroom exceeds the
+ * buffer size.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+struct rtdm_pbuf *rtdm_pbuf_alloc(struct rtdm_pbuf_pool *pool,
+				  size_t headroom)
+{
+	struct rtdm_pbuf *pbuf;
+
+	if (headroom > pool->buf_size)
+		return NULL;
+
+	if (atomic_dec_return(&pool->avail) < 0) {
+		atomic_inc(&pool->avail);
+		return NULL;
+	}
+
+	pbuf = rtdm_pbuf_grab(pool);
+	rtdm_pbuf_setup(pbuf, headroom);
+
+	return pbuf;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_alloc);
+
+/**
+ * @brief Allocate a chain of packet buffers
+ *
+ * Allocates as many buffers as needed to hold @a len bytes of payload
+ * after @a headroom bytes reserved in the first buffer. Either all
+ * buffers are obtained, or none is.
+ *
+ * @param[in] pool Pool to allocate from
+ * @param[in] len Payload length the chain must be able to hold
+ * @param[in] headroom Number of bytes to reserve in front of the
+ * payload of the first buffer
+ * @param[out] ppbuf Address of a pointer receiving the first buffer
+ * of the chain on success. All buffers have an empty payload;
+ * rtdm_pbuf_copy_from_iov() fills them in order.
+ *
+ * @return 0 on success, otherwise:
+ *
+ * - -EAGAIN is returned if the pool does not have enough free
+ * buffers at the moment.
+ *
+ * - -EMSGSIZE is returned if @a len and @a headroom exceed the
+ * capacity of the whole pool.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+int rtdm_pbuf_alloc_chain(struct rtdm_pbuf_pool *pool, size_t len,
+			  size_t headroom, struct rtdm_pbuf **ppbuf)
+{
+	struct rtdm_pbuf *head = NULL, **tail = &head;
+	unsigned long count;
+	int n;
+
+	if (headroom > pool->buf_size)
+		return -EMSGSIZE;
+
+	len += headroom;
+	count = len ? (len + pool->buf_size - 1) / pool->buf_size : 1;
+	if (count > pool->nr_bufs)
+		return -EMSGSIZE;
+
+	if (atomic_sub_return(count, &pool->avail) < 0) {
+		atomic_add(count, &pool->avail);
+		return -EAGAIN;
+	}
+
+	for (n = 0; n < count; n++) {
+		*tail = rtdm_pbuf_grab(pool);
+		rtdm_pbuf_setup(*tail, n ? 0 : headroom);
+		tail = &(*tail)->next;
+	}
+
+	*ppbuf = head;
+
+	return 0;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_alloc_chain);
+
+/**
+ * @brief Release a reference on a packet buffer chain
+ *
+ * Drops a reference on each buffer of the chain starting at @a pbuf,
+ * returning the unreferenced ones to their pool. The walk stops at the
+ * first buffer which is still referenced, since the rest of the chain
+ * then still belongs to its other owner.
+ *
+ * @param[in] pbuf First buffer of the chain
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Interrupt service routine
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+void rtdm_pbuf_free(struct rtdm_pbuf *pbuf)
+{
+	struct rtdm_pbuf *next;
+
+	while (pbuf && atomic_dec_and_test(&pbuf->refs)) {
+		next = pbuf->next;
+		rtdm_pbuf_release(pbuf->pool, pbuf);
+		pbuf = next;
+	}
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_free);
+
+static int rtdm_pbuf_copy_in(rtdm_user_info_t *user_info,
+			     void *dst, const void *src, size_t len)
+{
+	if (user_info)
+		return rtdm_safe_copy_from_user(user_info, dst, src, len);
+
+	memcpy(dst, src, len);
+
+	return 0;
+}
+
+static int rtdm_pbuf_copy_out(rtdm_user_info_t *user_info,
+			      void *dst, const void *src, size_t len)
+{
+	if (user_info)
+		return rtdm_safe_copy_to_user(user_info, dst, src, len);
+
+	memcpy(dst, src, len);
+
+	return 0;
+}
+
+/**
+ * @brief Fill a packet buffer chain from an I/O vector
+ *
+ * Appends up to @a len bytes from @a iov to the chain starting at @a
+ * pbuf, filling the tailroom of each buffer in turn. The I/O vector
+ * is updated to reflect the consumed data.
+ *
+ * @param[in] user_info User-space process @a iov refers to, NULL for
+ * kernel buffers
+ * @param[in] pbuf First buffer of the chain
+ * @param[in,out] iov I/O vector
+ * @param[in] iovlen Number of cells in @a iov
+ * @param[in] len Number of bytes to copy
+ *
+ * @return The number of bytes copied, which is less than @a len if the
+ * chain or the vector was exhausted, otherwise -EFAULT if a user-space
+ * cell could not be read.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+ssize_t rtdm_pbuf_copy_from_iov(rtdm_user_info_t *user_info,
+				struct rtdm_pbuf *pbuf,
+				struct iovec *iov, int iovlen, size_t len)
+{
+	size_t done = 0, vlen;
+	int nvec, ret;
+
+	for (nvec = 0; nvec < iovlen && pbuf && done < len; ) {
+		vlen = min(iov[nvec].iov_len, len - done);
+		vlen = min(vlen, rtdm_pbuf_tailroom(pbuf));
+		if (vlen == 0) {
+			if (iov[nvec].iov_len == 0)
+				nvec++;
+			else
+				pbuf = pbuf->next;
+			continue;
+		}
+		ret = rtdm_pbuf_copy_in(user_info,
+					pbuf->data + pbuf->len,
+					iov[nvec].iov_base, vlen);
+		if (ret)
+			return ret;
+		pbuf->len += vlen;
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		done += vlen;
+	}
+
+	return done;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_copy_from_iov);
+
+/**
+ * @brief Copy the payload of a packet buffer chain to an I/O vector
+ *
+ * Copies up to @a len bytes of the payload of the chain starting at
+ * @a pbuf, from byte @a offset on, to @a iov. The I/O vector is
+ * updated to reflect the filled data.
+ *
+ * @param[in] user_info User-space process @a iov refers to, NULL for
+ * kernel buffers
+ * @param[in] pbuf First buffer of the chain
+ * @param[in] offset Offset in the payload of the chain
+ * @param[in,out] iov I/O vector
+ * @param[in] iovlen Number of cells in @a iov
+ * @param[in] len Number of bytes to copy
+ *
+ * @return The number of bytes copied, which is less than @a len if the
+ * chain or the vector was exhausted, otherwise -EFAULT if a user-space
+ * cell could not be written.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - Kernel-based task
+ * - User-space task (RT, non-RT)
+ *
+ * Rescheduling: never.
+ */
+ssize_t rtdm_pbuf_copy_to_iov(rtdm_user_info_t *user_info,
+			      struct rtdm_pbuf *pbuf, size_t offset,
+			      struct iovec *iov, int iovlen, size_t len)
+{
+	size_t done = 0, vlen;
+	int nvec, ret;
+
+	while (pbuf && offset >= pbuf->len) {
+		offset -= pbuf->len;
+		pbuf = pbuf->next;
+	}
+
+	for (nvec = 0; nvec < iovlen && pbuf && done < len; ) {
+		vlen = min(iov[nvec].iov_len, len - done);
+		vlen = min(vlen, pbuf->len - offset);
+		if (vlen == 0) {
+			if (iov[nvec].iov_len == 0)
+				nvec++;
+			else {
+				pbuf = pbuf->next;
+				offset = 0;
+			}
+			continue;
+		}
+		ret = rtdm_pbuf_copy_out(user_info, iov[nvec].iov_base,
+					 pbuf->data + offset, vlen);
+		if (ret)
+			return ret;
+		offset += vlen;
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		done += vlen;
+	}
+
+	return done;
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_copy_to_iov);
+
+#ifdef CONFIG_XENO_OPT_PERVASIVE
+/**
+ * @brief Map the payload area of a packet buffer pool to user-space
+ *
+ * Once mapped, the payload of a buffer is found at the address
+ * returned in @a pptr, plus the offset of the buffer as returned by
+ * rtdm_pbuf_offset().
+ *
+ * @param[in] pool Pool to map
+ * @param[in] user_info User-space process to map the pool to
+ * @param[in] prot Protection flags of the mapping, e.g. PROT_READ
+ * @param[in,out] pptr Address of a pointer containing the desired
+ * user address or NULL on entry and the finally assigned address on
+ * return
+ *
+ * @return 0 on success, otherwise a negative error code as returned
+ * by rtdm_mmap_to_user().
+ *
+ * @note The mapping must be released with rtdm_munmap() before the
+ * pool is destroyed.
+ *
+ * Environments:
+ *
+ * This service can be called from:
+ *
+ * - Kernel module initialization/cleanup code
+ * - User-space task (non-RT)
+ *
+ * Rescheduling: possible.
+ */
+int rtdm_pbuf_pool_mmap(struct rtdm_pbuf_pool *pool,
+			rtdm_user_info_t *user_info, int prot, void **pptr)
+{
+	return rtdm_mmap_to_user(user_info, pool->area, pool->area_size,
+				 prot, pptr, NULL, NULL);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_pbuf_pool_mmap);
+#endif /* CONFIG_XENO_OPT_PERVASIVE */
+
+#ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
+/**
+ * @brief Acquire a reference on a packet buffer
+ *
+ * @param[in] pbuf Buffer to reference
+ *
+ * Environments:
+ *
+ * This service can be called from any context.
+ *
+ * Rescheduling: never.
+ */
+void rtdm_pbuf_get(struct rtdm_pbuf *pbuf);
+
+/**
+ * @brief Extend the payload of a packet buffer at its tail
+ *
+ * @param[in,out] pbuf Buffer to extend
+ * @param[in] len Number of bytes to add, at most rtdm_pbuf_tailroom()
+ *
+ * @return Address of the added bytes
+ *
+ * Environments:
+ *
+ * This service can be called from any context.
+ *
+ * Rescheduling: never.
+ */
+unsigned char *rtdm_pbuf_append(struct rtdm_pbuf *pbuf, size_t len);
+
+/**
+ * @brief Extend the payload of a packet buffer at its head
+ *
+ * @param[in,out] pbuf Buffer to extend
+ * @param[in] len Number of bytes to add, at most rtdm_pbuf_headroom()
+ *
+ * @return New start of the payload
+ *
+ * Environments:
+ *
+ * This service can be called from any context.
+ *
+ * Rescheduling: never.
+ */
+unsigned char *rtdm_pbuf_push(struct rtdm_pbuf *pbuf, size_t len);
+
+/**
+ * @brief Strip bytes from the head of a packet buffer payload
+ *
+ * @param[in,out] pbuf Buffer to shrink
+ * @param[in] len Number of bytes to remove, at most the payload length
+ *
+ * @return New start of the payload
+ *
+ * Environments:
+ *
+ * This service can be called from any context.
+ *
+ * Rescheduling: never.
+ */
+unsigned char *rtdm_pbuf_pull(struct rtdm_pbuf *pbuf, size_t len);
+
+/**
+ * @brief Get the offset of a packet buffer payload in its pool
+ *
+ * @param[in] pbuf Buffer to locate
+ *
+ * @return Offset of the payload start from the start of the pool
+ * payload area, as mapped by rtdm_pbuf_pool_mmap()
+ *
+ * Environments:
+ *
+ * This service can be called from any context.
+ *
+ * Rescheduling: never.
+ */
+unsigned long rtdm_pbuf_offset(struct rtdm_pbuf *pbuf);
+#endif /* DOXYGEN_CPP */
+
+/** @} */
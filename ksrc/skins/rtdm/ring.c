@@ -0,0 +1,499 @@
+/*
+ * Asynchronous submission/completion rings.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+/*
+ * A ring lives in a mapped heap shared with its owner process: the
+ * header, the SQE and CQE arrays, then the registered buffers. Each
+ * ring is served by a set of RTDM tasks which pick accepted SQEs in
+ * order, run the requested operation on behalf of the owner with
+ * kernel buffers (user_info == NULL), and post the outcome to the CQ.
+ * Since workers never touch the owner's address space, requests may
+ * only refer to data through the registered buffers.
+ *
+ * The kernel only trusts its own copy of the ring indexes; the
+ * application-owned ones (sq_tail, cq_head) are sanity checked on
+ * use. Submissions are throttled so that every accepted SQE is
+ * guaranteed a free CQE, hence completions are never dropped.
+ *
+ * All ring state is guarded by nklock.
+ */
+
+#include <linux/slab.h>
+#include <linux/delay.h>
+#include <nucleus/heap.h>
+
+#include "rtdm/internal.h"
+
+struct rtdm_ring {
+	struct rtdm_process *owner;
+	xnheap_t *heap;
+	struct rtdm_ring_shared *shared;
+	struct rtdm_ring_sqe *sqes;
+	struct rtdm_ring_cqe *cqes;
+	char *bufs;
+	unsigned int sq_entries;
+	unsigned int cq_entries;
+	unsigned int nr_bufs;
+	unsigned int buf_size;
+	unsigned int sq_head;	/* Next accepted SQE to hand over. */
+	unsigned int sq_limit;	/* End of the accepted SQEs. */
+	unsigned int cq_tail;
+	unsigned int inflight;	/* Accepted SQEs not posted to the CQ yet. */
+	unsigned int refs;	/* Callers sleeping in rtdm_ring_enter(). */
+	int dying;
+	xnsynch_t sq_synch;	/* Idle workers. */
+	xnsynch_t cq_synch;	/* Callers waiting for completions. */
+	unsigned int nr_workers;
+	rtdm_task_t workers[0];
+};
+
+static void rtdm_ring_release(struct xnheap *heap)
+{
+	xnfree(heap);
+}
+
+static inline int rtdm_ring_check_range(struct rtdm_ring *ring,
+					unsigned int off, unsigned int len)
+{
+	return off <= ring->buf_size && len <= ring->buf_size - off;
+}
+
+static ssize_t rtdm_ring_exec(struct rtdm_ring *ring,
+			      const struct rtdm_ring_sqe *sqe,
+			      unsigned int *addr_len)
+{
+	struct rtdm_dev_context *context;
+	struct rtdm_operations *ops;
+	struct msghdr msg;
+	struct iovec iov;
+	ssize_t ret;
+	char *buf;
+
+	if (sqe->opcode == RTDM_RING_OP_NOP)
+		return 0;
+
+	if (sqe->buf >= ring->nr_bufs ||
+	    !rtdm_ring_check_range(ring, sqe->off, sqe->len))
+		return -EINVAL;
+
+	/*
+	 * Workers are not bound to any process, make sure the target
+	 * descriptor belongs to the ring owner. We keep the context
+	 * locked until the request completes, so that the descriptor
+	 * cannot be closed and reused by someone else meanwhile.
+	 */
+	context = rtdm_context_get(sqe->fd);
+	if (context == NULL)
+		return -EBADF;
+	if (context->reserved.owner != ring->owner) {
+		ret = -EBADF;
+		goto unlock_out;
+	}
+
+	/* Workers always run in primary mode. */
+	ops = context->ops;
+	buf = ring->bufs + (unsigned long)sqe->buf * ring->buf_size;
+
+	switch (sqe->opcode) {
+	case RTDM_RING_OP_READ:
+		ret = ops->read_rt(context, NULL, buf + sqe->off, sqe->len);
+		break;
+
+	case RTDM_RING_OP_WRITE:
+		ret = ops->write_rt(context, NULL, buf + sqe->off, sqe->len);
+		break;
+
+	case RTDM_RING_OP_RECVMSG:
+	case RTDM_RING_OP_SENDMSG:
+		if (sqe->addr_len &&
+		    !rtdm_ring_check_range(ring, sqe->addr_off, sqe->addr_len)) {
+			ret = -EINVAL;
+			break;
+		}
+
+		iov.iov_base = buf + sqe->off;
+		iov.iov_len = sqe->len;
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_name = sqe->addr_len ? buf + sqe->addr_off : NULL;
+		msg.msg_namelen = sqe->addr_len;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+
+		if (sqe->opcode == RTDM_RING_OP_SENDMSG) {
+			ret = ops->sendmsg_rt(context, NULL, &msg,
+					      sqe->msg_flags);
+			break;
+		}
+
+		ret = ops->recvmsg_rt(context, NULL, &msg, sqe->msg_flags);
+		if (ret >= 0)
+			*addr_len = msg.msg_namelen;
+		break;
+
+	default:
+		ret = -EINVAL;
+	}
+
+  unlock_out:
+	rtdm_context_unlock(context);
+
+	return ret;
+}
+
+static void rtdm_ring_worker(void *arg)
+{
+	struct rtdm_ring *ring = arg;
+	struct rtdm_ring_cqe *cqe;
+	struct rtdm_ring_sqe sqe;
+	unsigned int addr_len;
+	ssize_t ret;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (;;) {
+		while (ring->sq_head == ring->sq_limit && !ring->dying)
+			xnsynch_sleep_on(&ring->sq_synch,
+					 XN_INFINITE, XN_RELATIVE);
+		if (ring->dying)
+			break;
+
+		sqe = ring->sqes[ring->sq_head & (ring->sq_entries - 1)];
+		ring->shared->sq_head = ++ring->sq_head;
+
+		xnlock_put_irqrestore(&nklock, s);
+
+		addr_len = 0;
+		ret = rtdm_ring_exec(ring, &sqe, &addr_len);
+
+		xnlock_get_irqsave(&nklock, s);
+
+		cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+		cqe->user_data = sqe.user_data;
+		cqe->res = ret;
+		cqe->addr_len = addr_len;
+		xnarch_write_memory_barrier();
+		ring->shared->cq_tail = ++ring->cq_tail;
+		ring->inflight--;
+
+		if (xnsynch_flush(&ring->cq_synch, 0) == XNSYNCH_RESCHED)
+			xnpod_schedule();
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+static void rtdm_ring_free(struct rtdm_ring *ring)
+{
+	unsigned int n;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring->dying = 1;
+	xnsynch_destroy(&ring->sq_synch);
+	xnsynch_destroy(&ring->cq_synch);
+
+	/*
+	 * Workers may be blocked in a driver, or about to block there
+	 * before noticing the ring is going away. Kick them: this
+	 * breaks their current wait, and makes any further one fail
+	 * with -EINTR, until they exit.
+	 */
+	for (n = 0; n < ring->nr_workers; n++) {
+		xnthread_set_info(&ring->workers[n], XNKICKED);
+		xnpod_unblock_thread(&ring->workers[n]);
+	}
+
+	xnpod_schedule();
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	for (n = 0; n < ring->nr_workers; n++)
+		rtdm_task_join_nrt(&ring->workers[n], 10);
+
+	xnlock_get_irqsave(&nklock, s);
+	while (ring->refs) {
+		xnlock_put_irqrestore(&nklock, s);
+		msleep(1);
+		xnlock_get_irqsave(&nklock, s);
+	}
+	xnlock_put_irqrestore(&nklock, s);
+
+	/*
+	 * The owner may still have the heap mapped, in which case the
+	 * actual release is deferred until the mapping goes away.
+	 */
+	xnheap_free(ring->heap, ring->shared);
+	xnheap_destroy_mapped(ring->heap, &rtdm_ring_release, NULL);
+	kfree(ring);
+}
+
+int rtdm_ring_setup(struct rtdm_process *process,
+		    const struct rtdm_ring_params *params,
+		    struct rtdm_ring_info *info)
+{
+	unsigned long hdrsize, sqsize, cqsize, memsize;
+	unsigned int buf_size, n;
+	struct rtdm_ring *ring;
+	char name[XNOBJECT_NAME_LEN];
+	xnheap_t *heap;
+	int id, err;
+	void *mem;
+	spl_t s;
+
+	if (params->sq_entries == 0 ||
+	    params->sq_entries > RTDM_RING_MAX_ENTRIES ||
+	    (params->sq_entries & (params->sq_entries - 1)) ||
+	    params->nr_bufs > RTDM_RING_MAX_ENTRIES ||
+	    params->buf_size > RTDM_RING_MAX_BUFSZ ||
+	    params->nr_workers == 0 ||
+	    params->nr_workers > RTDM_RING_MAX_WORKERS ||
+	    params->priority < RTDM_TASK_LOWEST_PRIORITY ||
+	    params->priority > RTDM_TASK_HIGHEST_PRIORITY)
+		return -EINVAL;
+
+	buf_size = xnheap_align(params->buf_size, XNHEAP_MINALIGNSZ);
+	hdrsize = xnheap_align(sizeof(struct rtdm_ring_shared),
+			       XNHEAP_MINALIGNSZ);
+	sqsize = xnheap_align(params->sq_entries * sizeof(struct rtdm_ring_sqe),
+			      XNHEAP_MINALIGNSZ);
+	cqsize = 2 * params->sq_entries * sizeof(struct rtdm_ring_cqe);
+	memsize = hdrsize + sqsize + cqsize
+		+ (unsigned long)params->nr_bufs * buf_size;
+
+	ring = kzalloc(sizeof(*ring) +
+		       params->nr_workers * sizeof(rtdm_task_t), GFP_KERNEL);
+	if (ring == NULL)
+		return -ENOMEM;
+
+	heap = (xnheap_t *)xnmalloc(sizeof(*heap));
+	if (heap == NULL) {
+		err = -ENOMEM;
+		goto fail_heap;
+	}
+
+	err = xnheap_init_mapped(heap, xnheap_rounded_size(memsize, PAGE_SIZE),
+				 XNARCH_SHARED_HEAP_FLAGS);
+	if (err) {
+		xnfree(heap);
+		goto fail_heap;
+	}
+
+	xnheap_set_label(heap, "rtdm ring: %d", current->pid);
+
+	mem = xnheap_alloc(heap, memsize);
+	if (mem == NULL) {
+		xnheap_destroy_mapped(heap, &rtdm_ring_release, NULL);
+		err = -ENOMEM;
+		goto fail_heap;
+	}
+	memset(mem, 0, hdrsize + sqsize + cqsize);
+
+	ring->owner = process;
+	ring->heap = heap;
+	ring->shared = mem;
+	ring->sqes = mem + hdrsize;
+	ring->cqes = mem + hdrsize + sqsize;
+	ring->bufs = mem + hdrsize + sqsize + cqsize;
+	ring->sq_entries = params->sq_entries;
+	ring->cq_entries = 2 * params->sq_entries;
+	ring->nr_bufs = params->nr_bufs;
+	ring->buf_size = buf_size;
+	xnsynch_init(&ring->sq_synch, XNSYNCH_FIFO, NULL);
+	xnsynch_init(&ring->cq_synch, XNSYNCH_PRIO, NULL);
+
+	ring->shared->sq_entries = ring->sq_entries;
+	ring->shared->cq_entries = ring->cq_entries;
+	ring->shared->nr_bufs = ring->nr_bufs;
+	ring->shared->buf_size = ring->buf_size;
+	ring->shared->sqes = hdrsize;
+	ring->shared->cqes = hdrsize + sqsize;
+	ring->shared->bufs = hdrsize + sqsize + cqsize;
+
+	for (n = 0; n < params->nr_workers; n++) {
+		snprintf(name, sizeof(name), "rtdm_ring/%d:%u",
+			 current->pid, n);
+		err = rtdm_task_init(&ring->workers[n], name,
+				     rtdm_ring_worker, ring,
+				     params->priority, 0);
+		if (err)
+			goto fail_workers;
+		ring->nr_workers++;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+
+	for (id = 0; id < RTDM_RING_MAX; id++)
+		if (process->rings[id] == NULL) {
+			process->rings[id] = ring;
+			break;
+		}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (id == RTDM_RING_MAX) {
+		err = -EMFILE;
+		goto fail_workers;
+	}
+
+	info->ring = id;
+	info->hdesc.handle = (unsigned long)heap;
+	info->hdesc.size = xnheap_extentsize(heap);
+	info->hdesc.area = xnheap_base_memory(heap);
+	info->hdesc.used = xnheap_used_mem(heap);
+	info->offset = xnheap_mapped_offset(heap, mem);
+
+	return 0;
+
+  fail_workers:
+	/* Also releases the heap. */
+	rtdm_ring_free(ring);
+	return err;
+
+  fail_heap:
+	kfree(ring);
+	return err;
+}
+
+int rtdm_ring_enter(struct rtdm_process *process, int id,
+		    unsigned int to_submit, unsigned int min_complete,
+		    nanosecs_rel_t timeout)
+{
+	unsigned int avail, cq_used, room, nr = 0, n;
+	struct rtdm_ring *ring;
+	rtdm_toseq_t toseq;
+	xnflags_t info;
+	int err = 0;
+	spl_t s;
+
+	if ((unsigned int)id >= RTDM_RING_MAX)
+		return -EBADF;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	ring = process->rings[id];
+	if (ring == NULL || ring->dying) {
+		err = -EBADF;
+		goto unlock_out;
+	}
+
+	if (min_complete > ring->cq_entries) {
+		err = -EINVAL;
+		goto unlock_out;
+	}
+
+	ring->refs++;
+
+	if (to_submit) {
+		avail = ring->shared->sq_tail - ring->sq_limit;
+		cq_used = ring->cq_tail - ring->shared->cq_head;
+		if (avail > ring->sq_entries || cq_used > ring->cq_entries) {
+			err = -EINVAL;
+			goto put_out;
+		}
+
+		/* Every accepted SQE must be granted a free CQE. */
+		room = ring->cq_entries - cq_used;
+		room = room > ring->inflight ? room - ring->inflight : 0;
+		nr = min(to_submit, min(avail, room));
+
+		xnarch_read_memory_barrier();
+		ring->sq_limit += nr;
+		ring->inflight += nr;
+
+		for (n = 0; n < nr; n++)
+			if (xnsynch_wakeup_one_sleeper(&ring->sq_synch) == NULL)
+				break;
+		if (n)
+			xnpod_schedule();
+	}
+
+	if (min_complete && timeout > 0)
+		rtdm_toseq_init(&toseq, timeout);
+
+	while (ring->cq_tail - ring->shared->cq_head < min_complete) {
+		if (ring->dying) {
+			err = -EIDRM;
+			break;
+		}
+		if (timeout < 0) {
+			err = -EWOULDBLOCK;
+			break;
+		}
+
+		if (timeout > 0)
+			info = xnsynch_sleep_on(&ring->cq_synch, toseq,
+						XN_ABSOLUTE);
+		else
+			info = xnsynch_sleep_on(&ring->cq_synch,
+						XN_INFINITE, XN_RELATIVE);
+
+		if (info & XNRMID) {
+			err = -EIDRM;
+			break;
+		}
+		if (info & XNTIMEO) {
+			err = -ETIMEDOUT;
+			break;
+		}
+		if (info & XNBREAK) {
+			err = -EINTR;
+			break;
+		}
+	}
+
+  put_out:
+	ring->refs--;
+
+  unlock_out:
+	xnlock_put_irqrestore(&nklock, s);
+
+	/* Report what was submitted even if the wait failed. */
+	return nr ? nr : err;
+}
+
+int rtdm_ring_destroy(struct rtdm_process *process, int id)
+{
+	struct rtdm_ring *ring;
+	spl_t s;
+
+	if ((unsigned int)id >= RTDM_RING_MAX)
+		return -EBADF;
+
+	xnlock_get_irqsave(&nklock, s);
+	ring = process->rings[id];
+	process->rings[id] = NULL;
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (ring == NULL)
+		return -EBADF;
+
+	rtdm_ring_free(ring);
+
+	return 0;
+}
+
+void rtdm_ring_cleanup(struct rtdm_process *process)
+{
+	int id;
+
+	for (id = 0; id < RTDM_RING_MAX; id++)
+		if (process->rings[id])
+			rtdm_ring_destroy(process, id);
+}
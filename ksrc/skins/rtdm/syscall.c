@@ -116,6 +116,79 @@ static int sys_rtdm_sendmsg(struct pt_regs *regs)
 				__xn_reg_arg3(regs));
 }
 
+#ifdef CONFIG_XENO_OPT_RTDM_RING
+
+static inline struct rtdm_process *rtdm_current_process(void)
+{
+	xnshadow_ppd_t *ppd;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	ppd = xnshadow_ppd_get(__rtdm_muxid);
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ppd ? container_of(ppd, struct rtdm_process, ppd) : NULL;
+}
+
+static int sys_rtdm_ring_setup(struct pt_regs *regs)
+{
+	struct rtdm_process *process = rtdm_current_process();
+	struct rtdm_ring_params params;
+	struct rtdm_ring_info info;
+	int ret;
+
+	if (process == NULL)
+		return -EPERM;
+
+	if (__xn_safe_copy_from_user(&params,
+				     (void __user *)__xn_reg_arg1(regs),
+				     sizeof(params)))
+		return -EFAULT;
+
+	ret = rtdm_ring_setup(process, &params, &info);
+	if (ret)
+		return ret;
+
+	if (__xn_safe_copy_to_user((void __user *)__xn_reg_arg2(regs),
+				   &info, sizeof(info))) {
+		rtdm_ring_destroy(process, info.ring);
+		return -EFAULT;
+	}
+
+	return 0;
+}
+
+static int sys_rtdm_ring_enter(struct pt_regs *regs)
+{
+	struct rtdm_process *process = rtdm_current_process();
+	nanosecs_rel_t timeout = 0;
+
+	if (process == NULL)
+		return -EPERM;
+
+	if (__xn_reg_arg4(regs) &&
+	    __xn_safe_copy_from_user(&timeout,
+				     (void __user *)__xn_reg_arg4(regs),
+				     sizeof(timeout)))
+		return -EFAULT;
+
+	return rtdm_ring_enter(process, __xn_reg_arg1(regs),
+			       __xn_reg_arg2(regs), __xn_reg_arg3(regs),
+			       timeout);
+}
+
+static int sys_rtdm_ring_destroy(struct pt_regs *regs)
+{
+	struct rtdm_process *process = rtdm_current_process();
+
+	if (process == NULL)
+		return -EPERM;
+
+	return rtdm_ring_destroy(process, __xn_reg_arg1(regs));
+}
+
+#endif /* CONFIG_XENO_OPT_RTDM_RING */
+
 static void *rtdm_skin_callback(int event, void *data)
 {
 	struct rtdm_process *process;
@@ -130,6 +203,9 @@ static void *rtdm_skin_callback(int event, void *data)
 		memcpy(process->name, current->comm, sizeof(process->name));
 		process->pid = current->pid;
 #endif /* CONFIG_XENO_OPT_VFILE */
+#ifdef CONFIG_XENO_OPT_RTDM_RING
+		memset(process->rings, 0, sizeof(process->rings));
+#endif /* CONFIG_XENO_OPT_RTDM_RING */
 
 		return &process->ppd;
 
@@ -137,6 +213,8 @@ static void *rtdm_skin_callback(int event, void *data)
 		process = container_of((xnshadow_ppd_t *) data,
 				       struct rtdm_process, ppd);
 
+		/* Rings refer to the process descriptors, drop them first. */
+		rtdm_ring_cleanup(process);
 		cleanup_owned_contexts(process);
 
 		xnarch_free_host_mem(process, sizeof(*process));
@@ -162,6 +240,11 @@ static xnsysent_t __systab[] = {
 	    {sys_rtdm_recvmsg, __xn_exec_current | __xn_exec_adaptive},
 	[__rtdm_sendmsg] =
 	    {sys_rtdm_sendmsg, __xn_exec_current | __xn_exec_adaptive},
+#ifdef CONFIG_XENO_OPT_RTDM_RING
+	[__rtdm_ring_setup] = {sys_rtdm_ring_setup, __xn_exec_lostage},
+	[__rtdm_ring_enter] = {sys_rtdm_ring_enter, __xn_exec_primary},
+	[__rtdm_ring_destroy] = {sys_rtdm_ring_destroy, __xn_exec_lostage},
+#endif /* CONFIG_XENO_OPT_RTDM_RING */
 };
 
 static struct xnskin_props __props = {
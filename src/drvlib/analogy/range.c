@@ -519,13 +519,11 @@ int a4l_ultoraw(a4l_chinfo_t * chan, void *dst, unsigned long *src, int cnt)
 int a4l_ftoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, float *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int size, j;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	float a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -533,21 +531,8 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	if (size < 0)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((float)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -555,14 +540,22 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 	b = ((float)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
-
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
-
-		/* Updates the counters */
-		i += size;
-		j++;
+	/* Performs the conversions with one loop per sample size, so
+	   that large blocks are converted without any indirect call */
+	switch (size) {
+	case 4:
+		for (j = 0; j < cnt; j++)
+			((lsampl_t *)dst)[j] = (lsampl_t) (a * src[j] - b);
+		break;
+	case 2:
+		for (j = 0; j < cnt; j++)
+			((sampl_t *)dst)[j] =
+				0xffff & (lsampl_t) (a * src[j] - b);
+		break;
+	default:
+		for (j = 0; j < cnt; j++)
+			((unsigned char *)dst)[j] =
+				0xff & (lsampl_t) (a * src[j] - b);
 	}
 
 	return j;
@@ -589,13 +582,11 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 int a4l_dtoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, double *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int size, j;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	double a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
@@ -603,21 +594,8 @@ int a4l_dtoraw(a4l_chinfo_t * chan,
 
 	/* Find out the size in memory */
 	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	if (size < 0)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((double)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -625,14 +603,22 @@ int a4l_dtoraw(a4l_chinfo_t * chan,
 	b = ((double)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
-
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
-
-		/* Updates the counters */
-		i += size;
-		j++;
+	/* Performs the conversions with one loop per sample size, so
+	   that large blocks are converted without any indirect call */
+	switch (size) {
+	case 4:
+		for (j = 0; j < cnt; j++)
+			((lsampl_t *)dst)[j] = (lsampl_t) (a * src[j] - b);
+		break;
+	case 2:
+		for (j = 0; j < cnt; j++)
+			((sampl_t *)dst)[j] =
+				0xffff & (lsampl_t) (a * src[j] - b);
+		break;
+	default:
+		for (j = 0; j < cnt; j++)
+			((unsigned char *)dst)[j] =
+				0xff & (lsampl_t) (a * src[j] - b);
 	}
 
 	return j;
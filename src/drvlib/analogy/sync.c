@@ -22,6 +22,7 @@
 
 #include <stdarg.h>
 #include <errno.h>
+#include <sys/mman.h>
 
 #include <analogy/ioctl.h>
 #include <analogy/analogy.h>
@@ -93,6 +94,117 @@ int a4l_snd_insn(a4l_desc_t * dsc, a4l_insn_t * arg)
 	return __sys_ioctl(dsc->fd, A4L_INSN, arg);
 }
 
+/**
+ * @brief Prepare a list of synchronous acquisition misc operations
+ *
+ * The function a4l_prep_insnlist() checks a list of instructions and
+ * registers it into the kernel, so that it can be run many times
+ * thanks to a4l_exec_insnlist(), without any allocation or copy of
+ * the instructions and their data.
+ *
+ * The data of all the instructions are gathered into an area which
+ * is mapped into the process address space. On success, the data
+ * pointer of each instruction of the list arg->insns is updated so
+ * as to point to the location of its data within this area: the
+ * values to write must be set there before the list is executed and
+ * the read values are found there afterwards. The values pointed to
+ * by the original data pointers of the write instructions are used
+ * as initial contents.
+ *
+ * This function must be called from a non real-time context.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in,out] arg Prepared instructions list structure; the fields
+ * count and insns must be filled, the fields id, data and data_size
+ * are set on success
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong, or if
+ *    the data size of some instruction exceeds A4L_PREPARED_DATA_MAX
+ *    (Please, type "dmesg" for more info)
+ * - -EFAULT is returned if a user <-> kernel transfer went wrong
+ * - -ENOMEM is returned if the system is out of memory
+ * - -EAGAIN is returned if too many lists are prepared on the
+ *    descriptor
+ *
+ */
+int a4l_prep_insnlist(a4l_desc_t * dsc, a4l_insnprep_t * arg)
+{
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0)
+		return -EINVAL;
+
+	return __sys_ioctl(dsc->fd, A4L_INSNPREP, arg);
+}
+
+/**
+ * @brief Perform a prepared list of synchronous acquisition misc
+ * operations
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] arg Prepared instructions list structure filled by
+ * a4l_prep_insnlist()
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong (Please,
+ *    type "dmesg" for more info)
+ * - -EBUSY is returned if the list is already being executed or if
+ *    some subdevice is busy
+ *
+ */
+int a4l_exec_insnlist(a4l_desc_t * dsc, a4l_insnprep_t * arg)
+{
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0 || arg == NULL)
+		return -EINVAL;
+
+	return __sys_ioctl(dsc->fd, A4L_INSNEXEC, (void *)(long)arg->id);
+}
+
+/**
+ * @brief Release a prepared list of synchronous acquisition misc
+ * operations
+ *
+ * The function a4l_free_insnlist() unmaps the data area of the list
+ * and unregisters it from the kernel. This function must be called
+ * from a non real-time context.
+ *
+ * @param[in] dsc Device descriptor filled by a4l_open() (and
+ * optionally a4l_fill_desc())
+ * @param[in] arg Prepared instructions list structure filled by
+ * a4l_prep_insnlist()
+ *
+ * @return 0 on success. Otherwise:
+ *
+ * - -EINVAL is returned if some argument is missing or wrong
+ * - -EBUSY is returned if the list is being executed
+ *
+ */
+int a4l_free_insnlist(a4l_desc_t * dsc, a4l_insnprep_t * arg)
+{
+	int ret;
+
+	/* Basic checking */
+	if (dsc == NULL || dsc->fd < 0 || arg == NULL)
+		return -EINVAL;
+
+	ret = __sys_ioctl(dsc->fd, A4L_INSNRLS, (void *)(long)arg->id);
+	if (ret < 0)
+		return ret;
+
+	if (arg->data != NULL)
+		munmap(arg->data, arg->data_size);
+
+	arg->data = NULL;
+	arg->data_size = 0;
+
+	return 0;
+}
+
 /** @} Synchronous acquisition API */
 
 /** @} Level 1 API */
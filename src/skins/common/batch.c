@@ -0,0 +1,106 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include <asm/xenomai/syscall.h>
+#include <asm-generic/batch.h>
+
+struct xeno_batch {
+	int count;
+	struct xnsys_batch_entry entries[XNSYS_BATCH_MAX];
+};
+
+#ifdef HAVE___THREAD
+
+static __thread struct xeno_batch xeno_batch;
+
+static inline struct xeno_batch *xeno_get_batch(void)
+{
+	return &xeno_batch;
+}
+
+#else /* !HAVE___THREAD */
+
+static pthread_key_t xeno_batch_key;
+
+static void init_batch_key(void)
+{
+	int err = pthread_key_create(&xeno_batch_key, free);
+	if (err) {
+		fprintf(stderr, "Xenomai: error creating TSD key: %s\n",
+			strerror(err));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static struct xeno_batch *xeno_get_batch(void)
+{
+	static pthread_once_t xeno_batch_key_once = PTHREAD_ONCE_INIT;
+	struct xeno_batch *batch;
+
+	pthread_once(&xeno_batch_key_once, init_batch_key);
+
+	batch = pthread_getspecific(xeno_batch_key);
+	if (batch == NULL) {
+		batch = calloc(1, sizeof(*batch));
+		if (batch)
+			pthread_setspecific(xeno_batch_key, batch);
+	}
+
+	return batch;
+}
+
+#endif /* !HAVE___THREAD */
+
+long *__xeno_batch_add(unsigned long muxcode,
+		       unsigned long a1, unsigned long a2, unsigned long a3,
+		       unsigned long a4, unsigned long a5)
+{
+	struct xeno_batch *batch = xeno_get_batch();
+	struct xnsys_batch_entry *entry;
+
+	if (batch == NULL || batch->count >= XNSYS_BATCH_MAX)
+		return NULL;
+
+	entry = &batch->entries[batch->count++];
+	entry->muxcode = muxcode;
+	entry->args[0] = a1;
+	entry->args[1] = a2;
+	entry->args[2] = a3;
+	entry->args[3] = a4;
+	entry->args[4] = a5;
+	entry->result = -EINTR;
+
+	return &entry->result;
+}
+
+int xeno_batch_submit(void)
+{
+	struct xeno_batch *batch = xeno_get_batch();
+	int ret;
+
+	if (batch == NULL || batch->count == 0)
+		return 0;
+
+	ret = XENOMAI_SYSCALL2(__xn_sys_batch, batch->entries, batch->count);
+	batch->count = 0;
+
+	return ret;
+}
+
+void xeno_batch_discard(void)
+{
+	struct xeno_batch *batch = xeno_get_batch();
+
+	if (batch)
+		batch->count = 0;
+}
+
+int xeno_batch_pending(void)
+{
+	struct xeno_batch *batch = xeno_get_batch();
+
+	return batch ? batch->count : 0;
+}
@@ -0,0 +1,84 @@
+#include <errno.h>
+
+#include <asm/xenomai/syscall.h>
+#include <asm-generic/fastmutex.h>
+
+#ifdef CONFIG_XENO_FASTSYNCH
+
+void xeno_fastmutex_count(xnarch_atomic_t *counter)
+{
+	unsigned long old;
+
+	do
+		old = xnarch_atomic_get(counter);
+	while (xnarch_atomic_cmpxchg(counter, old, old + 1) != old);
+}
+
+#ifdef CONFIG_SMP
+static int xeno_fastmutex_owner_running(struct xnsynch_fastmutex *fm)
+{
+	struct xnthread_user_window *u_window;
+	unsigned long offset;
+
+	offset = xnarch_atomic_get(&fm->owner_window);
+	if (offset == XNSYNCH_NO_WINDOW)
+		return 0;
+
+	u_window = (struct xnthread_user_window *)(xeno_sem_heap[0] + offset);
+
+	return u_window->oncpu != 0;
+}
+#endif /* CONFIG_SMP */
+
+/*
+ * Called when the fast path found the mutex locked by another
+ * thread. Returns 0 if the lock was grabbed while spinning, -EAGAIN
+ * if the caller should go for the kernel path.
+ */
+int xeno_fastmutex_spin(struct xnsynch_fastmutex *fm, xnhandle_t cur)
+{
+#ifdef CONFIG_SMP
+	unsigned long long end;
+	xnhandle_t state;
+#endif /* CONFIG_SMP */
+
+	xeno_fastmutex_count(&fm->stats.contended);
+
+#ifdef CONFIG_SMP
+	/* spinmax is zero for process-shared mutexes and on UP. */
+	if (!fm->adaptive || fm->spinmax == 0)
+		goto slow;
+
+	end = __xn_rdtsc() + fm->spinmax;
+
+	do {
+		state = xnarch_atomic_get(&fm->lock);
+		if (state == XN_NO_HANDLE) {
+			if (xnarch_atomic_cmpxchg(&fm->lock, XN_NO_HANDLE, cur)
+			    == XN_NO_HANDLE) {
+				xeno_fastmutex_count(&fm->stats.spun);
+				return 0;
+			}
+			continue;
+		}
+
+		/*
+		 * Once a waiter sleeps in the kernel, the owner hands
+		 * the mutex over to it upon release, so spinning is
+		 * pointless. Same if the owner is not running.
+		 */
+		if ((state & XNSYNCH_FLCLAIM) ||
+		    !xeno_fastmutex_owner_running(fm))
+			break;
+
+		cpu_relax();
+	} while (__xn_rdtsc() < end);
+
+  slow:
+#endif /* CONFIG_SMP */
+	xeno_fastmutex_count(&fm->stats.slow);
+
+	return -EAGAIN;
+}
+
+#endif /* CONFIG_XENO_FASTSYNCH */
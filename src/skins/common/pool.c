@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <alloca.h>
+
+#include <asm/xenomai/syscall.h>
+#include <asm-generic/current.h>
+#include <asm-generic/stack.h>
+#include <asm-generic/pool.h>
+
+/* Keep a safety margin below the stack limit. */
+#define XENO_POOL_STACK_GUARD	(16 * 1024)
+
+int xeno_pool_init(struct xeno_pool *pool, unsigned nr, unsigned stksize)
+{
+	unsigned n;
+
+	if (nr == 0)
+		return -EINVAL;
+
+	pool->workers = calloc(nr, sizeof(*pool->workers));
+	if (pool->workers == NULL)
+		return -ENOMEM;
+
+	for (n = 0; n < nr; n++)
+		xnarch_atomic_set(&pool->workers[n].state, XENO_POOL_STARTING);
+
+	stksize = xeno_stacksize(stksize);
+	pool->prefault = stksize > 2 * XENO_POOL_STACK_GUARD ?
+		stksize - XENO_POOL_STACK_GUARD : 0;
+	pool->nr = nr;
+	xnarch_atomic_set(&pool->next, 0);
+
+	return 0;
+}
+
+static __attribute__((noinline)) void xeno_pool_prefault(unsigned long size)
+{
+	volatile char *stk;
+	unsigned long n;
+
+	if (size == 0)
+		return;
+
+	stk = alloca(size);
+	for (n = 0; n < size; n += getpagesize())
+		stk[n] = 0xA5;
+	stk[size - 1] = 0xA5;
+}
+
+void xeno_pool_worker(struct xeno_pool *pool, unsigned n)
+{
+	struct xeno_pool_worker *w = &pool->workers[n];
+	int err;
+
+	xeno_pool_prefault(pool->prefault);
+
+	w->handle = xeno_get_current();
+	xnarch_write_memory_barrier();
+	xnarch_atomic_set(&w->state, XENO_POOL_IDLE);
+
+	for (;;) {
+		err = XENOMAI_SYSCALL0(__xn_sys_park);
+		if (err == -EINTR)
+			continue;
+		if (err) {
+			xnarch_atomic_set(&w->state, XENO_POOL_EXIT);
+			return;
+		}
+
+		switch (xnarch_atomic_get(&w->state)) {
+		case XENO_POOL_BUSY:
+			w->entry(w->cookie);
+			xnarch_memory_barrier();
+			xnarch_atomic_set(&w->state, XENO_POOL_IDLE);
+			break;
+
+		case XENO_POOL_EXIT:
+			return;
+		}
+	}
+}
+
+int xeno_pool_wait_ready(struct xeno_pool *pool)
+{
+	unsigned n;
+
+	for (n = 0; n < pool->nr; n++) {
+		while (xnarch_atomic_get(&pool->workers[n].state)
+		       == XENO_POOL_STARTING)
+			usleep(1000);
+		if (xnarch_atomic_get(&pool->workers[n].state)
+		    == XENO_POOL_EXIT)
+			return -EAGAIN;
+	}
+
+	return 0;
+}
+
+int xeno_pool_claim(struct xeno_pool *pool)
+{
+	unsigned start, i, n;
+
+	start = xnarch_atomic_get(&pool->next);
+
+	for (i = 0; i < pool->nr; i++) {
+		n = (start + i) % pool->nr;
+		if (xnarch_atomic_cmpxchg(&pool->workers[n].state,
+					  XENO_POOL_IDLE, XENO_POOL_BUSY)
+		    == XENO_POOL_IDLE) {
+			xnarch_atomic_set(&pool->next, n + 1);
+			return n;
+		}
+	}
+
+	return -EAGAIN;
+}
+
+int xeno_pool_activate(struct xeno_pool *pool, unsigned n, int prio,
+		       void (*entry)(void *cookie), void *cookie)
+{
+	struct xeno_pool_worker *w = &pool->workers[n];
+	int err;
+
+	w->entry = entry;
+	w->cookie = cookie;
+	xnarch_write_memory_barrier();
+
+	err = XENOMAI_SYSCALL2(__xn_sys_unpark, w->handle, prio);
+	if (err)
+		xnarch_atomic_set(&w->state, XENO_POOL_IDLE);
+
+	return err;
+}
+
+int xeno_pool_dispatch(struct xeno_pool *pool, int prio,
+		       void (*entry)(void *cookie), void *cookie)
+{
+	int n, err;
+
+	n = xeno_pool_claim(pool);
+	if (n < 0)
+		return n;
+
+	err = xeno_pool_activate(pool, n, prio, entry, cookie);
+
+	return err ?: n;
+}
+
+void xeno_pool_shutdown(struct xeno_pool *pool)
+{
+	struct xeno_pool_worker *w;
+	unsigned n;
+
+	for (n = 0; n < pool->nr; n++) {
+		w = &pool->workers[n];
+		for (;;) {
+			if (xnarch_atomic_get(&w->state) == XENO_POOL_EXIT)
+				break;
+			if (xnarch_atomic_cmpxchg(&w->state, XENO_POOL_IDLE,
+						  XENO_POOL_EXIT)
+			    == XENO_POOL_IDLE) {
+				XENOMAI_SYSCALL2(__xn_sys_unpark, w->handle, -1);
+				break;
+			}
+			/* Still starting up, or running a job. */
+			usleep(1000);
+		}
+	}
+}
+
+void xeno_pool_destroy(struct xeno_pool *pool)
+{
+	free(pool->workers);
+	pool->workers = NULL;
+	pool->nr = 0;
+}
@@ -49,6 +49,12 @@ int rt_alarm_stop(RT_ALARM *alarm)
 	return XENOMAI_SKINCALL1(__native_muxid, __native_alarm_stop, alarm);
 }
 
+int rt_alarm_set_slack(RT_ALARM *alarm, RTIME slack)
+{
+	return XENOMAI_SKINCALL2(__native_muxid,
+				 __native_alarm_set_slack, alarm, &slack);
+}
+
 int rt_alarm_inquire(RT_ALARM *alarm, RT_ALARM_INFO *info)
 {
 	return XENOMAI_SKINCALL2(__native_muxid,
@@ -23,6 +23,7 @@
 #include <native/mutex.h>
 #include <asm-generic/current.h>
 #include <asm-generic/sem_heap.h>
+#include <asm-generic/fastmutex.h>
 
 extern int __native_muxid;
 
@@ -81,6 +82,8 @@ static int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout, xntmode_t mode
 {
 	int err;
 #ifdef CONFIG_XENO_FASTSYNCH
+	struct xnsynch_fastmutex *fm =
+		(struct xnsynch_fastmutex *)mutex->fastlock;
 	unsigned long status;
 	xnhandle_t cur;
 
@@ -101,6 +104,7 @@ static int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout, xntmode_t mode
 		err = xnsynch_fast_acquire(mutex->fastlock, cur);
 		if (likely(!err)) {
 			mutex->lockcnt = 1;
+			xeno_fastmutex_set_owner(fm);
 			return 0;
 		}
 
@@ -114,6 +118,13 @@ static int rt_mutex_acquire_inner(RT_MUTEX *mutex, RTIME timeout, xntmode_t mode
 
 		if (timeout == TM_NONBLOCK && mode == XN_RELATIVE)
 			return -EWOULDBLOCK;
+
+		err = xeno_fastmutex_spin(fm, cur);
+		if (err == 0) {
+			mutex->lockcnt = 1;
+			xeno_fastmutex_set_owner(fm);
+			return 0;
+		}
 	} else if (xnsynch_fast_owner_check(mutex->fastlock, cur) == 0) {
 		/*
 		 * The application is buggy as it jumped to secondary mode
@@ -136,8 +147,10 @@ do_syscall:
 				__native_mutex_acquire, mutex, mode, &timeout);
 
 #ifdef CONFIG_XENO_FASTSYNCH
-	if (!err)
+	if (!err) {
 		mutex->lockcnt = 1;
+		xeno_fastmutex_set_owner(fm);
+	}
 #endif /* CONFIG_XENO_FASTSYNCH */
 
 	return err;
@@ -156,6 +169,8 @@ int rt_mutex_acquire_until(RT_MUTEX *mutex, RTIME timeout)
 int rt_mutex_release(RT_MUTEX *mutex)
 {
 #ifdef CONFIG_XENO_FASTSYNCH
+	struct xnsynch_fastmutex *fm =
+		(struct xnsynch_fastmutex *)mutex->fastlock;
 	unsigned long status;
 	xnhandle_t cur;
 
@@ -176,6 +191,8 @@ int rt_mutex_release(RT_MUTEX *mutex)
 		return 0;
 	}
 
+	xeno_fastmutex_clear_owner(fm);
+
 	if (likely(xnsynch_fast_release(mutex->fastlock, cur)))
 		return 0;
 
@@ -191,6 +208,22 @@ int rt_mutex_inquire(RT_MUTEX *mutex, RT_MUTEX_INFO *info)
 				 __native_mutex_inquire, mutex, info);
 }
 
+int rt_mutex_set_adaptive(RT_MUTEX *mutex, int adaptive)
+{
+#ifdef CONFIG_XENO_FASTSYNCH
+	struct xnsynch_fastmutex *fm =
+		(struct xnsynch_fastmutex *)mutex->fastlock;
+
+	if (fm == NULL)
+		return -EINVAL;
+
+	/* The mutex block is shared with the kernel, update it in place. */
+	fm->adaptive = !!adaptive;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	return 0;
+}
+
 /* Compatibility wrappers for pre-2.3 builds. */
 
 int rt_mutex_lock(RT_MUTEX *mutex, RTIME timeout)
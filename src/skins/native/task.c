@@ -30,6 +30,7 @@
 #include <asm-generic/sigshadow.h>
 #include <asm-generic/current.h>
 #include <asm-generic/stack.h>
+#include <asm-generic/pool.h>
 #include "wrappers.h"
 
 #ifdef HAVE___THREAD
@@ -426,7 +427,133 @@ int rt_task_reply(int flowid, RT_TASK_MCB *mcb_s)
 				 __native_task_reply, flowid, mcb_s);
 }
 
+int rt_task_reply_receive(int flowid, RT_TASK_MCB *mcb_s,
+			  RT_TASK_MCB *mcb_r, RTIME timeout)
+{
+	return XENOMAI_SKINCALL4(__native_muxid,
+				 __native_task_reply_receive,
+				 flowid, mcb_s, mcb_r, &timeout);
+}
+
 int rt_task_same(RT_TASK *task1, RT_TASK *task2)
 {
 	return task1->opaque == task2->opaque;
 }
+
+struct rt_task_pool_desc {
+	struct xeno_pool core;
+	struct rt_task_pool_slot {
+		RT_TASK task;
+		struct rt_task_pool_desc *desc;
+	} slots[0];
+};
+
+static void rt_task_pool_trampoline(void *cookie)
+{
+	struct rt_task_pool_slot *slot = cookie;
+	struct rt_task_pool_desc *desc = slot->desc;
+
+	xeno_pool_worker(&desc->core, slot - desc->slots);
+}
+
+static void rt_task_pool_free(struct rt_task_pool_desc *desc)
+{
+	unsigned n;
+
+	xeno_pool_shutdown(&desc->core);
+
+	for (n = 0; n < desc->core.nr; n++)
+		rt_task_join(&desc->slots[n].task);
+
+	xeno_pool_destroy(&desc->core);
+	free(desc);
+}
+
+int rt_task_pool_create(RT_TASK_POOL *pool,
+			const char *name, int nr, int stksize, int mode)
+{
+	char wname[XNOBJECT_NAME_LEN];
+	struct rt_task_pool_desc *desc;
+	struct rt_task_pool_slot *slot;
+	unsigned n;
+	int err;
+
+	if (nr <= 0)
+		return -EINVAL;
+
+	desc = malloc(sizeof(*desc) + nr * sizeof(desc->slots[0]));
+	if (desc == NULL)
+		return -ENOMEM;
+
+	err = xeno_pool_init(&desc->core, nr, stksize);
+	if (err) {
+		free(desc);
+		return err;
+	}
+
+	for (n = 0; n < (unsigned)nr; n++) {
+		slot = &desc->slots[n];
+		slot->desc = desc;
+		if (name)
+			snprintf(wname, sizeof(wname), "%s-%u", name, n);
+		err = rt_task_create(&slot->task, name ? wname : NULL,
+				     stksize, 1, mode | T_JOINABLE);
+		if (err)
+			goto fail;
+
+		err = rt_task_start(&slot->task, rt_task_pool_trampoline, slot);
+		if (err) {
+			rt_task_delete(&slot->task);
+			goto fail;
+		}
+	}
+
+	err = xeno_pool_wait_ready(&desc->core);
+	if (err) {
+		rt_task_pool_free(desc);
+		return err;
+	}
+
+	pool->opaque = desc;
+
+	return 0;
+
+  fail:
+	/* Only shut down the workers we managed to start. */
+	desc->core.nr = n;
+	rt_task_pool_free(desc);
+
+	return err;
+}
+
+int rt_task_spawn_from_pool(RT_TASK_POOL *pool, RT_TASK **taskp,
+			    int prio, void (*entry)(void *cookie), void *cookie)
+{
+	struct rt_task_pool_desc *desc = pool->opaque;
+	int n;
+
+	if (desc == NULL || prio < T_LOPRIO || prio > T_HIPRIO)
+		return -EINVAL;
+
+	n = xeno_pool_dispatch(&desc->core, prio, entry, cookie);
+	if (n < 0)
+		return n;
+
+	if (taskp)
+		*taskp = &desc->slots[n].task;
+
+	return 0;
+}
+
+int rt_task_pool_delete(RT_TASK_POOL *pool)
+{
+	struct rt_task_pool_desc *desc = pool->opaque;
+
+	if (desc == NULL)
+		return -EINVAL;
+
+	pool->opaque = NULL;
+	rt_task_pool_free(desc);
+
+	return 0;
+}
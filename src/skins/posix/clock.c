@@ -27,6 +27,7 @@
 #include <asm-generic/xenomai/timeconv.h>
 #include <sys/types.h>
 #include <nucleus/vdso.h>
+#include <asm-generic/current.h>
 
 extern int __pse51_muxid;
 
@@ -58,6 +59,14 @@ int __wrap_clock_getres(clockid_t clock_id, struct timespec *tp)
 	return -1;
 }
 
+static inline int __do_clock_gettime(clockid_t clock_id, struct timespec *tp)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_clock_gettime,
+				  clock_id,
+				  tp);
+}
+
 #ifdef XNARCH_HAVE_NONPRIV_TSC
 static int __do_clock_host_realtime(struct timespec *ts, void *tzp)
 {
@@ -102,6 +111,71 @@ retry:
 
 	return 0;
 }
+
+static int __do_clock_realtime(struct timespec *ts)
+{
+	struct xnvdso_wallclock_data *wallclock_data;
+	unsigned long long ns;
+	unsigned long rem;
+	unsigned int seq;
+	long long offset;
+
+	/*
+	 * The nucleus wallclock is the monotonic CPU time shifted by
+	 * a global offset, which is only meaningful to us with an
+	 * aperiodic time base.
+	 */
+	if (__pse51_sysinfo.tickval != 1 ||
+	    !xnvdso_test_feature(XNVDSO_FEAT_WALLCLOCK))
+		return -1;
+
+	wallclock_data = &nkvdso->wallclock_data;
+
+retry:
+	seq = xnread_seqcount_begin(&wallclock_data->seqcount);
+	offset = wallclock_data->offset;
+	if (xnread_seqcount_retry(&wallclock_data->seqcount, seq))
+		goto retry;
+
+	ns = xnarch_tsc_to_ns(__xn_rdtsc()) + offset;
+	ts->tv_sec = xnarch_divrem_billion(ns, &rem);
+	ts->tv_nsec = rem;
+
+	return 0;
+}
+
+static int __do_clock_thread_cputime(struct timespec *ts)
+{
+	struct xnthread_user_window *u_window;
+	unsigned long long exectime;
+	unsigned long rem;
+	unsigned int seq;
+
+	if (!xnvdso_test_feature(XNVDSO_FEAT_THREAD_EXECTIME))
+		return -1;
+
+	u_window = xeno_get_current_window();
+	if (u_window == NULL)
+		return -1;
+
+	/*
+	 * The nucleus publishes the accumulated exectime each time we
+	 * are switched in or out. While we run in primary mode, the
+	 * time elapsed since we were switched in is still ours.
+	 */
+retry:
+	seq = xnread_seqcount_begin(&u_window->seqcount);
+	exectime = u_window->exectime;
+	if (!(u_window->state & XNRELAX))
+		exectime += __xn_rdtsc() - u_window->lastswitch;
+	if (xnread_seqcount_retry(&u_window->seqcount, seq))
+		goto retry;
+
+	ts->tv_sec = xnarch_divrem_billion(xnarch_tsc_to_ns(exectime), &rem);
+	ts->tv_nsec = rem;
+
+	return 0;
+}
 #endif /* XNARCH_HAVE_NONPRIV_TSC */
 
 int __wrap_clock_gettime(clockid_t clock_id, struct timespec *tp)
@@ -113,6 +187,16 @@ int __wrap_clock_gettime(clockid_t clock_id, struct timespec *tp)
 	case CLOCK_HOST_REALTIME:
 		err = __do_clock_host_realtime(tp, NULL);
 		break;
+	case CLOCK_REALTIME:
+		if (__do_clock_realtime(tp) == 0)
+			return 0;
+		err = __do_clock_gettime(clock_id, tp);
+		break;
+	case CLOCK_THREAD_CPUTIME_ID:
+		if (__do_clock_thread_cputime(tp) == 0)
+			return 0;
+		err = __do_clock_gettime(clock_id, tp);
+		break;
 	case CLOCK_MONOTONIC:
 		if (__pse51_sysinfo.tickval == 1) {
 			unsigned long long ns;
@@ -126,10 +210,7 @@ int __wrap_clock_gettime(clockid_t clock_id, struct timespec *tp)
 		/* Falldown wanted */
 #endif /* XNARCH_HAVE_NONPRIV_TSC */
 	default:
-		err = -XENOMAI_SKINCALL2(__pse51_muxid,
-					 __pse51_clock_gettime,
-					 clock_id,
-					 tp);
+		err = __do_clock_gettime(clock_id, tp);
 	}
 
 	if (!err)
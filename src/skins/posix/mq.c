@@ -18,14 +18,284 @@
 
 #include <errno.h>
 #include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <posix/syscall.h>
 #include <pthread.h>
 #include <mqueue.h>
 
 extern int __pse51_muxid;
 
+void *xeno_map_heap(struct xnheap_desc *hd);
+
+/*
+ * Mappings of zero-copy queues, indexed by descriptor. Chunks are
+ * allocated on demand and never released, so that lookups from the
+ * fast path need no lock.
+ */
+#define ZCMAP_CHUNK_SHIFT  8
+#define ZCMAP_CHUNK_SIZE   (1 << ZCMAP_CHUNK_SHIFT)
+#define ZCMAP_NR_CHUNKS    256
+
+struct mq_zcmap {
+	struct pse51_mq_zcring *ring;
+	void *mapbase;
+	size_t mapsize;
+};
+
+static struct mq_zcmap **zcmaps[ZCMAP_NR_CHUNKS];
+
+static pthread_mutex_t zcmaps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline struct mq_zcmap *mq_zcmap_lookup(mqd_t q)
+{
+	struct mq_zcmap **chunk;
+
+	if (q >= ZCMAP_NR_CHUNKS * ZCMAP_CHUNK_SIZE)
+		return NULL;
+
+	chunk = zcmaps[q >> ZCMAP_CHUNK_SHIFT];
+
+	return chunk ? chunk[q & (ZCMAP_CHUNK_SIZE - 1)] : NULL;
+}
+
+static int mq_zcmap_attach(mqd_t q)
+{
+	struct pse51_mq_zcinfo info;
+	struct mq_zcmap **chunk;
+	struct mq_zcmap *map;
+	int err;
+
+	if (q >= ZCMAP_NR_CHUNKS * ZCMAP_CHUNK_SIZE)
+		return EMFILE;
+
+	err = -XENOMAI_SKINCALL2(__pse51_muxid, __pse51_mq_zcinfo, q, &info);
+	if (err)
+		return err;
+
+	map = malloc(sizeof(*map));
+	if (!map)
+		return ENOMEM;
+
+	map->mapbase = xeno_map_heap(&info.hdesc);
+	if (map->mapbase == MAP_FAILED) {
+		free(map);
+		return ENOMEM;
+	}
+	map->mapsize = info.hdesc.size;
+	map->ring = (struct pse51_mq_zcring *)
+		((char *)map->mapbase + info.ringoff);
+
+	pthread_mutex_lock(&zcmaps_lock);
+
+	chunk = zcmaps[q >> ZCMAP_CHUNK_SHIFT];
+	if (chunk == NULL) {
+		chunk = calloc(ZCMAP_CHUNK_SIZE, sizeof(*chunk));
+		if (chunk == NULL) {
+			pthread_mutex_unlock(&zcmaps_lock);
+			__real_munmap(map->mapbase, map->mapsize);
+			free(map);
+			return ENOMEM;
+		}
+		zcmaps[q >> ZCMAP_CHUNK_SHIFT] = chunk;
+	}
+	chunk[q & (ZCMAP_CHUNK_SIZE - 1)] = map;
+
+	pthread_mutex_unlock(&zcmaps_lock);
+
+	return 0;
+}
+
+static void mq_zcmap_detach(mqd_t q)
+{
+	struct mq_zcmap *map;
+
+	map = mq_zcmap_lookup(q);
+	if (map == NULL)
+		return;
+
+	pthread_mutex_lock(&zcmaps_lock);
+	zcmaps[q >> ZCMAP_CHUNK_SHIFT][q & (ZCMAP_CHUNK_SIZE - 1)] = NULL;
+	pthread_mutex_unlock(&zcmaps_lock);
+
+	__real_munmap(map->mapbase, map->mapsize);
+	free(map);
+}
+
+/* Return the slot holding @buf, or NULL if @buf is not a slot payload. */
+static struct pse51_mq_zcslot *mq_zcmap_slot(struct mq_zcmap *map, void *buf)
+{
+	struct pse51_mq_zcring *ring = map->ring;
+	unsigned long off;
+
+	off = (char *)pse51_mq_zcdata2slot(buf) - ((char *)ring + ring->slots);
+	if (off >= ring->nslots * ring->slotsize || off % ring->slotsize)
+		return NULL;
+
+	return pse51_mq_zcdata2slot(buf);
+}
+
+static int mq_zc_wait(mqd_t q, int dir, const struct timespec *abs_timeout)
+{
+	int err, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	err = -XENOMAI_SKINCALL3(__pse51_muxid,
+				 __pse51_mq_zcwait, q, dir, abs_timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	return err;
+}
+
+static int mq_zc_reserve(struct mq_zcmap *map, mqd_t q,
+			 struct pse51_mq_zcslot **slotp,
+			 const struct timespec *abs_timeout)
+{
+	struct pse51_mq_zcring *ring = map->ring;
+	struct pse51_mq_zcslot *slot;
+	unsigned long pos;
+	long diff;
+	int err;
+
+	for (;;) {
+		pos = xnarch_atomic_get(&ring->head);
+		slot = pse51_mq_zcslot(ring, pos);
+		diff = (long)(xnarch_atomic_get(&slot->seq) - pos);
+		if (diff == 0) {
+			if (xnarch_atomic_cmpxchg(&ring->head, pos, pos + 1) == pos)
+				break;
+		} else if (diff < 0) {
+			/* Queue full, wait for a receiver to release a slot. */
+			err = mq_zc_wait(q, PSE51_MQ_ZCSEND, abs_timeout);
+			if (err)
+				return err;
+		} else
+			cpu_relax();
+	}
+
+	*slotp = slot;
+
+	return 0;
+}
+
+static void mq_zc_commit(struct mq_zcmap *map, mqd_t q,
+			 struct pse51_mq_zcslot *slot, size_t len)
+{
+	struct pse51_mq_zcring *ring = map->ring;
+
+	slot->len = len;
+	xnarch_write_memory_barrier();
+	xnarch_atomic_set(&slot->seq, xnarch_atomic_get(&slot->seq) + 1);
+	xnarch_memory_barrier();
+
+	if (xnarch_atomic_get(&ring->rwaiters))
+		XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mq_zcwake, q, PSE51_MQ_ZCRECV);
+}
+
+static int mq_zc_fetch(struct mq_zcmap *map, mqd_t q,
+		       struct pse51_mq_zcslot **slotp,
+		       const struct timespec *abs_timeout)
+{
+	struct pse51_mq_zcring *ring = map->ring;
+	struct pse51_mq_zcslot *slot;
+	unsigned long pos;
+	long diff;
+	int err;
+
+	for (;;) {
+		pos = xnarch_atomic_get(&ring->tail);
+		slot = pse51_mq_zcslot(ring, pos);
+		diff = (long)(xnarch_atomic_get(&slot->seq) - (pos + 1));
+		if (diff == 0) {
+			if (xnarch_atomic_cmpxchg(&ring->tail, pos, pos + 1) == pos)
+				break;
+		} else if (diff < 0) {
+			/* Queue empty, wait for a sender to commit a message. */
+			err = mq_zc_wait(q, PSE51_MQ_ZCRECV, abs_timeout);
+			if (err)
+				return err;
+		} else
+			cpu_relax();
+	}
+
+	xnarch_read_memory_barrier();
+	*slotp = slot;
+
+	return 0;
+}
+
+static void mq_zc_release(struct mq_zcmap *map, mqd_t q,
+			  struct pse51_mq_zcslot *slot)
+{
+	struct pse51_mq_zcring *ring = map->ring;
+
+	/* Hand the slot over to the producer of the next lap. */
+	xnarch_memory_barrier();
+	xnarch_atomic_set(&slot->seq,
+			  xnarch_atomic_get(&slot->seq) + ring->nslots - 1);
+	xnarch_memory_barrier();
+
+	if (xnarch_atomic_get(&ring->swaiters))
+		XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mq_zcwake, q, PSE51_MQ_ZCSEND);
+}
+
+static int mq_zc_send(struct mq_zcmap *map, mqd_t q,
+		      const char *buffer, size_t len,
+		      const struct timespec *abs_timeout)
+{
+	struct pse51_mq_zcslot *slot;
+	int err;
+
+	if (len > map->ring->msgsize)
+		return EMSGSIZE;
+
+	err = mq_zc_reserve(map, q, &slot, abs_timeout);
+	if (err)
+		return err;
+
+	memcpy(slot->data, buffer, len);
+	mq_zc_commit(map, q, slot, len);
+
+	return 0;
+}
+
+static ssize_t mq_zc_receive(struct mq_zcmap *map, mqd_t q,
+			     char *buffer, size_t len, unsigned *prio,
+			     const struct timespec *abs_timeout)
+{
+	struct pse51_mq_zcslot *slot;
+	int err;
+
+	if (len < map->ring->msgsize) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	err = mq_zc_fetch(map, q, &slot, abs_timeout);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	len = slot->len;
+	memcpy(buffer, slot->data, len);
+	mq_zc_release(map, q, slot);
+
+	/* Zero-copy queues are FIFO, priorities are not conveyed. */
+	if (prio)
+		*prio = 0;
+
+	return len;
+}
+
 mqd_t __wrap_mq_open(const char *name, int oflags, ...)
 {
 	struct mq_attr *attr = NULL;
@@ -47,10 +317,21 @@ mqd_t __wrap_mq_open(const char *name, int oflags, ...)
 
 	err = -XENOMAI_SKINCALL5(__pse51_muxid,
 				 __pse51_mq_open, name, oflags, mode, attr, q);
+	if (err)
+		goto fail;
+
+	if (oflags & MQ_ZEROCOPY) {
+		err = mq_zcmap_attach(q);
+		if (err) {
+			XENOMAI_SKINCALL1(__pse51_muxid, __pse51_mq_close, q);
+			goto fail;
+		}
+	}
 
-	if (!err)
-		return (mqd_t) q;
+	return (mqd_t) q;
 
+  fail:
+	__real_close(q);
 	errno = err;
 	return (mqd_t) - 1;
 }
@@ -60,8 +341,10 @@ int __wrap_mq_close(mqd_t q)
 	int err;
 
 	err = XENOMAI_SKINCALL1(__pse51_muxid, __pse51_mq_close, q);
-	if (!err)
+	if (!err) {
+		mq_zcmap_detach(q);
 		return __real_close(q);
+	}
 
 	errno = -err;
 	return -1;
@@ -108,19 +391,26 @@ int __wrap_mq_setattr(mqd_t q,
 
 int __wrap_mq_send(mqd_t q, const char *buffer, size_t len, unsigned prio)
 {
+	struct mq_zcmap *map;
 	int err, oldtype;
 
+	map = mq_zcmap_lookup(q);
+	if (map) {
+		err = mq_zc_send(map, q, buffer, len, NULL);
+		goto out;
+	}
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
-	err = XENOMAI_SKINCALL4(__pse51_muxid,
-				__pse51_mq_send, q, buffer, len, prio);
+	err = -XENOMAI_SKINCALL4(__pse51_muxid,
+				 __pse51_mq_send, q, buffer, len, prio);
 
 	pthread_setcanceltype(oldtype, NULL);
-
+  out:
 	if (!err)
 		return 0;
 
-	errno = -err;
+	errno = err;
 	return -1;
 }
 
@@ -129,28 +419,40 @@ int __wrap_mq_timedsend(mqd_t q,
 			size_t len,
 			unsigned prio, const struct timespec *timeout)
 {
+	struct mq_zcmap *map;
 	int err, oldtype;
 
+	map = mq_zcmap_lookup(q);
+	if (map) {
+		err = mq_zc_send(map, q, buffer, len, timeout);
+		goto out;
+	}
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
-	err = XENOMAI_SKINCALL5(__pse51_muxid,
-				__pse51_mq_timedsend,
-				q, buffer, len, prio, timeout);
+	err = -XENOMAI_SKINCALL5(__pse51_muxid,
+				 __pse51_mq_timedsend,
+				 q, buffer, len, prio, timeout);
 
 	pthread_setcanceltype(oldtype, NULL);
-
+  out:
 	if (!err)
 		return 0;
 
-	errno = -err;
+	errno = err;
 	return -1;
 }
 
 ssize_t __wrap_mq_receive(mqd_t q, char *buffer, size_t len, unsigned *prio)
 {
 	ssize_t rlen = (ssize_t) len;
+	struct mq_zcmap *map;
 	int err, oldtype;
 
+	map = mq_zcmap_lookup(q);
+	if (map)
+		return mq_zc_receive(map, q, buffer, len, prio, NULL);
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SKINCALL4(__pse51_muxid,
@@ -172,8 +474,13 @@ ssize_t __wrap_mq_timedreceive(mqd_t q,
 			       const struct timespec * __restrict__ timeout)
 {
 	ssize_t rlen = (ssize_t) len;
+	struct mq_zcmap *map;
 	int err, oldtype;
 
+	map = mq_zcmap_lookup(q);
+	if (map)
+		return mq_zc_receive(map, q, buffer, len, prio, timeout);
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SKINCALL5(__pse51_muxid,
@@ -202,3 +509,93 @@ int __wrap_mq_notify(mqd_t mqdes, const struct sigevent *notification)
 
 	return 0;
 }
+
+int mq_reserve_np(mqd_t q, void **bufp, size_t len,
+		  const struct timespec *abs_timeout)
+{
+	struct pse51_mq_zcslot *slot;
+	struct mq_zcmap *map;
+	int err;
+
+	map = mq_zcmap_lookup(q);
+	if (map == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (len > map->ring->msgsize) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	err = mq_zc_reserve(map, q, &slot, abs_timeout);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	slot->len = len;
+	*bufp = slot->data;
+
+	return 0;
+}
+
+int mq_commit_np(mqd_t q, void *buf, size_t len)
+{
+	struct pse51_mq_zcslot *slot;
+	struct mq_zcmap *map;
+
+	map = mq_zcmap_lookup(q);
+	if (map == NULL || (slot = mq_zcmap_slot(map, buf)) == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (len > map->ring->msgsize) {
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	mq_zc_commit(map, q, slot, len);
+
+	return 0;
+}
+
+ssize_t mq_fetch_np(mqd_t q, void **bufp, const struct timespec *abs_timeout)
+{
+	struct pse51_mq_zcslot *slot;
+	struct mq_zcmap *map;
+	int err;
+
+	map = mq_zcmap_lookup(q);
+	if (map == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	err = mq_zc_fetch(map, q, &slot, abs_timeout);
+	if (err) {
+		errno = err;
+		return -1;
+	}
+
+	*bufp = slot->data;
+
+	return slot->len;
+}
+
+int mq_release_np(mqd_t q, void *buf)
+{
+	struct pse51_mq_zcslot *slot;
+	struct mq_zcmap *map;
+
+	map = mq_zcmap_lookup(q);
+	if (map == NULL || (slot = mq_zcmap_slot(map, buf)) == NULL) {
+		errno = EINVAL;
+		return -1;
+	}
+
+	mq_zc_release(map, q, slot);
+
+	return 0;
+}
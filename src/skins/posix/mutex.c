@@ -25,6 +25,7 @@
 #include <posix/cb_lock.h>
 #include <asm-generic/current.h>
 #include <asm-generic/sem_heap.h>
+#include <asm-generic/fastmutex.h>
 
 extern int __pse51_muxid;
 
@@ -38,6 +39,11 @@ static xnarch_atomic_t *get_ownerp(struct __shadow_mutex *shadow)
 
 	return (xnarch_atomic_t *) (xeno_sem_heap[1] + shadow->owner_offset);
 }
+
+static struct xnsynch_fastmutex *get_fastmutex(struct __shadow_mutex *shadow)
+{
+	return (struct xnsynch_fastmutex *)get_ownerp(shadow);
+}
 #endif /* CONFIG_XENO_FASTSYNCH */
 
 int __wrap_pthread_mutexattr_init(pthread_mutexattr_t *attr)
@@ -91,6 +97,21 @@ int __wrap_pthread_mutexattr_setpshared(pthread_mutexattr_t *attr, int pshared)
 				  __pse51_mutexattr_setpshared, attr, pshared);
 }
 
+int pthread_mutexattr_getadaptive_np(const pthread_mutexattr_t *attr,
+				     int *adaptive)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_getadaptive_np,
+				  attr, adaptive);
+}
+
+int pthread_mutexattr_setadaptive_np(pthread_mutexattr_t *attr, int adaptive)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_mutexattr_setadaptive_np,
+				  attr, adaptive);
+}
+
 int __wrap_pthread_mutex_init(pthread_mutex_t *mutex,
 			      const pthread_mutexattr_t *attr)
 {
@@ -174,8 +195,11 @@ int __wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
 		goto do_syscall;
 
 	err = xnsynch_fast_acquire(get_ownerp(shadow), cur);
+	if (err == -EAGAIN)
+		err = xeno_fastmutex_spin(get_fastmutex(shadow), cur);
 	if (likely(!err)) {
 		shadow->lockcnt = 1;
+		xeno_fastmutex_set_owner(get_fastmutex(shadow));
 		cb_read_unlock(&shadow->lock, s);
 		return 0;
 	}
@@ -207,6 +231,8 @@ int __wrap_pthread_mutex_lock(pthread_mutex_t *mutex)
 	} while (err == -EINTR);
 
 #ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		xeno_fastmutex_set_owner(get_fastmutex(shadow));
   out:
 	cb_read_unlock(&shadow->lock, s);
 #endif /* CONFIG_XENO_FASTSYNCH */
@@ -243,8 +269,11 @@ int __wrap_pthread_mutex_timedlock(pthread_mutex_t *mutex,
 		goto do_syscall;
 
 	err = xnsynch_fast_acquire(get_ownerp(shadow), cur);
+	if (err == -EAGAIN)
+		err = xeno_fastmutex_spin(get_fastmutex(shadow), cur);
 	if (likely(!err)) {
 		shadow->lockcnt = 1;
+		xeno_fastmutex_set_owner(get_fastmutex(shadow));
 		cb_read_unlock(&shadow->lock, s);
 		return 0;
 	}
@@ -277,6 +306,8 @@ int __wrap_pthread_mutex_timedlock(pthread_mutex_t *mutex,
 	} while (err == -EINTR);
 
 #ifdef CONFIG_XENO_FASTSYNCH
+	if (!err)
+		xeno_fastmutex_set_owner(get_fastmutex(shadow));
   out:
 	cb_read_unlock(&shadow->lock, s);
 #endif /* CONFIG_XENO_FASTSYNCH */
@@ -326,6 +357,7 @@ int __wrap_pthread_mutex_trylock(pthread_mutex_t *mutex)
 
 	if (likely(!err)) {
 		shadow->lockcnt = 1;
+		xeno_fastmutex_set_owner(get_fastmutex(shadow));
 		cb_read_unlock(&shadow->lock, s);
 		return 0;
 	}
@@ -352,6 +384,8 @@ do_syscall:
 	} while (err == -EINTR);
 	if (err == -ETIMEDOUT || err == -EDEADLK)
 		err = -EBUSY;
+	else if (!err)
+		xeno_fastmutex_set_owner(get_fastmutex(shadow));
 
 	cb_read_unlock(&shadow->lock, s);
 
@@ -405,6 +439,8 @@ int __wrap_pthread_mutex_unlock(pthread_mutex_t *mutex)
 		goto out;
 	}
 
+	xeno_fastmutex_clear_owner((struct xnsynch_fastmutex *)ownerp);
+
 	if (likely(xnsynch_fast_release(ownerp, cur))) {
 	  out:
 		cb_read_unlock(&shadow->lock, s);
@@ -426,3 +462,34 @@ do_syscall:
 
 	return -err;
 }
+
+int pthread_mutex_getstats_np(pthread_mutex_t *mutex,
+			      struct pthread_mutex_stats_np *stats)
+{
+	union __xeno_mutex *_mutex = (union __xeno_mutex *)mutex;
+	struct __shadow_mutex *shadow = &_mutex->shadow_mutex;
+#ifdef CONFIG_XENO_FASTSYNCH
+	struct xnsynch_fastmutex *fm;
+#endif /* CONFIG_XENO_FASTSYNCH */
+
+	if (unlikely(cb_try_read_lock(&shadow->lock, s)))
+		return EINVAL;
+
+#ifdef CONFIG_XENO_FASTSYNCH
+	if (unlikely(shadow->magic != PSE51_MUTEX_MAGIC)) {
+		cb_read_unlock(&shadow->lock, s);
+		return EINVAL;
+	}
+
+	fm = get_fastmutex(shadow);
+	stats->contended = xnarch_atomic_get(&fm->stats.contended);
+	stats->spun = xnarch_atomic_get(&fm->stats.spun);
+	stats->slow = xnarch_atomic_get(&fm->stats.slow);
+#else /* !CONFIG_XENO_FASTSYNCH */
+	stats->contended = stats->spun = stats->slow = 0;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
+	cb_read_unlock(&shadow->lock, s);
+
+	return 0;
+}
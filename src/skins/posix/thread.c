@@ -29,6 +29,7 @@
 #include <asm-generic/current.h>
 #include <asm-generic/sigshadow.h>
 #include <asm-generic/stack.h>
+#include <asm-generic/pool.h>
 
 extern int __pse51_muxid;
 
@@ -301,6 +302,12 @@ int pthread_wait_np(unsigned long *overruns_r)
 	return err;
 }
 
+int pthread_getrelstat_np(pthread_t thread, pthread_relstat_np_t *stat)
+{
+	return -XENOMAI_SKINCALL2(__pse51_muxid,
+				  __pse51_thread_getrelstat_np, thread, stat);
+}
+
 int pthread_set_mode_np(int clrmask, int setmask)
 {
 	int err;
@@ -351,3 +358,147 @@ static __constructor__ void pse51_thread_init(void)
 	linuxthreads = 1;
 #endif /* !_CS_GNU_LIBPTHREAD_VERSION */
 }
+
+struct pthread_pool_desc {
+	struct xeno_pool core;
+	struct pthread_pool_slot {
+		pthread_t tid;
+		void *(*start)(void *);
+		void *arg;
+		struct pthread_pool_desc *desc;
+	} slots[0];
+};
+
+static void *pthread_pool_worker(void *cookie)
+{
+	struct pthread_pool_slot *slot = cookie;
+	struct pthread_pool_desc *desc = slot->desc;
+
+	xeno_pool_worker(&desc->core, slot - desc->slots);
+
+	return NULL;
+}
+
+static void pthread_pool_run(void *cookie)
+{
+	struct pthread_pool_slot *slot = cookie;
+
+	slot->start(slot->arg);
+}
+
+static void pthread_pool_free(struct pthread_pool_desc *desc)
+{
+	unsigned n;
+
+	xeno_pool_shutdown(&desc->core);
+
+	for (n = 0; n < desc->core.nr; n++)
+		pthread_join(desc->slots[n].tid, NULL);
+
+	xeno_pool_destroy(&desc->core);
+	free(desc);
+}
+
+int pthread_pool_create_np(pthread_pool_np_t *pool, unsigned nr,
+			   const pthread_attr_t *attr)
+{
+	struct pthread_pool_desc *desc;
+	struct sched_param param;
+	pthread_attr_t iattr;
+	size_t stksz;
+	unsigned n;
+	int err;
+
+	if (nr == 0)
+		return EINVAL;
+
+	if (attr)
+		memcpy(&iattr, attr, sizeof(iattr));
+	else {
+		pthread_attr_init(&iattr);
+		pthread_attr_setinheritsched(&iattr, PTHREAD_EXPLICIT_SCHED);
+		pthread_attr_setschedpolicy(&iattr, SCHED_FIFO);
+		param.sched_priority = 1;
+		pthread_attr_setschedparam(&iattr, &param);
+	}
+	/* Workers are reaped when the pool is destroyed. */
+	pthread_attr_setdetachstate(&iattr, PTHREAD_CREATE_JOINABLE);
+	pthread_attr_getstacksize(&iattr, &stksz);
+
+	desc = malloc(sizeof(*desc) + nr * sizeof(desc->slots[0]));
+	if (desc == NULL)
+		return ENOMEM;
+
+	err = -xeno_pool_init(&desc->core, nr, stksz);
+	if (err) {
+		free(desc);
+		return err;
+	}
+
+	for (n = 0; n < nr; n++) {
+		desc->slots[n].desc = desc;
+		err = __wrap_pthread_create(&desc->slots[n].tid, &iattr,
+					    pthread_pool_worker,
+					    &desc->slots[n]);
+		if (err) {
+			/* Only shut down the workers we managed to start. */
+			desc->core.nr = n;
+			pthread_pool_free(desc);
+			return err;
+		}
+	}
+
+	err = -xeno_pool_wait_ready(&desc->core);
+	if (err) {
+		pthread_pool_free(desc);
+		return err;
+	}
+
+	pool->opaque = desc;
+
+	return 0;
+}
+
+int pthread_spawn_from_pool_np(pthread_pool_np_t *pool, pthread_t *tid,
+			       int prio, void *(*start)(void *), void *arg)
+{
+	struct pthread_pool_desc *desc = pool->opaque;
+	struct pthread_pool_slot *slot;
+	int n, err;
+
+	if (desc == NULL ||
+	    prio < sched_get_priority_min(SCHED_FIFO) ||
+	    prio > sched_get_priority_max(SCHED_FIFO))
+		return EINVAL;
+
+	n = xeno_pool_claim(&desc->core);
+	if (n < 0)
+		return -n;
+
+	slot = &desc->slots[n];
+	slot->start = start;
+	slot->arg = arg;
+
+	err = -xeno_pool_activate(&desc->core, n, prio,
+				  pthread_pool_run, slot);
+	if (err)
+		return err;
+
+	if (tid)
+		*tid = slot->tid;
+
+	return 0;
+}
+
+int pthread_pool_destroy_np(pthread_pool_np_t *pool)
+{
+	struct pthread_pool_desc *desc = pool->opaque;
+
+	if (desc == NULL)
+		return EINVAL;
+
+	pool->opaque = NULL;
+	pthread_pool_free(desc);
+
+	return 0;
+}
@@ -102,3 +102,18 @@ int __wrap_timer_getoverrun(timer_t timerid)
 
 	return -1;
 }
+
+int timer_setslack_np(timer_t timerid, const struct timespec *slack)
+{
+	int err = -XENOMAI_SKINCALL2(__pse51_muxid,
+				     __pse51_timer_setslack_np,
+				     timerid,
+				     slack);
+
+	if (!err)
+		return 0;
+
+	errno = err;
+
+	return -1;
+}
@@ -0,0 +1,172 @@
+/*
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <asm/xenomai/atomic.h>
+#include <rtdm/ring.h>
+#include <rtdm/syscall.h>
+#include <asm-generic/xenomai/timeconv.h>
+
+void *xeno_map_heap(struct xnheap_desc *hd);
+
+/* Indexes owned by the kernel, updated behind our back. */
+#define ring_peer_index(p)	(*(volatile unsigned int *)&(p))
+
+int rt_dev_ring_setup(rt_dev_ring_t *ring,
+		      const struct rtdm_ring_params *params)
+{
+	struct rtdm_ring_shared *shared;
+	struct rtdm_ring_info info;
+	void *base;
+	int err;
+
+	if (__rtdm_muxid < 0)
+		return -ENOSYS;
+
+	err = XENOMAI_SKINCALL2(__rtdm_muxid,
+				__rtdm_ring_setup, params, &info);
+	if (err)
+		return err;
+
+	base = xeno_map_heap(&info.hdesc);
+	if (base == MAP_FAILED) {
+		XENOMAI_SKINCALL1(__rtdm_muxid, __rtdm_ring_destroy, info.ring);
+		return -ENOMEM;
+	}
+
+	shared = (struct rtdm_ring_shared *)((char *)base + info.offset);
+
+	ring->id = info.ring;
+	ring->shared = shared;
+	ring->sqes = (struct rtdm_ring_sqe *)((char *)shared + shared->sqes);
+	ring->cqes = (struct rtdm_ring_cqe *)((char *)shared + shared->cqes);
+	ring->bufs = (char *)shared + shared->bufs;
+	ring->sq_mask = shared->sq_entries - 1;
+	ring->cq_mask = shared->cq_entries - 1;
+	ring->sq_tail = 0;
+	ring->sq_submitted = 0;
+	ring->mapbase = base;
+	ring->mapsize = info.hdesc.size;
+
+	return 0;
+}
+
+int rt_dev_ring_destroy(rt_dev_ring_t *ring)
+{
+	int err;
+
+	err = XENOMAI_SKINCALL1(__rtdm_muxid, __rtdm_ring_destroy, ring->id);
+	munmap(ring->mapbase, ring->mapsize);
+
+	return err;
+}
+
+struct rtdm_ring_sqe *rt_dev_ring_get_sqe(rt_dev_ring_t *ring)
+{
+	struct rtdm_ring_shared *shared = ring->shared;
+
+	if (ring->sq_tail - ring_peer_index(shared->sq_head) > ring->sq_mask)
+		return NULL;
+
+	return &ring->sqes[ring->sq_tail++ & ring->sq_mask];
+}
+
+int rt_dev_ring_submit(rt_dev_ring_t *ring, unsigned int min_complete,
+		       nanosecs_rel_t timeout)
+{
+	unsigned int to_submit;
+	int ret;
+
+	xnarch_write_memory_barrier();
+	ring->shared->sq_tail = ring->sq_tail;
+
+	to_submit = ring->sq_tail - ring->sq_submitted;
+	if (to_submit == 0 && min_complete == 0)
+		return 0;
+
+	ret = XENOMAI_SKINCALL4(__rtdm_muxid, __rtdm_ring_enter, ring->id,
+				to_submit, min_complete, &timeout);
+	if (ret > 0)
+		ring->sq_submitted += ret;
+
+	return ret;
+}
+
+struct rtdm_ring_cqe *rt_dev_ring_peek_cqe(rt_dev_ring_t *ring)
+{
+	struct rtdm_ring_shared *shared = ring->shared;
+	unsigned int head = shared->cq_head;
+
+	if (ring_peer_index(shared->cq_tail) == head)
+		return NULL;
+
+	xnarch_read_memory_barrier();
+
+	return &ring->cqes[head & ring->cq_mask];
+}
+
+static long long ring_clock_ns(void)
+{
+#ifdef XNARCH_HAVE_NONPRIV_TSC
+	return xnarch_tsc_to_ns(__xn_rdtsc());
+#else /* !XNARCH_HAVE_NONPRIV_TSC */
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif /* !XNARCH_HAVE_NONPRIV_TSC */
+}
+
+int rt_dev_ring_wait_cqe(rt_dev_ring_t *ring, struct rtdm_ring_cqe **cqep,
+			 nanosecs_rel_t timeout)
+{
+	long long deadline = 0;
+	int ret;
+
+	if (timeout > 0)
+		deadline = ring_clock_ns() + timeout;
+
+	for (;;) {
+		*cqep = rt_dev_ring_peek_cqe(ring);
+		if (*cqep)
+			return 0;
+
+		/* Each round only waits for what is left of the timeout. */
+		if (timeout > 0) {
+			timeout = deadline - ring_clock_ns();
+			if (timeout <= 0)
+				return -ETIMEDOUT;
+		}
+
+		/*
+		 * Pending submissions are flushed first; the enter call
+		 * reports them instead of a wait failure, which will be
+		 * caught on the next round.
+		 */
+		ret = rt_dev_ring_submit(ring, 1, timeout);
+		if (ret < 0)
+			return ret;
+	}
+}
+
+void rt_dev_ring_cqe_seen(rt_dev_ring_t *ring)
+{
+	/* Hand the entry back to the kernel once we are done with it. */
+	xnarch_memory_barrier();
+	ring->shared->cq_head++;
+}
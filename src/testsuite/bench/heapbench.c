@@ -0,0 +1,357 @@
+/*
+ * Replay allocation traces against a native heap, measuring the cost
+ * of rt_heap_alloc()/rt_heap_free() from primary mode, the memory
+ * lost to rounding, and the fraction of free memory which cannot be
+ * used anymore once the heap is fragmented. Comparing the results of
+ * kernels built with and without CONFIG_XENO_OPT_HEAP_TLSF gives the
+ * relative merits of both allocators. Results are printed as
+ * <metric>,<unit>,<value> lines, as expected by xeno-bench.
+ *
+ * Besides the built-in synthetic traces, a trace file may be given,
+ * containing one operation per line:
+ *   a <id> <size>	# allocate <size> bytes, remembered as <id>
+ *   f <id>		# free the block remembered as <id>
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <native/task.h>
+#include <native/heap.h>
+#include <native/timer.h>
+
+#define MAX_IDS		65536
+#define TRACE_LEN	20000
+
+struct op {
+	unsigned id;
+	unsigned long size;	/* Zero means free. */
+};
+
+struct trace {
+	const char *name;
+	struct op *ops;
+	int nr_ops;
+	unsigned long maxsize;
+};
+
+static int duration = 5;
+static unsigned long heapsize = 256 * 1024;
+static unsigned seed = 1;
+
+static RT_HEAP heap;
+static void *blocks[MAX_IDS];
+static unsigned long sizes[MAX_IDS];
+
+static unsigned long rnd(unsigned long max)
+{
+	return (unsigned long)rand_r(&seed) % max;
+}
+
+static int add_op(struct trace *t, unsigned id, unsigned long size)
+{
+	if (t->nr_ops % 1024 == 0) {
+		t->ops = realloc(t->ops, (t->nr_ops + 1024) * sizeof(*t->ops));
+		if (t->ops == NULL)
+			return -1;
+	}
+	t->ops[t->nr_ops].id = id;
+	t->ops[t->nr_ops++].size = size;
+	if (size > t->maxsize)
+		t->maxsize = size;
+
+	return 0;
+}
+
+/* Producer/consumer: small messages released in FIFO order. */
+static void gen_queue(struct trace *t)
+{
+	unsigned head = 0, tail = 0;
+	int n;
+
+	for (n = 0; n < TRACE_LEN; n++) {
+		if (head - tail >= 64 || (head > tail && rnd(3) == 0))
+			add_op(t, tail++ % MAX_IDS, 0);
+		else
+			add_op(t, head++ % MAX_IDS, 16 + rnd(497));
+	}
+}
+
+/* Random lifetimes over a slot table, given a size distribution. */
+static void gen_random(struct trace *t, int slots,
+		       unsigned long (*size)(void))
+{
+	char *live = calloc(slots, 1);
+	int n, i;
+
+	for (n = 0; n < TRACE_LEN; n++) {
+		i = rnd(slots);
+		add_op(t, i, live[i] ? 0 : size());
+		live[i] = !live[i];
+	}
+
+	free(live);
+}
+
+/* Log-uniform sizes between 8 bytes and 16k. */
+static unsigned long mixed_size(void)
+{
+	int shift = 3 + rnd(11);
+
+	return (1UL << shift) + rnd(1UL << shift);
+}
+
+static unsigned long large_size(void)
+{
+	return (1 + rnd(8)) * 4096 - rnd(64);
+}
+
+static void gen_mixed(struct trace *t)
+{
+	gen_random(t, 256, mixed_size);
+}
+
+static void gen_large(struct trace *t)
+{
+	gen_random(t, 32, large_size);
+}
+
+static struct {
+	const char *name;
+	void (*gen)(struct trace *t);
+} builtin_traces[] = {
+	{ "queue", gen_queue },
+	{ "mixed", gen_mixed },
+	{ "large", gen_large },
+};
+
+static int load_trace(struct trace *t, const char *path)
+{
+	unsigned long size;
+	char line[128], op;
+	unsigned id;
+	FILE *f;
+	int n;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		perror(path);
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || line[0] == '\n')
+			continue;
+		size = 0;
+		n = sscanf(line, "%c %u %lu", &op, &id, &size);
+		if (n < 2 || id >= MAX_IDS || (op == 'a' && (n != 3 || !size))
+		    || (op != 'a' && op != 'f')) {
+			fprintf(stderr, "heapbench: %s: bad line: %s", path, line);
+			fclose(f);
+			return -1;
+		}
+		add_op(t, id, op == 'a' ? size : 0);
+	}
+
+	fclose(f);
+
+	return 0;
+}
+
+static void release_all(void)
+{
+	int id;
+
+	for (id = 0; id < MAX_IDS; id++)
+		if (blocks[id]) {
+			rt_heap_free(&heap, blocks[id]);
+			blocks[id] = NULL;
+		}
+}
+
+static void run_trace(struct trace *t)
+{
+	unsigned long long alloc_tsc = 0, free_tsc = 0, allocs = 0, frees = 0;
+	unsigned long long requested = 0, end;
+	RTIME t0, dt, alloc_max = 0, free_max = 0;
+	unsigned long failures = 0, nr_fill = 0;
+	double waste = 0, frag = 0;
+	int n, pass, err;
+	RT_HEAP_INFO info;
+	void **fill;
+	void *ptr;
+
+	end = rt_timer_tsc2ns(rt_timer_tsc()) + duration * 1000000000ULL;
+
+	for (pass = 0;; pass++) {
+		for (n = 0; n < t->nr_ops; n++) {
+			struct op *op = &t->ops[n];
+
+			if (op->size == 0) {
+				if (blocks[op->id] == NULL)
+					continue;
+				t0 = rt_timer_tsc();
+				rt_heap_free(&heap, blocks[op->id]);
+				dt = rt_timer_tsc() - t0;
+				free_tsc += dt;
+				if (dt > free_max)
+					free_max = dt;
+				frees++;
+				blocks[op->id] = NULL;
+				requested -= sizes[op->id];
+				continue;
+			}
+
+			if (blocks[op->id]) {
+				rt_heap_free(&heap, blocks[op->id]);
+				blocks[op->id] = NULL;
+				requested -= sizes[op->id];
+			}
+
+			t0 = rt_timer_tsc();
+			err = rt_heap_alloc(&heap, op->size, TM_NONBLOCK, &ptr);
+			dt = rt_timer_tsc() - t0;
+			if (err) {
+				failures++;
+				continue;
+			}
+			alloc_tsc += dt;
+			if (dt > alloc_max)
+				alloc_max = dt;
+			allocs++;
+			blocks[op->id] = ptr;
+			sizes[op->id] = op->size;
+			requested += op->size;
+		}
+
+		if (pass > 0) {
+			if (rt_timer_tsc2ns(rt_timer_tsc()) >= end)
+				break;
+			release_all();
+			requested = 0;
+			continue;
+		}
+
+		/*
+		 * First pass done: measure the rounding waste on the
+		 * live set, then fill the heap with blocks of the
+		 * largest traced size, to find out how much of the
+		 * free memory is still usable.
+		 */
+		rt_heap_inquire(&heap, &info);
+		if (info.usedmem)
+			waste = 100.0 * (info.usedmem - requested) / info.usedmem;
+
+		fill = calloc(info.heapsize / 16 + 1, sizeof(*fill));
+		while (fill &&
+		       rt_heap_alloc(&heap, t->maxsize, TM_NONBLOCK,
+				     &fill[nr_fill]) == 0)
+			nr_fill++;
+		rt_heap_inquire(&heap, &info);
+		frag = 100.0 * (info.usablemem - info.usedmem) / info.usablemem;
+		while (nr_fill > 0)
+			rt_heap_free(&heap, fill[--nr_fill]);
+		free(fill);
+		release_all();
+		requested = 0;
+	}
+
+	release_all();
+
+	printf("heap.%s.alloc_ns,ns,%.1f\n", t->name,
+	       allocs ? (double)rt_timer_tsc2ns(alloc_tsc) / allocs : 0.0);
+	printf("heap.%s.alloc_max_ns,ns,%llu\n", t->name,
+	       (unsigned long long)rt_timer_tsc2ns(alloc_max));
+	printf("heap.%s.free_ns,ns,%.1f\n", t->name,
+	       frees ? (double)rt_timer_tsc2ns(free_tsc) / frees : 0.0);
+	printf("heap.%s.free_max_ns,ns,%llu\n", t->name,
+	       (unsigned long long)rt_timer_tsc2ns(free_max));
+	printf("heap.%s.waste_pct,%%,%.2f\n", t->name, waste);
+	printf("heap.%s.frag_pct,%%,%.2f\n", t->name, frag);
+	printf("heap.%s.failures,count,%.2f\n", t->name,
+	       (double)failures / (pass + 1));
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: heapbench [options]\n"
+		"  [-T <seconds>]         # duration per trace, default=5\n"
+		"  [-s <bytes>]           # heap size, default=256k\n"
+		"  [-t <trace>]           # queue, mixed, large or a trace file,\n"
+		"                         # default is all built-in traces\n"
+		"  [-S <seed>]            # seed of the synthetic traces\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	struct trace traces[3];
+	const char *only = NULL;
+	int c, n, nr_traces = 0;
+	RT_TASK task;
+	unsigned u;
+	int err;
+
+	while ((c = getopt(argc, argv, "T:s:t:S:")) != EOF)
+		switch (c) {
+		case 'T':
+			duration = atoi(optarg);
+			break;
+
+		case 's':
+			heapsize = strtoul(optarg, NULL, 0);
+			break;
+
+		case 't':
+			only = optarg;
+			break;
+
+		case 'S':
+			seed = atoi(optarg);
+			break;
+
+		default:
+			usage();
+			exit(2);
+		}
+
+	memset(traces, 0, sizeof(traces));
+
+	for (u = 0; u < sizeof(builtin_traces) / sizeof(builtin_traces[0]); u++) {
+		if (only && strcmp(only, builtin_traces[u].name))
+			continue;
+		traces[nr_traces].name = builtin_traces[u].name;
+		builtin_traces[u].gen(&traces[nr_traces++]);
+	}
+
+	if (only && nr_traces == 0) {
+		traces[0].name = "file";
+		if (load_trace(&traces[0], only))
+			exit(EXIT_FAILURE);
+		nr_traces = 1;
+	}
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	err = rt_task_shadow(&task, "heapbench", 99, 0);
+	if (err) {
+		fprintf(stderr, "heapbench: rt_task_shadow: %s\n", strerror(-err));
+		exit(EXIT_FAILURE);
+	}
+
+	for (n = 0; n < nr_traces; n++) {
+		err = rt_heap_create(&heap, NULL, heapsize, H_PRIO);
+		if (err) {
+			fprintf(stderr, "heapbench: rt_heap_create: %s\n",
+				strerror(-err));
+			exit(EXIT_FAILURE);
+		}
+		run_trace(&traces[n]);
+		rt_heap_delete(&heap);
+		free(traces[n].ops);
+	}
+
+	return EXIT_SUCCESS;
+}
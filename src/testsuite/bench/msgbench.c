@@ -0,0 +1,198 @@
+/*
+ * Ping-pong between a client and a server task, through the native
+ * synchronous message passing services, measuring the round-trip
+ * time of rt_task_send() from the client. The server either loops on
+ * rt_task_reply() then rt_task_receive() ("split" mode), or on
+ * rt_task_reply_receive() ("combined" mode). Both tasks run on the
+ * same CPU unless told otherwise, which is where the direct handoff
+ * from the server to the client matters. Results are printed as
+ * <metric>,<unit>,<value> lines, as expected by xeno-bench.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <native/task.h>
+#include <native/timer.h>
+
+#define MAX_MSG_SIZE	4096
+
+#define OP_PING		1
+#define OP_QUIT		2
+
+static int duration = 5;
+static size_t msgsize = 16;
+static int cpu;
+static int spread;
+
+static const char *mode_names[] = { "split", "combined" };
+
+static void server(void *cookie)
+{
+	static char rbuf[MAX_MSG_SIZE], sbuf[MAX_MSG_SIZE];
+	int combined = (long)cookie, flowid = 0, ret;
+	RT_TASK_MCB mcb_r, mcb_s;
+
+	for (;;) {
+		mcb_r.data = rbuf;
+		mcb_r.size = sizeof(rbuf);
+		mcb_s.data = sbuf;
+		mcb_s.size = msgsize;
+		mcb_s.opcode = 0;
+
+		if (combined)
+			ret = rt_task_reply_receive(flowid, &mcb_s,
+						    &mcb_r, TM_INFINITE);
+		else {
+			if (flowid > 0) {
+				ret = rt_task_reply(flowid, &mcb_s);
+				if (ret)
+					break;
+			}
+			ret = rt_task_receive(&mcb_r, TM_INFINITE);
+		}
+
+		if (ret < 0) {
+			fprintf(stderr, "msgbench: server: %s\n", strerror(-ret));
+			break;
+		}
+
+		flowid = ret;
+		if (mcb_r.opcode == OP_QUIT) {
+			rt_task_reply(flowid, NULL);
+			break;
+		}
+	}
+}
+
+static int run_mode(int combined)
+{
+	static char rbuf[MAX_MSG_SIZE], sbuf[MAX_MSG_SIZE];
+	unsigned long long sum = 0, count = 0, end;
+	RTIME t0, dt, max = 0;
+	RT_TASK_MCB mcb_s, mcb_r;
+	RT_TASK srv;
+	ssize_t ret;
+	int err;
+
+	err = rt_task_create(&srv, NULL, 0, 60,
+			     T_JOINABLE | T_CPU(spread ? cpu + 1 : cpu));
+	if (err == 0)
+		err = rt_task_start(&srv, server, (void *)(long)combined);
+	if (err) {
+		fprintf(stderr, "msgbench: cannot start server: %s\n",
+			strerror(-err));
+		return err;
+	}
+
+	end = rt_timer_tsc2ns(rt_timer_tsc()) + duration * 1000000000ULL;
+
+	do {
+		mcb_s.opcode = OP_PING;
+		mcb_s.data = sbuf;
+		mcb_s.size = msgsize;
+		mcb_r.data = rbuf;
+		mcb_r.size = sizeof(rbuf);
+
+		t0 = rt_timer_tsc();
+		ret = rt_task_send(&srv, &mcb_s, &mcb_r, TM_INFINITE);
+		dt = rt_timer_tsc() - t0;
+		if (ret < 0) {
+			fprintf(stderr, "msgbench: rt_task_send: %s\n",
+				strerror(-ret));
+			break;
+		}
+
+		sum += dt;
+		if (dt > max)
+			max = dt;
+		count++;
+	} while ((count & 1023) || rt_timer_tsc2ns(rt_timer_tsc()) < end);
+
+	mcb_s.opcode = OP_QUIT;
+	mcb_s.size = 0;
+	mcb_r.size = 0;
+	rt_task_send(&srv, &mcb_s, &mcb_r, TM_INFINITE);
+	rt_task_join(&srv);
+	rt_task_delete(&srv);
+
+	printf("msg.%s.rtt_ns,ns,%.1f\n", mode_names[combined],
+	       count ? (double)rt_timer_tsc2ns(sum) / count : 0.0);
+	printf("msg.%s.rtt_max_ns,ns,%llu\n", mode_names[combined],
+	       (unsigned long long)rt_timer_tsc2ns(max));
+
+	return ret < 0 ? (int)ret : 0;
+}
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: msgbench [options]\n"
+		"  [-T <seconds>]         # duration per mode, default=5\n"
+		"  [-s <bytes>]           # message size, default=16\n"
+		"  [-m <mode>]            # split or combined, default is both\n"
+		"  [-c <cpu>]             # CPU to run on, default=0\n"
+		"  [-x]                   # run the server on the next CPU\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int c, mode = -1, err = 0;
+	RT_TASK task;
+
+	while ((c = getopt(argc, argv, "T:s:m:c:x")) != EOF)
+		switch (c) {
+		case 'T':
+			duration = atoi(optarg);
+			break;
+
+		case 's':
+			msgsize = strtoul(optarg, NULL, 0);
+			if (msgsize > MAX_MSG_SIZE) {
+				fprintf(stderr, "msgbench: message size "
+					"limited to %d bytes\n", MAX_MSG_SIZE);
+				exit(2);
+			}
+			break;
+
+		case 'm':
+			if (!strcmp(optarg, "split"))
+				mode = 0;
+			else if (!strcmp(optarg, "combined"))
+				mode = 1;
+			else {
+				usage();
+				exit(2);
+			}
+			break;
+
+		case 'c':
+			cpu = atoi(optarg);
+			break;
+
+		case 'x':
+			spread = 1;
+			break;
+
+		default:
+			usage();
+			exit(2);
+		}
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	err = rt_task_shadow(&task, "msgbench", 50, T_CPU(cpu));
+	if (err) {
+		fprintf(stderr, "msgbench: rt_task_shadow: %s\n", strerror(-err));
+		exit(EXIT_FAILURE);
+	}
+
+	if (mode != 1)
+		err = run_mode(0);
+	if (!err && mode != 0)
+		err = run_mode(1);
+
+	return err ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,112 @@
+/*
+ * Measure the cost of a short Xenomai syscall issued from primary
+ * mode, and of a round-trip through the Xenomai scheduler. Results are
+ * printed as <metric>,<unit>,<value> lines, as expected by xeno-bench.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#define BATCH_SIZE 1000
+
+static int duration = 5;
+
+static inline unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *bench(void *cookie)
+{
+	unsigned long long start, end, t0, dt, best = ~0ULL, sum = 0;
+	unsigned long long ybest = ~0ULL, ysum = 0;
+	unsigned long batches = 0;
+	struct timespec ts;
+	int i;
+
+	/* Switch to primary mode. */
+	ts.tv_sec = 0;
+	ts.tv_nsec = 1000000;
+	clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL);
+
+	start = now_ns();
+	end = start + duration * 1000000000ULL;
+
+	do {
+		/* clock_getres() always traps, without switching mode. */
+		t0 = now_ns();
+		for (i = 0; i < BATCH_SIZE; i++)
+			clock_getres(CLOCK_MONOTONIC, &ts);
+		dt = now_ns() - t0;
+		sum += dt;
+		if (dt < best)
+			best = dt;
+
+		/* sched_yield() goes through the rescheduling procedure. */
+		t0 = now_ns();
+		for (i = 0; i < BATCH_SIZE; i++)
+			sched_yield();
+		dt = now_ns() - t0;
+		ysum += dt;
+		if (dt < ybest)
+			ybest = dt;
+
+		batches++;
+	} while (t0 + dt < end);
+
+	printf("syscall.avg_ns,ns,%.1f\n",
+	       (double)sum / (batches * BATCH_SIZE));
+	printf("syscall.best_ns,ns,%.1f\n", (double)best / BATCH_SIZE);
+	printf("yield.avg_ns,ns,%.1f\n",
+	       (double)ysum / (batches * BATCH_SIZE));
+	printf("yield.best_ns,ns,%.1f\n", (double)ybest / BATCH_SIZE);
+
+	return NULL;
+}
+
+int main(int argc, char *const argv[])
+{
+	struct sched_param param;
+	pthread_attr_t attr;
+	pthread_t tid;
+	int c, err;
+
+	while ((c = getopt(argc, argv, "T:")) != EOF)
+		switch (c) {
+		case 'T':
+			duration = atoi(optarg);
+			break;
+
+		default:
+			fprintf(stderr, "usage: syscallbench [-T <seconds>]\n");
+			exit(2);
+		}
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	param.sched_priority = 99;
+	pthread_attr_setschedparam(&attr, &param);
+
+	err = pthread_create(&tid, &attr, bench, NULL);
+	if (err) {
+		fprintf(stderr, "syscallbench: pthread_create: %s\n",
+			strerror(err));
+		exit(EXIT_FAILURE);
+	}
+
+	pthread_join(tid, NULL);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,857 @@
+/*
+ * Benchmark harness: runs a suite of scenarios under fixed load
+ * profiles, collects their results in a common format, and compares
+ * them to a baseline to detect performance regressions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <math.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define MAX_SCENARIOS	64
+#define MAX_METRICS	512
+#define MAX_SAMPLES	32
+#define MAX_LOADERS	64
+
+#define NAME_LEN	64
+
+/*
+ * Load profiles, applied while a scenario runs:
+ * - none: idle system,
+ * - cpu: one busy loop per online CPU,
+ * - io: a process writing and syncing a scratch file,
+ * - hell: the dohell script from the test suite.
+ */
+enum load_type {
+	LOAD_NONE,
+	LOAD_CPU,
+	LOAD_IO,
+	LOAD_HELL,
+};
+
+static const char *load_names[] = {
+	[LOAD_NONE] = "none",
+	[LOAD_CPU] = "cpu",
+	[LOAD_IO] = "io",
+	[LOAD_HELL] = "hell",
+};
+
+struct scenario {
+	char name[NAME_LEN];
+	char tool[NAME_LEN];
+	enum load_type load;
+	int duration;
+	char args[256];
+};
+
+/* Results, one entry per scenario and metric, one sample per run. */
+struct metric {
+	char scenario[NAME_LEN];
+	char name[NAME_LEN];
+	char unit[16];
+	int nr_samples;
+	double samples[MAX_SAMPLES];
+};
+
+struct metric_table {
+	int nr_metrics;
+	struct metric metrics[MAX_METRICS];
+};
+
+static const struct scenario default_suite[] = {
+	{ "latency-user-idle", "latency", LOAD_NONE, 30, "-t 0" },
+	{ "latency-user-cpu", "latency", LOAD_CPU, 30, "-t 0" },
+	{ "latency-user-io", "latency", LOAD_IO, 30, "-t 0" },
+	{ "latency-kernel-cpu", "latency", LOAD_CPU, 30, "-t 1" },
+	{ "latency-irq-cpu", "latency", LOAD_CPU, 30, "-t 2" },
+	{ "switch-idle", "switchtest", LOAD_NONE, 10, "" },
+	{ "switch-cpu", "switchtest", LOAD_CPU, 10, "" },
+	{ "syscall-idle", "syscallbench", LOAD_NONE, 5, "" },
+	{ "syscall-cpu", "syscallbench", LOAD_CPU, 5, "" },
+	{ "heap-idle", "heapbench", LOAD_NONE, 5, "" },
+	{ "msg-idle", "msgbench", LOAD_NONE, 5, "" },
+};
+
+static struct scenario suite[MAX_SCENARIOS];
+static int nr_scenarios;
+
+static struct metric_table results, baseline;
+
+static pid_t loaders[MAX_LOADERS];
+static int nr_loaders;
+
+static const char *testdir = TESTDIR;
+static int repeat = 3;
+static double threshold = 5.0;	/* percent */
+static int verbose;
+
+static volatile sig_atomic_t sigexit;
+
+static void usage(void)
+{
+	fprintf(stderr,
+"usage: xeno-bench [options]\n"
+"  [-s <suite-file>]      # scenarios to run, default is the built-in suite\n"
+"  [-n <scenario>]        # only run the given scenario\n"
+"  [-r <runs>]            # runs per scenario, default=3 (max. %d)\n"
+"  [-o <file>]            # write results to <file>, usable as a baseline\n"
+"  [-b <baseline-file>]   # compare results to <baseline-file>\n"
+"  [-c <results-file>]    # compare <results-file> to the baseline, no run\n"
+"  [-t <percent>]         # regression threshold, default=5%%\n"
+"  [-l]                   # list the scenarios and exit\n"
+"  [-v]                   # show the output of the benchmark tools\n"
+"\n"
+"Suite files contain one scenario per line:\n"
+"  <name> <tool> <load> <duration-seconds> [tool arguments...]\n"
+"where <tool> is latency, switchtest, syscallbench, heapbench or msgbench,\n"
+"and <load> is none, cpu, io or hell. Empty lines and lines starting\n"
+"with # are ignored.\n"
+"\n"
+"xeno-bench exits with status 1 if a regression was detected.\n",
+		MAX_SAMPLES);
+}
+
+static int parse_load(const char *name)
+{
+	unsigned i;
+
+	for (i = 0; i < sizeof(load_names) / sizeof(load_names[0]); i++)
+		if (!strcmp(name, load_names[i]))
+			return i;
+
+	return -1;
+}
+
+static int load_suite(const char *path)
+{
+	char line[512], name[NAME_LEN], tool[NAME_LEN], load[NAME_LEN];
+	int lineno = 0, duration, pos, type;
+	struct scenario *s;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, "xeno-bench: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		char *p = line;
+
+		lineno++;
+		line[strcspn(line, "\n")] = '\0';
+		while (isspace(*p))
+			p++;
+		if (*p == '\0' || *p == '#')
+			continue;
+
+		if (sscanf(p, "%63s %63s %63s %d %n",
+			   name, tool, load, &duration, &pos) < 4 ||
+		    duration <= 0 || (type = parse_load(load)) < 0) {
+			fprintf(stderr, "xeno-bench: %s:%d: syntax error\n",
+				path, lineno);
+			goto fail;
+		}
+
+		if (nr_scenarios == MAX_SCENARIOS) {
+			fprintf(stderr, "xeno-bench: %s: too many scenarios\n",
+				path);
+			goto fail;
+		}
+
+		s = &suite[nr_scenarios++];
+		strcpy(s->name, name);
+		strcpy(s->tool, tool);
+		s->load = type;
+		s->duration = duration;
+		snprintf(s->args, sizeof(s->args), "%s", p + pos);
+	}
+
+	fclose(f);
+	return 0;
+
+fail:
+	fclose(f);
+	return -1;
+}
+
+static struct metric *
+lookup_metric(struct metric_table *t, const char *scenario,
+	      const char *name, const char *unit, int create)
+{
+	struct metric *m;
+	int i;
+
+	for (i = 0; i < t->nr_metrics; i++) {
+		m = &t->metrics[i];
+		if (!strcmp(m->scenario, scenario) && !strcmp(m->name, name))
+			return m;
+	}
+
+	if (!create || t->nr_metrics == MAX_METRICS)
+		return NULL;
+
+	m = &t->metrics[t->nr_metrics++];
+	snprintf(m->scenario, sizeof(m->scenario), "%s", scenario);
+	snprintf(m->name, sizeof(m->name), "%s", name);
+	snprintf(m->unit, sizeof(m->unit), "%s", unit);
+	m->nr_samples = 0;
+
+	return m;
+}
+
+static void add_sample(const char *scenario, const char *name,
+		       const char *unit, double value)
+{
+	struct metric *m;
+
+	m = lookup_metric(&results, scenario, name, unit, 1);
+	if (m == NULL) {
+		fprintf(stderr, "xeno-bench: too many metrics\n");
+		return;
+	}
+
+	if (m->nr_samples < MAX_SAMPLES)
+		m->samples[m->nr_samples++] = value;
+}
+
+/*
+ * Results files hold one line per scenario and metric:
+ * <scenario> <metric> <unit> <sample> [<sample>...]
+ */
+static int load_results(struct metric_table *t, const char *path)
+{
+	char line[1024], scenario[NAME_LEN], name[NAME_LEN], unit[16];
+	struct metric *m;
+	int pos, n;
+	FILE *f;
+
+	f = fopen(path, "r");
+	if (f == NULL) {
+		fprintf(stderr, "xeno-bench: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		char *p;
+		double v;
+
+		if (line[0] == '#' ||
+		    sscanf(line, "%63s %63s %15s %n",
+			   scenario, name, unit, &pos) < 3)
+			continue;
+
+		m = lookup_metric(t, scenario, name, unit, 1);
+		if (m == NULL)
+			break;
+
+		for (p = line + pos;
+		     m->nr_samples < MAX_SAMPLES &&
+			     sscanf(p, "%lf%n", &v, &n) == 1; p += n)
+			m->samples[m->nr_samples++] = v;
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static int save_results(struct metric_table *t, const char *path)
+{
+	FILE *f;
+	int i, n;
+
+	f = fopen(path, "w");
+	if (f == NULL) {
+		fprintf(stderr, "xeno-bench: %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+
+	fprintf(f, "# xeno-bench results: scenario metric unit samples...\n");
+	for (i = 0; i < t->nr_metrics; i++) {
+		struct metric *m = &t->metrics[i];
+
+		fprintf(f, "%s %s %s", m->scenario, m->name, m->unit);
+		for (n = 0; n < m->nr_samples; n++)
+			fprintf(f, " %.3f", m->samples[n]);
+		fprintf(f, "\n");
+	}
+
+	fclose(f);
+	return 0;
+}
+
+static void start_loader(void (*fn)(void *), void *arg)
+{
+	pid_t pid;
+
+	if (nr_loaders == MAX_LOADERS)
+		return;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("xeno-bench: fork");
+		return;
+	}
+
+	if (pid == 0) {
+		signal(SIGTERM, SIG_DFL);
+		fn(arg);
+		_exit(EXIT_SUCCESS);
+	}
+
+	loaders[nr_loaders++] = pid;
+}
+
+static void cpu_load(void *arg)
+{
+	volatile unsigned long count = 0;
+
+	for (;;)
+		count++;
+}
+
+static void io_load(void *arg)
+{
+	char path[64], buf[65536];
+	int fd, n;
+
+	memset(buf, 0xa5, sizeof(buf));
+	snprintf(path, sizeof(path), "/tmp/xeno-bench-io.%d", getpid());
+
+	for (;;) {
+		fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0)
+			_exit(EXIT_FAILURE);
+		unlink(path);
+		for (n = 0; n < 256; n++)
+			if (write(fd, buf, sizeof(buf)) < 0)
+				break;
+		fsync(fd);
+		close(fd);
+	}
+}
+
+static void hell_load(void *arg)
+{
+	char cmd[256];
+
+	snprintf(cmd, sizeof(cmd), "%s/dohell %d",
+		 testdir, *(int *)arg + 10);
+	setpgid(0, 0);
+	execl("/bin/sh", "sh", "-c", cmd, (char *)NULL);
+	_exit(EXIT_FAILURE);
+}
+
+static void start_load(const struct scenario *s)
+{
+	int duration = s->duration, cpus, i;
+
+	switch (s->load) {
+	case LOAD_CPU:
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		for (i = 0; i < cpus; i++)
+			start_loader(cpu_load, NULL);
+		break;
+	case LOAD_IO:
+		start_loader(io_load, NULL);
+		break;
+	case LOAD_HELL:
+		start_loader(hell_load, &duration);
+		break;
+	default:
+		break;
+	}
+}
+
+static void stop_load(void)
+{
+	int i;
+
+	for (i = 0; i < nr_loaders; i++) {
+		/* dohell spawns a process group of its own. */
+		kill(-loaders[i], SIGTERM);
+		kill(loaders[i], SIGTERM);
+		waitpid(loaders[i], NULL, 0);
+	}
+
+	nr_loaders = 0;
+}
+
+/*
+ * Run a benchmark tool, with its standard output redirected to
+ * the given file.
+ */
+static int run_tool(const struct scenario *s, char *const extra[],
+		    const char *outfile)
+{
+	char *argv[64], args[256], path[256], *p;
+	int argc = 0, status, fd;
+	pid_t pid;
+
+	snprintf(path, sizeof(path), "%s/%s", testdir, s->tool);
+	argv[argc++] = path;
+
+	snprintf(args, sizeof(args), "%s", s->args);
+	for (p = strtok(args, " \t"); p && argc < 48; p = strtok(NULL, " \t"))
+		argv[argc++] = p;
+
+	while (*extra && argc < 63)
+		argv[argc++] = *extra++;
+	argv[argc] = NULL;
+
+	pid = fork();
+	if (pid < 0) {
+		perror("xeno-bench: fork");
+		return -1;
+	}
+
+	if (pid == 0) {
+		signal(SIGTERM, SIG_DFL);
+		fd = open(outfile, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+		if (fd < 0)
+			_exit(EXIT_FAILURE);
+		dup2(fd, STDOUT_FILENO);
+		close(fd);
+		execv(path, argv);
+		fprintf(stderr, "xeno-bench: %s: %s\n", path, strerror(errno));
+		_exit(EXIT_FAILURE);
+	}
+
+	while (waitpid(pid, &status, 0) < 0)
+		if (errno != EINTR || sigexit) {
+			kill(pid, SIGTERM);
+			waitpid(pid, &status, 0);
+			return -1;
+		}
+
+	if (verbose) {
+		char line[256];
+		FILE *f = fopen(outfile, "r");
+
+		if (f) {
+			while (fgets(line, sizeof(line), f))
+				fputs(line, stdout);
+			fclose(f);
+		}
+	}
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		fprintf(stderr, "xeno-bench: %s failed in scenario %s\n",
+			s->tool, s->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * latency -O csv: one header line, one line per CPU and one line for
+ * all of them, which we report.
+ */
+static int parse_latency(const struct scenario *s, const char *csv)
+{
+	char header[512], line[512], name[NAME_LEN];
+	char *hsave, *lsave, *h, *v;
+	int found = 0;
+	FILE *f;
+
+	f = fopen(csv, "r");
+	if (f == NULL)
+		return -1;
+
+	if (fgets(header, sizeof(header), f) == NULL)
+		goto out;
+	header[strcspn(header, "\n")] = '\0';
+
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+		if (strncmp(line, "all,", 4))
+			continue;
+
+		h = strtok_r(header, ",", &hsave);
+		v = strtok_r(line, ",", &lsave);
+		for (; h && v; h = strtok_r(NULL, ",", &hsave),
+			     v = strtok_r(NULL, ",", &lsave)) {
+			size_t len = strlen(h);
+
+			if (len < 4 || strcmp(h + len - 3, "_ns"))
+				continue;
+
+			snprintf(name, sizeof(name), "latency.%.*s",
+				 (int)len - 3, h);
+			add_sample(s->name, name, "ns", atof(v));
+		}
+		found = 1;
+		break;
+	}
+
+out:
+	fclose(f);
+	return found ? 0 : -1;
+}
+
+/*
+ * switchtest: RTD|[cpu|]switches-per-second|total. The first second
+ * is skipped, it does not count a full period. switchtest only tells
+ * how many switches it achieved, so we report a throughput, not a
+ * per-switch latency.
+ */
+static int parse_switchtest(const struct scenario *s, const char *out)
+{
+	double sum = 0, lowest = 0;
+	char line[256], *f1, *f2;
+	int nlines = 0, samples = 0;
+	unsigned long count;
+	FILE *f;
+
+	f = fopen(out, "r");
+	if (f == NULL)
+		return -1;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (strncmp(line, "RTD|", 4))
+			continue;
+
+		/* The per-second count is the second to last field. */
+		f2 = strrchr(line, '|');
+		if (f2 == NULL || f2 == line + 3)
+			continue;
+		*f2 = '\0';
+		f1 = strrchr(line, '|');
+		count = strtoul(f1 + 1, NULL, 10);
+
+		if (nlines++ == 0)
+			continue;
+
+		sum += count;
+		if (samples == 0 || count < lowest)
+			lowest = count;
+		samples++;
+	}
+
+	fclose(f);
+
+	if (samples == 0)
+		return -1;
+
+	add_sample(s->name, "switch.rate_avg", "switch/s", sum / samples);
+	add_sample(s->name, "switch.rate_min", "switch/s", lowest);
+
+	return 0;
+}
+
+/* syscallbench, heapbench, msgbench: <metric>,<unit>,<value> lines. */
+static int parse_csv_metrics(const struct scenario *s, const char *out)
+{
+	char line[256], name[NAME_LEN], unit[16];
+	int found = 0;
+	double value;
+	FILE *f;
+
+	f = fopen(out, "r");
+	if (f == NULL)
+		return -1;
+
+	while (fgets(line, sizeof(line), f))
+		if (sscanf(line, "%63[^,],%15[^,],%lf",
+			   name, unit, &value) == 3) {
+			add_sample(s->name, name, unit, value);
+			found = 1;
+		}
+
+	fclose(f);
+	return found ? 0 : -1;
+}
+
+static int run_scenario(const struct scenario *s)
+{
+	char out[64], csv[64], duration[16];
+	int err = -1;
+
+	snprintf(out, sizeof(out), "/tmp/xeno-bench-out.%d", getpid());
+	snprintf(csv, sizeof(csv), "/tmp/xeno-bench-csv.%d", getpid());
+	snprintf(duration, sizeof(duration), "%d", s->duration);
+
+	start_load(s);
+
+	if (!strcmp(s->tool, "latency")) {
+		char *extra[] = { "-T", duration, "-q", "-o", csv,
+				  "-O", "csv", NULL };
+		if (run_tool(s, extra, out) == 0)
+			err = parse_latency(s, csv);
+	} else if (!strcmp(s->tool, "switchtest")) {
+		char *extra[] = { "-T", duration, NULL };
+		if (run_tool(s, extra, out) == 0)
+			err = parse_switchtest(s, out);
+	} else if (!strcmp(s->tool, "syscallbench") ||
+		   !strcmp(s->tool, "heapbench") ||
+		   !strcmp(s->tool, "msgbench")) {
+		char *extra[] = { "-T", duration, NULL };
+		if (run_tool(s, extra, out) == 0)
+			err = parse_csv_metrics(s, out);
+	} else
+		fprintf(stderr, "xeno-bench: unknown tool %s\n", s->tool);
+
+	stop_load();
+
+	unlink(out);
+	unlink(csv);
+
+	return err;
+}
+
+static void stats(const struct metric *m, double *mean, double *var)
+{
+	double sum = 0, sq = 0;
+	int n;
+
+	for (n = 0; n < m->nr_samples; n++)
+		sum += m->samples[n];
+	*mean = sum / m->nr_samples;
+
+	for (n = 0; n < m->nr_samples; n++)
+		sq += (m->samples[n] - *mean) * (m->samples[n] - *mean);
+	*var = m->nr_samples > 1 ? sq / (m->nr_samples - 1) : 0;
+}
+
+/* One-sided 95% critical values of Student's t distribution. */
+static double t_critical(double df)
+{
+	static const double table[] = {
+		6.314, 2.920, 2.353, 2.132, 2.015, 1.943, 1.895, 1.860,
+		1.833, 1.812, 1.796, 1.782, 1.771, 1.761, 1.753, 1.746,
+		1.740, 1.734, 1.729, 1.725, 1.721, 1.717, 1.714, 1.711,
+		1.708, 1.706, 1.703, 1.701, 1.699, 1.697,
+	};
+	int i = (int)floor(df);
+
+	if (i < 1)
+		i = 1;
+
+	return i <= 30 ? table[i - 1] : 1.645;
+}
+
+/* Rates are better when higher, all other metrics when lower. */
+static int higher_is_better(const struct metric *m)
+{
+	size_t len = strlen(m->unit);
+
+	return len > 2 && !strcmp(m->unit + len - 2, "/s");
+}
+
+/*
+ * A metric regressed if its mean moved the wrong way by more than
+ * the threshold, and Welch's t-test tells the difference is
+ * significant at the 95% level. With a single sample on either side,
+ * only the threshold applies.
+ */
+static int compare_results(void)
+{
+	double bmean, bvar, rmean, rvar, delta, se, t, df;
+	int i, sign, regressions = 0;
+	struct metric *b, *r;
+
+	printf("CMP|%-24s|%-20s|%12s|%12s|%8s|%7s|%s\n",
+	       "scenario", "metric", "baseline", "current",
+	       "delta", "t", "verdict");
+
+	for (i = 0; i < results.nr_metrics; i++) {
+		const char *verdict = "ok";
+
+		r = &results.metrics[i];
+		b = lookup_metric(&baseline, r->scenario, r->name, NULL, 0);
+		if (b == NULL || b->nr_samples == 0 || r->nr_samples == 0)
+			continue;
+
+		stats(b, &bmean, &bvar);
+		stats(r, &rmean, &rvar);
+
+		delta = bmean ? (rmean - bmean) * 100.0 / bmean : 0;
+		se = sqrt(bvar / b->nr_samples + rvar / r->nr_samples);
+		sign = higher_is_better(r) ? -1 : 1;
+
+		if (b->nr_samples > 1 && r->nr_samples > 1 && se > 0) {
+			t = (rmean - bmean) / se;
+			df = pow(se, 4) /
+				(pow(bvar / b->nr_samples, 2) / (b->nr_samples - 1) +
+				 pow(rvar / r->nr_samples, 2) / (r->nr_samples - 1));
+			if (sign * delta > threshold &&
+			    sign * t > t_critical(df))
+				verdict = "REGRESSION";
+			else if (sign * delta < -threshold &&
+				 -sign * t > t_critical(df))
+				verdict = "improved";
+		} else {
+			t = 0;
+			if (sign * delta > threshold)
+				verdict = "REGRESSION";
+			else if (sign * delta < -threshold)
+				verdict = "improved";
+		}
+
+		if (!strcmp(verdict, "REGRESSION"))
+			regressions++;
+
+		printf("CMP|%-24s|%-20s|%12.1f|%12.1f|%+7.1f%%|%7.2f|%s\n",
+		       r->scenario, r->name, bmean, rmean, delta, t, verdict);
+	}
+
+	printf("CMP|%d regression(s), threshold %.1f%%\n",
+	       regressions, threshold);
+
+	return regressions;
+}
+
+static void print_results(void)
+{
+	double mean, var;
+	int i;
+
+	printf("RES|%-24s|%-20s|%4s|%12s|%12s\n",
+	       "scenario", "metric", "runs", "mean", "stddev");
+
+	for (i = 0; i < results.nr_metrics; i++) {
+		struct metric *m = &results.metrics[i];
+
+		stats(m, &mean, &var);
+		printf("RES|%-24s|%-20s|%4d|%12.1f|%12.1f\n",
+		       m->scenario, m->name, m->nr_samples, mean, sqrt(var));
+	}
+}
+
+static void sigexit_handler(int sig)
+{
+	sigexit = 1;
+}
+
+int main(int argc, char *const argv[])
+{
+	const char *suite_file = NULL, *only = NULL, *output = NULL,
+		*baseline_file = NULL, *results_file = NULL;
+	int c, i, run, list = 0, failed = 0;
+	struct sigaction sa;
+	unsigned u;
+
+	if (getenv("XENO_TEST_DIR"))
+		testdir = getenv("XENO_TEST_DIR");
+
+	while ((c = getopt(argc, argv, "s:n:r:o:b:c:t:lvh")) != EOF)
+		switch (c) {
+		case 's':
+			suite_file = optarg;
+			break;
+
+		case 'n':
+			only = optarg;
+			break;
+
+		case 'r':
+			repeat = atoi(optarg);
+			if (repeat < 1 || repeat > MAX_SAMPLES) {
+				usage();
+				exit(2);
+			}
+			break;
+
+		case 'o':
+			output = optarg;
+			break;
+
+		case 'b':
+			baseline_file = optarg;
+			break;
+
+		case 'c':
+			results_file = optarg;
+			break;
+
+		case 't':
+			threshold = atof(optarg);
+			break;
+
+		case 'l':
+			list = 1;
+			break;
+
+		case 'v':
+			verbose = 1;
+			break;
+
+		default:
+			usage();
+			exit(2);
+		}
+
+	if (suite_file) {
+		if (load_suite(suite_file))
+			exit(2);
+	} else {
+		for (u = 0; u < sizeof(default_suite) / sizeof(default_suite[0]); u++)
+			suite[nr_scenarios++] = default_suite[u];
+	}
+
+	if (list) {
+		for (i = 0; i < nr_scenarios; i++)
+			printf("%-24s %-14s %-5s %4ds %s\n", suite[i].name,
+			       suite[i].tool, load_names[suite[i].load],
+			       suite[i].duration, suite[i].args);
+		exit(EXIT_SUCCESS);
+	}
+
+	if (baseline_file && load_results(&baseline, baseline_file))
+		exit(2);
+
+	if (results_file) {
+		if (baseline_file == NULL) {
+			fprintf(stderr, "xeno-bench: -c requires -b\n");
+			exit(2);
+		}
+		if (load_results(&results, results_file))
+			exit(2);
+		exit(compare_results() ? EXIT_FAILURE : EXIT_SUCCESS);
+	}
+
+	sigemptyset(&sa.sa_mask);
+	sa.sa_handler = sigexit_handler;
+	sa.sa_flags = 0;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	setlinebuf(stdout);
+
+	for (run = 0; run < repeat && !sigexit; run++)
+		for (i = 0; i < nr_scenarios && !sigexit; i++) {
+			if (only && strcmp(only, suite[i].name))
+				continue;
+
+			printf("RUN|%d/%d|%s (%s, load %s, %ds)\n",
+			       run + 1, repeat, suite[i].name, suite[i].tool,
+			       load_names[suite[i].load], suite[i].duration);
+
+			if (run_scenario(&suite[i])) {
+				fprintf(stderr,
+					"xeno-bench: no results for scenario %s\n",
+					suite[i].name);
+				failed = 1;
+			}
+		}
+
+	print_results();
+
+	if (output && save_results(&results, output))
+		failed = 1;
+
+	if (baseline_file && compare_results())
+		exit(EXIT_FAILURE);
+
+	exit(failed ? 2 : EXIT_SUCCESS);
+}
@@ -2,6 +2,7 @@
 #include <math.h>
 #include <stdio.h>
 #include <string.h>
+#include <errno.h>
 #include <signal.h>
 #include <time.h>
 
@@ -18,17 +19,31 @@
 #include <native/sem.h>
 #include <rtdm/rttesting.h>
 
-RT_TASK latency_task, display_task;
+RT_TASK display_task;
 
 RT_SEM display_sem;
 
 #define ONE_BILLION  1000000000
 #define TEN_MILLION    10000000
 
-unsigned max_relaxed;
-long minjitter, maxjitter, avgjitter;
-long gminjitter = TEN_MILLION, gmaxjitter = -TEN_MILLION, goverrun = 0;
-long long gavgjitter = 0;
+#define MAX_SAMPLERS 8		/* T_CPU() can't address more CPUs */
+
+/* One measurement task (or in-kernel benchmark) per sampled CPU. */
+struct sampler {
+	RT_TASK task;
+	int cpu;
+	int updated;
+	int test_loops;		/* outer loop count */
+	unsigned max_relaxed;
+	long minjitter, maxjitter, avgjitter;
+	long gminjitter, gmaxjitter, goverrun;
+	long long gavgjitter;
+	long *histogram_avg, *histogram_max, *histogram_min;
+	long *hdr;		/* log-linear histogram of all samples */
+};
+
+struct sampler samplers[MAX_SAMPLERS];
+int nr_samplers = 0;
 
 long long period_ns = 0;
 int test_duration = 0;		/* sec of testing, via -T <sec>, 0 is inf */
@@ -53,7 +68,6 @@ const char *test_mode_names[] = {
 };
 
 time_t test_start, test_end;	/* report test duration */
-int test_loops = 0;		/* outer loop count */
 
 #define MEASURE_PERIOD ONE_BILLION
 #define SAMPLE_COUNT (MEASURE_PERIOD / period_ns)
@@ -68,7 +82,14 @@ char *do_gnuplot = NULL;
 int do_histogram = 0, do_stats = 0, finished = 0;
 int bucketsize = 1000;		/* default = 1000ns, -B <size> to override */
 
+#define REPORT_JSON 0
+#define REPORT_CSV  1
+
+char *report_file = NULL;	/* -o <file>, machine-readable results */
+int report_format = REPORT_JSON;
+
 #define need_histo() (do_histogram || do_stats || do_gnuplot)
+#define need_hdr() (report_file || (do_stats && test_mode == USER_TASK))
 
 static inline void add_histogram(long *histogram, long addval)
 {
@@ -78,8 +99,14 @@ static inline void add_histogram(long *histogram, long addval)
 	histogram[inabs < histogram_size ? inabs : histogram_size - 1]++;
 }
 
+static inline void add_hdr(long *hdr, long addval)
+{
+	hdr[rttst_hdr_index(rt_timer_tsc2ns(addval >= 0 ? addval : -addval))]++;
+}
+
 void latency(void *cookie)
 {
+	struct sampler *s = cookie;
 	int err, count, nsamples, warmup = 1;
 	RTIME expected_tsc, period_tsc, start_ticks, fault_threshold;
 	RT_TIMER_INFO timer_info;
@@ -113,7 +140,7 @@ void latency(void *cookie)
 		long minj = TEN_MILLION, maxj = -TEN_MILLION, dt;
 		long overrun = 0;
 		long long sumj;
-		test_loops++;
+		s->test_loops++;
 
 		for (count = sumj = 0; count < nsamples; count++) {
 			unsigned new_relaxed;
@@ -127,7 +154,7 @@ void latency(void *cookie)
 			if (dt > maxj) {
 				if (new_relaxed != old_relaxed
 				    && dt > fault_threshold)
-					max_relaxed +=
+					s->max_relaxed +=
 						new_relaxed - old_relaxed;
 				maxj = dt;
 			}
@@ -148,38 +175,43 @@ void latency(void *cookie)
 				expected_tsc += period_tsc * ov;
 			}
 
-			if (freeze_max && (dt > gmaxjitter)
+			if (freeze_max && (dt > s->gmaxjitter)
 			    && !(finished || warmup)) {
 				xntrace_user_freeze(rt_timer_tsc2ns(dt), 0);
-				gmaxjitter = dt;
+				s->gmaxjitter = dt;
 			}
 
-			if (!(finished || warmup) && need_histo())
-				add_histogram(histogram_avg, dt);
+			if (!(finished || warmup)) {
+				if (need_histo())
+					add_histogram(s->histogram_avg, dt);
+				if (need_hdr())
+					add_hdr(s->hdr, dt);
+			}
 		}
 
 		if (!warmup) {
 			if (!finished && need_histo()) {
-				add_histogram(histogram_max, maxj);
-				add_histogram(histogram_min, minj);
+				add_histogram(s->histogram_max, maxj);
+				add_histogram(s->histogram_min, minj);
 			}
 
-			minjitter = minj;
-			if (minj < gminjitter)
-				gminjitter = minj;
+			s->minjitter = minj;
+			if (minj < s->gminjitter)
+				s->gminjitter = minj;
 
-			maxjitter = maxj;
-			if (maxj > gmaxjitter)
-				gmaxjitter = maxj;
+			s->maxjitter = maxj;
+			if (maxj > s->gmaxjitter)
+				s->gmaxjitter = maxj;
 
-			avgjitter = sumj / nsamples;
-			gavgjitter += avgjitter;
-			goverrun += overrun;
+			s->avgjitter = sumj / nsamples;
+			s->gavgjitter += s->avgjitter;
+			s->goverrun += overrun;
+			s->updated = 1;
 			rt_sem_v(&display_sem);
 		}
 
-		if (warmup && test_loops == WARMUP_TIME) {
-			test_loops = 0;
+		if (warmup && s->test_loops == WARMUP_TIME) {
+			s->test_loops = 0;
 			warmup = 0;
 		}
 	}
@@ -213,8 +245,15 @@ void display(void *cookie)
 		config.period = period_ns;
 		config.priority = priority;
 		config.warmup_loops = WARMUP_TIME;
-		config.histogram_size = need_histo() ? histogram_size : 0;
-		config.histogram_bucketsize = bucketsize;
+		if (report_file) {
+			/* Log-linear cells, for the machine-readable report. */
+			config.histogram_size = RTTST_HDR_CELLS;
+			config.histogram_bucketsize = 0;
+		} else {
+			config.histogram_size =
+				need_histo() ? histogram_size : 0;
+			config.histogram_bucketsize = bucketsize;
+		}
 		config.freeze_max = freeze_max;
 
 		err =
@@ -238,7 +277,8 @@ void display(void *cookie)
 			test_duration);
 
 	for (;;) {
-		long minj, gminj, maxj, gmaxj, avgj;
+		struct sampler *smp;
+		int i;
 
 		if (test_mode == USER_TASK) {
 			err = rt_sem_p(&display_sem, TM_INFINITE);
@@ -252,13 +292,6 @@ void display(void *cookie)
 				return;
 			}
 
-			/* convert jitters to nanoseconds. */
-			minj = rt_timer_tsc2ns(minjitter);
-			gminj = rt_timer_tsc2ns(gminjitter);
-			avgj = rt_timer_tsc2ns(avgjitter);
-			maxj = rt_timer_tsc2ns(maxjitter);
-			gmaxj = rt_timer_tsc2ns(gmaxjitter);
-
 		} else {
 			struct rttst_interm_bench_res result;
 
@@ -275,15 +308,44 @@ void display(void *cookie)
 				return;
 			}
 
-			minj = result.last.min;
-			gminj = result.overall.min;
-			avgj = result.last.avg;
-			maxj = result.last.max;
-			gmaxj = result.overall.max;
-			goverrun = result.overall.overruns;
+			/* The in-kernel benchmark reports nanoseconds. */
+			smp = &samplers[0];
+			smp->minjitter = result.last.min;
+			smp->gminjitter = result.overall.min;
+			smp->avgjitter = result.last.avg;
+			smp->maxjitter = result.last.max;
+			smp->gmaxjitter = result.overall.max;
+			smp->goverrun = result.overall.overruns;
+			smp->updated = 1;
 		}
 
-		if (!quiet) {
+		for (i = 0; i < nr_samplers; i++) {
+			long minj, gminj, maxj, gmaxj, avgj;
+
+			smp = &samplers[i];
+			if (!smp->updated)
+				continue;
+
+			smp->updated = 0;
+
+			if (test_mode == USER_TASK) {
+				/* convert jitters to nanoseconds. */
+				minj = rt_timer_tsc2ns(smp->minjitter);
+				gminj = rt_timer_tsc2ns(smp->gminjitter);
+				avgj = rt_timer_tsc2ns(smp->avgjitter);
+				maxj = rt_timer_tsc2ns(smp->maxjitter);
+				gmaxj = rt_timer_tsc2ns(smp->gmaxjitter);
+			} else {
+				minj = smp->minjitter;
+				gminj = smp->gminjitter;
+				avgj = smp->avgjitter;
+				maxj = smp->maxjitter;
+				gmaxj = smp->gmaxjitter;
+			}
+
+			if (quiet)
+				continue;
+
 			if (data_lines && (n++ % data_lines) == 0) {
 				time_t now, dt;
 				time(&now);
@@ -294,17 +356,25 @@ void display(void *cookie)
 				     (dt / 60) % 60, dt % 60,
 				     test_mode_names[test_mode],
 				     period_ns / 1000, priority);
-				printf("RTH|%11s|%11s|%11s|%8s|%6s|%11s|%11s\n",
+				if (nr_samplers > 1)
+					printf("RTH|%3s", "cpu");
+				else
+					printf("RTH");
+				printf("|%11s|%11s|%11s|%8s|%6s|%11s|%11s\n",
 				       "----lat min", "----lat avg",
 				       "----lat max", "-overrun", "---msw",
 				       "---lat best", "--lat worst");
 			}
-			printf("RTD|%11.3f|%11.3f|%11.3f|%8ld|%6u|%11.3f|%11.3f\n",
+			if (nr_samplers > 1)
+				printf("RTD|%3d", smp->cpu);
+			else
+				printf("RTD");
+			printf("|%11.3f|%11.3f|%11.3f|%8ld|%6u|%11.3f|%11.3f\n",
 			       (double)minj / 1000,
 			       (double)avgj / 1000,
 			       (double)maxj / 1000,
-			       goverrun,
-			       max_relaxed,
+			       smp->goverrun,
+			       smp->max_relaxed,
 			       (double)gminj / 1000, (double)gmaxj / 1000);
 		}
 	}
@@ -406,57 +476,303 @@ void dump_hist_stats(void)
 		dump_histo_gnuplot(histogram_avg);
 }
 
+static unsigned long long hdr_count(long *hdr)
+{
+	unsigned long long count = 0;
+	int n;
+
+	for (n = 0; n < RTTST_HDR_CELLS; n++)
+		count += hdr[n];
+
+	return count;
+}
+
+/*
+ * Return the smallest latency bounding pct% of the samples. The
+ * result is the upper bound of the cell holding the given rank,
+ * capped by the largest absolute latency actually observed, so its
+ * error is bounded by the cell width.
+ */
+static long hdr_percentile(long *hdr, double pct, long absmax)
+{
+	unsigned long long rank, seen = 0, count = hdr_count(hdr);
+	unsigned long highest;
+	int n;
+
+	if (count == 0)
+		return 0;
+
+	rank = (unsigned long long)ceil(count * pct / 100.0);
+	if (rank == 0)
+		rank = 1;
+
+	for (n = 0; n < RTTST_HDR_CELLS; n++) {
+		seen += hdr[n];
+		if (seen >= rank)
+			break;
+	}
+
+	highest = rttst_hdr_highest(n < RTTST_HDR_CELLS ? n : RTTST_HDR_CELLS - 1);
+
+	return highest < (unsigned long)absmax ? (long)highest : absmax;
+}
+
+static const struct {
+	double pct;
+	const char *label;
+} percentiles[] = {
+	{ 50.0, "p50" },
+	{ 90.0, "p90" },
+	{ 99.0, "p99" },
+	{ 99.9, "p99.9" },
+	{ 99.99, "p99.99" },
+};
+
+#define NR_PERCENTILES (sizeof(percentiles) / sizeof(percentiles[0]))
+
+static inline long sampler_absmax(struct sampler *s)
+{
+	long absmin = s->gminjitter >= 0 ? s->gminjitter : -s->gminjitter;
+	long absmax = s->gmaxjitter >= 0 ? s->gmaxjitter : -s->gmaxjitter;
+
+	return absmax > absmin ? absmax : absmin;
+}
+
+/* Merge all samplers into one, for reporting overall results. */
+static void merge_samplers(struct sampler *all)
+{
+	int i, n;
+
+	memset(all, 0, sizeof(*all));
+	all->cpu = -1;
+	all->gminjitter = TEN_MILLION;
+	all->gmaxjitter = -TEN_MILLION;
+	all->hdr = calloc(RTTST_HDR_CELLS, sizeof(long));
+
+	for (i = 0; i < nr_samplers; i++) {
+		struct sampler *s = &samplers[i];
+
+		if (s->gminjitter < all->gminjitter)
+			all->gminjitter = s->gminjitter;
+		if (s->gmaxjitter > all->gmaxjitter)
+			all->gmaxjitter = s->gmaxjitter;
+		all->gavgjitter += s->gavgjitter;
+		all->goverrun += s->goverrun;
+		all->max_relaxed += s->max_relaxed;
+
+		if (all->hdr && s->hdr)
+			for (n = 0; n < RTTST_HDR_CELLS; n++)
+				all->hdr[n] += s->hdr[n];
+	}
+
+	if (nr_samplers)
+		all->gavgjitter /= nr_samplers;
+}
+
+static void dump_percentiles(struct sampler *all)
+{
+	unsigned i;
+
+	printf("HSP|--param");
+	for (i = 0; i < NR_PERCENTILES; i++)
+		printf("|%11s", percentiles[i].label);
+	printf("\n");
+
+	printf("HSP|    lat");
+	for (i = 0; i < NR_PERCENTILES; i++)
+		printf("|%11.3f", (double)hdr_percentile(all->hdr,
+							 percentiles[i].pct,
+							 sampler_absmax(all)) / 1000);
+	printf("\n");
+}
+
+static void report_json(FILE *f, struct sampler *s)
+{
+	unsigned long long count = hdr_count(s->hdr);
+	int n, first = 1;
+	unsigned i;
+
+	fprintf(f, "    {\n");
+	if (s->cpu >= 0)
+		fprintf(f, "      \"cpu\": %d,\n", s->cpu);
+	else
+		fprintf(f, "      \"cpu\": null,\n");
+	fprintf(f, "      \"samples\": %llu,\n", count);
+	fprintf(f, "      \"min_ns\": %ld,\n", s->gminjitter);
+	fprintf(f, "      \"avg_ns\": %lld,\n", s->gavgjitter);
+	fprintf(f, "      \"max_ns\": %ld,\n", s->gmaxjitter);
+	fprintf(f, "      \"overruns\": %ld,\n", s->goverrun);
+	fprintf(f, "      \"mode_switches\": %u,\n", s->max_relaxed);
+	fprintf(f, "      \"percentiles_ns\": {");
+	for (i = 0; i < NR_PERCENTILES; i++)
+		fprintf(f, "%s\"%s\": %ld", i ? ", " : " ",
+			percentiles[i].label,
+			hdr_percentile(s->hdr, percentiles[i].pct,
+				       sampler_absmax(s)));
+	fprintf(f, " },\n");
+	/* Only non-empty cells, as [lowest_ns, highest_ns, count]. */
+	fprintf(f, "      \"histogram\": [");
+	for (n = 0; n < RTTST_HDR_CELLS; n++) {
+		if (s->hdr[n] == 0)
+			continue;
+		fprintf(f, "%s\n        [%lu, %lu, %ld]", first ? "" : ",",
+			rttst_hdr_lowest(n), rttst_hdr_highest(n), s->hdr[n]);
+		first = 0;
+	}
+	fprintf(f, "%s]\n    }", first ? "" : "\n      ");
+}
+
+static void report_csv(FILE *f, struct sampler *s)
+{
+	unsigned i;
+
+	if (s->cpu >= 0)
+		fprintf(f, "%d", s->cpu);
+	else
+		fprintf(f, "all");
+
+	fprintf(f, ",%llu,%ld,%lld,%ld", hdr_count(s->hdr),
+		s->gminjitter, s->gavgjitter, s->gmaxjitter);
+	for (i = 0; i < NR_PERCENTILES; i++)
+		fprintf(f, ",%ld", hdr_percentile(s->hdr, percentiles[i].pct,
+						  sampler_absmax(s)));
+	fprintf(f, ",%ld,%u\n", s->goverrun, s->max_relaxed);
+}
+
+static void dump_report(struct sampler *all, time_t duration)
+{
+	FILE *f;
+	unsigned i;
+	int n;
+
+	f = fopen(report_file, "w");
+	if (!f) {
+		fprintf(stderr, "latency: cannot open %s: %s\n",
+			report_file, strerror(errno));
+		return;
+	}
+
+	if (report_format == REPORT_CSV) {
+		fprintf(f, "cpu,samples,min_ns,avg_ns,max_ns");
+		for (i = 0; i < NR_PERCENTILES; i++)
+			fprintf(f, ",%s_ns", percentiles[i].label);
+		fprintf(f, ",overruns,mode_switches\n");
+		for (n = 0; n < nr_samplers; n++)
+			report_csv(f, &samplers[n]);
+		report_csv(f, all);
+	} else {
+		fprintf(f, "{\n");
+		fprintf(f, "  \"test_mode\": \"%s\",\n", test_mode_names[test_mode]);
+		fprintf(f, "  \"period_ns\": %Ld,\n", period_ns);
+		fprintf(f, "  \"priority\": %d,\n", priority);
+		fprintf(f, "  \"duration_s\": %ld,\n", (long)duration);
+		fprintf(f, "  \"histogram\": { \"type\": \"log-linear\", "
+			"\"sub_buckets\": %d, \"max_ns\": %lu },\n",
+			RTTST_HDR_SUB_COUNT, 1UL << RTTST_HDR_MAX_BITS);
+		fprintf(f, "  \"samplers\": [\n");
+		for (n = 0; n < nr_samplers; n++) {
+			report_json(f, &samplers[n]);
+			fprintf(f, ",\n");
+		}
+		report_json(f, all);
+		fprintf(f, "\n  ]\n}\n");
+	}
+
+	fclose(f);
+}
+
 void cleanup(void)
 {
 	time_t actual_duration;
-	long gmaxj, gminj, gavgj;
+	struct sampler all;
+	int i, n;
 
 	if (test_mode == USER_TASK) {
 		rt_sem_delete(&display_sem);
 
-		gavgjitter /= (test_loops > 1 ? test_loops : 2) - 1;
+		for (i = 0; i < nr_samplers; i++) {
+			struct sampler *s = &samplers[i];
 
-		gminj = rt_timer_tsc2ns(gminjitter);
-		gmaxj = rt_timer_tsc2ns(gmaxjitter);
-		gavgj = rt_timer_tsc2ns(gavgjitter);
+			s->gavgjitter /=
+				(s->test_loops > 1 ? s->test_loops : 2) - 1;
+
+			/* convert jitters to nanoseconds. */
+			s->gminjitter = rt_timer_tsc2ns(s->gminjitter);
+			s->gmaxjitter = rt_timer_tsc2ns(s->gmaxjitter);
+			s->gavgjitter = rt_timer_tsc2ns(s->gavgjitter);
+		}
 	} else {
+		static long hdr_scratch[2][RTTST_HDR_CELLS];
 		struct rttst_overall_bench_res overall;
+		struct sampler *s = &samplers[0];
 
-		overall.histogram_min = histogram_min;
-		overall.histogram_max = histogram_max;
-		overall.histogram_avg = histogram_avg;
+		if (report_file) {
+			/* Only the histogram of all samples is reported. */
+			overall.histogram_min = hdr_scratch[0];
+			overall.histogram_max = hdr_scratch[1];
+			overall.histogram_avg = s->hdr;
+		} else {
+			overall.histogram_min = s->histogram_min;
+			overall.histogram_max = s->histogram_max;
+			overall.histogram_avg = s->histogram_avg;
+		}
 
 		rt_dev_ioctl(benchdev, RTTST_RTIOC_TMBENCH_STOP, &overall);
 
-		gminj = overall.result.min;
-		gmaxj = overall.result.max;
-		gavgj = overall.result.avg;
-		goverrun = overall.result.overruns;
+		s->gminjitter = overall.result.min;
+		s->gmaxjitter = overall.result.max;
+		s->gavgjitter = overall.result.avg;
+		s->goverrun = overall.result.overruns;
 	}
 
 	if (benchdev >= 0)
 		rt_dev_close(benchdev);
 
+	/* Fold per-CPU histograms into the global ones. */
+	if (nr_samplers > 1 && need_histo())
+		for (i = 0; i < nr_samplers; i++)
+			for (n = 0; n < histogram_size; n++) {
+				histogram_avg[n] += samplers[i].histogram_avg[n];
+				histogram_max[n] += samplers[i].histogram_max[n];
+				histogram_min[n] += samplers[i].histogram_min[n];
+			}
+
+	merge_samplers(&all);
+
 	if (need_histo())
 		dump_hist_stats();
 
+	if (need_hdr() && do_stats && all.hdr)
+		dump_percentiles(&all);
+
 	time(&test_end);
 	actual_duration = test_end - test_start - WARMUP_TIME;
 	if (!test_duration)
 		test_duration = actual_duration;
 
-	printf
-	    ("---|-----------|-----------|-----------|--------|------|-------------------------\n"
-	     "RTS|%11.3f|%11.3f|%11.3f|%8ld|%6u|    %.2ld:%.2ld:%.2ld/%.2d:%.2d:%.2d\n",
-	     (double)gminj / 1000, (double)gavgj / 1000, (double)gmaxj / 1000,
-	     goverrun, max_relaxed, actual_duration / 3600, (actual_duration / 60) % 60,
-	     actual_duration % 60, test_duration / 3600,
-	     (test_duration / 60) % 60, test_duration % 60);
-	if (max_relaxed > 0)
+	printf("---|-----------|-----------|-----------|--------|------|-------------------------\n");
+	for (i = 0; i < nr_samplers; i++) {
+		struct sampler *s = &samplers[i];
+
+		if (nr_samplers > 1)
+			printf("RTS|%3d", s->cpu);
+		else
+			printf("RTS");
+		printf("|%11.3f|%11.3f|%11.3f|%8ld|%6u|    %.2ld:%.2ld:%.2ld/%.2d:%.2d:%.2d\n",
+		       (double)s->gminjitter / 1000, (double)s->gavgjitter / 1000,
+		       (double)s->gmaxjitter / 1000, s->goverrun, s->max_relaxed,
+		       actual_duration / 3600, (actual_duration / 60) % 60,
+		       actual_duration % 60, test_duration / 3600,
+		       (test_duration / 60) % 60, test_duration % 60);
+	}
+	if (all.max_relaxed > 0)
 		printf(
 "Warning! some latency maxima may have been due to involuntary mode switches.\n"
 "Please contact xenomai@xenomai.org\n");
 
+	if (report_file && all.hdr)
+		dump_report(&all, actual_duration);
+
 	if (histogram_avg)
 		free(histogram_avg);
 	if (histogram_max)
@@ -531,12 +847,14 @@ void sigdebug(int sig, siginfo_t *si, void *context)
 
 int main(int argc, char **argv)
 {
-	int cpu = 0, c, err, sig;
+	int cpus[MAX_SAMPLERS], nr_cpus = 0, all_cpus = 0;
+	int c, i, err, sig;
 	struct sigaction sa;
 	char task_name[16];
 	sigset_t mask;
+	char *p;
 
-	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
+	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:CP:bo:O:")) != EOF)
 		switch (c) {
 		case 'g':
 			do_gnuplot = strdup(optarg);
@@ -599,7 +917,36 @@ int main(int argc, char **argv)
 			break;
 
 		case 'c':
-			cpu = T_CPU(atoi(optarg));
+			for (p = strtok(optarg, ","); p; p = strtok(NULL, ",")) {
+				if (nr_cpus == MAX_SAMPLERS) {
+					fprintf(stderr,
+						"latency: too many CPUs (max. %d)\n",
+						MAX_SAMPLERS);
+					exit(2);
+				}
+				cpus[nr_cpus++] = atoi(p);
+			}
+			break;
+
+		case 'C':
+			all_cpus = 1;
+			break;
+
+		case 'o':
+			report_file = strdup(optarg);
+			break;
+
+		case 'O':
+			if (!strcmp(optarg, "csv"))
+				report_format = REPORT_CSV;
+			else if (!strcmp(optarg, "json"))
+				report_format = REPORT_JSON;
+			else {
+				fprintf(stderr,
+					"latency: unknown report format %s\n",
+					optarg);
+				exit(2);
+			}
 			break;
 
 		case 'P':
@@ -626,9 +973,13 @@ int main(int argc, char **argv)
 "  [-D <testing_device_no>]     # number of testing device, default=0\n"
 "  [-t <test_mode>]             # 0=user task (default), 1=kernel task, 2=timer IRQ\n"
 "  [-f]                         # freeze trace for each new max latency\n"
-"  [-c <cpu>]                   # pin measuring task down to given CPU\n"
+"  [-c <cpu>[,<cpu>...]]        # pin measuring task down to given CPU,\n"
+"                               # one task per CPU if several (test mode 0 only)\n"
+"  [-C]                         # one measuring task per online CPU (test mode 0 only)\n"
 "  [-P <priority>]              # task priority (test mode 0 and 1 only)\n"
 "  [-b]                         # break upon mode switch\n"
+"  [-o <file>]                  # write results and log-linear histograms to <file>\n"
+"  [-O <format>]                # format of -o output, json (default) or csv\n"
 );
 			exit(2);
 		}
@@ -644,6 +995,27 @@ int main(int argc, char **argv)
 		exit(2);
 	}
 
+	if (all_cpus) {
+		nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		if (nr_cpus > MAX_SAMPLERS)
+			nr_cpus = MAX_SAMPLERS;
+		for (i = 0; i < nr_cpus; i++)
+			cpus[i] = i;
+	}
+
+	if (test_mode != USER_TASK) {
+		if (nr_cpus > 1) {
+			fprintf(stderr,
+				"latency: multiple CPUs only work in test mode 0.\n");
+			exit(2);
+		}
+		if (report_file && need_histo()) {
+			fprintf(stderr,
+				"latency: -o excludes -h, -s and -g in test modes 1 and 2.\n");
+			exit(2);
+		}
+	}
+
 	time(&test_start);
 
 	histogram_avg = calloc(histogram_size, sizeof(long));
@@ -653,6 +1025,34 @@ int main(int argc, char **argv)
 	if (!(histogram_avg && histogram_max && histogram_min))
 		cleanup();
 
+	nr_samplers = nr_cpus > 1 ? nr_cpus : 1;
+	for (i = 0; i < nr_samplers; i++) {
+		struct sampler *s = &samplers[i];
+
+		s->cpu = nr_cpus ? cpus[i] : -1;
+		s->gminjitter = TEN_MILLION;
+		s->gmaxjitter = -TEN_MILLION;
+
+		if (nr_samplers == 1) {
+			s->histogram_avg = histogram_avg;
+			s->histogram_max = histogram_max;
+			s->histogram_min = histogram_min;
+		} else {
+			s->histogram_avg = calloc(histogram_size, sizeof(long));
+			s->histogram_max = calloc(histogram_size, sizeof(long));
+			s->histogram_min = calloc(histogram_size, sizeof(long));
+			if (!(s->histogram_avg && s->histogram_max &&
+			      s->histogram_min))
+				cleanup();
+		}
+
+		if (need_hdr()) {
+			s->hdr = calloc(RTTST_HDR_CELLS, sizeof(long));
+			if (!s->hdr)
+				cleanup();
+		}
+	}
+
 	if (period_ns == 0)
 		period_ns = CONFIG_XENO_DEFAULT_PERIOD;	/* ns */
 
@@ -725,28 +1125,37 @@ int main(int argc, char **argv)
 		return 0;
 	}
 
-	if (test_mode == USER_TASK) {
-		snprintf(task_name, sizeof(task_name), "sampling-%d", getpid());
-		err =
-		    rt_task_create(&latency_task, task_name, 0, priority,
-				   T_FPU | cpu | T_WARNSW);
+	if (test_mode == USER_TASK)
+		for (i = 0; i < nr_samplers; i++) {
+			struct sampler *s = &samplers[i];
 
-		if (err) {
-			fprintf(stderr,
-				"latency: failed to create latency task, code %d\n",
-				err);
-			return 0;
-		}
+			if (nr_samplers > 1)
+				snprintf(task_name, sizeof(task_name),
+					 "smpl%d-%d", s->cpu, getpid());
+			else
+				snprintf(task_name, sizeof(task_name),
+					 "sampling-%d", getpid());
+			err =
+			    rt_task_create(&s->task, task_name, 0, priority,
+					   T_FPU | (s->cpu >= 0 ? T_CPU(s->cpu) : 0)
+					   | T_WARNSW);
+
+			if (err) {
+				fprintf(stderr,
+					"latency: failed to create latency task, code %d\n",
+					err);
+				return 0;
+			}
 
-		err = rt_task_start(&latency_task, &latency, NULL);
+			err = rt_task_start(&s->task, &latency, s);
 
-		if (err) {
-			fprintf(stderr,
-				"latency: failed to start latency task, code %d\n",
-				err);
-			return 0;
+			if (err) {
+				fprintf(stderr,
+					"latency: failed to start latency task, code %d\n",
+					err);
+				return 0;
+			}
 		}
-	}
 
 	sigwait(&mask, &sig);
 	finished = 1;
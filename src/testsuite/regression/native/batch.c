@@ -0,0 +1,220 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <sched.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include <native/task.h>
+#include <native/sem.h>
+#include <native/event.h>
+#include <native/queue.h>
+#include <native/syscall.h>
+#include <asm-generic/batch.h>
+
+#include "check.h"
+
+static RT_SEM sem;
+static RT_EVENT event;
+static unsigned long seen;
+
+static void waiter(void *cookie)
+{
+	check_native(rt_sem_p(&sem, TM_INFINITE));
+	/* The batch must have completed before we could resume. */
+	check_native(rt_event_wait(&event, 0x4, &seen,
+				   EV_ANY, TM_NONBLOCK));
+}
+
+static void check_status(const char *what, long *status, long expected)
+{
+	if (*status != expected) {
+		fprintf(stderr, "FAILURE: %s returned %ld, expected %ld\n",
+			what, *status, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void *other_thread(void *arg)
+{
+	long *st[2];
+	RT_TASK task;
+	int n;
+
+	/*
+	 * A non real-time shadow relaxes after each call holding no
+	 * resource, batched or not: the batch stops after the first
+	 * one.
+	 */
+	check_native(rt_task_shadow(&task, "other", 0, 0));
+	st[0] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	st[1] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	n = check_native(xeno_batch_submit());
+	if (n != 1) {
+		fprintf(stderr, "FAILURE: processed %d calls out of 1\n", n);
+		exit(EXIT_FAILURE);
+	}
+	check_status("sem_v", st[0], 0);
+	check_status("sem_v after relax", st[1], -EAGAIN);
+
+	return NULL;
+}
+
+int main(void)
+{
+	long *st[4], *bad, *lostage;
+	RT_QUEUE_PLACEHOLDER ph;
+	RTIME timeout = TM_NONBLOCK;
+	RT_SEM_INFO sinfo;
+	RT_TASK task, wtask;
+	RT_QUEUE queue;
+	pthread_attr_t attr;
+	cpu_set_t cpus;
+	pthread_t tid;
+	int i, n, mode;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	/* Keep the waiter on our CPU, so that it could preempt us. */
+	CPU_ZERO(&cpus);
+	CPU_SET(0, &cpus);
+	sched_setaffinity(0, sizeof(cpus), &cpus);
+
+	fprintf(stderr, "Checking batched skin calls\n");
+
+	check_native(rt_task_shadow(&task, "main", 10, 0));
+	check_native(rt_sem_create(&sem, NULL, 0, S_PRIO));
+	check_native(rt_event_create(&event, NULL, 0, EV_PRIO));
+
+	st[0] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	st[1] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	st[2] = XENOMAI_BATCH_SKINCALL2(__native_muxid,
+					__native_event_signal, &event, 0x5);
+	bad = XENOMAI_BATCH_SKINCALL0(__native_muxid, 255);
+	lostage = XENOMAI_BATCH_SKINCALL1(__native_muxid,
+					  __native_queue_delete, NULL);
+	n = check_native(xeno_batch_submit());
+	if (n != 5 || xeno_batch_pending()) {
+		fprintf(stderr, "FAILURE: processed %d calls out of 5\n", n);
+		exit(EXIT_FAILURE);
+	}
+	check_status("sem_v", st[0], 0);
+	check_status("sem_v", st[1], 0);
+	check_status("event_signal", st[2], 0);
+	check_status("invalid call", bad, -ENOSYS);
+	check_status("secondary mode call", lostage, -EPERM);
+
+	check_native(rt_sem_inquire(&sem, &sinfo));
+	if (sinfo.count != 2) {
+		fprintf(stderr, "FAILURE: semaphore count %lu, expected 2\n",
+			sinfo.count);
+		exit(EXIT_FAILURE);
+	}
+	check_native(rt_sem_p(&sem, TM_NONBLOCK));
+	check_native(rt_sem_p(&sem, TM_NONBLOCK));
+	check_native(rt_event_clear(&event, ~0UL, NULL));
+
+	/* The batch is bounded. */
+	for (i = 0; i < XNSYS_BATCH_MAX; i++)
+		if (XENOMAI_BATCH_SKINCALL1(__native_muxid,
+					    __native_sem_v, &sem) == NULL) {
+			fprintf(stderr, "FAILURE: batch full at %d\n", i);
+			exit(EXIT_FAILURE);
+		}
+	if (XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem)) {
+		fprintf(stderr, "FAILURE: batch overflow\n");
+		exit(EXIT_FAILURE);
+	}
+	xeno_batch_discard();
+
+	/*
+	 * Wake up a higher priority waiter first in a batch: it must
+	 * not preempt us before the last call has run.
+	 */
+	check_native(rt_task_spawn(&wtask, "waiter", 0, 20, T_JOINABLE,
+				   waiter, NULL));
+	st[0] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	st[1] = XENOMAI_BATCH_SKINCALL2(__native_muxid,
+					__native_event_signal, &event, 0x4);
+	check_native(xeno_batch_submit());
+	check_status("sem_v", st[0], 0);
+	check_status("event_signal", st[1], 0);
+	check_native(rt_task_join(&wtask));
+	if (seen != 0x4) {
+		fprintf(stderr, "FAILURE: waiter saw events %#lx\n", seen);
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Binding to a queue relaxes the caller: the batch must stop
+	 * right after, and leave the remaining calls for user space
+	 * to resubmit.
+	 */
+	check_native(rt_queue_create(&queue, "batchq", 1024, Q_UNLIMITED,
+				     Q_FIFO));
+	st[0] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	st[1] = XENOMAI_BATCH_SKINCALL3(__native_muxid, __native_queue_bind,
+					&ph, "batchq", &timeout);
+	st[2] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	st[3] = XENOMAI_BATCH_SKINCALL2(__native_muxid,
+					__native_event_signal, &event, 0x1);
+	n = check_native(xeno_batch_submit());
+	if (n != 2) {
+		fprintf(stderr, "FAILURE: processed %d calls out of 2\n", n);
+		exit(EXIT_FAILURE);
+	}
+	check_status("sem_v", st[0], 0);
+	check_status("queue_bind", st[1], 0);
+	check_status("sem_v after relax", st[2], -EAGAIN);
+	check_status("event_signal after relax", st[3], -EAGAIN);
+
+	check_native(rt_sem_inquire(&sem, &sinfo));
+	if (sinfo.count != 1) {
+		fprintf(stderr, "FAILURE: semaphore count %lu, expected 1\n",
+			sinfo.count);
+		exit(EXIT_FAILURE);
+	}
+
+	/* The scheduler lock must have been dropped. */
+	check_native(rt_task_set_mode(0, 0, &mode));
+	if (mode & T_LOCK) {
+		fprintf(stderr, "FAILURE: scheduler still locked\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Resubmit the calls which did not run. */
+	st[0] = XENOMAI_BATCH_SKINCALL1(__native_muxid, __native_sem_v, &sem);
+	st[1] = XENOMAI_BATCH_SKINCALL2(__native_muxid,
+					__native_event_signal, &event, 0x1);
+	n = check_native(xeno_batch_submit());
+	if (n != 2) {
+		fprintf(stderr, "FAILURE: processed %d calls out of 2\n", n);
+		exit(EXIT_FAILURE);
+	}
+	check_status("sem_v", st[0], 0);
+	check_status("event_signal", st[1], 0);
+
+	check_native(rt_sem_p(&sem, TM_NONBLOCK));
+	check_native(rt_sem_p(&sem, TM_NONBLOCK));
+	check_native(-pthread_attr_init(&attr));
+	check_native(-pthread_attr_setinheritsched(&attr,
+						   PTHREAD_EXPLICIT_SCHED));
+	check_native(-pthread_attr_setschedpolicy(&attr, SCHED_OTHER));
+	check_native(-pthread_create(&tid, &attr, other_thread, NULL));
+	check_native(-pthread_join(tid, NULL));
+	pthread_attr_destroy(&attr);
+	check_native(rt_sem_inquire(&sem, &sinfo));
+	if (sinfo.count != 1) {
+		fprintf(stderr, "FAILURE: semaphore count %lu, expected 1\n",
+			sinfo.count);
+		exit(EXIT_FAILURE);
+	}
+
+	check_native(rt_queue_delete(&queue));
+	check_native(rt_event_delete(&event));
+	check_native(rt_sem_delete(&sem));
+
+	fprintf(stderr, "batched skin calls: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+
+#include <analogy/analogy.h>
+
+#include "check.h"
+
+#define DEVICE "analogy0"
+#define BOARD "analogy_fake"
+#define AI_SUBD 0
+#define MAX_LISTS 64
+
+static a4l_desc_t dsc;
+
+static int count_mappings(void)
+{
+	char line[256];
+	int n = 0;
+	FILE *fp;
+
+	fp = fopen("/proc/self/maps", "r");
+	if (fp == NULL) {
+		perror("fopen");
+		exit(EXIT_FAILURE);
+	}
+
+	while (fgets(line, sizeof(line), fp))
+		n++;
+
+	fclose(fp);
+
+	return n;
+}
+
+static void attach_fake(void)
+{
+	a4l_lnkdesc_t lnkdsc;
+	int fd;
+
+	fd = check_native(a4l_sys_open(DEVICE));
+
+	memset(&lnkdsc, 0, sizeof(lnkdsc));
+	lnkdsc.bname = BOARD;
+	lnkdsc.bname_size = strlen(BOARD);
+	/* Fails harmlessly if some driver is already attached. */
+	a4l_sys_attach(fd, &lnkdsc);
+
+	a4l_sys_close(fd);
+}
+
+static void check_prep_error(const char *what, a4l_insnprep_t *prep,
+			     int expected)
+{
+	int ret = a4l_prep_insnlist(&dsc, prep);
+
+	if (ret != expected) {
+		fprintf(stderr, "FAILURE: %s returned %d, expected %d\n",
+			what, ret, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(void)
+{
+	static a4l_insnprep_t preps[MAX_LISTS];
+	uint16_t samples[2], *data;
+	a4l_insnprep_t prep;
+	a4l_insn_t insns[1];
+	int i, n, nmaps;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking analogy prepared instruction lists\n");
+
+	attach_fake();
+	check_native(a4l_open(&dsc, DEVICE));
+
+	/* Prepare, run, then release a single read. */
+	memset(insns, 0, sizeof(insns));
+	insns[0].type = A4L_INSN_READ;
+	insns[0].idx_subd = AI_SUBD;
+	insns[0].chan_desc = CHAN(0);
+	insns[0].data_size = sizeof(samples);
+	insns[0].data = samples;
+	prep.count = 1;
+	prep.insns = insns;
+	check_native(a4l_prep_insnlist(&dsc, &prep));
+	data = insns[0].data;
+	if (prep.data == NULL || (void *)data < prep.data ||
+	    (char *)data + sizeof(samples) >
+	    (char *)prep.data + prep.data_size) {
+		fprintf(stderr, "FAILURE: data %p out of area %p\n",
+			data, prep.data);
+		exit(EXIT_FAILURE);
+	}
+	check_native(a4l_exec_insnlist(&dsc, &prep));
+	check_native(a4l_free_insnlist(&dsc, &prep));
+
+	/* Oversized data areas must be rejected up front. */
+	insns[0].data_size = A4L_PREPARED_DATA_MAX + 1;
+	insns[0].data = samples;
+	check_prep_error("oversized instruction", &prep, -EINVAL);
+
+	insns[0].data_size = ~0U;
+	check_prep_error("wrapping instruction", &prep, -EINVAL);
+
+	/*
+	 * Fill the context; the list which finds no room must not
+	 * leave its data area mapped.
+	 */
+	for (n = 0; n < MAX_LISTS; n++) {
+		insns[0].data_size = sizeof(samples);
+		insns[0].data = samples;
+		preps[n].count = 1;
+		preps[n].insns = insns;
+		nmaps = count_mappings();
+		i = a4l_prep_insnlist(&dsc, &preps[n]);
+		if (i == -EAGAIN)
+			break;
+		check_native(i);
+	}
+	if (n == 0 || n == MAX_LISTS) {
+		fprintf(stderr, "FAILURE: %d lists prepared\n", n);
+		exit(EXIT_FAILURE);
+	}
+	if (count_mappings() != nmaps) {
+		fprintf(stderr, "FAILURE: rejected list left a mapping\n");
+		exit(EXIT_FAILURE);
+	}
+
+	for (i = 0; i < n; i++)
+		check_native(a4l_free_insnlist(&dsc, &preps[i]));
+
+	check_native(a4l_close(&dsc));
+
+	fprintf(stderr, "analogy prepared instruction lists: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,196 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+
+#include <native/task.h>
+#include <native/timer.h>
+#include <rtdm/ring.h>
+#include <rtdm/rtipc.h>
+
+#include "check.h"
+
+#define MSG "ring message"
+
+static rt_dev_ring_t ring;
+
+static struct rtdm_ring_sqe *get_sqe(unsigned int opcode, int fd,
+				     unsigned long long user_data)
+{
+	struct rtdm_ring_sqe *sqe;
+
+	sqe = rt_dev_ring_get_sqe(&ring);
+	if (sqe == NULL) {
+		fprintf(stderr, "FAILURE: submission queue full\n");
+		exit(EXIT_FAILURE);
+	}
+
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = opcode;
+	sqe->fd = fd;
+	sqe->user_data = user_data;
+
+	return sqe;
+}
+
+static long long reap(unsigned long long user_data)
+{
+	struct rtdm_ring_cqe *cqe;
+	long long res;
+
+	check_native(rt_dev_ring_wait_cqe(&ring, &cqe, 0));
+	if (cqe->user_data != user_data) {
+		fprintf(stderr, "FAILURE: completed %llu, expected %llu\n",
+			cqe->user_data, user_data);
+		exit(EXIT_FAILURE);
+	}
+	res = cqe->res;
+	rt_dev_ring_cqe_seen(&ring);
+
+	return res;
+}
+
+static void check_result(const char *what, long long res, long long expected)
+{
+	if (res != expected) {
+		fprintf(stderr, "FAILURE: %s returned %lld, expected %lld\n",
+			what, res, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static int check_socket_requests(struct rtdm_ring_params *params)
+{
+	struct rtdm_ring_sqe *sqe;
+	struct rtdm_ring_cqe *cqe;
+	struct sockaddr_ipc saddr;
+	socklen_t addrlen;
+	char *buf;
+	int s;
+
+	s = rt_dev_socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (s < 0) {
+		fprintf(stderr, "IDDP not supported, skipping socket checks\n");
+		return -1;
+	}
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;
+	check_native(rt_dev_bind(s, (struct sockaddr *)&saddr,
+				 sizeof(saddr)));
+	addrlen = sizeof(saddr);
+	check_native(rt_dev_getsockname(s, (struct sockaddr *)&saddr,
+					&addrlen));
+
+	/* A blocked receiver only stalls one worker. */
+	sqe = get_sqe(RTDM_RING_OP_RECVMSG, s, 10);
+	sqe->buf = 1;
+	sqe->len = params->buf_size;
+	check_native(rt_dev_ring_submit(&ring, 0, 0));
+
+	buf = rt_dev_ring_buffer(&ring, 0);
+	strcpy(buf, MSG);
+	memcpy(buf + 128, &saddr, sizeof(saddr));
+	sqe = get_sqe(RTDM_RING_OP_SENDMSG, s, 11);
+	sqe->len = sizeof(MSG);
+	sqe->addr_off = 128;
+	sqe->addr_len = sizeof(saddr);
+	check_native(rt_dev_ring_submit(&ring, 0, 0));
+
+	check_native(rt_dev_ring_wait_cqe(&ring, &cqe, 0));
+	if (cqe->user_data == 11) {
+		check_result("sendmsg", cqe->res, sizeof(MSG));
+		rt_dev_ring_cqe_seen(&ring);
+		check_result("recvmsg", reap(10), sizeof(MSG));
+	} else {
+		check_result("recvmsg", cqe->res, sizeof(MSG));
+		rt_dev_ring_cqe_seen(&ring);
+		check_result("sendmsg", reap(11), sizeof(MSG));
+	}
+	if (strcmp(rt_dev_ring_buffer(&ring, 1), MSG)) {
+		fprintf(stderr, "FAILURE: received garbage\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/*
+	 * Leave a worker blocked in the driver: destroying the ring
+	 * must still get rid of it.
+	 */
+	sqe = get_sqe(RTDM_RING_OP_RECVMSG, s, 12);
+	sqe->buf = 1;
+	sqe->len = params->buf_size;
+	check_native(rt_dev_ring_submit(&ring, 0, 0));
+	check_native(rt_task_sleep(10000000));
+
+	return s;
+}
+
+int main(void)
+{
+	struct rtdm_ring_params params;
+	struct rtdm_ring_sqe *sqe;
+	struct rtdm_ring_cqe *cqe;
+	RTIME start, elapsed;
+	RT_TASK task;
+	int s;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking RTDM submission/completion rings\n");
+
+	check_native(rt_task_shadow(&task, "main", 10, 0));
+
+	memset(&params, 0, sizeof(params));
+	params.sq_entries = 3;
+	params.nr_bufs = 2;
+	params.buf_size = 256;
+	params.nr_workers = 2;
+	params.priority = 20;
+	check_result("setup with a bad SQ size",
+		     rt_dev_ring_setup(&ring, &params), -EINVAL);
+
+	params.sq_entries = 8;
+	s = rt_dev_ring_setup(&ring, &params);
+	if (s == -ENOSYS) {
+		fprintf(stderr, "RTDM rings not supported, skipping\n");
+		return EXIT_SUCCESS;
+	}
+	check_native(s);
+
+	/* Requests complete with their own tag. */
+	get_sqe(RTDM_RING_OP_NOP, -1, 1);
+	check_native(rt_dev_ring_submit(&ring, 0, 0));
+	check_result("nop", reap(1), 0);
+
+	get_sqe(RTDM_RING_OP_READ, -1, 2);
+	check_native(rt_dev_ring_submit(&ring, 0, 0));
+	check_result("read from a bad descriptor", reap(2), -EBADF);
+
+	sqe = get_sqe(RTDM_RING_OP_WRITE, -1, 3);
+	sqe->buf = params.nr_bufs;
+	check_native(rt_dev_ring_submit(&ring, 0, 0));
+	check_result("write from a bad buffer", reap(3), -EINVAL);
+
+	/* Waiting must not outlast the timeout, whatever happens. */
+	start = rt_timer_read();
+	check_result("wait on an idle ring",
+		     rt_dev_ring_wait_cqe(&ring, &cqe, 10000000), -ETIMEDOUT);
+	elapsed = rt_timer_read() - start;
+	if (elapsed < 10000000 || elapsed > 1000000000) {
+		fprintf(stderr, "FAILURE: waited %llu ns for 10 ms\n",
+			(unsigned long long)elapsed);
+		exit(EXIT_FAILURE);
+	}
+
+	s = check_socket_requests(&params);
+
+	check_native(rt_dev_ring_destroy(&ring));
+	if (s >= 0)
+		check_native(rt_dev_close(s));
+
+	fprintf(stderr, "RTDM submission/completion rings: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+
+#include <native/task.h>
+#include <native/sem.h>
+
+#include "check.h"
+
+#define POOL_SIZE	4
+#define NR_JOBS		200
+
+static RT_SEM done;
+static int prios[NR_JOBS];
+
+static void job(void *cookie)
+{
+	long n = (long)cookie;
+	RT_TASK_INFO info;
+
+	check_native(rt_task_inquire(NULL, &info));
+	prios[n] = info.bprio;
+	check_native(rt_sem_v(&done));
+}
+
+static void blocker(void *cookie)
+{
+	check_native(rt_sem_p((RT_SEM *)cookie, TM_INFINITE));
+}
+
+static void self_job(void *cookie)
+{
+	*(RT_TASK *)cookie = *rt_task_self();
+	check_native(rt_sem_v(&done));
+}
+
+int main(void)
+{
+	RT_TASK_POOL pool;
+	RT_TASK task, wtask, *worker;
+	RT_SEM gate;
+	long n;
+	int err, prio;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking native task pools\n");
+
+	check_native(rt_task_shadow(&task, "main", 50, 0));
+	check_native(rt_sem_create(&done, NULL, 0, S_FIFO));
+	check_native(rt_sem_create(&gate, NULL, 0, S_FIFO));
+	check_native(rt_task_pool_create(&pool, "pool", POOL_SIZE, 0, 0));
+
+	/* Jobs must run with the priority they were given. */
+	for (n = 0; n < NR_JOBS; n++) {
+		prio = 1 + n % 40;
+		check_native(rt_task_spawn_from_pool(&pool, &worker, prio,
+						     job, (void *)n));
+		check_native(rt_sem_p(&done, TM_INFINITE));
+		if (prios[n] != prio) {
+			fprintf(stderr, "FAILURE: job %ld ran at priority %d, "
+				"expected %d\n", n, prios[n], prio);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* Exhaust the pool, then release it. */
+	for (n = 0; n < POOL_SIZE; n++)
+		check_native(rt_task_spawn_from_pool(&pool, NULL, 60,
+						     blocker, &gate));
+	err = rt_task_spawn_from_pool(&pool, NULL, 60, blocker, &gate);
+	if (err != -EAGAIN) {
+		fprintf(stderr, "FAILURE: spawned from an exhausted pool "
+			"(%d)\n", err);
+		exit(EXIT_FAILURE);
+	}
+	check_native(rt_sem_broadcast(&gate));
+
+	check_native(rt_task_pool_delete(&pool));
+
+	/*
+	 * Parking is distinct from suspension: an explicitly
+	 * suspended idle worker must not run any job until it is
+	 * resumed, and resuming it must not wake it up otherwise.
+	 */
+	check_native(rt_task_pool_create(&pool, "pool1", 1, 0, 0));
+	check_native(rt_task_spawn_from_pool(&pool, NULL, 60,
+					     self_job, &wtask));
+	check_native(rt_sem_p(&done, TM_INFINITE));
+	check_native(rt_task_resume(&wtask));
+	check_native(rt_task_suspend(&wtask));
+	check_native(rt_task_spawn_from_pool(&pool, NULL, 60,
+					     self_job, &wtask));
+	err = rt_sem_p(&done, 10000000);
+	if (err != -ETIMEDOUT) {
+		fprintf(stderr, "FAILURE: suspended worker ran a job (%d)\n",
+			err);
+		exit(EXIT_FAILURE);
+	}
+	check_native(rt_task_resume(&wtask));
+	check_native(rt_sem_p(&done, TM_INFINITE));
+
+	check_native(rt_task_pool_delete(&pool));
+	check_native(rt_sem_delete(&gate));
+	check_native(rt_sem_delete(&done));
+
+	fprintf(stderr, "native task pools: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,127 @@
+/*
+ * IDDP packet buffer regression test.
+ *
+ * Checks that datagrams spanning several buffers of a local pool are
+ * conveyed intact, that a datagram which can never fit the pool is
+ * refused with ENOBUFS, and that buffers are recycled once read.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include <rtdm/rtipc.h>
+#include "check.h"
+
+#define POOLSZ	4096
+#define MSGSZ	1500
+#define MAXMSGS	16
+
+static char msgs[MAXMSGS][MSGSZ];
+
+static void check_errno(const char *what, int ret, int expected)
+{
+	if (ret >= 0 || errno != expected) {
+		fprintf(stderr, "FAILURE: %s returned %d, expected %s\n",
+			what, ret < 0 ? -errno : ret, strerror(expected));
+		exit(EXIT_FAILURE);
+	}
+}
+
+static int fill_pool(int s, int round)
+{
+	int n, ret;
+
+	for (n = 0; n < MAXMSGS; n++) {
+		memset(msgs[n], round * MAXMSGS + n, MSGSZ);
+		ret = send(s, msgs[n], MSGSZ, MSG_DONTWAIT);
+		if (ret < 0) {
+			check_errno("send to a full pool", ret, EAGAIN);
+			break;
+		}
+		if (ret != MSGSZ) {
+			fprintf(stderr, "FAILURE: short send (%d)\n", ret);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	if (n == 0 || n == MAXMSGS) {
+		fprintf(stderr, "FAILURE: %d datagrams fit the pool\n", n);
+		exit(EXIT_FAILURE);
+	}
+
+	return n;
+}
+
+static void drain_pool(int s, int nr)
+{
+	char buf[MSGSZ];
+	int n, ret;
+
+	for (n = 0; n < nr; n++) {
+		ret = check_unix(recv(s, buf, sizeof(buf), MSG_DONTWAIT));
+		if (ret != MSGSZ || memcmp(buf, msgs[n], MSGSZ)) {
+			fprintf(stderr, "FAILURE: datagram %d corrupted\n", n);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	ret = recv(s, buf, sizeof(buf), MSG_DONTWAIT);
+	check_errno("recv from an empty socket", ret, EAGAIN);
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 10 };
+	static char big[POOLSZ + 1];
+	struct sockaddr_ipc saddr;
+	size_t poolsz = POOLSZ;
+	socklen_t addrlen;
+	int s, nr, ret;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	fprintf(stderr, "Checking IDDP packet buffers\n");
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_IDDP);
+	if (s < 0 && (errno == EAFNOSUPPORT || errno == EPROTONOSUPPORT)) {
+		fprintf(stderr, "IDDP not supported, skipping\n");
+		return EXIT_SUCCESS;
+	}
+	check_unix(s);
+	check_unix(setsockopt(s, SOL_IDDP, IDDP_POOLSZ,
+			      &poolsz, sizeof(poolsz)));
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;
+	check_unix(bind(s, (struct sockaddr *)&saddr, sizeof(saddr)));
+	addrlen = sizeof(saddr);
+	check_unix(getsockname(s, (struct sockaddr *)&saddr, &addrlen));
+
+	/* Talk to ourselves, through our own pool. */
+	check_unix(connect(s, (struct sockaddr *)&saddr, sizeof(saddr)));
+
+	ret = send(s, big, sizeof(big), MSG_DONTWAIT);
+	check_errno("send larger than the pool", ret, ENOBUFS);
+
+	/* Released buffers must be reusable, time and again. */
+	nr = fill_pool(s, 0);
+	drain_pool(s, nr);
+	if (fill_pool(s, 1) != nr) {
+		fprintf(stderr, "FAILURE: pool shrank after recycling\n");
+		exit(EXIT_FAILURE);
+	}
+	drain_pool(s, nr);
+
+	check_unix(close(s));
+
+	fprintf(stderr, "IDDP packet buffers: success\n");
+	return EXIT_SUCCESS;
+}
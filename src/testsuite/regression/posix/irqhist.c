@@ -0,0 +1,187 @@
+/*
+ * Interrupt histograms regression test.
+ *
+ * Checks the layout of the records read from /proc/xenomai/irqhist,
+ * that the histograms of the timer interrupt account for every hit
+ * within bounds matching the worst cases, and that they may be
+ * reset.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sched.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include <nucleus/intr.h>
+#include "check.h"
+
+#define IRQHIST		"/proc/xenomai/irqhist"
+#define MAX_RECORDS	256
+
+static struct xnintr_hist_rec recs[MAX_RECORDS];
+
+static int read_records(void)
+{
+	char *p = (char *)recs;
+	size_t len = 0;
+	ssize_t ret;
+	int fd;
+
+	fd = check_unix(open(IRQHIST, O_RDONLY));
+	do {
+		ret = check_unix(read(fd, p + len, sizeof(recs) - len));
+		len += ret;
+	} while (ret > 0 && len < sizeof(recs));
+	check_unix(close(fd));
+
+	if (len % sizeof(recs[0])) {
+		fprintf(stderr, "FAILURE: read %zu bytes, not a multiple of "
+			"%zu\n", len, sizeof(recs[0]));
+		exit(EXIT_FAILURE);
+	}
+
+	return len / sizeof(recs[0]);
+}
+
+/* The records of our own CPU are fetched with its interrupts off. */
+static struct xnintr_hist_rec *find_timer(int nr)
+{
+	int n;
+
+	for (n = 0; n < nr; n++) {
+		if (recs[n].name[sizeof(recs[n].name) - 1]) {
+			fprintf(stderr, "FAILURE: unterminated name\n");
+			exit(EXIT_FAILURE);
+		}
+		if (recs[n].cpu == 0 && !strcmp(recs[n].name, "[timer]"))
+			return &recs[n];
+	}
+
+	fprintf(stderr, "FAILURE: no timer record for CPU0\n");
+	exit(EXIT_FAILURE);
+}
+
+static unsigned long long check_hist(const char *what,
+				     const unsigned long long *hist,
+				     unsigned long long max)
+{
+	unsigned long long sum = 0, low, high;
+	int n, top = -1;
+
+	for (n = 0; n < XNINTR_HIST_BUCKETS; n++) {
+		sum += hist[n];
+		if (hist[n])
+			top = n;
+	}
+
+	if (top < 0)
+		return 0;
+
+	/* The worst case must lie in the topmost bucket in use. */
+	low = top ? (1ULL << XNINTR_HIST_SHIFT) << (top - 1) : 0;
+	high = (1ULL << XNINTR_HIST_SHIFT) << top;
+	if (max < low || (top < XNINTR_HIST_BUCKETS - 1 && max >= high)) {
+		fprintf(stderr, "FAILURE: %s worst case %llu ns outside "
+			"bucket #%d\n", what, max, top);
+		exit(EXIT_FAILURE);
+	}
+
+	return sum;
+}
+
+static void check_timer(struct xnintr_hist_rec *rec)
+{
+	unsigned long long lat, run;
+
+	lat = check_hist("latency", rec->lat, rec->lat_max);
+	run = check_hist("duration", rec->run, rec->run_max);
+	if (lat != run || lat > rec->count) {
+		fprintf(stderr, "FAILURE: %llu hits, %llu latencies, "
+			"%llu durations\n", rec->count, lat, run);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void tick(void)
+{
+	struct timespec ts = { .tv_sec = 0, .tv_nsec = 1000000 };
+	int n;
+
+	for (n = 0; n < 10; n++)
+		check_unix(clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL));
+}
+
+static void write_reset(const char *val, int expected)
+{
+	int fd, ret;
+
+	fd = check_unix(open(IRQHIST, O_WRONLY));
+	ret = write(fd, val, strlen(val));
+	check_unix(close(fd));
+
+	if (ret < 0)
+		ret = -errno;
+	else
+		ret = 0;
+	if (ret != expected) {
+		fprintf(stderr, "FAILURE: writing %s returned %d, "
+			"expected %d\n", val, ret, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	struct xnintr_hist_rec *rec;
+	unsigned long long before;
+	cpu_set_t cpus;
+	int nr;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking interrupt histograms\n");
+
+	if (access(IRQHIST, R_OK)) {
+		fprintf(stderr, "No interrupt histograms, skipping\n");
+		return EXIT_SUCCESS;
+	}
+
+	CPU_ZERO(&cpus);
+	CPU_SET(0, &cpus);
+	check_unix(sched_setaffinity(0, sizeof(cpus), &cpus));
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	tick();
+	nr = read_records();
+	rec = find_timer(nr);
+	if (rec->count == 0) {
+		fprintf(stderr, "FAILURE: no timer hit on CPU0\n");
+		exit(EXIT_FAILURE);
+	}
+	check_timer(rec);
+
+	/* Only zero resets the histograms, not the hit counts. */
+	write_reset("1", -EINVAL);
+	before = rec->count;
+	write_reset("0", 0);
+	tick();
+	nr = read_records();
+	rec = find_timer(nr);
+	check_timer(rec);
+	if (rec->count < before ||
+	    check_hist("latency", rec->lat, rec->lat_max) >= rec->count) {
+		fprintf(stderr, "FAILURE: histograms not reset\n");
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stderr, "interrupt histograms: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "check.h"
+
+#define MQ_NAME "/mq_zerocopy"
+#define MQ_MAXMSG 4
+#define MQ_MSGSIZE 64
+#define NR_ROUNDS 1000
+
+static void *receiver(void *cookie)
+{
+	mqd_t mqd = (mqd_t)(long)cookie;
+	unsigned i, val;
+	ssize_t len;
+	void *buf;
+
+	for (i = 0; i < NR_ROUNDS; i++) {
+		check_unix(len = mq_fetch_np(mqd, &buf, NULL));
+		memcpy(&val, buf, sizeof(val));
+		if (len != sizeof(val) || val != i) {
+			fprintf(stderr, "FAILURE: received %u (%ld bytes), "
+				"expected %u\n", val, (long)len, i);
+			exit(EXIT_FAILURE);
+		}
+		check_unix(mq_release_np(mqd, buf));
+	}
+
+	return NULL;
+}
+
+int main(void)
+{
+	struct mq_attr attr = {
+		.mq_maxmsg = MQ_MAXMSG,
+		.mq_msgsize = MQ_MSGSIZE,
+	};
+	struct sched_param sparam;
+	char msg[MQ_MSGSIZE];
+	pthread_t tid;
+	mqd_t mqd, nbd;
+	unsigned i, prio;
+	void *buf;
+
+	fprintf(stderr, "Checking posix skin zero-copy message queues\n");
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	sparam.sched_priority = 10;
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &sparam));
+
+	mq_unlink(MQ_NAME);
+	check_unix(mqd = mq_open(MQ_NAME, O_CREAT | O_EXCL | O_RDWR
+				 | MQ_ZEROCOPY, 0644, &attr));
+
+	/* Type mismatch between openers must be caught. */
+	if (mq_open(MQ_NAME, O_RDWR) != (mqd_t)-1 || errno != EINVAL) {
+		fprintf(stderr, "FAILURE: opened zero-copy queue as regular\n");
+		exit(EXIT_FAILURE);
+	}
+
+	check_unix(nbd = mq_open(MQ_NAME, O_RDWR | O_NONBLOCK | MQ_ZEROCOPY));
+
+	/* Fill the queue in place, then check overflow. */
+	for (i = 0; i < MQ_MAXMSG; i++) {
+		check_unix(mq_reserve_np(nbd, &buf, sizeof(i), NULL));
+		memcpy(buf, &i, sizeof(i));
+		check_unix(mq_commit_np(nbd, buf, sizeof(i)));
+	}
+	if (mq_reserve_np(nbd, &buf, sizeof(i), NULL) != -1 || errno != EAGAIN) {
+		fprintf(stderr, "FAILURE: reserved a slot in a full queue\n");
+		exit(EXIT_FAILURE);
+	}
+	if (mq_reserve_np(nbd, &buf, MQ_MSGSIZE + 1, NULL) != -1
+	    || errno != EMSGSIZE) {
+		fprintf(stderr, "FAILURE: reserved an oversized slot\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Drain through the copying interface, FIFO order expected. */
+	for (i = 0; i < MQ_MAXMSG; i++) {
+		unsigned val;
+		check_unix(mq_receive(nbd, msg, sizeof(msg), &prio));
+		memcpy(&val, msg, sizeof(val));
+		if (val != i) {
+			fprintf(stderr, "FAILURE: received %u, expected %u\n",
+				val, i);
+			exit(EXIT_FAILURE);
+		}
+	}
+	if (mq_receive(nbd, msg, sizeof(msg), &prio) != -1 || errno != EAGAIN) {
+		fprintf(stderr, "FAILURE: received from an empty queue\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Ping-pong with a blocking receiver, to exercise wakeups. */
+	check_pthread(pthread_create(&tid, NULL, receiver, (void *)(long)mqd));
+	for (i = 0; i < NR_ROUNDS; i++)
+		check_unix(mq_send(mqd, (const char *)&i, sizeof(i), 0));
+	check_pthread(pthread_join(tid, NULL));
+
+	check_unix(mq_close(nbd));
+	check_unix(mq_close(mqd));
+	check_unix(mq_unlink(MQ_NAME));
+
+	/* The capacity is rounded up to a power of two, and reported. */
+	attr.mq_maxmsg = MQ_MAXMSG - 1;
+	check_unix(mqd = mq_open(MQ_NAME, O_CREAT | O_EXCL | O_RDWR
+				 | O_NONBLOCK | MQ_ZEROCOPY, 0644, &attr));
+	check_unix(mq_getattr(mqd, &attr));
+	if (attr.mq_maxmsg != MQ_MAXMSG) {
+		fprintf(stderr, "FAILURE: capacity %ld, expected %d\n",
+			attr.mq_maxmsg, MQ_MAXMSG);
+		exit(EXIT_FAILURE);
+	}
+	for (i = 0; i < MQ_MAXMSG; i++)
+		check_unix(mq_send(mqd, (const char *)&i, sizeof(i), 0));
+	if (mq_send(mqd, (const char *)&i, sizeof(i), 0) != -1
+	    || errno != EAGAIN) {
+		fprintf(stderr, "FAILURE: sent to a full queue\n");
+		exit(EXIT_FAILURE);
+	}
+	check_unix(mq_close(mqd));
+	check_unix(mq_unlink(MQ_NAME));
+
+	fprintf(stderr, "posix skin zero-copy message queues: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,142 @@
+/*
+ * Adaptive mutex regression test.
+ *
+ * Checks the adaptive attribute, and that the contention statistics
+ * returned by pthread_mutex_getstats_np() account for every failed
+ * fast path exactly once, either as spun or as slow.
+ */
+#include <xeno_config.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "check.h"
+
+static pthread_mutex_t mutex;
+
+static void check_stats(const char *what, unsigned long contended,
+			unsigned long spun, unsigned long slow)
+{
+	struct pthread_mutex_stats_np stats;
+
+	check_pthread(pthread_mutex_getstats_np(&mutex, &stats));
+	if (stats.contended != contended || stats.spun != spun ||
+	    stats.slow != slow) {
+		fprintf(stderr, "FAILURE: %s: contended %lu, spun %lu, "
+			"slow %lu, expected %lu, %lu, %lu\n", what,
+			stats.contended, stats.spun, stats.slow,
+			contended, spun, slow);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void *contender(void *arg)
+{
+	/* Relaxed callers always go through the kernel, uncounted. */
+	check_pthread(pthread_set_mode_np(0, PTHREAD_PRIMARY));
+	check_pthread(pthread_mutex_lock(&mutex));
+	check_pthread(pthread_mutex_unlock(&mutex));
+
+	return NULL;
+}
+
+static void contend(void)
+{
+	struct sched_param param = { .sched_priority = 20 };
+	pthread_attr_t attr;
+	pthread_t tid;
+
+	check_pthread(pthread_mutex_lock(&mutex));
+
+	check_pthread(pthread_attr_init(&attr));
+	check_pthread(pthread_attr_setinheritsched(&attr,
+						   PTHREAD_EXPLICIT_SCHED));
+	check_pthread(pthread_attr_setschedpolicy(&attr, SCHED_FIFO));
+	check_pthread(pthread_attr_setschedparam(&attr, &param));
+	check_pthread(pthread_create(&tid, &attr, contender, NULL));
+	check_pthread(pthread_attr_destroy(&attr));
+
+	usleep(100000);
+	check_pthread(pthread_mutex_unlock(&mutex));
+	check_pthread(pthread_join(tid, NULL));
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 10 };
+	struct pthread_mutex_stats_np stats;
+	pthread_mutexattr_t mattr;
+	int adaptive, n;
+	cpu_set_t cpus;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking adaptive mutexes\n");
+
+#ifndef CONFIG_XENO_FASTSYNCH
+	fprintf(stderr, "No fast mutexes, skipping\n");
+	return EXIT_SUCCESS;
+#endif /* !CONFIG_XENO_FASTSYNCH */
+
+	/*
+	 * Keep everyone on the same CPU: the owner is then never
+	 * running while someone contends, so nobody may spin.
+	 */
+	CPU_ZERO(&cpus);
+	CPU_SET(0, &cpus);
+	check_unix(sched_setaffinity(0, sizeof(cpus), &cpus));
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	check_pthread(pthread_mutexattr_init(&mattr));
+	check_pthread(pthread_mutexattr_getadaptive_np(&mattr, &adaptive));
+	if (adaptive) {
+		fprintf(stderr, "FAILURE: mutexes are adaptive by default\n");
+		exit(EXIT_FAILURE);
+	}
+	check_pthread(pthread_mutexattr_setadaptive_np(&mattr, 2));
+	check_pthread(pthread_mutexattr_getadaptive_np(&mattr, &adaptive));
+	if (adaptive != 1) {
+		fprintf(stderr, "FAILURE: adaptive attribute is %d\n",
+			adaptive);
+		exit(EXIT_FAILURE);
+	}
+
+	check_pthread(pthread_mutex_init(&mutex, &mattr));
+	check_stats("fresh mutex", 0, 0, 0);
+
+	/* The fast path does not count. */
+	check_pthread(pthread_set_mode_np(0, PTHREAD_PRIMARY));
+	for (n = 0; n < 10; n++) {
+		check_pthread(pthread_mutex_lock(&mutex));
+		check_pthread(pthread_mutex_unlock(&mutex));
+	}
+	check_stats("uncontended mutex", 0, 0, 0);
+
+	contend();
+	check_stats("contended mutex", 1, 0, 1);
+
+	check_pthread(pthread_mutex_destroy(&mutex));
+	if (pthread_mutex_getstats_np(&mutex, &stats) != EINVAL) {
+		fprintf(stderr, "FAILURE: stats of a destroyed mutex\n");
+		exit(EXIT_FAILURE);
+	}
+
+	/* Plain mutexes are accounted for as well. */
+	check_pthread(pthread_mutexattr_setadaptive_np(&mattr, 0));
+	check_pthread(pthread_mutex_init(&mutex, &mattr));
+	contend();
+	check_stats("contended plain mutex", 1, 0, 1);
+	check_pthread(pthread_mutex_destroy(&mutex));
+
+	check_pthread(pthread_mutexattr_destroy(&mattr));
+
+	fprintf(stderr, "adaptive mutexes: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+/*
+ * PSDP publish/subscribe regression test.
+ *
+ * Checks the subscriber ring depth bounds, fan-out and overrun
+ * accounting, and that subscribers blocked on a topic which is
+ * withdrawn are woken up with ECONNRESET, then may still reconnect
+ * or close their socket.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include <rtdm/rtipc.h>
+#include "check.h"
+
+#define NMSGS 6
+
+static int publish(void)
+{
+	struct sockaddr_ipc saddr;
+	socklen_t addrlen;
+	int s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_PSDP);
+	if (s < 0 && (errno == EAFNOSUPPORT || errno == EPROTONOSUPPORT)) {
+		fprintf(stderr, "PSDP not supported, skipping\n");
+		exit(EXIT_SUCCESS);
+	}
+	check_unix(s);
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;
+	check_unix(bind(s, (struct sockaddr *)&saddr, sizeof(saddr)));
+	addrlen = sizeof(saddr);
+	check_unix(getsockname(s, (struct sockaddr *)&saddr, &addrlen));
+
+	return s;
+}
+
+static int subscribe(int pub, int s)
+{
+	struct sockaddr_ipc saddr;
+	socklen_t addrlen;
+
+	addrlen = sizeof(saddr);
+	check_unix(getsockname(pub, (struct sockaddr *)&saddr, &addrlen));
+	check_unix(connect(s, (struct sockaddr *)&saddr, sizeof(saddr)));
+
+	return s;
+}
+
+static void check_recv(int s, int expected)
+{
+	int msg;
+
+	check_unix(recv(s, &msg, sizeof(msg), 0));
+	if (msg != expected) {
+		fprintf(stderr, "FAILURE: received %d, expected %d\n",
+			msg, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void check_depth(int s, int depth, int expected)
+{
+	int ret;
+
+	ret = setsockopt(s, SOL_PSDP, PSDP_DEPTH, &depth, sizeof(depth));
+	if (ret < 0)
+		ret = -errno;
+	if (ret != expected) {
+		fprintf(stderr, "FAILURE: depth %d returned %d, expected %d\n",
+			depth, ret, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+static void *blocked_subscriber(void *arg)
+{
+	long s = (long)arg;
+	int msg, ret;
+
+	ret = recv(s, &msg, sizeof(msg), 0);
+
+	return (void *)(long)(ret < 0 ? errno : 0);
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 10 };
+	int pub, sub1, sub2, msg, ret;
+	unsigned long overruns;
+	pthread_attr_t attr;
+	socklen_t optlen;
+	pthread_t tid;
+	void *status;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	fprintf(stderr, "Checking PSDP publish/subscribe\n");
+
+	pub = publish();
+	sub1 = check_unix(socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_PSDP));
+	sub2 = check_unix(socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_PSDP));
+
+	/* The ring depth must stay within bounds. */
+	check_depth(sub1, 0, -EINVAL);
+	check_depth(sub1, 4097, -EINVAL);
+	check_depth(sub1, 4, 0);
+
+	subscribe(pub, sub1);
+	subscribe(pub, sub2);
+
+	/* Every subscriber gets every message, sub1 loses the oldest. */
+	for (msg = 0; msg < NMSGS; msg++)
+		check_unix(send(pub, &msg, sizeof(msg), 0));
+
+	for (msg = NMSGS - 4; msg < NMSGS; msg++)
+		check_recv(sub1, msg);
+	for (msg = 0; msg < NMSGS; msg++)
+		check_recv(sub2, msg);
+
+	optlen = sizeof(overruns);
+	check_unix(getsockopt(sub1, SOL_PSDP, PSDP_OVERRUNS,
+			      &overruns, &optlen));
+	if (overruns != NMSGS - 4) {
+		fprintf(stderr, "FAILURE: %lu overruns, expected %d\n",
+			overruns, NMSGS - 4);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Withdrawing the topic must wake up a blocked subscriber. */
+	check_pthread(pthread_attr_init(&attr));
+	check_pthread(pthread_attr_setinheritsched(&attr,
+						   PTHREAD_EXPLICIT_SCHED));
+	check_pthread(pthread_attr_setschedpolicy(&attr, SCHED_FIFO));
+	param.sched_priority = 20;
+	check_pthread(pthread_attr_setschedparam(&attr, &param));
+	check_pthread(pthread_create(&tid, &attr, blocked_subscriber,
+				     (void *)(long)sub1));
+	check_pthread(pthread_attr_destroy(&attr));
+
+	usleep(100000);
+	check_unix(close(pub));
+	check_pthread(pthread_join(tid, &status));
+	if ((long)status != ECONNRESET) {
+		fprintf(stderr, "FAILURE: blocked subscriber got %ld, "
+			"expected ECONNRESET\n", (long)status);
+		exit(EXIT_FAILURE);
+	}
+
+	ret = recv(sub2, &msg, sizeof(msg), MSG_DONTWAIT);
+	if (ret >= 0 || errno != ECONNRESET) {
+		fprintf(stderr, "FAILURE: recv from a withdrawn topic "
+			"returned %d\n", ret < 0 ? -errno : ret);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Stale subscribers may move to a new topic, or go away. */
+	pub = publish();
+	subscribe(pub, sub1);
+	msg = 42;
+	check_unix(send(pub, &msg, sizeof(msg), 0));
+	check_recv(sub1, 42);
+
+	check_unix(close(sub2));
+	check_unix(close(sub1));
+	check_unix(close(pub));
+
+	fprintf(stderr, "PSDP publish/subscribe: success\n");
+	return EXIT_SUCCESS;
+}
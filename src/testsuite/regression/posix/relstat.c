@@ -0,0 +1,129 @@
+/*
+ * Periodic release statistics regression test.
+ *
+ * Checks that pthread_getrelstat_np() counts the release points
+ * reached, that missed release points are accounted for as reported
+ * by pthread_wait_np(), and that restarting the period resets the
+ * statistics.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "check.h"
+
+#define PERIOD_NS	10000000LL
+#define NR_RELEASES	5
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	check_unix(clock_gettime(CLOCK_REALTIME, &ts));
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void start_period(void)
+{
+	struct timespec start, period;
+	long long date = now_ns() + PERIOD_NS;
+
+	start.tv_sec = date / 1000000000LL;
+	start.tv_nsec = date % 1000000000LL;
+	period.tv_sec = 0;
+	period.tv_nsec = PERIOD_NS;
+	check_pthread(pthread_make_periodic_np(pthread_self(),
+					       &start, &period));
+}
+
+static void get_relstat(pthread_relstat_np_t *rs)
+{
+	unsigned long sum = 0;
+	int n;
+
+	check_pthread(pthread_getrelstat_np(pthread_self(), rs));
+
+	for (n = 0; n < XNTHREAD_RELSTAT_BUCKETS; n++)
+		sum += rs->hist[n];
+	if (sum != rs->releases) {
+		fprintf(stderr, "FAILURE: %lu releases, %lu in histogram\n",
+			rs->releases, sum);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	unsigned long overruns = 0;
+	pthread_relstat_np_t rs;
+	long long end;
+	int n, err;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking periodic release statistics\n");
+
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	start_period();
+	for (n = 0; n < NR_RELEASES; n++)
+		check_pthread(pthread_wait_np(NULL));
+
+	get_relstat(&rs);
+	if (rs.releases == 0) {
+		fprintf(stderr, "No release statistics, skipping\n");
+		return EXIT_SUCCESS;
+	}
+	if (rs.releases != NR_RELEASES || rs.overruns || rs.maxburst) {
+		fprintf(stderr, "FAILURE: %lu releases, %lu overruns, "
+			"burst %lu\n", rs.releases, rs.overruns, rs.maxburst);
+		exit(EXIT_FAILURE);
+	}
+	if (rs.latsum > rs.latmax * rs.releases) {
+		fprintf(stderr, "FAILURE: latency sum %llu above %lu times "
+			"the worst case %llu\n", rs.latsum, rs.releases,
+			rs.latmax);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Miss a few release points, without leaving primary mode. */
+	end = now_ns() + 3 * PERIOD_NS + PERIOD_NS / 2;
+	while (now_ns() < end)
+		;
+
+	err = pthread_wait_np(&overruns);
+	if (err != ETIMEDOUT || overruns < 3) {
+		fprintf(stderr, "FAILURE: wait returned %d, %lu overruns\n",
+			err, overruns);
+		exit(EXIT_FAILURE);
+	}
+
+	get_relstat(&rs);
+	if (rs.releases != NR_RELEASES + 1 || rs.overruns != overruns ||
+	    rs.maxburst != overruns) {
+		fprintf(stderr, "FAILURE: %lu releases, %lu overruns, "
+			"burst %lu, expected %d, %lu, %lu\n", rs.releases,
+			rs.overruns, rs.maxburst, NR_RELEASES + 1,
+			overruns, overruns);
+		exit(EXIT_FAILURE);
+	}
+
+	/* A new period starts from scratch. */
+	start_period();
+	get_relstat(&rs);
+	if (rs.releases || rs.overruns || rs.maxburst || rs.latmax) {
+		fprintf(stderr, "FAILURE: statistics not reset\n");
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stderr, "periodic release statistics: success\n");
+	return EXIT_SUCCESS;
+}
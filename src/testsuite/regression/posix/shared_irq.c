@@ -0,0 +1,73 @@
+/*
+ * Shared interrupts regression test.
+ *
+ * Has the RTDM test driver chain three handlers on a shared virtual
+ * IRQ: the first one's probe rejects every IRQ, the second one claims
+ * them all, the third one never does. Checks that the walk stops at
+ * the handler claiming the IRQ, that rejected handlers are skipped,
+ * and that the chain is reordered for the busy handler to come first.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include <rtdm/rttesting.h>
+#include "check.h"
+
+#define DEVNAME		"/dev/rttest-rtdm0"
+#define NR_TRIGGERS	1024
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 10 };
+	struct rttst_rtdm_irq_res res;
+	int fd, ret;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking shared interrupts\n");
+
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	fd = open(DEVNAME, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "No RTDM test driver, skipping\n");
+		return EXIT_SUCCESS;
+	}
+
+	memset(&res, 0, sizeof(res));
+	res.triggers = NR_TRIGGERS;
+	ret = ioctl(fd, RTTST_RTIOC_RTDM_IRQ_SHARED, &res);
+	if (ret < 0 && (errno == ENOTTY || errno == EOPNOTSUPP)) {
+		fprintf(stderr, "No shared interrupts, skipping\n");
+		return EXIT_SUCCESS;
+	}
+	check_unix(ret);
+	check_unix(close(fd));
+
+	if (res.hits[0] || res.hits[1] != NR_TRIGGERS || res.hits[2] ||
+	    res.threaded) {
+		fprintf(stderr, "FAILURE: hits %lu, %lu, %lu, %lu threaded, "
+			"expected 0, %d, 0, 0\n", res.hits[0], res.hits[1],
+			res.hits[2], res.threaded, NR_TRIGGERS);
+		exit(EXIT_FAILURE);
+	}
+
+	/* Once moved behind the busy handler, the probe is not run. */
+	if (res.probes == 0 || res.probes > NR_TRIGGERS / 2) {
+		fprintf(stderr, "FAILURE: %lu probes for %d IRQs\n",
+			res.probes, NR_TRIGGERS);
+		exit(EXIT_FAILURE);
+	}
+
+	fprintf(stderr, "shared interrupts: success\n");
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*
+ * POSIX thread pool regression test.
+ *
+ * Checks that jobs run with the priority they were spawned with, that
+ * out of range priorities are refused, and that an exhausted pool
+ * reports EAGAIN.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+#include <sys/mman.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "check.h"
+
+#define POOL_SIZE	4
+#define NR_JOBS		100
+
+static sem_t done, gate;
+static int prios[NR_JOBS];
+
+static void *job(void *arg)
+{
+	long n = (long)arg;
+	struct sched_param param;
+	int policy;
+
+	check_pthread(pthread_getschedparam(pthread_self(), &policy, &param));
+	prios[n] = param.sched_priority;
+	check_unix(sem_post(&done));
+
+	return NULL;
+}
+
+static void *blocker(void *arg)
+{
+	check_unix(sem_wait(&gate));
+
+	return NULL;
+}
+
+static void check_spawn_error(pthread_pool_np_t *pool, int prio,
+			      int expected)
+{
+	int err;
+
+	err = pthread_spawn_from_pool_np(pool, NULL, prio, blocker, NULL);
+	if (err != expected) {
+		fprintf(stderr, "FAILURE: spawning at priority %d returned "
+			"%d, expected %d\n", prio, err, expected);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	pthread_pool_np_t pool;
+	pthread_attr_t attr;
+	pthread_t tid;
+	long n;
+	int prio;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking POSIX thread pools\n");
+
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+	check_unix(sem_init(&done, 0, 0));
+	check_unix(sem_init(&gate, 0, 0));
+
+	check_pthread(pthread_attr_init(&attr));
+	check_pthread(pthread_attr_setinheritsched(&attr,
+						   PTHREAD_EXPLICIT_SCHED));
+	check_pthread(pthread_attr_setschedpolicy(&attr, SCHED_FIFO));
+	param.sched_priority = 1;
+	check_pthread(pthread_attr_setschedparam(&attr, &param));
+	check_pthread(pthread_pool_create_np(&pool, POOL_SIZE, &attr));
+	check_pthread(pthread_attr_destroy(&attr));
+
+	/* Priorities must fit the SCHED_FIFO range. */
+	check_spawn_error(&pool, -1, EINVAL);
+	check_spawn_error(&pool, sched_get_priority_min(SCHED_FIFO) - 1,
+			  EINVAL);
+	check_spawn_error(&pool, sched_get_priority_max(SCHED_FIFO) + 1,
+			  EINVAL);
+
+	/* Jobs must run with the priority they were given. */
+	for (n = 0; n < NR_JOBS; n++) {
+		prio = 1 + n % 40;
+		check_pthread(pthread_spawn_from_pool_np(&pool, &tid, prio,
+							 job, (void *)n));
+		check_unix(sem_wait(&done));
+		if (prios[n] != prio) {
+			fprintf(stderr, "FAILURE: job %ld ran at priority %d, "
+				"expected %d\n", n, prios[n], prio);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	/* Exhaust the pool, then release it. */
+	for (n = 0; n < POOL_SIZE; n++)
+		check_pthread(pthread_spawn_from_pool_np(&pool, NULL, 60,
+							 blocker, NULL));
+	check_spawn_error(&pool, 60, EAGAIN);
+	for (n = 0; n < POOL_SIZE; n++)
+		check_unix(sem_post(&gate));
+
+	check_pthread(pthread_pool_destroy_np(&pool));
+	check_unix(sem_destroy(&gate));
+	check_unix(sem_destroy(&done));
+
+	fprintf(stderr, "POSIX thread pools: success\n");
+	return EXIT_SUCCESS;
+}
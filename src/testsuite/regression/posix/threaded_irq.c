@@ -0,0 +1,93 @@
+/*
+ * Threaded interrupts regression test.
+ *
+ * Has the RTDM test driver serve a virtual IRQ from a handler thread,
+ * checks that every IRQ raised ran the handler over that thread, and
+ * that the thread is gone once the IRQ is released.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include <rtdm/rttesting.h>
+#include "check.h"
+
+#define DEVNAME		"/dev/rttest-rtdm0"
+#define SCHED		"/proc/xenomai/sched"
+#define NR_TRIGGERS	10
+
+static void check_no_thread(const char *name)
+{
+	char line[256], *p;
+	FILE *f;
+
+	f = fopen(SCHED, "r");
+	if (f == NULL) {
+		fprintf(stderr, "FAILURE: %s: %s\n", SCHED, strerror(errno));
+		exit(EXIT_FAILURE);
+	}
+
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\n")] = '\0';
+		p = strrchr(line, ' ');
+		if (p && !strcmp(p + 1, name)) {
+			fprintf(stderr, "FAILURE: thread %s still exists\n",
+				name);
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	fclose(f);
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 10 };
+	struct rttst_rtdm_irq_res res;
+	char name[32];
+	int fd, ret;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking threaded interrupts\n");
+
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	fd = open(DEVNAME, O_RDWR);
+	if (fd < 0) {
+		fprintf(stderr, "No RTDM test driver, skipping\n");
+		return EXIT_SUCCESS;
+	}
+
+	memset(&res, 0, sizeof(res));
+	res.triggers = NR_TRIGGERS;
+	ret = ioctl(fd, RTTST_RTIOC_RTDM_IRQ_THREADED, &res);
+	if (ret < 0 && errno == ENOTTY) {
+		fprintf(stderr, "No interrupt checks in test driver, "
+			"skipping\n");
+		return EXIT_SUCCESS;
+	}
+	check_unix(ret);
+	check_unix(close(fd));
+
+	if (res.hits[0] != NR_TRIGGERS || res.threaded != NR_TRIGGERS) {
+		fprintf(stderr, "FAILURE: %lu hits, %lu threaded, "
+			"expected %d\n", res.hits[0], res.threaded,
+			NR_TRIGGERS);
+		exit(EXIT_FAILURE);
+	}
+
+	snprintf(name, sizeof(name), "irq%u", res.irq);
+	check_no_thread(name);
+
+	fprintf(stderr, "threaded interrupts: success\n");
+	return EXIT_SUCCESS;
+}
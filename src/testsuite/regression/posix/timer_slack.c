@@ -0,0 +1,137 @@
+/*
+ * Timer slack regression test.
+ *
+ * A timer with slack must join a timer queued within its slack
+ * window, even when that one is not the next timer to elapse, and
+ * must never elapse early.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+
+#include <sys/mman.h>
+#include <pthread.h>
+
+#include "check.h"
+
+#define NS_PER_MS 1000000LL
+
+static long long ts2ns(const struct timespec *ts)
+{
+	return ts->tv_sec * 1000000000LL + ts->tv_nsec;
+}
+
+static void ns2ts(struct timespec *ts, long long ns)
+{
+	ts->tv_sec = ns / 1000000000LL;
+	ts->tv_nsec = ns % 1000000000LL;
+}
+
+static timer_t make_timer(int sig)
+{
+	struct sigevent sev;
+	timer_t tm;
+
+	memset(&sev, 0, sizeof(sev));
+	sev.sigev_notify = SIGEV_SIGNAL;
+	sev.sigev_signo = sig;
+	check_unix(timer_create(CLOCK_MONOTONIC, &sev, &tm));
+
+	return tm;
+}
+
+static void arm_timer(timer_t tm, long long date)
+{
+	struct itimerspec its;
+
+	memset(&its, 0, sizeof(its));
+	ns2ts(&its.it_value, date);
+	check_unix(timer_settime(tm, TIMER_ABSTIME, &its, NULL));
+}
+
+static void check_slack_error(timer_t tm, long sec, long nsec)
+{
+	struct timespec slack = { .tv_sec = sec, .tv_nsec = nsec };
+
+	if (timer_setslack_np(tm, &slack) != -1 || errno != EINVAL) {
+		fprintf(stderr, "FAILURE: slack %ld.%09ld accepted\n",
+			sec, nsec);
+		exit(EXIT_FAILURE);
+	}
+}
+
+int main(void)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	long long start, date_a, date_b, date_c, fired_b = 0;
+	struct timespec now, slack;
+	timer_t tm_a, tm_b, tm_c;
+	int sig, n;
+	sigset_t set;
+
+	mlockall(MCL_CURRENT | MCL_FUTURE);
+
+	fprintf(stderr, "Checking timer slack\n");
+
+	check_pthread(pthread_setschedparam(pthread_self(),
+					    SCHED_FIFO, &param));
+
+	sigemptyset(&set);
+	sigaddset(&set, SIGRTMIN);
+	sigaddset(&set, SIGRTMIN + 1);
+	sigaddset(&set, SIGRTMIN + 2);
+	check_pthread(pthread_sigmask(SIG_BLOCK, &set, NULL));
+
+	tm_a = make_timer(SIGRTMIN);
+	tm_b = make_timer(SIGRTMIN + 1);
+	tm_c = make_timer(SIGRTMIN + 2);
+
+	check_slack_error(tm_b, 0, -1);
+	check_slack_error(tm_b, 0, 1000000000);
+
+	slack.tv_sec = 0;
+	slack.tv_nsec = NS_PER_MS;
+	check_unix(timer_setslack_np(tm_b, &slack));
+
+	/*
+	 * C heads the queue and is out of reach, A is not the head
+	 * but lies within B's slack window: B must fire along with A.
+	 */
+	check_unix(clock_gettime(CLOCK_MONOTONIC, &now));
+	start = ts2ns(&now);
+	date_c = start + 30 * NS_PER_MS;
+	date_a = start + 50 * NS_PER_MS;
+	date_b = date_a - NS_PER_MS / 2;
+	arm_timer(tm_c, date_c);
+	arm_timer(tm_a, date_a);
+	arm_timer(tm_b, date_b);
+
+	for (n = 0; n < 3; n++) {
+		check_pthread(sigwait(&set, &sig));
+		if (sig == SIGRTMIN + 1) {
+			check_unix(clock_gettime(CLOCK_MONOTONIC, &now));
+			fired_b = ts2ns(&now);
+		}
+	}
+
+	if (fired_b < date_a) {
+		fprintf(stderr, "FAILURE: timer fired %lld ns before its "
+			"peer\n", date_a - fired_b);
+		exit(EXIT_FAILURE);
+	}
+	if (fired_b > date_b + 1000 * NS_PER_MS) {
+		fprintf(stderr, "FAILURE: timer fired %lld ns late\n",
+			fired_b - date_b);
+		exit(EXIT_FAILURE);
+	}
+
+	check_unix(timer_delete(tm_c));
+	check_unix(timer_delete(tm_b));
+	check_unix(timer_delete(tm_a));
+
+	fprintf(stderr, "timer slack: success\n");
+	return EXIT_SUCCESS;
+}
@@ -55,6 +55,8 @@ typedef enum {
 	RTUS = 3,	 /* user-space real-time thread in secondary mode. */
 	RTUO = 4,	 /* user-space real-time thread oscillating
 			    between primary and secondary mode. */
+	RTUI = 5,	 /* user-space real-time thread in primary mode,
+			    running on the next CPU. */
 	SWITCHER = 8,
 	FPU_STRESS = 16,
 } threadtype;
@@ -90,6 +92,8 @@ static struct timespec start;
 static pthread_mutex_t headers_lock;
 static unsigned long data_lines = 21;
 static unsigned freeze_on_error;
+static unsigned breakdown;
+static unsigned nr_cpus;
 
 static inline void clean_exit(int retval)
 {
@@ -122,6 +126,7 @@ static char *task_name(char *buf, size_t sz,
 		[RTUP] = "rtup",
 		[RTUS] = "rtus",
 		[RTUO] = "rtuo",
+		[RTUI] = "rtui",
 		[SWITCHER] = "switcher",
 		[FPU_STRESS] = "fpu_stress",
 	};
@@ -263,6 +268,70 @@ void display_switches_count(struct cpu_tasks *cpu, struct timespec *now)
 	cpu->last_switches_count = switches_count;
 }
 
+static long leg_percentile(const long *histogram,
+			   unsigned long long count, double p)
+{
+	unsigned long long rank, sum = 0;
+	int i;
+
+	rank = (unsigned long long)(count * p / 100.0 + 0.5);
+	if (rank == 0)
+		rank = 1;
+
+	for (i = 0; i < RTTST_HDR_CELLS; i++) {
+		sum += histogram[i];
+		if (sum >= rank)
+			return rttst_hdr_highest(i);
+	}
+
+	return rttst_hdr_lowest(RTTST_HDR_CELLS - 1);
+}
+
+static void display_breakdown(struct cpu_tasks *cpu)
+{
+	static const char *kinds[] = {
+		[RTTST_SWTEST_LEG_KK] = "rtk->rtk",
+		[RTTST_SWTEST_LEG_KU] = "rtk->rtup",
+		[RTTST_SWTEST_LEG_UK] = "rtup->rtk",
+		[RTTST_SWTEST_LEG_UU] = "rtup->rtup",
+		[RTTST_SWTEST_LEG_NRT] = "secondary",
+		[RTTST_SWTEST_LEG_IPI] = "cross-cpu",
+	};
+	static const char *fpu_modes[] = {
+		[RTTST_SWTEST_LEG_NOFPU] = "nofpu",
+		[RTTST_SWTEST_LEG_FPU_LAZY] = "lazy",
+		[RTTST_SWTEST_LEG_FPU_SWITCH] = "switch",
+	};
+	struct rttst_swtest_leg_stats stats;
+	static long histogram[RTTST_HDR_CELLS];
+	unsigned kind, fpu;
+
+	printf("RBH|%4s|%-10s|%-6s|%12s|%8s|%8s|%8s|%8s|%8s\n",
+	       "cpu", "leg", "fpu", "count", "min", "avg", "p99", "p99.9",
+	       "max");
+
+	for (kind = 0; kind < RTTST_SWTEST_LEG_KINDS; kind++)
+		for (fpu = 0; fpu < RTTST_SWTEST_LEG_FPU_MODES; fpu++) {
+			stats.type = RTTST_SWTEST_LEG_TYPE(kind, fpu);
+			stats.histogram = histogram;
+			if (ioctl(cpu->fd,
+				  RTTST_RTIOC_SWTEST_GET_LEG_STATS, &stats)) {
+				perror("ioctl(RTTST_RTIOC_SWTEST_GET_LEG_STATS)");
+				return;
+			}
+			if (stats.count == 0)
+				continue;
+
+			printf("RBD|%4u|%-10s|%-6s|%12llu|%8ld|%8llu|%8ld|%8ld|%8ld\n",
+			       cpu->index, kinds[kind], fpu_modes[fpu],
+			       stats.count, stats.min,
+			       stats.sum / stats.count,
+			       leg_percentile(histogram, stats.count, 99.0),
+			       leg_percentile(histogram, stats.count, 99.9),
+			       stats.max);
+		}
+}
+
 static void *sleeper_switcher(void *cookie)
 {
 	struct task_params *param = (struct task_params *) cookie;
@@ -416,7 +485,10 @@ static void *rtup(void *cookie)
 	unsigned i = 0;
 
 	CPU_ZERO(&cpu_set);
-	CPU_SET(param->cpu->index, &cpu_set);
+	if (param->type == RTUI)
+		CPU_SET((param->cpu->index + 1) % nr_cpus, &cpu_set);
+	else
+		CPU_SET(param->cpu->index, &cpu_set);
 	if (smp_sched_setaffinity(0, sizeof(cpu_set), &cpu_set)) {
 		perror("rtup: sched_setaffinity");
 		clean_exit(EXIT_FAILURE);
@@ -689,7 +761,8 @@ static int parse_arg(struct task_params *param,
 		{ "rtk",  RTK  },
 		{ "rtup", RTUP },
 		{ "rtus", RTUS },
-		{ "rtuo", RTUO }
+		{ "rtuo", RTUO },
+		{ "rtui", RTUI }
 	};
 
 	static struct t2f fp2flags [] = {
@@ -764,6 +837,7 @@ static int check_arg(const struct task_params *param, struct cpu_tasks *end_cpu)
 		break;
 
 	case RTUP:
+	case RTUI:
 		if (param->fp & (AFP|UFPS))
 			return 0;
 		break;
@@ -793,7 +867,8 @@ static int task_create(struct cpu_tasks *cpu,
 	thread_routine *task_routine [] = {
 		[RTUP] = &rtup,
 		[RTUS] = &rtus,
-		[RTUO] = &rtuo
+		[RTUO] = &rtuo,
+		[RTUI] = &rtup
 	};
 	int err;
 
@@ -813,6 +888,7 @@ static int task_create(struct cpu_tasks *cpu,
 	case RTUP:
 	case RTUS:
 	case RTUO:
+	case RTUI:
 	case SLEEPER:
 	case SWITCHER:
 		param->swt.flags = 0;
@@ -1018,17 +1094,22 @@ void usage(FILE *fd, const char *progname)
 		"--stress <period> or -s <period> enable a stress mode where:\n"
 		"  context switches occur every <period> us;\n"
 		"  a background task uses fpu (and check) fpu all the time.\n"
-		"--freeze trace upon error.\n\n"
+		"--freeze trace upon error.\n"
+		"--breakdown or -b, measure the cost of each context switch "
+		"and print its\ndistribution per type of switch on exit.\n\n"
 		"Each 'threadspec' specifies the characteristics of a "
 		"thread to be created:\n"
-		"threadspec = (rtk|rtup|rtus|rtuo)(_fp|_ufpp|_ufps)*[0-9]*\n"
+		"threadspec = (rtk|rtup|rtus|rtuo|rtui)(_fp|_ufpp|_ufps)*[0-9]*\n"
 		"rtk for a kernel-space real-time thread;\n"
 		"rtup for a user-space real-time thread running in primary"
 		" mode,\n"
 		"rtus for a user-space real-time thread running in secondary"
 		" mode,\n"
 		"rtuo for a user-space real-time thread oscillating between"
-		" primary and\nsecondary mode,\n\n"
+		" primary and\nsecondary mode,\n"
+		"rtui for a user-space real-time thread running in primary"
+		" mode on the next\nCPU, so that switching to it requires an"
+		" inter-processor interrupt,\n\n"
 		"_fp means that the created thread will have the XNFPU bit"
 		" armed (only valid for\nrtk),\n"
 		"_ufpp means that the created thread will use the FPU when in "
@@ -1116,7 +1197,7 @@ int check_fpu(void)
 
 int main(int argc, const char *argv[])
 {
-	unsigned i, j, nr_cpus, use_fp = 1, stress = 0;
+	unsigned i, j, use_fp = 1, stress = 0;
 	pthread_attr_t rt_attr;
 	const char *progname = argv[0];
 	struct cpu_tasks *cpus;
@@ -1158,6 +1239,7 @@ int main(int argc, const char *argv[])
 	opterr = 0;
 	for (;;) {
 		static struct option long_options[] = {
+			{ "breakdown", 0, NULL, 'b' },
 			{ "freeze",  0, NULL, 'f' },
 			{ "help",    0, NULL, 'h' },
 			{ "lines",   1, NULL, 'l' },
@@ -1168,13 +1250,17 @@ int main(int argc, const char *argv[])
 			{ NULL,      0, NULL, 0   }
 		};
 		int i = 0;
-		int c = getopt_long(argc, (char *const *) argv, "fhl:nqs:T:",
+		int c = getopt_long(argc, (char *const *) argv, "bfhl:nqs:T:",
 				    long_options, &i);
 
 		if (c == -1)
 			break;
 
 		switch(c) {
+		case 'b':
+			breakdown = 1;
+			break;
+
 		case 'f':
 			freeze_on_error = 1;
 			break;
@@ -1397,6 +1483,12 @@ int main(int argc, const char *argv[])
 			goto failure;
 		}
 
+		if (breakdown &&
+		    ioctl(cpu->fd, RTTST_RTIOC_SWTEST_SET_LEG_STATS, 1)) {
+			perror("ioctl(RTTST_RTIOC_SWTEST_SET_LEG_STATS)");
+			goto failure;
+		}
+
 		for (j = 0; j < cpu->tasks_count + !!stress; j++) {
 			struct task_params *param = &cpu->tasks[j];
 			if (task_create(cpu, param, &rt_attr)) {
@@ -1456,6 +1548,9 @@ int main(int argc, const char *argv[])
 			quiet = 0;
 			display_switches_count(&cpus[i], &now);
 
+			if (breakdown)
+				display_breakdown(&cpus[i]);
+
 			/* Kill the kernel-space tasks. */
 			close(cpus[i].fd);
 		}
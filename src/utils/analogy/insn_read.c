@@ -26,12 +26,14 @@
 #include <sys/mman.h>
 #include <errno.h>
 #include <getopt.h>
+#include <time.h>
 
 #include <analogy/analogy.h>
 
 #define FILENAME "analogy0"
 #define BUF_SIZE 10000
 #define SCAN_CNT 10
+#define BENCH_MAX_INSNS 256
 
 static unsigned char buf[BUF_SIZE];
 static char *filename = FILENAME;
@@ -40,6 +42,7 @@ static int idx_subd = -1;
 static int idx_chan;
 static int idx_rng = -1;
 static unsigned int scan_size = SCAN_CNT;
+static unsigned long bench_cycles;
 
 struct option insn_read_opts[] = {
 	{"verbose", no_argument, NULL, 'v'},
@@ -49,6 +52,7 @@ struct option insn_read_opts[] = {
 	{"channel", required_argument, NULL, 'c'},
 	{"range", required_argument, NULL, 'R'},
 	{"raw", no_argument, NULL, 'w'},
+	{"bench", required_argument, NULL, 'b'},
 	{"help", no_argument, NULL, 'h'},
 	{0},
 };
@@ -64,6 +68,10 @@ void do_print_usage(void)
 	fprintf(stdout, "\t\t -c, --channel: channel to use\n");
 	fprintf(stdout, "\t\t -R, --range: range to use\n");
 	fprintf(stdout, "\t\t -w, --raw: dump data in raw format\n");
+	fprintf(stdout,
+		"\t\t -b, --bench: time <arg> cycles of scan-count "
+		"single reads,\n"
+		"\t\t\t     sent as a list, then as a prepared list\n");
 	fprintf(stdout, "\t\t -h, --help: print this help\n");
 }
 
@@ -183,6 +191,107 @@ out:
 	return err;
 }
 
+static unsigned long long bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, unsigned long long sum,
+			 unsigned long long max)
+{
+	printf("insn.%s.cycle_ns,ns,%.1f\n", name,
+	       (double)sum / bench_cycles);
+	printf("insn.%s.cycle_max_ns,ns,%llu\n", name, max);
+}
+
+/* Reads scan_size samples one instruction at a time, the same way a
+   polling loop would, first with a4l_snd_insnlist() which copies the
+   whole list at each call, then with a list prepared once */
+int do_bench(a4l_desc_t *dsc, int width)
+{
+	static a4l_insn_t insns[BENCH_MAX_INSNS];
+	a4l_insnlst_t lst = { .count = scan_size, .insns = insns };
+	a4l_insnprep_t prep = { .count = scan_size, .insns = insns };
+	unsigned long long t0, dt, sum, max;
+	unsigned long n;
+	unsigned int i;
+	int err;
+
+	if (scan_size == 0 || scan_size > BENCH_MAX_INSNS ||
+	    scan_size * width > BUF_SIZE) {
+		fprintf(stderr,
+			"insn_read: bench: scan count must be in [1-%d]\n",
+			BUF_SIZE / width < BENCH_MAX_INSNS ?
+			BUF_SIZE / width : BENCH_MAX_INSNS);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < scan_size; i++) {
+		insns[i].type = A4L_INSN_READ;
+		insns[i].idx_subd = idx_subd;
+		insns[i].chan_desc = CHAN(idx_chan);
+		insns[i].data_size = width;
+		insns[i].data = buf + i * width;
+	}
+
+	for (n = 0, sum = 0, max = 0; n < bench_cycles; n++) {
+		t0 = bench_now();
+		err = a4l_snd_insnlist(dsc, &lst);
+		dt = bench_now() - t0;
+		if (err < 0) {
+			fprintf(stderr,
+				"insn_read: a4l_snd_insnlist failed (err=%d)\n",
+				err);
+			return err;
+		}
+		sum += dt;
+		if (dt > max)
+			max = dt;
+	}
+
+	bench_report("list", sum, max);
+
+	/* The data pointers of insns are updated by the preparation */
+	err = a4l_prep_insnlist(dsc, &prep);
+	if (err < 0) {
+		fprintf(stderr,
+			"insn_read: a4l_prep_insnlist failed (err=%d)\n", err);
+		return err;
+	}
+
+	for (n = 0, sum = 0, max = 0; n < bench_cycles; n++) {
+		t0 = bench_now();
+		err = a4l_exec_insnlist(dsc, &prep);
+		dt = bench_now() - t0;
+		if (err < 0) {
+			fprintf(stderr,
+				"insn_read: a4l_exec_insnlist failed (err=%d)\n",
+				err);
+			goto out;
+		}
+		sum += dt;
+		if (dt > max)
+			max = dt;
+	}
+
+	bench_report("prep", sum, max);
+
+	if (verbose != 0)
+		printf("insn_read: last value read = 0x%x\n",
+		       width == 1 ? *(unsigned char *)insns[0].data :
+		       width == 2 ? *(unsigned short *)insns[0].data :
+		       *(unsigned int *)insns[0].data);
+
+out:
+	a4l_free_insnlist(dsc, &prep);
+
+	return err;
+}
+
 int main(int argc, char *argv[])
 {
 	int err = 0;
@@ -197,7 +306,7 @@ int main(int argc, char *argv[])
 	/* Compute arguments */
 	while ((err = getopt_long(argc,
 				  argv,
-				  "vrd:s:S:c:R:wh", insn_read_opts,
+				  "vrd:s:S:c:R:wb:h", insn_read_opts,
 				  NULL)) >= 0) {
 		switch (err) {
 		case 'v':
@@ -222,6 +331,9 @@ int main(int argc, char *argv[])
 		case 'w':
 			dump_function = dump_raw;
 			break;
+		case 'b':
+			bench_cycles = strtoul(optarg, NULL, 0);
+			break;
 		case 'h':
 		default:
 			do_print_usage();
@@ -332,6 +444,11 @@ int main(int argc, char *argv[])
 		goto out_insn_read;
 	}
 
+	if (bench_cycles != 0) {
+		err = do_bench(&dsc, a4l_sizeof_chan(chinfo));
+		goto out_insn_read;
+	}
+
 	/* Set the data size to read */
 	scan_size *= a4l_sizeof_chan(chinfo);
 
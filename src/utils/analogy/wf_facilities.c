@@ -156,3 +156,123 @@ void a4l_wf_dump_values(struct waveform_config *config, double *values)
 		fprintf(stderr, "%f\n", values[i]);
 }
 
+
+/* --- Streaming generation --- */
+
+/* Samples converted at once by a4l_wf_engine_run_raw() */
+#define WF_CHUNK 256
+
+static double wf_period_value(struct waveform_config *config, double x)
+{
+	double low = config->wf_offset - config->wf_amplitude / 2;
+
+	/* x is the position within the period, in [0, 1) */
+	switch (config->wf_kind) {
+	case WAVEFORM_SAWTOOTH:
+		return low + x * config->wf_amplitude;
+	case WAVEFORM_TRIANGULAR:
+		return x < 0.5 ?
+			low + 2 * x * config->wf_amplitude :
+			low + 2 * (1 - x) * config->wf_amplitude;
+	case WAVEFORM_STEPS:
+		return x < 0.5 ? low + config->wf_amplitude : low;
+	default:
+		return low + 0.5 * config->wf_amplitude * cos(2 * PI * x);
+	}
+}
+
+void a4l_wf_engine_init(struct waveform_engine *engine,
+			struct waveform_config *config)
+{
+	double ratio = config->wf_frequency / config->spl_frequency;
+	int i;
+
+	for (i = 0; i < WF_TABLE_SIZE; i++)
+		engine->table[i] =
+			wf_period_value(config, (double)i / WF_TABLE_SIZE);
+	engine->table[WF_TABLE_SIZE] = engine->table[0];
+
+	/* Interpolating across a discontinuity would smooth it */
+	engine->interpolate = config->wf_kind == WAVEFORM_SINE ||
+		config->wf_kind == WAVEFORM_TRIANGULAR;
+
+	/* a4l_wf_check_config() ensured that ratio <= 0.5 */
+	engine->step = (uint32_t)(ratio * 4294967296.0 + 0.5);
+	engine->phase = 0;
+}
+
+/* Generates the next count values of the signal; successive calls
+   produce a continuous signal */
+void a4l_wf_engine_run(struct waveform_engine *engine,
+		       double *values, int count)
+{
+	const double scale = 1.0 / (1 << WF_FRAC_BITS);
+	const uint32_t mask = (1 << WF_FRAC_BITS) - 1;
+	const double *table = engine->table;
+	uint32_t phase = engine->phase, step = engine->step, idx;
+	int i;
+
+	if (engine->interpolate)
+		for (i = 0; i < count; i++, phase += step) {
+			idx = phase >> WF_FRAC_BITS;
+			values[i] = table[idx] + (phase & mask) * scale *
+				(table[idx + 1] - table[idx]);
+		}
+	else
+		for (i = 0; i < count; i++, phase += step)
+			values[i] = table[phase >> WF_FRAC_BITS];
+
+	engine->phase = phase;
+}
+
+/* Same as a4l_wf_engine_run() but the values are converted into raw
+   samples for the channel chan used with the range rng */
+int a4l_wf_engine_run_raw(struct waveform_engine *engine,
+			  a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+			  void *dst, int count)
+{
+	int err, size, done, tmp;
+	double values[WF_CHUNK];
+
+	size = a4l_sizeof_chan(chan);
+	if (size < 0)
+		return size;
+
+	for (done = 0; done < count; done += tmp) {
+		tmp = count - done < WF_CHUNK ? count - done : WF_CHUNK;
+		a4l_wf_engine_run(engine, values, tmp);
+		err = a4l_dtoraw(chan, rng, dst + done * size, values, tmp);
+		if (err < 0)
+			return err;
+	}
+
+	return done;
+}
+
+/* Generates count raw samples into a ring-buffer, such as the
+   Analogy buffer mapped with a4l_mmap(), starting at the byte offset
+   offset (modulo the ring size) and wrapping around if need be */
+int a4l_wf_engine_fill_ring(struct waveform_engine *engine,
+			    a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+			    void *ring, unsigned long ring_size,
+			    unsigned long offset, int count)
+{
+	int err, size, tmp;
+
+	size = a4l_sizeof_chan(chan);
+	if (size < 0)
+		return size;
+
+	offset %= ring_size;
+	tmp = (ring_size - offset) / size;
+	if (tmp > count)
+		tmp = count;
+
+	err = a4l_wf_engine_run_raw(engine, chan, rng, ring + offset, tmp);
+	if (err < 0 || tmp == count)
+		return err;
+
+	err = a4l_wf_engine_run_raw(engine, chan, rng, ring, count - tmp);
+
+	return err < 0 ? err : count;
+}
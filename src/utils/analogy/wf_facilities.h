@@ -2,6 +2,9 @@
 #define  __SIGNAL_GENERATION_H__
 
 #include <stdio.h>
+#include <stdint.h>
+
+#include <analogy/analogy.h>
 
 #define MAX_SAMPLE_COUNT 8096
 #define MIN_SAMPLE_COUNT 2
@@ -24,6 +27,22 @@ struct waveform_config {
 	int spl_count;
 };
 
+/* Streaming generation: one period of the waveform is tabulated, then
+   read by a phase accumulator, a full period spanning 2^32 */
+#define WF_TABLE_BITS 12
+#define WF_TABLE_SIZE (1 << WF_TABLE_BITS)
+#define WF_FRAC_BITS (32 - WF_TABLE_BITS)
+
+struct waveform_engine {
+	uint32_t phase;
+	uint32_t step;
+	/* Linear interpolation between the table points, only for
+	   continuous waveforms */
+	int interpolate;
+	/* One period, plus a guard point for the interpolation */
+	double table[WF_TABLE_SIZE + 1];
+};
+
 void a4l_wf_init_sine(struct waveform_config *config, double *values);
 void a4l_wf_init_sawtooth(struct waveform_config *config, double *values);
 void a4l_wf_init_triangular(struct waveform_config *config, double *values);
@@ -32,5 +51,16 @@ void a4l_wf_set_sample_count(struct waveform_config *config);
 int a4l_wf_check_config(struct waveform_config *config);
 void a4l_wf_init_values(struct waveform_config *config, double *values);
 void a4l_wf_dump_values(struct waveform_config *config, double *values);
+void a4l_wf_engine_init(struct waveform_engine *engine,
+			struct waveform_config *config);
+void a4l_wf_engine_run(struct waveform_engine *engine,
+		       double *values, int count);
+int a4l_wf_engine_run_raw(struct waveform_engine *engine,
+			  a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+			  void *dst, int count);
+int a4l_wf_engine_fill_ring(struct waveform_engine *engine,
+			    a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+			    void *ring, unsigned long ring_size,
+			    unsigned long offset, int count);
 
 #endif /*  __SIGNAL_GENERATION_H__ */
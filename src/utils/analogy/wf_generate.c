@@ -26,9 +26,13 @@
 #include <errno.h>
 #include <getopt.h>
 #include <string.h>
+#include <time.h>
 
 #include "wf_facilities.h"
 
+/* Samples generated at once by the benchmark */
+#define BENCH_BLOCK 4096
+
 void do_print_usage(void)
 {
 	fprintf(stdout, "usage:\twf_generate [OPTS]\n");
@@ -41,6 +45,9 @@ void do_print_usage(void)
 	fprintf(stdout, "\t\t -o, --offset: waveform offet\n");
 	fprintf(stdout, "\t\t -s, --sampling-frequency: sampling frequency\n");
 	fprintf(stdout, "\t\t -O, --outpout: output file (or stdout)\n");
+	fprintf(stdout,
+		"\t\t -b, --bench: measure the generation throughput "
+		"over <arg> samples\n");
 	fprintf(stdout, "\t\t -h, --help: print this help\n");
 }
 
@@ -52,6 +59,7 @@ static struct option opts[] = {
 	{"offset", required_argument, NULL, 'o'},
 	{"sampling-frequency", required_argument, NULL, 's'},
 	{"output", required_argument, NULL, 'O'},
+	{"bench", required_argument, NULL, 'b'},
 	{"help", no_argument, NULL, 'h'},
 	{0},
 };
@@ -80,6 +88,7 @@ struct config {
 	int verbose;
 	char *filename;
 	FILE *output;
+	unsigned long bench;
 	struct waveform_config wf;
 };
 
@@ -104,7 +113,7 @@ int init_config(struct config *cfg, int argc, char *argv[])
 	cfg->wf.spl_count = 0;
 
 	while ((err = getopt_long(argc, 
-				  argv, "vt:f:a:o:s:O:h", opts, NULL)) >= 0) {
+				  argv, "vt:f:a:o:s:O:b:h", opts, NULL)) >= 0) {
 		
 		switch (err) {
 
@@ -151,6 +160,9 @@ int init_config(struct config *cfg, int argc, char *argv[])
 		case 'O':
 			cfg->filename = optarg;
 			break;
+		case 'b':
+			cfg->bench = strtoul(optarg, NULL, 0);
+			break;
 		case 'h':
 		default:
 			err = -EINVAL;
@@ -161,6 +173,10 @@ int init_config(struct config *cfg, int argc, char *argv[])
 	
 	err = 0;
 
+	/* The benchmark only prints its results */
+	if (cfg->bench != 0)
+		goto out;
+
 	if (cfg->filename != NULL) {
 		cfg->output = fopen(cfg->filename, "w");
 		if (cfg->output == NULL) {
@@ -193,6 +209,75 @@ bad_conversion:
 	return err;	
 }
 
+static double bench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Compares the throughput of the point by point generation with the
+   one of the streaming engine, first producing values, then 16 bit
+   raw samples written into a ring-buffer like the mapped Analogy
+   buffer */
+int run_bench(struct config *cfg)
+{
+	static char *types[] = {"sine", "sawtooth", "triangular", "steps"};
+	static double values[BENCH_BLOCK];
+	static uint16_t ring[32768];
+	a4l_chinfo_t chan = { .nb_bits = 16 };
+	a4l_rnginfo_t rng = {
+		.min = -10 * A4L_RNG_FACTOR,
+		.max = 10 * A4L_RNG_FACTOR,
+	};
+	struct waveform_config block = cfg->wf;
+	struct waveform_engine engine;
+	unsigned long done, offset;
+	double t0, dt;
+	int err;
+
+	block.spl_count = BENCH_BLOCK;
+
+	t0 = bench_now();
+	for (done = 0; done < cfg->bench; done += BENCH_BLOCK)
+		a4l_wf_init_values(&block, values);
+	dt = bench_now() - t0;
+	printf("wf.%s.legacy_msps,MS/s,%.2f\n",
+	       types[cfg->wf.wf_kind], done / dt / 1e6);
+
+	a4l_wf_engine_init(&engine, &cfg->wf);
+
+	t0 = bench_now();
+	for (done = 0; done < cfg->bench; done += BENCH_BLOCK)
+		a4l_wf_engine_run(&engine, values, BENCH_BLOCK);
+	dt = bench_now() - t0;
+	printf("wf.%s.engine_msps,MS/s,%.2f\n",
+	       types[cfg->wf.wf_kind], done / dt / 1e6);
+
+	/* The block size is not a divider of the ring size, so that
+	   the wrap-around is exercised */
+	t0 = bench_now();
+	for (done = 0, offset = 0; done < cfg->bench;
+	     done += BENCH_BLOCK - 1) {
+		err = a4l_wf_engine_fill_ring(&engine, &chan, &rng,
+					      ring, sizeof(ring), offset,
+					      BENCH_BLOCK - 1);
+		if (err < 0) {
+			fprintf(stderr,
+				"Error: raw conversion failed (err=%d)\n", err);
+			return err;
+		}
+		offset += (BENCH_BLOCK - 1) * sizeof(uint16_t);
+	}
+	dt = bench_now() - t0;
+	printf("wf.%s.raw16_msps,MS/s,%.2f\n",
+	       types[cfg->wf.wf_kind], done / dt / 1e6);
+
+	return 0;
+}
+
 int main(int argc, char *argv[])
 {
 	int err = 0;
@@ -207,6 +292,11 @@ int main(int argc, char *argv[])
 	if (err < 0)
 		goto out;
 
+	if (cfg.bench != 0) {
+		err = run_bench(&cfg);
+		goto out;
+	}
+
 	a4l_wf_set_sample_count(&cfg.wf);
 
 	if (cfg.verbose) {
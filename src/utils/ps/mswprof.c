@@ -0,0 +1,208 @@
+#include <string.h>
+#include <stdio.h>
+#include <error.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#define PROC_MSWPROF  "/proc/xenomai/mswprof"
+
+#define MSWPROF_FMT  "%d %15s %63s %x %lu %Lu %Lu %63[^\n]"
+#define MSWPROF_NFMT 8
+
+struct site {
+	int pid;
+	char event[16];
+	char trigger[64];
+	unsigned hash;
+	unsigned long count;
+	unsigned long long total;
+	unsigned long long max;
+	char name[64];
+};
+
+static struct site *sites;
+
+static int nrsites, maxsites;
+
+static enum {
+	SORT_COUNT,
+	SORT_TOTAL,
+	SORT_MAX,
+} sort_key = SORT_TOTAL;
+
+static void usage(void)
+{
+	fprintf(stderr,
+		"usage: mswprof [options]\n"
+		"  -e             enable mode switch profiling\n"
+		"  -d             disable mode switch profiling\n"
+		"  -r             clear the collected data\n"
+		"  -n <count>     show the <count> top offenders (default 10, 0 for all)\n"
+		"  -s <key>       sort by count, total (default) or max\n"
+		"  -p <pid>       only show thread <pid>\n"
+		"  -a             merge identical call sites of all threads\n");
+}
+
+static void control(int cmd)
+{
+	FILE *fp;
+
+	fp = fopen(PROC_MSWPROF, "w");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", PROC_MSWPROF);
+
+	if (fprintf(fp, "%d\n", cmd) < 0 || fclose(fp))
+		error(1, errno, "cannot write to %s", PROC_MSWPROF);
+}
+
+static struct site *lookup(const struct site *key, int merge)
+{
+	struct site *s;
+	int n;
+
+	for (n = 0; n < nrsites; n++) {
+		s = &sites[n];
+		if (s->hash == key->hash &&
+		    strcmp(s->event, key->event) == 0 &&
+		    strcmp(s->trigger, key->trigger) == 0 &&
+		    (merge || s->pid == key->pid))
+			return s;
+	}
+
+	if (nrsites == maxsites) {
+		maxsites = maxsites ? maxsites * 2 : 64;
+		sites = realloc(sites, maxsites * sizeof(*sites));
+		if (sites == NULL)
+			error(1, ENOMEM, "cannot collect profile");
+	}
+
+	s = &sites[nrsites++];
+	*s = *key;
+	s->count = 0;
+	s->total = 0;
+	s->max = 0;
+	if (merge) {
+		s->pid = 0;
+		strcpy(s->name, "*");
+	}
+
+	return s;
+}
+
+static int compare(const void *a, const void *b)
+{
+	const struct site *sa = a, *sb = b;
+	unsigned long long va, vb;
+
+	switch (sort_key) {
+	case SORT_COUNT:
+		va = sa->count;
+		vb = sb->count;
+		break;
+	case SORT_MAX:
+		va = sa->max;
+		vb = sb->max;
+		break;
+	default:
+		va = sa->total;
+		vb = sb->total;
+	}
+
+	return va < vb ? 1 : va > vb ? -1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+	int c, n, top = 10, pid = -1, merge = 0;
+	char buf[BUFSIZ];
+	struct site key, *s;
+	FILE *fp;
+
+	while ((c = getopt(argc, argv, "edrn:s:p:ah")) != EOF) {
+		switch (c) {
+		case 'e':
+			control(1);
+			return 0;
+		case 'd':
+			control(0);
+			return 0;
+		case 'r':
+			control(2);
+			return 0;
+		case 'n':
+			top = atoi(optarg);
+			break;
+		case 's':
+			if (strcmp(optarg, "count") == 0)
+				sort_key = SORT_COUNT;
+			else if (strcmp(optarg, "total") == 0)
+				sort_key = SORT_TOTAL;
+			else if (strcmp(optarg, "max") == 0)
+				sort_key = SORT_MAX;
+			else {
+				usage();
+				return 2;
+			}
+			break;
+		case 'p':
+			pid = atoi(optarg);
+			break;
+		case 'a':
+			merge = 1;
+			break;
+		default:
+			usage();
+			return c == 'h' ? 0 : 2;
+		}
+	}
+
+	fp = fopen(PROC_MSWPROF, "r");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", PROC_MSWPROF);
+
+	/* Skip the header. */
+	if (fgets(buf, sizeof(buf), fp) == NULL)
+		return 0;
+
+	while (fgets(buf, sizeof(buf), fp) != NULL) {
+		if (sscanf(buf, MSWPROF_FMT, &key.pid, key.event, key.trigger,
+			   &key.hash, &key.count, &key.total, &key.max,
+			   key.name) != MSWPROF_NFMT)
+			continue;
+		if (pid >= 0 && key.pid != pid)
+			continue;
+		s = lookup(&key, merge);
+		s->count += key.count;
+		s->total += key.total;
+		if (key.max > s->max)
+			s->max = key.max;
+	}
+
+	fclose(fp);
+
+	qsort(sites, nrsites, sizeof(*sites), compare);
+
+	printf("%-6s %-8s %-16s %-8s %-10s %-12s %-10s %-10s %s\n",
+	       "PID", "EVENT", "TRIGGER", "HASH", "COUNT", "SECONDARY(us)",
+	       "AVG(us)", "MAX(us)", "THREAD");
+
+	for (n = 0; n < nrsites && (top == 0 || n < top); n++) {
+		s = &sites[n];
+		/* Hardening hits carry no time, show them as such. */
+		if (strcmp(s->event, "harden") == 0 ||
+		    strcmp(s->event, "lost") == 0)
+			printf("%-6d %-8s %-16s %.8x %-10lu %-12s  %-10s %-10s %s\n",
+			       s->pid, s->event, s->trigger, s->hash,
+			       s->count, "-", "-", "-", s->name);
+		else
+			printf("%-6d %-8s %-16s %.8x %-10lu %-12Lu  %-10Lu %-10Lu %s\n",
+			       s->pid, s->event, s->trigger, s->hash,
+			       s->count, s->total / 1000,
+			       s->count ? s->total / s->count / 1000 : 0,
+			       s->max / 1000, s->name);
+	}
+
+	return 0;
+}